@@ -0,0 +1,96 @@
+// BasicWSC against the WSC façade over the same loopback transport: static handler calls,
+// no WSCMessage per received message and no thread hand-off. Compare with LoopbackReceive128
+// and LoopbackPipelined128 in bench/loopback.cpp.
+#include <stdexcept>
+#include <string>
+
+#include "basic.h"
+#include "bench.h"
+#include "loopback.h"
+
+namespace {
+    struct CountingHandler {
+        uint64_t received = 0;
+        uint64_t bytes = 0;
+        void onMessage(const WSCMessageView &message) {
+            received++;
+            bytes += message.size;
+        }
+    };
+
+    template <typename QueuePolicy>
+    using LoopbackClient = BasicWSC<WSCTransport, QueuePolicy, CountingHandler>;
+
+    template <typename QueuePolicy>
+    void connect(LoopbackClient<QueuePolicy> &client) {
+        const Poco::Timespan timeout(5, 0);
+        client.connect("/", WSCTransport::Options{"loopback", 80, false, timeout, timeout,
+                                                  timeout, 16 * 1024 * 1024, 64 * 1024,
+                                                  64 * 1024, 64 * 1024, {}, nullptr,
+                                                  nullptr});
+    }
+
+    void pollUntil(LoopbackClient<WSCRingQueuePolicy> &client, const CountingHandler &handler,
+                   uint64_t received) {
+        while (handler.received < received) {
+            if (client.poll(Poco::Timespan(1, 0)) < 0) throw std::runtime_error(client.error());
+        }
+    }
+
+    // Server initiated frames, polled on the sending thread every 64 frames
+    void receive(WSCBench::State &state, size_t size) {
+        WSCLoopback::Config config;
+        config.mode = WSCLoopback::Mode::SINK;
+        WSCLoopback loopback(config);
+        CountingHandler handler;
+        LoopbackClient<WSCRingQueuePolicy> client(loopback.transportFactory()(), handler);
+        connect(client);
+        const std::string message(size, 'x');
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            loopback.send(message.data(), message.size(),
+                          WSCMessageType::FIN | WSCMessageType::TEXT);
+            if ((i & 63) == 63) pollUntil(client, handler, i + 1);
+        }
+        pollUntil(client, handler, state.iterations);
+        state.setBytes(size);
+    }
+
+    // Queued, flushed in batches of 64 and echoed back
+    void pipelined(WSCBench::State &state, size_t size) {
+        WSCLoopback loopback;
+        CountingHandler handler;
+        LoopbackClient<WSCRingQueuePolicy> client(loopback.transportFactory()(), handler);
+        connect(client);
+        const std::string message(size, 'x');
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            client.sendText(message);
+            if ((i & 63) == 63) {
+                client.flush();
+                pollUntil(client, handler, i + 1);
+            }
+        }
+        client.flush();
+        pollUntil(client, handler, state.iterations);
+        state.setBytes(size);
+    }
+
+    template <typename QueuePolicy>
+    void queue(WSCBench::State &state, size_t size) {
+        QueuePolicy policy;
+        const std::string message(size, 'x');
+        size_t bytes = 0;
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            policy.push(WSCMessageType::FIN | WSCMessageType::TEXT, message.data(), size);
+            policy.drain([&](int, const void *, size_t length) { bytes += length; });
+        }
+        WSCBench::doNotOptimize(bytes);
+    }
+}  // namespace
+
+WSC_BENCHMARK(BasicLoopbackReceive128) { receive(state, 128); }
+
+WSC_BENCHMARK(BasicLoopbackPipelined128) { pipelined(state, 128); }
+
+WSC_BENCHMARK(BasicQueueLocked128) { queue<WSCLockedQueuePolicy>(state, 128); }
+
+WSC_BENCHMARK(BasicQueueRing128) { queue<WSCRingQueuePolicy>(state, 128); }
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Small self-contained microbenchmark harness for WSCppBench.
+//
+//   WSC_BENCHMARK(QueuePushPop) {
+//       WSCQueue<int> queue;
+//       for (uint64_t i = 0; i < state.iterations; i++) { ... }
+//       state.setBytes(...);  // optional, per iteration
+//   }
+//
+// The runner picks the iteration count so a run lasts at least --min-time and reports the
+// median of --repetitions runs.
+namespace WSCBench {
+    struct State {
+        uint64_t iterations = 1;
+        uint64_t bytesPerIteration = 0;
+        int threads = 1;  // for benchmarks registered with several thread counts
+
+        void setBytes(uint64_t bytes) noexcept { bytesPerIteration = bytes; }
+
+        // Time spent in setup that must not count, e.g. starting threads
+        void pauseTiming() noexcept { m_pausedAt = std::chrono::steady_clock::now(); }
+        void resumeTiming() noexcept {
+            m_paused += std::chrono::steady_clock::now() - m_pausedAt;
+        }
+
+        std::chrono::steady_clock::duration paused() const noexcept { return m_paused; }
+
+       private:
+        std::chrono::steady_clock::time_point m_pausedAt;
+        std::chrono::steady_clock::duration m_paused{0};
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::function<void(State &)> function;
+        int threads;
+    };
+
+    inline std::vector<Benchmark> &registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar {
+        Registrar(const char *name, void (*function)(State &), std::vector<int> threads = {1}) {
+            for (int count : threads) {
+                registry().push_back(
+                    {threads.size() > 1 ? std::string(name) + "/threads:" + std::to_string(count)
+                                        : std::string(name),
+                     function, count});
+            }
+        }
+    };
+
+    // Keeps the compiler from optimizing away a computed value
+    template <typename T>
+    inline void doNotOptimize(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+}  // namespace WSCBench
+
+#define WSC_BENCH_CONCAT_INNER(a, b) a##b
+#define WSC_BENCH_CONCAT(a, b) WSC_BENCH_CONCAT_INNER(a, b)
+
+#define WSC_BENCHMARK(name) WSC_BENCHMARK_THREADS(name, {1})
+
+// Registers one benchmark per thread count, the count is passed in state.threads
+#define WSC_BENCHMARK_THREADS(name, ...)                                                     \
+    static void name(WSCBench::State &state);                                                \
+    static const WSCBench::Registrar WSC_BENCH_CONCAT(wscBenchRegistrar, __LINE__)(         \
+        #name, name, __VA_ARGS__);                                                           \
+    static void name(WSCBench::State &state)
@@ -0,0 +1,63 @@
+// WSCCapture: the cost a capture adds to every frame sent and received
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/Process.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "WSCMessage.h"
+#include "bench.h"
+#include "capture.h"
+
+namespace {
+    // Small captures that are replaced when full, a long run must not fill the disk
+    class CaptureFile {
+       public:
+        CaptureFile()
+            : m_path(Poco::Path::temp() + "WSCppBench-" + std::to_string(Poco::Process::id()) +
+                     ".cap") {
+            open();
+        }
+        ~CaptureFile() {
+            m_capture.reset();
+            Poco::File(m_path).remove();
+        }
+
+        void append(WSCBench::State &state, const std::vector<char> &payload) {
+            if (m_capture->append(WSCCapture::Direction::SENT, 1, WSCMessageType::TEXT,
+                                  payload.data(), payload.size())) {
+                return;
+            }
+            state.pauseTiming();
+            open();
+            state.resumeTiming();
+        }
+
+       private:
+        void open() {
+            m_capture.reset();
+            WSCCapture::Config config;
+            config.capacity = 64 * 1024 * 1024;  // 64MB
+            m_capture = std::make_unique<WSCCapture>(m_path, config);
+        }
+
+        std::string m_path;
+        std::unique_ptr<WSCCapture> m_capture;
+    };
+
+    void appendLoop(WSCBench::State &state, size_t size) {
+        CaptureFile file;
+        const std::vector<char> payload(size, 'x');
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            file.append(state, payload);
+        }
+        state.setBytes(size);
+    }
+}  // namespace
+
+WSC_BENCHMARK(CaptureAppend128) { appendLoop(state, 128); }
+
+WSC_BENCHMARK(CaptureAppend4K) { appendLoop(state, 4096); }
+
@@ -0,0 +1,46 @@
+// WSCDispatcher: the strand hand-off from a receive thread to the worker pool
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "dispatcher.h"
+
+namespace {
+    WSCDispatcher::Config dispatcherConfig(int threads) {
+        WSCDispatcher::Config config;
+        config.threads = threads;
+        return config;
+    }
+}  // namespace
+
+// state.threads receive threads, one strand each, post 128 byte messages to a pool of as
+// many workers with an empty handler. Reported time is per message, delivery included.
+WSC_BENCHMARK_THREADS(DispatchStrand, {1, 2, 4}) {
+    state.pauseTiming();
+    WSCDispatcher dispatcher(dispatcherConfig(state.threads));
+    std::atomic<uint64_t> delivered{0};
+    std::vector<std::shared_ptr<WSCDispatcher::Strand>> strands;
+    for (int t = 0; t < state.threads; t++) {
+        strands.push_back(dispatcher.makeStrand(1024, [&](const WSCMessage &, bool) {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+        }));
+    }
+    const WSCMessage message{WSCMessageType::TEXT, std::vector<uint8_t>(128, 'x')};
+    const uint64_t perStrand = std::max<uint64_t>(1, state.iterations / state.threads);
+    state.resumeTiming();
+
+    std::vector<std::thread> receivers;
+    for (int t = 0; t < state.threads; t++) {
+        receivers.emplace_back([&, t] {
+            for (uint64_t i = 0; i < perStrand; i++) {
+                WSCMessage copy = message;
+                strands[t]->post(std::move(copy), false);
+            }
+            strands[t]->flush();
+        });
+    }
+    for (auto &receiver : receivers) receiver.join();
+    WSCBench::doNotOptimize(delivered);
+}
@@ -0,0 +1,273 @@
+// WSC frame paths through the public interface: batches of frames read ahead from a socket
+// and delivered to the batch callback, sendBinary() through the send thread, chunked or in
+// one frame, and the read-ahead parser on its own. The single frame receive path over the
+// loopback transport is in bench/loopback.cpp.
+#include <Poco/Base64Encoder.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/SHA1Engine.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "WSCFrameReader.h"
+#include "bench.h"
+#include "ws.h"
+
+namespace {
+    class SinkHandler : public Poco::Net::HTTPRequestHandler {
+       public:
+        void handleRequest(Poco::Net::HTTPServerRequest &request,
+                           Poco::Net::HTTPServerResponse &response) override {
+            try {
+                WebSocket socket(request, response);
+                Poco::Buffer<char> buffer(0);
+                int flags = 0;
+                int n;
+                do {
+                    buffer.resize(0);
+                    n = socket.receiveFrame(buffer, flags);
+                } while (n > 0 && (flags & WebSocket::FRAME_OP_BITMASK) !=
+                                      WebSocket::FRAME_OP_CLOSE);
+            } catch (const Poco::Exception &) {
+                // client went away
+            }
+        }
+    };
+
+    class SinkFactory : public Poco::Net::HTTPRequestHandlerFactory {
+       public:
+        Poco::Net::HTTPRequestHandler *createRequestHandler(
+            const Poco::Net::HTTPServerRequest &) override {
+            return new SinkHandler;
+        }
+    };
+
+    void waitConnected(WSC &wsc) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!wsc.isConnected()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("Benchmark server connection timed out");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // A WSC connected to a local sink server for the duration of one benchmark run
+    class SinkConnection {
+       public:
+        explicit SinkConnection(int sendChunkSize)
+            : m_socket(Poco::Net::SocketAddress("127.0.0.1", 0)),
+              m_server(new SinkFactory, m_socket, new Poco::Net::HTTPServerParams) {
+            m_server.start();
+            WSC::Config config;
+            config.sendChunkSize = sendChunkSize;
+            config.autoPing = false;
+            m_wsc = std::make_unique<WSC>(
+                "ws://127.0.0.1:" + std::to_string(m_socket.address().port()) + "/sink",
+                config);
+            m_wsc->connect();
+            waitConnected(*m_wsc);
+        }
+
+        ~SinkConnection() {
+            m_wsc.reset();
+            m_server.stopAll(true);
+        }
+
+        WSC &wsc() { return *m_wsc; }
+
+        // Until the send thread has written `count` messages
+        void waitSent(uint64_t count) const {
+            while (m_wsc->getStatistics().messagesSent < count) std::this_thread::yield();
+        }
+
+       private:
+        Poco::Net::ServerSocket m_socket;
+        Poco::Net::HTTPServer m_server;
+        std::unique_ptr<WSC> m_wsc;
+    };
+
+    // Answers one handshake, then writes the same run of encoded frames over and over until
+    // stopped, one write per run so the server costs little next to the client
+    class FloodServer {
+       public:
+        explicit FloodServer(std::string frames)
+            : m_socket(Poco::Net::SocketAddress("127.0.0.1", 0)),
+              m_frames(std::move(frames)),
+              m_thread([this] { run(); }) {}
+
+        ~FloodServer() {
+            m_running = false;
+            m_thread.join();
+        }
+
+        uint16_t port() const { return m_socket.address().port(); }
+
+       private:
+        static std::string acceptKey(const std::string &key) {
+            Poco::SHA1Engine sha1;
+            sha1.update(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+            const auto digest = sha1.digest();
+            std::ostringstream out;
+            Poco::Base64Encoder base64(out);
+            base64.write(reinterpret_cast<const char *>(digest.data()),
+                         static_cast<std::streamsize>(digest.size()));
+            base64.close();
+            return out.str();
+        }
+
+        static bool sendAll(Poco::Net::StreamSocket &socket, const std::string &bytes) {
+            size_t sent = 0;
+            while (sent < bytes.size()) {
+                const int n = socket.sendBytes(bytes.data() + sent,
+                                               static_cast<int>(bytes.size() - sent));
+                if (n <= 0) return false;
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        void run() {
+            try {
+                Poco::Net::StreamSocket peer = m_socket.acceptConnection();
+                std::string request;
+                char buffer[4096];
+                while (request.find("\r\n\r\n") == std::string::npos) {
+                    const int n = peer.receiveBytes(buffer, sizeof(buffer));
+                    if (n <= 0) return;
+                    request.append(buffer, static_cast<size_t>(n));
+                }
+                const std::string name = "Sec-WebSocket-Key: ";
+                const size_t begin = request.find(name) + name.size();
+                const std::string key = request.substr(begin, request.find("\r\n", begin) - begin);
+                if (!sendAll(peer, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                                   "Connection: Upgrade\r\nSec-WebSocket-Accept: " +
+                                       acceptKey(key) + "\r\n\r\n")) {
+                    return;
+                }
+                while (m_running && sendAll(peer, m_frames)) {
+                }
+            } catch (const Poco::Exception &) {
+                // client went away
+            }
+        }
+
+        Poco::Net::ServerSocket m_socket;
+        std::string m_frames;
+        std::atomic<bool> m_running{true};
+        std::thread m_thread;
+    };
+
+    // `batch` TEXT frames of `size` bytes per server write; the read-ahead buffer hands them
+    // to setDataBatchCallback() as views, time per message
+    void receiveBatch(WSCBench::State &state, size_t batch, size_t size) {
+        state.pauseTiming();
+        std::string frames;
+        for (size_t i = 0; i < batch; i++) {
+            frames += static_cast<char>(WSCMessageType::FIN | WSCMessageType::TEXT);
+            if (size < 126) {
+                frames += static_cast<char>(size);
+            } else {
+                frames += static_cast<char>(126);
+                frames += static_cast<char>(size >> 8);
+                frames += static_cast<char>(size);
+            }
+            frames.append(size, 'x');
+        }
+        auto server = std::make_unique<FloodServer>(std::move(frames));
+        WSC::Config config;
+        config.autoPing = false;
+        auto wsc = std::make_unique<WSC>(
+            "ws://127.0.0.1:" + std::to_string(server->port()) + "/flood", config);
+        std::atomic<uint64_t> delivered{0};
+        wsc->setDataBatchCallback([&](std::span<const WSCMessageView> messages) {
+            delivered.fetch_add(messages.size(), std::memory_order_release);
+        });
+        wsc->connect();
+        waitConnected(*wsc);
+        const uint64_t start = delivered.load(std::memory_order_acquire);
+        state.resumeTiming();
+        while (delivered.load(std::memory_order_acquire) - start < state.iterations) {
+            std::this_thread::yield();  // the receive and server threads may share the core
+        }
+        state.pauseTiming();
+        server.reset();
+        wsc.reset();
+        state.resumeTiming();
+        state.setBytes(size);
+    }
+
+    void send(WSCBench::State &state, int sendChunkSize, size_t size) {
+        // connection setup and teardown (close handshake, thread joins) are not measured
+        state.pauseTiming();
+        auto connection = std::make_unique<SinkConnection>(sendChunkSize);
+        const std::vector<uint8_t> payload(size, 'x');
+        state.resumeTiming();
+        for (uint64_t i = 0; i < state.iterations; i++) connection->wsc().sendBinary(payload);
+        connection->waitSent(state.iterations);
+        state.pauseTiming();
+        connection.reset();
+        state.resumeTiming();
+        state.setBytes(size);
+    }
+
+    // Unmasked server frames of `size` bytes handed to the reader by 64KB "recv" calls
+    void readAhead(WSCBench::State &state, size_t size) {
+        std::vector<char> stream;
+        while (stream.size() < 256 * 1024) {
+            stream.push_back(static_cast<char>(WSCMessageType::FIN | WSCMessageType::TEXT));
+            if (size < 126) {
+                stream.push_back(static_cast<char>(size));
+            } else {
+                stream.push_back(126);
+                stream.push_back(static_cast<char>(size >> 8));
+                stream.push_back(static_cast<char>(size));
+            }
+            stream.insert(stream.end(), size, 'x');
+        }
+        size_t position = 0;
+        auto read = [&](char *out, size_t length) {
+            length = std::min(length, stream.size() - position);
+            std::memcpy(out, stream.data() + position, length);
+            position = (position + length) % stream.size();
+            return static_cast<int>(length);
+        };
+        WSCFrameReader reader(64 * 1024, 16 * 1024 * 1024);
+        WSCFrameReader::Frame frame;
+        uint64_t bytes = 0;
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            while (reader.next(frame) != WSCFrameReader::Parse::FRAME) reader.fill(read);
+            bytes += frame.length;
+        }
+        WSCBench::doNotOptimize(bytes);
+        state.setBytes(size);
+    }
+}  // namespace
+
+// 64 messages per server write, as from a busy feed
+WSC_BENCHMARK(ReceiveBatch128) { receiveBatch(state, 64, 128); }
+
+// 64KB in 16 frames of the default 4KB sendChunkSize
+WSC_BENCHMARK(SendChunked64K) { send(state, 4096, 64 * 1024); }
+
+// the same payload in one frame
+WSC_BENCHMARK(SendSingle64K) { send(state, 64 * 1024, 64 * 1024); }
+
+// small messages queued back to back go out in batches
+WSC_BENCHMARK(SendSmall128) { send(state, 4096, 128); }
+
+// WSCPocoTransport receive parsing, one frame per iteration: about 650 frames per fill()
+WSC_BENCHMARK(ReadAheadParse100) { readAhead(state, 100); }
+
+WSC_BENCHMARK(ReadAheadParse4K) { readAhead(state, 4096); }
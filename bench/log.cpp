@@ -0,0 +1,47 @@
+// WSCLog call cost in each logger mode. The async and binary runs measure the calling
+// thread only: messages that do not fit in the ring are dropped, not waited for.
+#include "WSCLogger.h"
+#include "bench.h"
+
+namespace {
+    enum class Mode { SYNC, ASYNC, BINARY };
+
+    // Logs with console output off, restores the quiet default logger afterwards
+    void logLoop(WSCBench::State &state, Mode mode) {
+        state.pauseTiming();
+        switch (mode) {
+            case Mode::SYNC:
+                WSCLogger::init("WSCppBench", "WSCppBench.txt", spdlog::level::info);
+                break;
+            case Mode::ASYNC:
+                WSCLogger::initAsync("WSCppBench", "WSCppBench.txt", spdlog::level::info);
+                break;
+            case Mode::BINARY:
+                WSCLogger::initBinary("WSCppBench", "WSCppBench.wscb", spdlog::level::info);
+                break;
+        }
+        WSCLogger::setConsoleLogLevel(spdlog::level::off);
+        const std::string peer = "127.0.0.1:9000";
+        state.resumeTiming();
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            WSCLog(info, "Frame {} from {} length {} rtt {:.3f}ms", i, peer, 4096, 0.25);
+        }
+        state.pauseTiming();
+        WSCLogger::init("WSCppBench", "WSCppBench.txt", spdlog::level::warn);
+        WSCLogger::setConsoleLogLevel(spdlog::level::off);
+        state.resumeTiming();
+    }
+}  // namespace
+
+// below the runtime level, the cost every disabled debug message pays
+WSC_BENCHMARK(LogFilteredOut) {
+    for (uint64_t i = 0; i < state.iterations; i++) {
+        WSCLog(debug, "Processing frame: Flags={} Length={}", 0x81, i);
+    }
+}
+
+WSC_BENCHMARK(LogSync) { logLoop(state, Mode::SYNC); }
+
+WSC_BENCHMARK(LogAsync) { logLoop(state, Mode::ASYNC); }
+
+WSC_BENCHMARK(LogBinary) { logLoop(state, Mode::BINARY); }
@@ -0,0 +1,134 @@
+// Whole client paths over the in-process loopback transport: send queue, send thread,
+// frame codec, receive thread and callbacks, without the kernel TCP stack.
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "bench.h"
+#include "loopback.h"
+#include "ws.h"
+
+namespace {
+    class LoopbackClient {
+       public:
+        explicit LoopbackClient(WSCLoopback::Mode mode) : m_loopback(loopbackConfig(mode)) {
+            WSC::Config config;
+            config.transportFactory = m_loopback.transportFactory();
+            config.autoPing = false;
+            config.receiveTimeout = Poco::Timespan(0, 100 * 1000);  // bounds the teardown
+            m_wsc = std::make_unique<WSC>("ws://loopback/", config);
+            m_wsc->setDataMessageCallback([this](const WSCMessage &message) {
+                m_bytes.fetch_add(message.payload.size(), std::memory_order_relaxed);
+                m_received.fetch_add(1, std::memory_order_release);
+            });
+            m_wsc->setControlMessageCallback([this](const WSCMessage &message) {
+                if (message.type == WSCMessageType::RECEIVED) {
+                    m_received.fetch_add(1, std::memory_order_release);
+                }
+            });
+            m_wsc->connect();
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!m_wsc->isConnected()) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    throw std::runtime_error("Loopback connection timed out");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        ~LoopbackClient() {
+            m_wsc->disconnect();
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (m_wsc->isConnected() && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        WSC &wsc() { return *m_wsc; }
+        WSCLoopback &loopback() { return m_loopback; }
+
+        void waitFor(uint64_t received) const {
+            while (m_received.load(std::memory_order_acquire) < received) {
+            }
+        }
+
+       private:
+        static WSCLoopback::Config loopbackConfig(WSCLoopback::Mode mode) {
+            WSCLoopback::Config config;
+            config.mode = mode;
+            return config;
+        }
+
+        WSCLoopback m_loopback;
+        std::unique_ptr<WSC> m_wsc;
+        std::atomic<uint64_t> m_received{0};
+        std::atomic<uint64_t> m_bytes{0};
+    };
+
+    // One message in flight: the latency of the whole path
+    void roundTrip(WSCBench::State &state, size_t size) {
+        state.pauseTiming();
+        auto client = std::make_unique<LoopbackClient>(WSCLoopback::Mode::ECHO);
+        std::string message(size, 'x');
+        state.resumeTiming();
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            client->wsc().sendText(message);
+            client->waitFor(i + 1);
+        }
+        state.pauseTiming();
+        client.reset();
+        state.resumeTiming();
+        state.setBytes(size);
+    }
+
+    // All messages queued at once: the throughput of the whole path
+    void pipelined(WSCBench::State &state, size_t size) {
+        state.pauseTiming();
+        auto client = std::make_unique<LoopbackClient>(WSCLoopback::Mode::ECHO);
+        std::string message(size, 'x');
+        state.resumeTiming();
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            client->wsc().sendText(message);
+        }
+        client->waitFor(state.iterations);
+        state.pauseTiming();
+        client.reset();
+        state.resumeTiming();
+        state.setBytes(size);
+    }
+
+    // Server initiated frames: the receive path alone
+    void receive(WSCBench::State &state, int flags, size_t size) {
+        state.pauseTiming();
+        auto client = std::make_unique<LoopbackClient>(WSCLoopback::Mode::SINK);
+        const std::string message(size, 'x');
+        state.resumeTiming();
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            client->loopback().send(message.data(), message.size(), flags);
+        }
+        client->waitFor(state.iterations);
+        state.pauseTiming();
+        client.reset();
+        state.resumeTiming();
+        state.setBytes(size);
+    }
+}  // namespace
+
+WSC_BENCHMARK(LoopbackRoundTrip128) { roundTrip(state, 128); }
+
+WSC_BENCHMARK(LoopbackPipelined128) { pipelined(state, 128); }
+
+WSC_BENCHMARK(LoopbackPipelined4K) { pipelined(state, 4096); }
+
+constexpr int kText = WSCMessageType::FIN | WSCMessageType::TEXT;
+
+WSC_BENCHMARK(LoopbackReceive128) { receive(state, kText, 128); }
+
+WSC_BENCHMARK(LoopbackReceive4K) { receive(state, kText, 4096); }
+
+WSC_BENCHMARK(LoopbackReceive16K) { receive(state, kText, 16 * 1024); }
+
+// every PING is answered with a PONG, which the server drops
+WSC_BENCHMARK(LoopbackReceivePing) {
+    receive(state, WSCMessageType::FIN | WSCMessageType::PING, 16);
+}
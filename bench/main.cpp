@@ -0,0 +1,202 @@
+// WSCppBench: microbenchmarks for the WebSocket hot paths.
+//
+//   WSCppBench [--filter TEXT] [--min-time S] [--repetitions N] [--json FILE]
+//              [--baseline FILE | --no-baseline] [--threshold PERCENT]
+//
+// Every result is compared with the run of the same name in the baseline, bench/baseline.json
+// unless --baseline names another file; the exit code is 2 when one of them is slower by more
+// than --threshold percent. A baseline is just the --json output of an earlier run: refresh
+// the stored one with --json bench/baseline.json on the reference machine when a change
+// makes a benchmark faster on purpose.
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "WSCLogger.h"
+#include "bench.h"
+
+namespace {
+    struct Options {
+        std::string filter;
+        double minTime = 0.2;  // seconds per repetition
+        int repetitions = 5;
+        std::string json;
+        std::string baseline = WSC_BENCH_BASELINE;  // empty with --no-baseline
+        double threshold = 10.0;  // percent
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        double nsPerOp;  // median over the repetitions
+        double minNsPerOp;
+        double bytesPerSecond;
+    };
+
+    // Nanoseconds per iteration of one run
+    double runOnce(const WSCBench::Benchmark &benchmark, uint64_t iterations,
+                   uint64_t &bytesPerIteration) {
+        WSCBench::State state;
+        state.iterations = iterations;
+        state.threads = benchmark.threads;
+        const auto start = std::chrono::steady_clock::now();
+        benchmark.function(state);
+        const auto elapsed = std::chrono::steady_clock::now() - start - state.paused();
+        bytesPerIteration = state.bytesPerIteration;
+        return std::chrono::duration<double, std::nano>(elapsed).count() /
+               static_cast<double>(iterations);
+    }
+
+    Result run(const WSCBench::Benchmark &benchmark, const Options &options) {
+        // grow the iteration count until one run takes a measurable fraction of min-time
+        uint64_t iterations = 1;
+        uint64_t bytes = 0;
+        double ns = runOnce(benchmark, iterations, bytes);
+        while (ns * static_cast<double>(iterations) < options.minTime * 1e9 / 10 &&
+               iterations < (uint64_t{1} << 40)) {
+            iterations *= 10;
+            ns = runOnce(benchmark, iterations, bytes);
+        }
+        iterations = std::max<uint64_t>(
+            1, static_cast<uint64_t>(options.minTime * 1e9 / std::max(ns, 1e-3)));
+
+        std::vector<double> samples;
+        for (int i = 0; i < options.repetitions; i++) {
+            samples.push_back(runOnce(benchmark, iterations, bytes));
+        }
+        std::sort(samples.begin(), samples.end());
+        const double median = samples[samples.size() / 2];
+        return Result{benchmark.name, iterations, median, samples.front(),
+                      bytes ? static_cast<double>(bytes) * 1e9 / median : 0.0};
+    }
+
+    std::string toJson(const std::vector<Result> &results) {
+        std::ostringstream out;
+        out.precision(3);
+        out << std::fixed << "{\"benchmarks\":[\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            out << "{\"name\":\"" << r.name << "\",\"iterations\":" << r.iterations
+                << ",\"nsPerOp\":" << r.nsPerOp << ",\"minNsPerOp\":" << r.minNsPerOp
+                << ",\"bytesPerSecond\":" << r.bytesPerSecond << '}'
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+        return out.str();
+    }
+
+    // Reads the nsPerOp of every benchmark from an earlier --json output
+    std::map<std::string, double> loadBaseline(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) throw std::runtime_error("Cannot read baseline " + path);
+        const std::regex entry(R"re("name":"([^"]+)".*"nsPerOp":([0-9.eE+-]+))re");
+        std::map<std::string, double> baseline;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::smatch match;
+            if (std::regex_search(line, match, entry)) {
+                baseline[match[1]] = std::stod(match[2]);
+            }
+        }
+        return baseline;
+    }
+
+    std::string formatBytes(double bytesPerSecond) {
+        if (bytesPerSecond <= 0) return "";
+        char text[32];
+        std::snprintf(text, sizeof(text), "%10.1f MB/s", bytesPerSecond / 1e6);
+        return text;
+    }
+
+    Options parseOptions(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--filter") {
+                options.filter = value();
+            } else if (arg == "--min-time") {
+                options.minTime = std::stod(value());
+            } else if (arg == "--repetitions") {
+                options.repetitions = std::max(1, std::stoi(value()));
+            } else if (arg == "--json") {
+                options.json = value();
+            } else if (arg == "--baseline") {
+                options.baseline = value();
+            } else if (arg == "--no-baseline") {
+                options.baseline.clear();
+            } else if (arg == "--threshold") {
+                options.threshold = std::stod(value());
+            } else {
+                throw std::invalid_argument("Unknown option " + arg);
+            }
+        }
+        return options;
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    std::map<std::string, double> baseline;
+    try {
+        options = parseOptions(argc, argv);
+        if (!options.baseline.empty()) baseline = loadBaseline(options.baseline);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // benchmarks below warn must not pay for log output
+    WSCLogger::init("WSCppBench", "WSCppBench.txt", spdlog::level::warn);
+    WSCLogger::setConsoleLogLevel(spdlog::level::off);
+
+    std::vector<Result> results;
+    bool regressed = false;
+    std::printf("%-44s %12s %12s %15s %10s\n", "benchmark", "ns/op", "iterations", "throughput",
+                baseline.empty() ? "" : "vs base");
+    for (const auto &benchmark : WSCBench::registry()) {
+        if (benchmark.name.find(options.filter) == std::string::npos) continue;
+        const Result result = run(benchmark, options);
+        results.push_back(result);
+
+        std::string comparison;
+        auto base = baseline.find(result.name);
+        if (base != baseline.end() && base->second > 0) {
+            const double change = (result.nsPerOp / base->second - 1.0) * 100.0;
+            char text[32];
+            std::snprintf(text, sizeof(text), "%+8.1f%%%s", change,
+                          change > options.threshold ? " !" : "");
+            comparison = text;
+            regressed |= change > options.threshold;
+        }
+        std::printf("%-44s %12.1f %12llu %15s %10s\n", result.name.c_str(), result.nsPerOp,
+                    static_cast<unsigned long long>(result.iterations),
+                    formatBytes(result.bytesPerSecond).c_str(), comparison.c_str());
+        std::fflush(stdout);
+    }
+
+    if (!options.json.empty()) {
+        std::ofstream file(options.json, std::ios::out | std::ios::trunc);
+        file << toJson(results);
+        if (!file) {
+            std::cerr << "Failed to write " << options.json << std::endl;
+            return 1;
+        }
+    }
+    WSCLogger::shutdown();
+    if (regressed) {
+        std::cerr << "Slower than the baseline by more than " << options.threshold << "%"
+                  << std::endl;
+        return 2;
+    }
+    return 0;
+}
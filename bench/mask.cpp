@@ -0,0 +1,45 @@
+// WSCMask and WSCFrame: masking of client frames, broadcast encoding
+#include <cstdint>
+#include <vector>
+
+#include "WSCFrame.h"
+#include "WSCMask.h"
+#include "WSCMessage.h"
+#include "bench.h"
+
+namespace {
+    const uint8_t kKey[4] = {0x12, 0x34, 0x56, 0x78};
+
+    // the loop Poco::Net::WebSocketImpl::sendBytes() runs for every client frame
+    void maskBytewise(char *out, const char *in, size_t length, const uint8_t key[4]) {
+        for (size_t i = 0; i < length; i++) out[i] = static_cast<char>(in[i] ^ key[i % 4]);
+    }
+
+    template <typename Mask>
+    void maskLoop(WSCBench::State &state, size_t size, Mask mask) {
+        const std::vector<char> in(size, 'x');
+        std::vector<char> out(size);
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            mask(out.data(), in.data(), size, kKey);
+            WSCBench::doNotOptimize(out);
+        }
+        state.setBytes(size);
+    }
+}  // namespace
+
+WSC_BENCHMARK(MaskBytewise128) { maskLoop(state, 128, maskBytewise); }
+WSC_BENCHMARK(Mask128) { maskLoop(state, 128, WSCMask::apply); }
+WSC_BENCHMARK(MaskBytewise16K) { maskLoop(state, 16384, maskBytewise); }
+WSC_BENCHMARK(Mask16K) { maskLoop(state, 16384, WSCMask::apply); }
+
+// per connection share of a broadcast: the masked copy of the shared frame
+WSC_BENCHMARK(FrameEncodeMasked1K) {
+    const std::vector<char> payload(1024, 'x');
+    const auto frame = WSCFrame::make(WSCMessageType::TEXT, payload.data(), payload.size());
+    std::vector<char> scratch(frame->maskedSize());
+    for (uint64_t i = 0; i < state.iterations; i++) {
+        frame->encodeMasked(scratch.data(), static_cast<uint32_t>(i));
+        WSCBench::doNotOptimize(scratch);
+    }
+    state.setBytes(payload.size());
+}
@@ -0,0 +1,38 @@
+// WSCMessage: built for every received frame and read back by the callbacks and the GUI
+#include <string>
+
+#include "WSCMessage.h"
+#include "bench.h"
+
+namespace {
+    void construct(WSCBench::State &state, size_t size) {
+        const std::vector<uint8_t> payload(size, 'x');
+        for (uint64_t i = 0; i < state.iterations; i++) {
+            WSCMessage message{WSCMessageType::TEXT,
+                               std::vector<uint8_t>(payload.begin(), payload.end())};
+            WSCBench::doNotOptimize(message);
+        }
+        state.setBytes(size);
+    }
+}  // namespace
+
+WSC_BENCHMARK(MessageConstruct128) { construct(state, 128); }
+
+WSC_BENCHMARK(MessageConstruct4K) { construct(state, 4096); }
+
+WSC_BENCHMARK(MessageGetPayload4K) {
+    const WSCMessage message{WSCMessageType::TEXT, std::vector<uint8_t>(4096, 'x')};
+    for (uint64_t i = 0; i < state.iterations; i++) {
+        std::string payload = message.getPayload();
+        WSCBench::doNotOptimize(payload);
+    }
+    state.setBytes(4096);
+}
+
+WSC_BENCHMARK(MessageFormattedTimestamp) {
+    const WSCMessage message{WSCMessageType::TEXT, {}};
+    for (uint64_t i = 0; i < state.iterations; i++) {
+        std::string timestamp = message.getFormattedTimestamp();
+        WSCBench::doNotOptimize(timestamp);
+    }
+}
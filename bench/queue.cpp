@@ -0,0 +1,55 @@
+// WSCQueue: the send and command queues of every connection
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "WSCMessage.h"
+#include "WSCQueue.h"
+#include "bench.h"
+
+WSC_BENCHMARK(QueuePushPop) {
+    WSCQueue<int> queue;
+    int value = 0;
+    for (uint64_t i = 0; i < state.iterations; i++) {
+        queue.push(static_cast<int>(i));
+        queue.try_pop(value);
+    }
+    WSCBench::doNotOptimize(value);
+}
+
+WSC_BENCHMARK(QueuePushPopMessage) {
+    WSCQueue<WSCMessage> queue;
+    WSCMessage message{WSCMessageType::TEXT, std::vector<uint8_t>(128, 'x')};
+    WSCMessage out;
+    for (uint64_t i = 0; i < state.iterations; i++) {
+        queue.push(message);
+        queue.try_pop(out);
+    }
+    WSCBench::doNotOptimize(out);
+}
+
+// state.threads producers against one consumer blocked in wait_and_pop, like sendText()
+// callers feeding the send thread. Reported time is per message.
+WSC_BENCHMARK_THREADS(QueueContended, {1, 2, 4}) {
+    WSCQueue<uint64_t> queue;
+    const uint64_t perProducer = std::max<uint64_t>(1, state.iterations / state.threads);
+    const uint64_t total = perProducer * state.threads;
+
+    std::thread consumer([&] {
+        uint64_t value = 0;
+        for (uint64_t i = 0; i < total; i++) {
+            queue.wait_and_pop(value);
+        }
+        WSCBench::doNotOptimize(value);
+    });
+    std::vector<std::thread> producers;
+    for (int t = 0; t < state.threads; t++) {
+        producers.emplace_back([&] {
+            for (uint64_t i = 0; i < perProducer; i++) {
+                queue.push(i);
+            }
+        });
+    }
+    for (auto &producer : producers) producer.join();
+    consumer.join();
+}
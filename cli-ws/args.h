@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Minimal "--key value" / "--key=value" / "--flag" command line parser shared by the modes.
+class Args {
+   public:
+    Args(int argc, char **argv, int first) {
+        for (int i = first; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                m_positional.push_back(arg);
+                continue;
+            }
+            arg = arg.substr(2);
+            const auto equals = arg.find('=');
+            if (equals != std::string::npos) {
+                m_values[arg.substr(0, equals)] = arg.substr(equals + 1);
+            } else if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) {
+                m_values[arg] = argv[++i];
+            } else {
+                m_values[arg] = "true";
+            }
+        }
+    }
+
+    bool has(const std::string &key) const {
+        m_used.insert(key);
+        return m_values.count(key) != 0;
+    }
+
+    template <typename T>
+    T get(const std::string &key, const T &fallback) const {
+        m_used.insert(key);
+        auto it = m_values.find(key);
+        if (it == m_values.end()) return fallback;
+        if constexpr (std::is_same_v<T, std::string>) {
+            return it->second;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return it->second == "true" || it->second == "1" || it->second == "yes";
+        } else {
+            std::istringstream in(it->second);
+            T value;
+            if (!(in >> value) || !in.eof()) {
+                throw std::invalid_argument("Invalid value for --" + key + ": " + it->second);
+            }
+            return value;
+        }
+    }
+
+    const std::vector<std::string> &positional() const { return m_positional; }
+
+    // Call after all options were read, typos should not silently fall back to defaults
+    void rejectUnknown() const {
+        for (const auto &[key, value] : m_values) {
+            if (!m_used.count(key)) throw std::invalid_argument("Unknown option --" + key);
+        }
+    }
+
+   private:
+    std::map<std::string, std::string> m_values;
+    std::vector<std::string> m_positional;
+    mutable std::set<std::string> m_used;
+};
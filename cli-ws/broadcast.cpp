@@ -0,0 +1,166 @@
+#include "broadcast.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "json.h"
+#include "stamp.h"
+
+namespace {
+    // VmRSS of this process in kB, 0 where /proc is not available
+    uint64_t readStatusKb(const std::string &field) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind(field + ":", 0) == 0) {
+                return std::strtoull(line.c_str() + field.size() + 1, nullptr, 10);
+            }
+        }
+        return 0;
+    }
+
+    const char *modeName(BroadcastBenchmark::Mode mode) {
+        return mode == BroadcastBenchmark::Mode::COPY ? "copy" : "shared";
+    }
+}  // namespace
+
+BroadcastBenchmark::BroadcastBenchmark(const Config &config) : m_config(config) {
+    if (m_config.connections < 1) throw std::invalid_argument("At least one connection needed");
+    if (m_config.rate <= 0) throw std::invalid_argument("The rate must be positive");
+}
+
+BroadcastBenchmark::~BroadcastBenchmark() {
+    m_manager.disconnectAll();
+    const auto closeEnd = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (m_manager.connectedCount() > 0 && std::chrono::steady_clock::now() < closeEnd) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+uint64_t BroadcastBenchmark::totalSent() {
+    uint64_t sent = 0;
+    for (size_t i = 0; i < m_manager.size(); i++) {
+        sent += m_manager[i].getStatistics().messagesSent;
+    }
+    return sent;
+}
+
+std::vector<BroadcastBenchmark::Result> BroadcastBenchmark::run() {
+    for (int i = 0; i < m_config.connections; i++) m_manager.add(m_config.url, m_config.client);
+    m_manager.connectAll();
+    const auto connectEnd = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (m_manager.connectedCount() < static_cast<size_t>(m_config.connections)) {
+        if (std::chrono::steady_clock::now() > connectEnd) {
+            throw std::runtime_error("Only " + std::to_string(m_manager.connectedCount()) +
+                                     " connections to " + m_config.url);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    std::vector<Result> results;
+    for (Mode mode : m_config.modes) results.push_back(runMode(mode));
+    return results;
+}
+
+BroadcastBenchmark::Result BroadcastBenchmark::runMode(Mode mode) {
+    Result result;
+    result.mode = mode;
+    result.connected = static_cast<int>(m_manager.connectedCount());
+    result.rssConnectedKb = readStatusKb("VmRSS");
+
+    std::atomic<bool> sampling{true};
+    std::atomic<uint64_t> peakRss{result.rssConnectedKb};
+    std::thread sampler([&] {
+        while (sampling.load()) {
+            const uint64_t rss = readStatusKb("VmRSS");
+            if (rss > peakRss.load()) peakRss.store(rss);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    std::string text(m_config.size, 'x');
+    std::vector<WSC *> connections;
+    for (size_t i = 0; i < m_manager.size(); i++) connections.push_back(&m_manager[i]);
+    const uint64_t sentBefore = totalSent();
+    const std::clock_t cpuStart = std::clock();
+    const int64_t startNs = Stamp::steadyNowNs();
+    const double intervalNs = 1e9 / m_config.rate;
+    for (int k = 0; k < m_config.broadcasts; k++) {
+        Stamp::waitUntil(startNs + static_cast<int64_t>(k * intervalNs));
+        if (mode == Mode::SHARED) {
+            result.messagesQueued += m_manager.broadcastText(text);
+        } else {
+            for (WSC *connection : connections) {
+                if (connection->sendText(text)) result.messagesQueued++;
+            }
+        }
+        result.broadcasts++;
+        const int perSecond = std::max(1, static_cast<int>(m_config.rate));
+        if (m_config.progress && (k + 1) % perSecond == 0) {
+            std::cerr << "[" << modeName(mode) << "] " << k + 1 << " broadcasts, rss "
+                      << readStatusKb("VmRSS") << " kB" << std::endl;
+        }
+    }
+
+    const auto drainEnd = std::chrono::steady_clock::now() + m_config.drain;
+    while (totalSent() - sentBefore < result.messagesQueued &&
+           std::chrono::steady_clock::now() < drainEnd) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const std::clock_t cpuEnd = std::clock();
+    result.seconds = (Stamp::steadyNowNs() - startNs) / 1e9;
+    result.messagesSent = totalSent() - sentBefore;
+    result.cpuUsPerBroadcast = result.broadcasts ? static_cast<double>(cpuEnd - cpuStart) *
+                                                       1e6 / CLOCKS_PER_SEC / result.broadcasts
+                                                 : 0;
+    sampling.store(false);
+    sampler.join();
+    result.peakRssKb = peakRss.load();
+    return result;
+}
+
+std::string BroadcastBenchmark::toJson(const Config &config, const std::vector<Result> &results) {
+    std::ostringstream out;
+    out.precision(3);
+    out << std::fixed << "{\"config\":{\"url\":" << Json::quote(config.url)
+        << ",\"connections\":" << config.connections << ",\"broadcasts\":" << config.broadcasts
+        << ",\"rate\":" << Json::number(config.rate) << ",\"size\":" << config.size
+        << "},\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        out << (i ? "," : "") << "{\"mode\":\"" << modeName(r.mode) << "\",\"connected\":"
+            << r.connected << ",\"broadcasts\":" << r.broadcasts
+            << ",\"messagesQueued\":" << r.messagesQueued << ",\"messagesSent\":" << r.messagesSent
+            << ",\"seconds\":" << Json::number(r.seconds)
+            << ",\"cpuUsPerBroadcast\":" << Json::number(r.cpuUsPerBroadcast)
+            << ",\"rssConnectedKb\":" << r.rssConnectedKb << ",\"peakRssKb\":" << r.peakRssKb
+            << '}';
+    }
+    out << "]}\n";
+    return out.str();
+}
+
+std::string BroadcastBenchmark::toText(const std::vector<Result> &results) {
+    std::string out = "mode      connected  broadcasts       sent  seconds  cpu us/broadcast  "
+                      "rss growth kB\n";
+    for (const Result &r : results) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-8s %10d %11llu %10llu %8.2f %17.1f %14lld\n",
+                      modeName(r.mode), r.connected,
+                      static_cast<unsigned long long>(r.broadcasts),
+                      static_cast<unsigned long long>(r.messagesSent), r.seconds,
+                      r.cpuUsPerBroadcast,
+                      static_cast<long long>(r.peakRssKb) -
+                          static_cast<long long>(r.rssConnectedKb));
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "manager.h"
+
+// Sends the same message to many connections, either as one shared pre-encoded frame
+// (WSCManager::broadcastText) or with a sendText() per connection, and reports what a
+// broadcast costs the process: CPU time and resident memory while the send queues drain.
+class BroadcastBenchmark {
+   public:
+    enum class Mode { COPY, SHARED };
+
+    struct Config {
+        std::string url;
+        int connections;
+        int broadcasts;  // per mode
+        double rate;     // broadcasts per second
+        size_t size;     // payload bytes
+        std::vector<Mode> modes;
+        std::chrono::milliseconds drain;  // limit for the send queues to empty
+        bool progress;
+        WSC::Config client;
+
+        Config()
+            : url("ws://127.0.0.1:9000/sink"),
+              connections(1000),
+              broadcasts(1000),
+              rate(100),
+              size(256),
+              modes{Mode::COPY, Mode::SHARED},
+              drain(30 * 1000),  // 30 seconds
+              progress(true) {}
+    };
+
+    struct Result {
+        Mode mode = Mode::SHARED;
+        int connected = 0;
+        uint64_t broadcasts = 0;
+        uint64_t messagesQueued = 0;
+        uint64_t messagesSent = 0;  // written by the send threads before the drain limit
+        double seconds = 0;         // first broadcast to drained
+        double cpuUsPerBroadcast = 0;  // the whole process, send threads included
+        uint64_t rssConnectedKb = 0;   // before the first broadcast
+        uint64_t peakRssKb = 0;        // sampled while broadcasting and draining
+    };
+
+    explicit BroadcastBenchmark(const Config &config);
+    ~BroadcastBenchmark();
+
+    std::vector<Result> run();
+
+    static std::string toJson(const Config &config, const std::vector<Result> &results);
+    static std::string toText(const std::vector<Result> &results);
+
+   private:
+    Result runMode(Mode mode);
+    uint64_t totalSent();
+
+    Config m_config;
+    WSCManager m_manager;
+};
@@ -0,0 +1,447 @@
+#include "impair.h"
+
+#include <Poco/Net/NetException.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // Poll interval of every proxy thread, bounds how fast stop() and resets take effect
+    constexpr auto kPoll = std::chrono::milliseconds(50);
+    const Poco::Timespan kPollSpan(0, 50 * 1000);
+
+    const std::map<std::string, std::string> kScenarios = {
+        // high latency, jitter and a narrow pipe for the whole run
+        {"slow-link", "0 latency=80ms jitter=40ms bandwidth=256k\n"},
+        // ever longer blackouts without a disconnect: keepalive false positives
+        {"stalls", "0 latency=5ms\n5 stall=1s\n12 stall=3s\n20 stall=6s\n"},
+        // the server side resets the connection: reconnect time
+        {"resets", "0 latency=2ms\n5 reset\n10 reset\n15 reset\n20 reset\n"},
+        // the link cannot carry the offered load: send queue and memory growth
+        {"congested", "0 latency=20ms bandwidth=32k\n"},
+        // everything at once
+        {"flaky", "0 latency=30ms jitter=20ms\n4 stall=2s\n8 bandwidth=64k\n12 reset\n"
+                  "14 clear\n18 latency=200ms jitter=100ms\n22 reset\n24 clear\n"},
+    };
+
+    std::chrono::microseconds parseDuration(const std::string &value) {
+        size_t unit = 0;
+        const double number = std::stod(value, &unit);
+        const std::string suffix = value.substr(unit);
+        double factor;
+        if (suffix == "us") {
+            factor = 1;
+        } else if (suffix == "ms") {
+            factor = 1e3;
+        } else if (suffix == "s") {
+            factor = 1e6;
+        } else {
+            throw std::invalid_argument("Duration needs a unit (us, ms, s): " + value);
+        }
+        if (number < 0) throw std::invalid_argument("Negative duration: " + value);
+        return std::chrono::microseconds(static_cast<int64_t>(number * factor));
+    }
+
+    uint64_t parseBandwidth(const std::string &value) {
+        size_t unit = 0;
+        const double number = std::stod(value, &unit);
+        const std::string suffix = value.substr(unit);
+        double factor = 1;
+        if (suffix == "k") {
+            factor = 1024;
+        } else if (suffix == "m") {
+            factor = 1024 * 1024;
+        } else if (!suffix.empty()) {
+            throw std::invalid_argument("Bandwidth takes k or m: " + value);
+        }
+        if (number < 0) throw std::invalid_argument("Negative bandwidth: " + value);
+        return static_cast<uint64_t>(number * factor);
+    }
+}  // namespace
+
+// ==================================== PROFILE ====================================
+
+ImpairProfile ImpairProfile::parse(const std::string &text) {
+    ImpairProfile profile;
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+    while (std::getline(lines, line)) {
+        number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word)) continue;
+        try {
+            Step step;
+            step.at = std::chrono::milliseconds(static_cast<int64_t>(std::stod(word) * 1000));
+            while (words >> word) {
+                const auto equals = word.find('=');
+                const std::string key = word.substr(0, equals);
+                const std::string value =
+                    equals == std::string::npos ? "" : word.substr(equals + 1);
+                if (key == "clear") {
+                    step.clear = true;
+                } else if (key == "reset") {
+                    step.reset = true;
+                } else if (key == "stall") {
+                    step.stall = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        parseDuration(value));
+                } else if (key == "latency") {
+                    step.latency = parseDuration(value);
+                } else if (key == "jitter") {
+                    step.jitter = parseDuration(value);
+                } else if (key == "bandwidth") {
+                    step.bandwidth = parseBandwidth(value);
+                } else {
+                    throw std::invalid_argument("Unknown setting " + key);
+                }
+            }
+            profile.m_steps.push_back(step);
+        } catch (const std::exception &e) {
+            throw std::invalid_argument("Profile line " + std::to_string(number) + ": " +
+                                        e.what());
+        }
+    }
+    std::stable_sort(profile.m_steps.begin(), profile.m_steps.end(),
+                     [](const Step &a, const Step &b) { return a.at < b.at; });
+    return profile;
+}
+
+ImpairProfile ImpairProfile::load(const std::string &nameOrFile) {
+    if (auto it = kScenarios.find(nameOrFile); it != kScenarios.end()) return parse(it->second);
+    std::ifstream file(nameOrFile);
+    if (!file) throw std::invalid_argument("No scenario or profile file named " + nameOrFile);
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str());
+}
+
+std::vector<std::string> ImpairProfile::scenarioNames() {
+    std::vector<std::string> names;
+    for (const auto &[name, text] : kScenarios) names.push_back(name);
+    return names;
+}
+
+// ===================================== PROXY =====================================
+
+struct ImpairProxy::Direction {
+    Direction(Poco::Net::StreamSocket &from, Poco::Net::StreamSocket &to, uint32_t seed)
+        : from(from), to(to), rng(seed) {}
+
+    struct Chunk {
+        std::vector<char> data;
+        size_t offset;
+        Clock::time_point due;
+    };
+
+    Poco::Net::StreamSocket &from;
+    Poco::Net::StreamSocket &to;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Chunk> chunks;
+    size_t buffered = 0;
+    bool eof = false;
+    Clock::time_point lastDue;  // TCP keeps the order, jitter must not reorder chunks
+    std::mt19937 rng;
+};
+
+struct ImpairProxy::Link {
+    Link(Poco::Net::StreamSocket client, Poco::Net::StreamSocket upstream, uint32_t seed)
+        : client(std::move(client)),
+          upstream(std::move(upstream)),
+          up(this->client, this->upstream, seed),
+          down(this->upstream, this->client, seed + 1) {}
+
+    Poco::Net::StreamSocket client;
+    Poco::Net::StreamSocket upstream;
+    Direction up;    // client to upstream
+    Direction down;  // upstream to client
+    std::atomic<bool> closing{false};
+    std::atomic<bool> reset{false};  // close with RST
+    std::atomic<int> finished{0};
+    std::vector<std::thread> threads;
+
+    void close(bool abort) {
+        if (abort) reset = true;
+        closing = true;
+        up.changed.notify_all();
+        down.changed.notify_all();
+    }
+};
+
+ImpairProxy::ImpairProxy(const Config &config) : m_config(config) {}
+
+ImpairProxy::~ImpairProxy() { stop(); }
+
+void ImpairProxy::start() {
+    if (m_running) return;
+    m_server.bind(Poco::Net::SocketAddress(m_config.listenAddress, m_config.listenPort), true);
+    m_server.listen();
+    m_port = m_server.address().port();
+    m_running = true;
+    m_acceptThread = std::thread(&ImpairProxy::acceptLoop, this);
+}
+
+void ImpairProxy::stop() {
+    if (!m_running.exchange(false)) return;
+    m_playCondition.notify_all();
+    if (m_playThread.joinable()) m_playThread.join();
+    if (m_acceptThread.joinable()) m_acceptThread.join();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &link : m_links) link->close(false);
+    }
+    while (true) {
+        reapLinks();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_links.empty()) break;
+    }
+    m_server.close();
+}
+
+void ImpairProxy::setImpairment(const Impairment &impairment) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_impairment = impairment;
+}
+
+void ImpairProxy::stall(std::chrono::milliseconds duration) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stallUntil = std::max(m_stallUntil, Clock::now() + duration);
+}
+
+void ImpairProxy::resetConnections() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &link : m_links) {
+        if (!link->closing) {
+            link->close(true);
+            m_resets.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ImpairProxy::play(const ImpairProfile &profile) {
+    if (m_playThread.joinable()) {
+        throw std::logic_error("A profile is already playing");
+    }
+    m_playThread = std::thread(&ImpairProxy::playLoop, this, profile, Clock::now());
+}
+
+ImpairProxy::Statistics ImpairProxy::getStatistics() const {
+    Statistics statistics;
+    statistics.connections = m_connections.load(std::memory_order_relaxed);
+    statistics.resets = m_resets.load(std::memory_order_relaxed);
+    statistics.bytesForwarded = m_bytesForwarded.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &link : m_links) statistics.active += !link->closing;
+    return statistics;
+}
+
+void ImpairProxy::playLoop(ImpairProfile profile, Clock::time_point start) {
+    for (const auto &step : profile.steps()) {
+        {
+            std::unique_lock<std::mutex> lock(m_playMutex);
+            if (m_playCondition.wait_until(lock, start + step.at, [this] { return !m_running; })) {
+                return;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (step.clear) {
+                m_impairment = Impairment{};
+                m_stallUntil = Clock::time_point{};
+            }
+            if (step.latency) m_impairment.latency = *step.latency;
+            if (step.jitter) m_impairment.jitter = *step.jitter;
+            if (step.bandwidth) m_impairment.bandwidth = *step.bandwidth;
+        }
+        if (step.stall.count() > 0) stall(step.stall);
+        if (step.reset) resetConnections();
+    }
+}
+
+void ImpairProxy::acceptLoop() {
+    uint32_t seed = 1;
+    while (m_running) {
+        reapLinks();
+        if (!m_server.poll(kPollSpan, Poco::Net::Socket::SELECT_READ)) continue;
+        Poco::Net::StreamSocket client;
+        try {
+            client = m_server.acceptConnection();
+        } catch (const Poco::Exception &) {
+            continue;
+        }
+        Poco::Net::StreamSocket upstream;
+        try {
+            const Poco::Net::SocketAddress address(m_config.upstreamHost, m_config.upstreamPort);
+            upstream.connect(address, Poco::Timespan(5, 0));
+        } catch (const Poco::Exception &) {
+            // refuse the client the way the server would have
+            client.setLinger(true, 0);
+            client.close();
+            continue;
+        }
+        for (auto *socket : {&client, &upstream}) {
+            socket->setNoDelay(true);
+            socket->setSendTimeout(kPollSpan);
+        }
+        m_connections.fetch_add(1, std::memory_order_relaxed);
+
+        auto link = std::make_unique<Link>(std::move(client), std::move(upstream), seed += 2);
+        Link &raw = *link;
+        for (Direction *direction : {&raw.up, &raw.down}) {
+            raw.threads.emplace_back(&ImpairProxy::readLoop, this, std::ref(raw),
+                                     std::ref(*direction));
+            raw.threads.emplace_back(&ImpairProxy::writeLoop, this, std::ref(raw),
+                                     std::ref(*direction));
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_links.push_back(std::move(link));
+    }
+}
+
+void ImpairProxy::reapLinks() {
+    std::list<std::unique_ptr<Link>> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_links.begin(); it != m_links.end();) {
+            if ((*it)->finished == static_cast<int>((*it)->threads.size())) {
+                done.splice(done.end(), m_links, it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto &link : done) {
+        for (auto &thread : link->threads) thread.join();
+        for (auto *socket : {&link->client, &link->upstream}) {
+            try {
+                if (link->reset) socket->setLinger(true, 0);
+                socket->close();
+            } catch (const Poco::Exception &) {
+                // already gone
+            }
+        }
+    }
+}
+
+void ImpairProxy::readLoop(Link &link, Direction &direction) {
+    std::vector<char> buffer(64 * 1024);
+    try {
+        while (!link.closing) {
+            {
+                std::unique_lock<std::mutex> lock(direction.mutex);
+                if (direction.buffered >= m_config.maxBuffered) {
+                    direction.changed.wait_for(lock, kPoll);
+                    continue;
+                }
+            }
+            if (!direction.from.poll(kPollSpan, Poco::Net::Socket::SELECT_READ)) continue;
+            const int n =
+                direction.from.receiveBytes(buffer.data(), static_cast<int>(buffer.size()));
+
+            Impairment impairment;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                impairment = m_impairment;
+            }
+            std::lock_guard<std::mutex> lock(direction.mutex);
+            if (n <= 0) {
+                direction.eof = true;
+                direction.changed.notify_all();
+                break;
+            }
+            auto delay = impairment.latency;
+            if (impairment.jitter.count() > 0) {
+                delay += std::chrono::microseconds(std::uniform_int_distribution<int64_t>(
+                    -impairment.jitter.count(), impairment.jitter.count())(direction.rng));
+            }
+            delay = std::max(delay, std::chrono::microseconds(0));
+            const auto due = std::max(direction.lastDue, Clock::now() + delay);
+            direction.lastDue = due;
+            direction.chunks.push_back(
+                {std::vector<char>(buffer.begin(), buffer.begin() + n), 0, due});
+            direction.buffered += static_cast<size_t>(n);
+            direction.changed.notify_all();
+        }
+    } catch (const Poco::Exception &) {
+        // the peer reset the connection, pass that on to the other side
+        link.close(true);
+    }
+    link.finished++;
+}
+
+void ImpairProxy::writeLoop(Link &link, Direction &direction) {
+    double tokens = 0;  // bandwidth budget in bytes
+    Clock::time_point refilled = Clock::now();
+    try {
+        while (!link.closing) {
+            std::unique_lock<std::mutex> lock(direction.mutex);
+            if (direction.chunks.empty()) {
+                if (direction.eof) {
+                    direction.to.shutdownSend();
+                    break;
+                }
+                direction.changed.wait_for(lock, kPoll);
+                continue;
+            }
+            Direction::Chunk &chunk = direction.chunks.front();
+            lock.unlock();
+
+            Impairment impairment;
+            Clock::time_point stallUntil;
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                impairment = m_impairment;
+                stallUntil = m_stallUntil;
+            }
+            const auto now = Clock::now();
+            const auto readyAt = std::max(chunk.due, stallUntil);
+            if (now < readyAt) {
+                std::this_thread::sleep_for(std::min<Clock::duration>(readyAt - now, kPoll));
+                continue;
+            }
+
+            size_t allowed = chunk.data.size() - chunk.offset;
+            if (impairment.bandwidth > 0) {
+                const double rate = static_cast<double>(impairment.bandwidth);
+                tokens = std::min(tokens + std::chrono::duration<double>(now - refilled).count() *
+                                               rate,
+                                  rate / 10);  // at most 100ms worth of burst
+                refilled = now;
+                if (tokens < 1) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                allowed = std::min(allowed, static_cast<size_t>(tokens));
+            } else {
+                refilled = now;
+            }
+
+            int sent = 0;
+            try {
+                sent = direction.to.sendBytes(chunk.data.data() + chunk.offset,
+                                              static_cast<int>(allowed));
+            } catch (const Poco::TimeoutException &) {
+                continue;  // the receiver is not reading, check for close and retry
+            }
+            if (sent <= 0) continue;
+            tokens -= sent;
+            m_bytesForwarded.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+
+            lock.lock();
+            chunk.offset += static_cast<size_t>(sent);
+            direction.buffered -= static_cast<size_t>(sent);
+            if (chunk.offset == chunk.data.size()) direction.chunks.pop_front();
+            direction.changed.notify_all();
+        }
+    } catch (const Poco::Exception &) {
+        link.close(true);
+    }
+    link.finished++;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/StreamSocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Link conditions applied by ImpairProxy, in both directions
+struct Impairment {
+    std::chrono::microseconds latency{0};
+    std::chrono::microseconds jitter{0};  // latency +- jitter, uniform
+    uint64_t bandwidth = 0;               // bytes per second, 0 = unlimited
+};
+
+// Scripted timeline of link conditions, one step per line:
+//
+//   # seconds  changes
+//   0          latency=20ms jitter=5ms
+//   5          stall=3s
+//   10         bandwidth=64k
+//   15         reset
+//   20         clear
+//
+// latency, jitter and bandwidth stay in effect until changed, clear restores a perfect
+// link. stall=D delivers nothing in either direction for D, reset aborts every open
+// connection with a TCP RST. Durations take us, ms or s, bandwidth k or m (bytes/s).
+class ImpairProfile {
+   public:
+    struct Step {
+        std::chrono::milliseconds at{0};
+        bool clear = false;
+        bool reset = false;
+        std::chrono::milliseconds stall{0};
+        std::optional<std::chrono::microseconds> latency;
+        std::optional<std::chrono::microseconds> jitter;
+        std::optional<uint64_t> bandwidth;
+    };
+
+    // Profile text as above, or the name of a built-in scenario
+    static ImpairProfile parse(const std::string &text);
+    static ImpairProfile load(const std::string &nameOrFile);
+    static std::vector<std::string> scenarioNames();
+
+    const std::vector<Step> &steps() const noexcept { return m_steps; }
+
+   private:
+    std::vector<Step> m_steps;
+};
+
+// Local TCP proxy that forwards to an upstream server through impaired links. Point a
+// client at 127.0.0.1:port() instead of the server; every accepted connection opens its own
+// upstream connection.
+class ImpairProxy {
+   public:
+    struct Config {
+        std::string listenAddress;
+        uint16_t listenPort;  // 0 picks a free port
+        std::string upstreamHost;
+        uint16_t upstreamPort;
+        size_t maxBuffered;  // per direction, reading stops beyond it (backpressure)
+
+        Config()
+            : listenAddress("127.0.0.1"),
+              listenPort(0),
+              upstreamPort(80),
+              maxBuffered(4 * 1024 * 1024) {}  // 4MB
+    };
+
+    struct Statistics {
+        uint64_t connections = 0;
+        uint64_t active = 0;
+        uint64_t resets = 0;
+        uint64_t bytesForwarded = 0;
+    };
+
+    explicit ImpairProxy(const Config &config);
+    ~ImpairProxy();
+
+    ImpairProxy(const ImpairProxy &) = delete;
+    ImpairProxy &operator=(const ImpairProxy &) = delete;
+
+    void start();
+    void stop();
+    uint16_t port() const noexcept { return m_port; }
+
+    void setImpairment(const Impairment &impairment);
+    void stall(std::chrono::milliseconds duration);
+    void resetConnections();
+
+    // Applies the steps of a profile on its own thread, relative to now
+    void play(const ImpairProfile &profile);
+
+    Statistics getStatistics() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+    struct Link;
+    struct Direction;
+
+    void acceptLoop();
+    void playLoop(ImpairProfile profile, Clock::time_point start);
+    void readLoop(Link &link, Direction &direction);
+    void writeLoop(Link &link, Direction &direction);
+    void reapLinks();
+
+    Config m_config;
+    Poco::Net::ServerSocket m_server;
+    uint16_t m_port = 0;
+    std::atomic<bool> m_running{false};
+    std::thread m_acceptThread;
+    std::thread m_playThread;
+    std::mutex m_playMutex;
+    std::condition_variable m_playCondition;
+
+    mutable std::mutex m_mutex;  // m_impairment, m_stallUntil and m_links
+    Impairment m_impairment;
+    Clock::time_point m_stallUntil;
+    std::list<std::unique_ptr<Link>> m_links;
+
+    std::atomic<uint64_t> m_connections{0};
+    std::atomic<uint64_t> m_resets{0};
+    std::atomic<uint64_t> m_bytesForwarded{0};
+};
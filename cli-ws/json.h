@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cmath>
+#include <ostream>
+#include <string>
+
+// Values of the --json summaries. The writers stream into an std::ostringstream set to
+// std::fixed, precision 3.
+namespace Json {
+    // value between double quotes, quotes and backslashes escaped
+    inline std::string quote(const std::string &value) {
+        std::string out = "\"";
+        for (char c : value) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + '"';
+    }
+
+    struct Number {
+        double value;
+    };
+
+    // JSON has no inf or nan: a rate over a zero second window or a percentile of an empty
+    // histogram is written as null
+    inline Number number(double value) { return Number{value}; }
+
+    inline std::ostream &operator<<(std::ostream &out, Number number) {
+        if (!std::isfinite(number.value)) return out << "null";
+        return out << number.value;
+    }
+}  // namespace Json
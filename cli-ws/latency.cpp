@@ -0,0 +1,221 @@
+#include "latency.h"
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "json.h"
+#include "stamp.h"
+
+namespace {
+    // scheduled send time, then the actual one
+    constexpr size_t kStamps = 2;
+
+    void appendCpus(std::ostringstream &out, const char *name, const std::vector<int> &cpus) {
+        out << ",\"" << name << "\":[";
+        for (size_t i = 0; i < cpus.size(); i++) out << (i ? "," : "") << cpus[i];
+        out << ']';
+    }
+
+    void appendPercentiles(std::ostringstream &out,
+                           const LatencyBenchmark::Histogram::Snapshot &h) {
+        out << "{\"count\":" << h.count << ",\"min\":" << Json::number(h.min / 1e3)
+            << ",\"mean\":" << Json::number(h.mean() / 1e3);
+        const std::pair<const char *, double> percentiles[] = {
+            {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}, {"p99.99", 99.99}};
+        for (const auto &[name, p] : percentiles) {
+            out << ",\"" << name << "\":" << Json::number(h.percentile(p) / 1e3);
+        }
+        out << ",\"max\":" << Json::number(h.max / 1e3) << '}';
+    }
+}  // namespace
+
+LatencyBenchmark::LatencyBenchmark(const Config &config)
+    : m_config(config), m_text(std::max(config.size, Stamp::kSize * kStamps), 'x') {
+    if (m_config.connections < 1) throw std::invalid_argument("At least one connection needed");
+    if (m_config.rate <= 0) throw std::invalid_argument("The rate must be positive");
+    if (m_config.ioUring) {
+        WSCUringReactor::Config reactor;
+        reactor.maxConnections = m_config.connections;
+        m_reactor = std::make_unique<WSCUringReactor>(reactor);
+        m_config.client.transportFactory = m_reactor->transportFactory();
+    }
+}
+
+LatencyBenchmark::~LatencyBenchmark() { m_clients.clear(); }
+
+void LatencyBenchmark::onMessage(const WSCMessage &message) {
+    const int64_t now = Stamp::steadyNowNs();
+    int64_t stamps[kStamps];
+    if (!Stamp::read(message.payload, stamps, kStamps) || !inWindow(stamps[0])) return;
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    m_latency.record(static_cast<uint64_t>(std::max<int64_t>(now - stamps[0], 0)));
+    m_uncorrected.record(static_cast<uint64_t>(std::max<int64_t>(now - stamps[1], 0)));
+}
+
+LatencyBenchmark::Result LatencyBenchmark::run() {
+    for (int i = 0; i < m_config.connections; i++) {
+        auto client = std::make_unique<WSC>(m_config.url, m_config.client);
+        client->setDataMessageCallback([this](const WSCMessage &message) { onMessage(message); });
+        client->connect();
+        m_clients.push_back(std::move(client));
+    }
+    const auto connectEnd = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (auto &client : m_clients) {
+        while (!client->isConnected()) {
+            if (std::chrono::steady_clock::now() > connectEnd) {
+                throw std::runtime_error("Could not connect to " + m_config.url);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    const double intervalNs = 1e9 / m_config.rate;
+    const int64_t startNs = Stamp::steadyNowNs();
+    const int64_t measureStartNs = startNs + m_config.warmup.count() * 1000000;
+    const int64_t measureEndNs = measureStartNs + m_config.duration.count() * 1000000;
+    m_measureStartNs.store(measureStartNs, std::memory_order_relaxed);
+    m_measureEndNs.store(measureEndNs, std::memory_order_relaxed);
+
+    // A late message keeps its scheduled time and the following ones are not pushed back,
+    // the sender catches up by sending them immediately.
+    std::string text = m_text;
+    std::vector<uint8_t> binary(m_text.begin(), m_text.end());
+    int64_t nextReportNs = startNs + 1000000000;
+    uint64_t reportedSent = 0, reportedReceived = 0;
+    for (uint64_t k = 0;; k++) {
+        const int64_t scheduledNs = startNs + static_cast<int64_t>(k * intervalNs);
+        if (scheduledNs >= measureEndNs) break;
+        Stamp::waitUntil(scheduledNs);
+
+        const int64_t actualNs = Stamp::steadyNowNs();
+        WSC &client = *m_clients[k % m_clients.size()];
+        bool sent;
+        if (m_config.binary) {
+            Stamp::write(reinterpret_cast<char *>(binary.data()), scheduledNs);
+            Stamp::write(reinterpret_cast<char *>(binary.data()) + Stamp::kSize, actualNs);
+            sent = client.sendBinary(binary);
+        } else {
+            Stamp::write(text.data(), scheduledNs);
+            Stamp::write(text.data() + Stamp::kSize, actualNs);
+            sent = client.sendText(text);
+        }
+        if (inWindow(scheduledNs)) {
+            if (!sent) {
+                m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                m_sent.fetch_add(1, std::memory_order_relaxed);
+                m_senderLag.record(static_cast<uint64_t>(actualNs - scheduledNs));
+            }
+        }
+
+        if (m_config.progress && actualNs >= nextReportNs) {
+            const uint64_t sentNow = m_sent.load(), receivedNow = m_received.load();
+            const auto snapshot = m_latency.snapshot();
+            std::cerr << "[" << (scheduledNs < measureStartNs ? "warm" : "run ") << "] sent "
+                      << sentNow - reportedSent << " msg/s  received "
+                      << receivedNow - reportedReceived << " msg/s  p99 "
+                      << snapshot.percentile(99) / 1e3 << " us  max " << snapshot.max / 1e3
+                      << " us" << std::endl;
+            reportedSent = sentNow;
+            reportedReceived = receivedNow;
+            nextReportNs += 1000000000;
+        }
+    }
+
+    const auto drainEnd = std::chrono::steady_clock::now() + m_config.drain;
+    while (m_received.load() < m_sent.load() && std::chrono::steady_clock::now() < drainEnd) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // replies from now on are not counted, the missing ones are charged with the drain
+    // timeout: every one of them waited at least that long
+    m_measureEndNs.store(measureStartNs, std::memory_order_relaxed);
+
+    Result result;
+    result.seconds = m_config.duration.count() / 1000.0;
+    result.messagesSent = m_sent.load();
+    result.messagesReceived = m_received.load();
+    result.timeouts =
+        result.messagesSent - std::min(result.messagesReceived, result.messagesSent);
+    if (result.timeouts > 0) {
+        const auto timeoutNs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(m_config.drain).count());
+        m_latency.record(timeoutNs, result.timeouts);
+        m_uncorrected.record(timeoutNs, result.timeouts);
+    }
+    result.sendFailures = m_sendFailures.load();
+    result.latency = m_latency.snapshot();
+    result.uncorrected = m_uncorrected.snapshot();
+    result.senderLag = m_senderLag.snapshot();
+
+    for (auto &client : m_clients) {
+        if (client->isConnected()) client->disconnect();
+    }
+    const auto closeEnd = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    for (auto &client : m_clients) {
+        while (client->isConnected() && std::chrono::steady_clock::now() < closeEnd) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    return result;
+}
+
+std::string LatencyBenchmark::toJson(const Config &config, const Result &result) {
+    std::ostringstream out;
+    out.precision(3);
+    out << std::fixed << "{\"config\":{\"url\":" << Json::quote(config.url)
+        << ",\"connections\":" << config.connections << ",\"rate\":" << Json::number(config.rate)
+        << ",\"size\":" << config.size << ",\"binary\":" << (config.binary ? "true" : "false")
+        << ",\"warmupSeconds\":" << config.warmup.count() / 1000.0
+        << ",\"durationSeconds\":" << config.duration.count() / 1000.0
+        << ",\"ioUring\":" << (config.ioUring ? "true" : "false");
+    appendCpus(out, "receiveCpus", config.client.receiveCpus);
+    appendCpus(out, "sendCpus", config.client.sendCpus);
+    appendCpus(out, "controlCpus", config.client.controlCpus);
+    out << ",\"busyPollUs\":" << config.client.busyPoll.count()
+        << ",\"socketBusyPollUs\":" << config.client.socketBusyPoll.count();
+    out << "},";
+    out << "\"seconds\":" << Json::number(result.seconds)
+        << ",\"messagesSent\":" << result.messagesSent
+        << ",\"messagesReceived\":" << result.messagesReceived
+        << ",\"timeouts\":" << result.timeouts
+        << ",\"sendFailures\":" << result.sendFailures << ",\"latencyUs\":";
+    appendPercentiles(out, result.latency);
+    out << ",\"uncorrectedUs\":";
+    appendPercentiles(out, result.uncorrected);
+    out << ",\"senderLagUs\":";
+    appendPercentiles(out, result.senderLag);
+    out << "}\n";
+    return out.str();
+}
+
+std::string LatencyBenchmark::toText(const Result &result) {
+    auto line = [](const char *name, const Histogram::Snapshot &h) {
+        char text[256];
+        std::snprintf(text, sizeof(text), "%-12s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+                      h.percentile(50) / 1e3, h.percentile(90) / 1e3, h.percentile(99) / 1e3,
+                      h.percentile(99.9) / 1e3, h.percentile(99.99) / 1e3, h.max / 1e3);
+        return std::string(text);
+    };
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "%.1fs, sent %llu (%.0f msg/s), received %llu, %llu timed out, %llu send "
+                  "failures\n%-12s %9s %9s %9s %9s %9s %9s\n",
+                  result.seconds, static_cast<unsigned long long>(result.messagesSent),
+                  result.seconds > 0 ? result.messagesSent / result.seconds : 0.0,
+                  static_cast<unsigned long long>(result.messagesReceived),
+                  static_cast<unsigned long long>(result.timeouts),
+                  static_cast<unsigned long long>(result.sendFailures), "us", "p50", "p90",
+                  "p99", "p99.9", "p99.99", "max");
+    std::string out = text + line("latency", result.latency) +
+                      line("uncorrected", result.uncorrected) +
+                      line("sender lag", result.senderLag);
+    if (result.timeouts) {
+        out += "warning: replies timed out, they are recorded at the drain timeout, a lower "
+               "bound of their latency\n";
+    }
+    return out;
+}
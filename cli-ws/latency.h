@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "WSCHistogram.h"
+#include "uring.h"
+#include "ws.h"
+
+// End-to-end latency against an echo server, corrected for coordinated omission.
+//
+// Messages go out on a fixed schedule (open-loop) and every message carries the time it was
+// scheduled for next to the time it was actually handed to WSC. Latency is measured from
+// the scheduled time: when the sender or the client falls behind, the messages that should
+// have gone out in the meantime are charged with the wait instead of silently disappearing
+// from the distribution, as they would in a send-wait-reply benchmark. The latency from
+// the actual send call is reported next to it, the gap between the two is the queueing
+// delay a naive benchmark hides.
+class LatencyBenchmark {
+   public:
+    struct Config {
+        std::string url;
+        int connections;  // the schedule is spread round-robin over the connections
+        double rate;      // messages per second over all connections
+        size_t size;      // payload bytes
+        bool binary;
+        std::chrono::milliseconds warmup;  // sent but not recorded
+        std::chrono::milliseconds duration;
+        std::chrono::milliseconds drain;  // wait for outstanding replies at the end
+        bool progress;                    // per second lines on stderr
+        bool ioUring;                     // connections share a WSCUringReactor
+        WSC::Config client;
+
+        Config()
+            : url("ws://127.0.0.1:9000"),
+              connections(1),
+              rate(10000),
+              size(128),
+              binary(false),
+              warmup(2 * 1000),     // 2 seconds
+              duration(10 * 1000),  // 10 seconds
+              drain(2 * 1000),      // 2 seconds
+              progress(true),
+              ioUring(false) {}
+    };
+
+    using Histogram = WSCHistogram<11, 40>;  // nanoseconds, 3 significant digits
+
+    struct Result {
+        double seconds = 0;  // measured window, after warm-up
+        uint64_t messagesSent = 0;
+        uint64_t messagesReceived = 0;
+        uint64_t timeouts = 0;  // no reply before the drain timeout, recorded at it
+        uint64_t sendFailures = 0;
+        Histogram::Snapshot latency;      // reply time - scheduled send time
+        Histogram::Snapshot uncorrected;  // reply time - actual send time
+        Histogram::Snapshot senderLag;    // actual send time - scheduled send time
+    };
+
+    explicit LatencyBenchmark(const Config &config);
+    ~LatencyBenchmark();
+
+    LatencyBenchmark(const LatencyBenchmark &) = delete;
+    LatencyBenchmark &operator=(const LatencyBenchmark &) = delete;
+
+    Result run();
+
+    static std::string toJson(const Config &config, const Result &result);
+    static std::string toText(const Result &result);
+
+   private:
+    void onMessage(const WSCMessage &message);
+    bool inWindow(int64_t scheduledNs) const noexcept {
+        return scheduledNs >= m_measureStartNs.load(std::memory_order_relaxed) &&
+               scheduledNs < m_measureEndNs.load(std::memory_order_relaxed);
+    }
+
+    Config m_config;
+    std::unique_ptr<WSCUringReactor> m_reactor;  // outlives the clients
+    std::string m_text;  // payload template, the stamps are written over its first bytes
+    std::vector<std::unique_ptr<WSC>> m_clients;
+    std::atomic<int64_t> m_measureStartNs{INT64_MAX};  // read by the receive threads
+    std::atomic<int64_t> m_measureEndNs{INT64_MAX};
+
+    std::atomic<uint64_t> m_sent{0};  // in the measured window
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_sendFailures{0};
+    Histogram m_latency;
+    Histogram m_uncorrected;
+    Histogram m_senderLag;
+};
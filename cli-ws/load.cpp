@@ -0,0 +1,406 @@
+#include "load.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+
+#include "json.h"
+#include "stamp.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+    // CPU seconds and context switches of the whole process so far, 0 where unknown
+    void processUsage(double &cpuSeconds, uint64_t &contextSwitches) {
+        cpuSeconds = 0;
+        contextSwitches = 0;
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return;
+        cpuSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                     (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+        contextSwitches = static_cast<uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw);
+#endif
+    }
+
+    template <typename Snapshot>
+    void appendPercentiles(std::ostringstream &out, const Snapshot &h, double scale) {
+        out << "{\"count\":" << h.count << ",\"min\":" << Json::number(h.min / scale)
+            << ",\"mean\":" << Json::number(h.mean() / scale);
+        const std::pair<const char *, double> percentiles[] = {
+            {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}, {"p99.99", 99.99}};
+        for (const auto &[name, p] : percentiles) {
+            out << ",\"" << name << "\":" << Json::number(h.percentile(p) / scale);
+        }
+        out << ",\"max\":" << Json::number(h.max / scale) << '}';
+    }
+
+}  // namespace
+
+// ================================ SIZE DISTRIBUTION ================================
+
+SizeDistribution::SizeDistribution(const std::string &spec) : m_spec(spec) {
+    try {
+        if (spec.rfind("exp:", 0) == 0) {
+            m_kind = Kind::EXPONENTIAL;
+            m_mean = std::stod(spec.substr(4));
+            m_min = Stamp::kSize;
+            m_max = 16 * 1024 * 1024;  // the default receiveMaxPayloadSize
+        } else if (const auto dash = spec.find('-'); dash != std::string::npos) {
+            m_kind = Kind::UNIFORM;
+            m_min = std::stoul(spec.substr(0, dash));
+            m_max = std::stoul(spec.substr(dash + 1));
+        } else {
+            m_min = m_max = std::stoul(spec);
+        }
+    } catch (const std::exception &) {
+        throw std::invalid_argument("Invalid size distribution: " + spec);
+    }
+    if (m_min > m_max || (m_kind == Kind::EXPONENTIAL && m_mean <= 0)) {
+        throw std::invalid_argument("Invalid size distribution: " + spec);
+    }
+    m_min = std::max(m_min, Stamp::kSize);
+    m_max = std::max(m_max, m_min);
+}
+
+size_t SizeDistribution::operator()(std::mt19937_64 &rng) const {
+    switch (m_kind) {
+        case Kind::UNIFORM:
+            return std::uniform_int_distribution<size_t>(m_min, m_max)(rng);
+        case Kind::EXPONENTIAL: {
+            const double size = std::exponential_distribution<double>(1.0 / m_mean)(rng);
+            return std::clamp(static_cast<size_t>(std::llround(size)), m_min, m_max);
+        }
+        default:
+            return m_min;
+    }
+}
+
+// ================================== LOAD GENERATOR =================================
+
+LoadGenerator::LoadGenerator(const Config &config)
+    : m_config(config), m_sizes(config.sizes), m_filler(m_sizes.max(), 'x') {
+    if (m_config.connections < 1) throw std::invalid_argument("At least one connection needed");
+    if (m_config.openLoop && m_config.rate <= 0) {
+        throw std::invalid_argument("Open-loop mode needs a positive rate");
+    }
+    if (!m_config.openLoop && m_config.inFlight < 1) {
+        throw std::invalid_argument("Closed-loop mode needs at least one message in flight");
+    }
+    if (m_config.ioUring) {
+        WSCUringReactor::Config reactor;
+        reactor.maxConnections = m_config.connections;
+        m_reactor = std::make_unique<WSCUringReactor>(reactor);
+        m_config.client.transportFactory = m_reactor->transportFactory();
+    }
+}
+
+LoadGenerator::~LoadGenerator() {
+    m_sending = false;
+    m_connections.clear();
+}
+
+LoadGenerator::Totals LoadGenerator::totals() const {
+    Totals totals{m_sent.load(),          m_received.load(),     m_bytesSent.load(),
+                  m_bytesReceived.load(), m_sendFailures.load(), 0};
+    for (const auto &connection : m_connections) {
+        totals.errors += connection->client->getStatistics().errors;
+    }
+    return totals;
+}
+
+void LoadGenerator::sendOne(Connection &connection) {
+    std::lock_guard<std::mutex> lock(connection.sendMutex);
+    const size_t size = m_sizes(connection.rng);
+    const bool binary = m_config.binaryRatio > 0 &&
+                        std::uniform_real_distribution<double>(0.0, 1.0)(connection.rng) <
+                            m_config.binaryRatio;
+
+    // only the send call itself is timed, not building the payload
+    bool sent;
+    std::chrono::steady_clock::duration elapsed;
+    if (binary) {
+        std::vector<uint8_t> payload(m_filler.begin(),
+                                     m_filler.begin() + static_cast<std::ptrdiff_t>(size));
+        Stamp::write(reinterpret_cast<char *>(payload.data()), Stamp::steadyNowNs());
+        const auto start = std::chrono::steady_clock::now();
+        sent = connection.client->sendBinary(payload);
+        elapsed = std::chrono::steady_clock::now() - start;
+    } else {
+        std::string payload(m_filler, 0, size);
+        Stamp::write(payload.data(), Stamp::steadyNowNs());
+        const auto start = std::chrono::steady_clock::now();
+        sent = connection.client->sendText(payload);
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+
+    if (!sent) {
+        m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_sent.fetch_add(1, std::memory_order_relaxed);
+    m_bytesSent.fetch_add(size, std::memory_order_relaxed);
+    if (m_measuring.load(std::memory_order_relaxed)) {
+        m_sendLatency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+}
+
+void LoadGenerator::onMessage(Connection &connection, const WSCMessage &message) {
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    m_bytesReceived.fetch_add(message.payload.size(), std::memory_order_relaxed);
+    int64_t sendNs;
+    if (m_measuring.load(std::memory_order_relaxed) && Stamp::read(message.payload, &sendNs)) {
+        m_rtt.record(
+            static_cast<uint64_t>(std::max<int64_t>(Stamp::steadyNowNs() - sendNs, 0)));
+    }
+    if (!m_config.openLoop && m_sending.load(std::memory_order_relaxed)) sendOne(connection);
+}
+
+// Open-loop: every connection sends at rate / connections on its own fixed schedule, late
+// sends are caught up immediately so the offered load does not depend on the server.
+// Closed-loop: the initial window is sent here, replies trigger the following sends.
+void LoadGenerator::senderLoop(size_t first, size_t stride) {
+    using Clock = std::chrono::steady_clock;
+    using Slot = std::pair<Clock::time_point, size_t>;
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(m_config.connections / m_config.rate));
+
+    std::priority_queue<Slot, std::vector<Slot>, std::greater<Slot>> schedule;
+    for (size_t i = first; i < m_connections.size(); i += stride) {
+        schedule.emplace(m_connections[i]->startAt, i);
+    }
+    while (m_sending.load(std::memory_order_relaxed) && !schedule.empty()) {
+        auto [due, index] = schedule.top();
+        if (due > Clock::now()) {
+            // bounded so a stop request is noticed
+            std::this_thread::sleep_until(
+                std::min(due, Clock::now() + std::chrono::milliseconds(50)));
+            continue;
+        }
+        schedule.pop();
+        Connection &connection = *m_connections[index];
+        if (!connection.started.load(std::memory_order_relaxed)) {
+            if (connection.client->getCurrentState() == WSC::State::UNINITIALIZED) {
+                connection.client->connect();
+            }
+            if (!connection.client->isConnected()) {
+                // not up yet, a failed connection is retried by WSC itself if configured
+                schedule.emplace(Clock::now() + std::chrono::milliseconds(1), index);
+                continue;
+            }
+            connection.started = true;
+            if (!m_config.openLoop) {
+                for (int n = 0; n < m_config.inFlight; n++) sendOne(connection);
+                continue;
+            }
+            due = Clock::now();
+        }
+        sendOne(connection);
+        schedule.emplace(due + interval, index);
+    }
+}
+
+void LoadGenerator::startMeasuring() {
+    m_baseline = totals();
+    processUsage(m_baselineCpuSeconds, m_baselineContextSwitches);
+    m_baselineRingEnters = m_reactor ? m_reactor->statistics().enters : 0;
+    m_sendLatency.reset();
+    m_rtt.reset();
+    m_measuring = true;
+}
+
+LoadGenerator::Result LoadGenerator::run() {
+    using Clock = std::chrono::steady_clock;
+    const size_t count = static_cast<size_t>(m_config.connections);
+    const auto start = Clock::now() + std::chrono::milliseconds(10);
+
+    std::random_device seed;
+    for (size_t i = 0; i < count; i++) {
+        auto connection = std::make_unique<Connection>();
+        connection->client = std::make_unique<WSC>(m_config.url, m_config.client);
+        connection->startAt =
+            start + std::chrono::duration_cast<Clock::duration>(m_config.rampUp * i / count);
+        connection->rng.seed(seed());
+        Connection *raw = connection.get();
+        connection->client->setDataMessageCallback(
+            [this, raw](const WSCMessage &message) { onMessage(*raw, message); });
+        m_connections.push_back(std::move(connection));
+    }
+
+    size_t threads = m_config.senderThreads > 0 ? static_cast<size_t>(m_config.senderThreads)
+                                                : std::thread::hardware_concurrency();
+    threads = std::clamp<size_t>(threads, 1, count);
+
+    m_sending = true;
+    std::vector<std::thread> senders;
+    for (size_t t = 0; t < threads; t++) {
+        senders.emplace_back(&LoadGenerator::senderLoop, this, t, threads);
+    }
+
+    const auto measureStart = start + m_config.rampUp;
+    const auto measureEnd = measureStart + m_config.duration;
+    Totals previous = totals();
+    auto nextReport = Clock::now() + std::chrono::seconds(1);
+    bool measuring = false;
+    while (Clock::now() < measureEnd) {
+        std::this_thread::sleep_until(
+            std::min({nextReport, measureEnd, measuring ? measureEnd : measureStart}));
+        if (!measuring && Clock::now() >= measureStart) {
+            startMeasuring();
+            measuring = true;
+        }
+        if (Clock::now() >= nextReport) {
+            const Totals current = totals();
+            int connected = 0;
+            for (const auto &connection : m_connections) {
+                connected += connection->client->isConnected();
+            }
+            if (m_config.progress) {
+                std::cerr << "[" << (measuring ? "run " : "ramp") << "] connections " << connected
+                          << '/' << count << "  sent " << current.sent - previous.sent
+                          << " msg/s  received " << current.received - previous.received
+                          << " msg/s  failed " << current.sendFailures - previous.sendFailures
+                          << std::endl;
+            }
+            previous = current;
+            nextReport += std::chrono::seconds(1);
+        }
+    }
+    if (!measuring) startMeasuring();
+
+    m_sending = false;
+    for (auto &sender : senders) sender.join();
+    Result result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - measureStart).count();
+    const Totals sentTotals = totals();
+
+    // replies to messages sent inside the window still count
+    const auto drainEnd = Clock::now() + m_config.drain;
+    while (Clock::now() < drainEnd &&
+           m_received.load() - m_baseline.received < sentTotals.sent - m_baseline.sent) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    m_measuring = false;
+
+    const Totals end = totals();
+    processUsage(result.cpuSeconds, result.contextSwitches);
+    result.cpuSeconds -= m_baselineCpuSeconds;
+    result.contextSwitches -= m_baselineContextSwitches;
+    if (m_reactor) result.ringEnters = m_reactor->statistics().enters - m_baselineRingEnters;
+    for (const auto &connection : m_connections) {
+        result.connected += connection->client->isConnected();
+    }
+    result.messagesSent = sentTotals.sent - m_baseline.sent;
+    result.bytesSent = sentTotals.bytesSent - m_baseline.bytesSent;
+    result.sendFailures = sentTotals.sendFailures - m_baseline.sendFailures;
+    result.messagesReceived = end.received - m_baseline.received;
+    result.bytesReceived = end.bytesReceived - m_baseline.bytesReceived;
+    result.errors = end.errors - m_baseline.errors;
+    result.sendLatency = m_sendLatency.snapshot();
+    result.rtt = m_rtt.snapshot();
+    for (const auto &connection : m_connections) {
+        // whole connections, the handshake records are not counted anyway
+        const auto records = connection->client->getTlsRecordSnapshot();
+        if (records.count == 0) continue;
+        for (size_t i = 0; i < records.counts.size(); i++) {
+            result.tlsRecords.counts[i] += records.counts[i];
+        }
+        result.tlsRecords.min = result.tlsRecords.count
+                                    ? std::min(result.tlsRecords.min, records.min)
+                                    : records.min;
+        result.tlsRecords.count += records.count;
+        result.tlsRecords.sum += records.sum;
+        result.tlsRecords.max = std::max(result.tlsRecords.max, records.max);
+    }
+
+    for (auto &connection : m_connections) {
+        if (connection->client->isConnected()) connection->client->disconnect();
+    }
+    const auto closeEnd = Clock::now() + std::chrono::seconds(2);
+    for (auto &connection : m_connections) {
+        while (connection->client->isConnected() && Clock::now() < closeEnd) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    return result;
+}
+
+std::string LoadGenerator::toJson(const Config &config, const Result &result) {
+    std::ostringstream out;
+    out.precision(3);
+    out << std::fixed << "{\"config\":{\"url\":" << Json::quote(config.url)
+        << ",\"connections\":" << config.connections
+        << ",\"mode\":" << (config.openLoop ? "\"open\"" : "\"closed\"")
+        << ",\"rate\":" << Json::number(config.rate) << ",\"inFlight\":" << config.inFlight
+        << ",\"sizes\":" << Json::quote(config.sizes) << ",\"binaryRatio\":"
+        << Json::number(config.binaryRatio)
+        << ",\"rampUpSeconds\":" << config.rampUp.count() / 1000.0
+        << ",\"durationSeconds\":" << config.duration.count() / 1000.0 << "},";
+    out << "\"seconds\":" << Json::number(result.seconds) << ",\"connected\":" << result.connected
+        << ",\"messagesSent\":" << result.messagesSent
+        << ",\"messagesReceived\":" << result.messagesReceived
+        << ",\"bytesSent\":" << result.bytesSent << ",\"bytesReceived\":" << result.bytesReceived
+        << ",\"sendFailures\":" << result.sendFailures << ",\"errors\":" << result.errors
+        << ",\"sendRate\":" << Json::number(result.messagesSent / result.seconds)
+        << ",\"receiveRate\":" << Json::number(result.messagesReceived / result.seconds)
+        << ",\"sendMBps\":" << Json::number(result.bytesSent / result.seconds / 1e6)
+        << ",\"receiveMBps\":" << Json::number(result.bytesReceived / result.seconds / 1e6)
+        << ",\"cpuSeconds\":" << Json::number(result.cpuSeconds)
+        << ",\"contextSwitches\":" << result.contextSwitches
+        << ",\"ringEnters\":" << result.ringEnters << ",\"sendLatencyUs\":";
+    appendPercentiles(out, result.sendLatency, 1e3);
+    out << ",\"rttUs\":";
+    appendPercentiles(out, result.rtt, 1e3);
+    out << ",\"tlsRecordBytes\":";
+    appendPercentiles(out, result.tlsRecords, 1);
+    out << "}\n";
+    return out.str();
+}
+
+std::string LoadGenerator::toText(const Result &result) {
+    auto line = [](const char *name, const Histogram::Snapshot &h) {
+        char text[256];
+        std::snprintf(text, sizeof(text),
+                      "%-12s p50 %9.1f  p90 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f us (%llu)\n",
+                      name, h.percentile(50) / 1e3, h.percentile(90) / 1e3,
+                      h.percentile(99) / 1e3, h.percentile(99.9) / 1e3, h.max / 1e3,
+                      static_cast<unsigned long long>(h.count));
+        return std::string(text);
+    };
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "%.1fs, %d connected, sent %llu (%.0f msg/s, %.2f MB/s), received %llu "
+                  "(%.0f msg/s, %.2f MB/s), %llu send failures, %llu errors\n",
+                  result.seconds, result.connected,
+                  static_cast<unsigned long long>(result.messagesSent),
+                  result.messagesSent / result.seconds, result.bytesSent / result.seconds / 1e6,
+                  static_cast<unsigned long long>(result.messagesReceived),
+                  result.messagesReceived / result.seconds,
+                  result.bytesReceived / result.seconds / 1e6,
+                  static_cast<unsigned long long>(result.sendFailures),
+                  static_cast<unsigned long long>(result.errors));
+    char usage[256];
+    std::snprintf(usage, sizeof(usage),
+                  "process      cpu %.2f s, %llu context switches, %llu io_uring enters\n",
+                  result.cpuSeconds, static_cast<unsigned long long>(result.contextSwitches),
+                  static_cast<unsigned long long>(result.ringEnters));
+    char records[256] = "";
+    if (result.tlsRecords.count > 0) {
+        const auto &h = result.tlsRecords;
+        std::snprintf(records, sizeof(records),
+                      "tls records  p50 %7llu  p90 %7llu  max %7llu bytes (%llu records)\n",
+                      static_cast<unsigned long long>(h.percentile(50)),
+                      static_cast<unsigned long long>(h.percentile(90)),
+                      static_cast<unsigned long long>(h.max),
+                      static_cast<unsigned long long>(h.count));
+    }
+    return text + line("send call", result.sendLatency) + line("rtt", result.rtt) + usage +
+           records;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "WSCHistogram.h"
+#include "uring.h"
+#include "ws.h"
+
+// Message size distribution: "N" (fixed), "MIN-MAX" (uniform) or "exp:MEAN" (exponential)
+class SizeDistribution {
+   public:
+    explicit SizeDistribution(const std::string &spec);
+
+    size_t operator()(std::mt19937_64 &rng) const;
+    size_t max() const noexcept { return m_max; }
+    const std::string &spec() const noexcept { return m_spec; }
+
+   private:
+    enum class Kind { FIXED, UNIFORM, EXPONENTIAL };
+    std::string m_spec;
+    Kind m_kind = Kind::FIXED;
+    size_t m_min = 0;
+    size_t m_max = 0;
+    double m_mean = 0;
+};
+
+// Drives N WSC connections against a server and measures throughput, send call latency
+// and echo round trip time. Open-loop sends on a fixed schedule regardless of replies,
+// closed-loop keeps a fixed number of messages in flight per connection.
+class LoadGenerator {
+   public:
+    struct Config {
+        std::string url;
+        int connections;
+        bool openLoop;
+        double rate;   // messages per second over all connections, open-loop
+        int inFlight;  // per connection, closed-loop
+        std::string sizes;
+        double binaryRatio;  // share of binary messages, 0..1
+        std::chrono::milliseconds rampUp;
+        std::chrono::milliseconds duration;
+        std::chrono::milliseconds drain;  // wait for outstanding replies at the end
+        int senderThreads;
+        bool progress;  // per second lines on stderr
+        bool ioUring;   // connections share a WSCUringReactor
+        WSC::Config client;
+
+        Config()
+            : url("ws://127.0.0.1:9000"),
+              connections(1),
+              openLoop(false),
+              rate(1000),
+              inFlight(1),
+              sizes("128"),
+              binaryRatio(0.0),
+              rampUp(0),
+              duration(10 * 1000),  // 10 seconds
+              drain(2 * 1000),      // 2 seconds
+              senderThreads(0),     // 0 = min(connections, hardware threads)
+              progress(true),
+              ioUring(false) {}
+    };
+
+    using Histogram = WSCHistogram<7, 40>;  // nanoseconds
+
+    struct Result {
+        double seconds = 0;  // measured window, after ramp-up
+        int connected = 0;
+        uint64_t messagesSent = 0;
+        uint64_t messagesReceived = 0;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t sendFailures = 0;
+        uint64_t errors = 0;
+        Histogram::Snapshot sendLatency;
+        Histogram::Snapshot rtt;
+        // whole process over the measured window
+        double cpuSeconds = 0;
+        uint64_t contextSwitches = 0;
+        uint64_t ringEnters = 0;  // io_uring_enter() calls of the reactor, with --io-uring
+        // bytes per TLS record written, over the connections' whole lifetime
+        WSCTlsRecords::SizeHistogram::Snapshot tlsRecords;
+    };
+
+    explicit LoadGenerator(const Config &config);
+    ~LoadGenerator();
+
+    LoadGenerator(const LoadGenerator &) = delete;
+    LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+    Result run();
+
+    static std::string toJson(const Config &config, const Result &result);
+    static std::string toText(const Result &result);
+
+   private:
+    struct Connection {
+        std::unique_ptr<WSC> client;
+        std::chrono::steady_clock::time_point startAt;  // ramp-up slot
+        std::atomic<bool> started{false};
+        std::mutex sendMutex;  // closed-loop sends come from the sender and receive threads
+        std::mt19937_64 rng;
+    };
+
+    struct Totals {
+        uint64_t sent, received, bytesSent, bytesReceived, sendFailures, errors;
+    };
+    Totals totals() const;
+
+    void sendOne(Connection &connection);
+    void onMessage(Connection &connection, const WSCMessage &message);
+    void senderLoop(size_t first, size_t stride);
+    void startMeasuring();
+
+    Config m_config;
+    std::unique_ptr<WSCUringReactor> m_reactor;  // outlives the connections
+    SizeDistribution m_sizes;
+    std::string m_filler;  // payload body, the header is written over its first bytes
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    std::atomic<bool> m_sending{false};
+    std::atomic<bool> m_measuring{false};
+
+    std::atomic<uint64_t> m_sent{0};
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_bytesSent{0};
+    std::atomic<uint64_t> m_bytesReceived{0};
+    std::atomic<uint64_t> m_sendFailures{0};
+    Totals m_baseline{};  // totals when the measured window started
+    double m_baselineCpuSeconds = 0;
+    uint64_t m_baselineContextSwitches = 0;
+    uint64_t m_baselineRingEnters = 0;
+    Histogram m_sendLatency;
+    Histogram m_rtt;
+};
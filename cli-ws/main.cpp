@@ -1,53 +1,342 @@
-
-#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
-#include "ws.h"
+#include "WSCThread.h"
+#include "args.h"
+#include "broadcast.h"
+#include "impair.h"
+#include "latency.h"
+#include "load.h"
+#include "metrics.h"
+#include "replay.h"
+#include "scenario.h"
 
-int main() {
-    try {
-        WSC::Config config;
-        // config.autoPing = false;
-        config.subprotocols = {"echo"};
-        WSC wsc("ws://192.168.0.175:9000", config);
-        wsc.setDataMessageCallback([](const Message &msg) {
-            std::cout << "[DataMessageCallback] [" << msg.getFormattedTimestamp() << "] ";
-            std::cout << "Received message: ";
-            std::cout << msg.getPayload() << std::endl;
-        });
-        wsc.setControlMessageCallback([](const Message &msg) {
-            std::cout << "[ControlMessageCallback] [" << msg.getFormattedTimestamp() << "] ";
-            std::cout << "Received control message: ";
-            std::cout << msg.getPayload() << std::endl;
-        });
-        wsc.setStateChangeCallback([](const std::string &state) {
-            std::cout << "[StateChangeCallback] State changed to: ";
-            std::cout << state << std::endl;
-        });
-        if (!wsc.connect()) {
-            std::cout << "Failed to connect to server" << std::endl;
+namespace {
+    void usage(const char *program) {
+        std::cerr
+            << "Usage: " << program << " load|latency|impair|proxy|replay|broadcast [options]\n"
+            << "\n"
+            << "load: drive connections against a (local echo) server\n"
+            << "  --url URL             server url (ws://127.0.0.1:9000)\n"
+            << "  --connections N       concurrent connections (1)\n"
+            << "  --mode open|closed    fixed schedule or fixed messages in flight (closed)\n"
+            << "  --rate R              open-loop messages per second, all connections (1000)\n"
+            << "  --in-flight W         closed-loop messages in flight per connection (1)\n"
+            << "  --size SPEC           N, MIN-MAX (uniform) or exp:MEAN bytes (128)\n"
+            << "  --binary-ratio F      share of binary messages, 0..1 (0)\n"
+            << "  --ramp-up S           seconds to bring all connections up (0)\n"
+            << "  --duration S          measured seconds after ramp-up (10)\n"
+            << "  --threads N           sender threads (hardware threads)\n"
+            << "  --subprotocol P       Sec-WebSocket-Protocol to request (echo)\n"
+            << "  --capture FILE        record every frame of every connection\n"
+            << "  --io-uring            serve all connections from one io_uring reactor (Linux)\n"
+            << "  --ktls                hand TLS records of wss:// connections to the kernel\n"
+            << "  --tls-records         small TLS records after idle, 16KB ones under load\n"
+            << "  --metrics-port P      serve OpenMetrics on 127.0.0.1:P/metrics while running\n"
+            << "  --json FILE           write the summary as JSON, - for stdout\n"
+            << "  --quiet               no per second progress\n"
+            << "\n"
+            << "latency: open-loop echo latency, measured from the scheduled send time\n"
+            << "  --url URL             echo server url (ws://127.0.0.1:9000)\n"
+            << "  --connections N       connections sharing the schedule (1)\n"
+            << "  --rate R              messages per second (10000)\n"
+            << "  --size N              payload bytes (128)\n"
+            << "  --binary              binary instead of text messages\n"
+            << "  --warmup S            seconds sent before recording starts (2)\n"
+            << "  --duration S          measured seconds (10)\n"
+            << "  --subprotocol P       Sec-WebSocket-Protocol to request (echo)\n"
+            << "  --io-uring            serve all connections from one io_uring reactor (Linux)\n"
+            << "  --receive-cpus LIST   pin the receive threads, e.g. 2-3 (not pinned)\n"
+            << "  --send-cpus LIST      pin the send threads (not pinned)\n"
+            << "  --control-cpus LIST   pin the command and ping threads (not pinned)\n"
+            << "  --busy-poll US        spin the receive threads for US after data (0, block)\n"
+            << "  --socket-busy-poll US SO_BUSY_POLL on every socket (0)\n"
+            << "  --json FILE           write the summary as JSON, - for stdout\n"
+            << "  --quiet               no per second progress\n"
+            << "\n"
+            << "impair: one echo connection through an impaired link, reports recovery\n"
+            << "  --url URL             echo server url, reached through a local proxy\n"
+            << "  --scenario NAME|FILE  built-in scenario or profile file (flaky)\n"
+            << "  --duration S          seconds (30)\n"
+            << "  --rate R              messages per second (200)\n"
+            << "  --size N              payload bytes (256)\n"
+            << "  --reconnect-delay S   wait before reconnecting (0.1)\n"
+            << "  --json FILE           write the summary as JSON, - for stdout\n"
+            << "  --quiet               no per second progress\n"
+            << "\n"
+            << "proxy: impaired TCP proxy for any client\n"
+            << "  --target HOST:PORT    upstream server\n"
+            << "  --listen PORT         local port (9100)\n"
+            << "  --profile NAME|FILE   scenario or profile to play, none by default\n"
+            << "  --duration S          seconds to run, 0 until killed (0)\n"
+            << "\n"
+            << "replay FILE: send the messages of a capture file with the recorded timing\n"
+            << "  --url URL             server url (ws://127.0.0.1:9000)\n"
+            << "  --direction D         sent or received messages of the capture (sent)\n"
+            << "  --connection ID       only this recorded connection, 0 for all (0)\n"
+            << "  --speed X             scale the recorded timing, 2 is twice as fast (1)\n"
+            << "  --fast                as fast as possible instead of the recorded timing\n"
+            << "  --connections N       connections, each replays every message (1)\n"
+            << "  --threads N           sender threads (hardware threads)\n"
+            << "  --spin-us N           spin the last N us of every wait (100)\n"
+            << "  --dry-run             only report what would be replayed\n"
+            << "  --subprotocol P       Sec-WebSocket-Protocol to request (echo)\n"
+            << "  --json FILE           write the summary as JSON, - for stdout\n"
+            << "  --quiet               no per second progress\n"
+            << "\n"
+            << "broadcast: one message to many connections, shared frame against a copy each\n"
+            << "  --url URL             server url (ws://127.0.0.1:9000/sink)\n"
+            << "  --connections N       connections (1000)\n"
+            << "  --broadcasts N        broadcasts per mode (1000)\n"
+            << "  --rate R              broadcasts per second (100)\n"
+            << "  --size N              payload bytes (256)\n"
+            << "  --mode copy|shared|both  sendText() per connection, WSCManager or both (both)\n"
+            << "  --subprotocol P       Sec-WebSocket-Protocol to request (echo)\n"
+            << "  --json FILE           write the summary as JSON, - for stdout\n"
+            << "  --quiet               no per second progress\n"
+            << "\n"
+            << "scenarios:";
+        for (const auto &name : ImpairProfile::scenarioNames()) std::cerr << ' ' << name;
+        std::cerr << "\n";
+    }
+
+    bool writeJson(const std::string &json, const std::string &path) {
+        if (path == "-") {
+            std::cout << json;
+            return true;
+        }
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        file << json;
+        if (!file) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::chrono::milliseconds seconds(double value) {
+        return std::chrono::milliseconds(static_cast<int64_t>(value * 1000));
+    }
+
+    int runLoad(const Args &args) {
+        LoadGenerator::Config config;
+        config.url = args.get<std::string>("url", config.url);
+        config.connections = args.get("connections", config.connections);
+        const std::string mode = args.get<std::string>("mode", "closed");
+        if (mode != "open" && mode != "closed") {
+            throw std::invalid_argument("--mode must be open or closed");
+        }
+        config.openLoop = mode == "open";
+        config.rate = args.get("rate", config.rate);
+        config.inFlight = args.get("in-flight", config.inFlight);
+        config.sizes = args.get<std::string>("size", config.sizes);
+        config.binaryRatio = args.get("binary-ratio", config.binaryRatio);
+        config.rampUp = seconds(args.get("ramp-up", 0.0));
+        config.duration = seconds(args.get("duration", 10.0));
+        config.senderThreads = args.get("threads", config.senderThreads);
+        config.progress = !args.get("quiet", false);
+        config.ioUring = args.get("io-uring", false);
+        config.client.kernelTls = args.get("ktls", false);
+        config.client.tlsRecords.enabled = args.get("tls-records", false);
+        config.client.subprotocols = {args.get<std::string>("subprotocol", "echo")};
+        config.client.autoReconnect = false;
+        const std::string capture = args.get<std::string>("capture", "");
+        const std::string json = args.get<std::string>("json", "");
+        const int metricsPort = args.get("metrics-port", -1);
+        args.rejectUnknown();
+        if (!capture.empty()) config.client.capture = std::make_shared<WSCCapture>(capture);
+
+        std::unique_ptr<WSCMetrics> metrics;
+        if (metricsPort >= 0) {
+            WSCMetrics::Config metricsConfig;
+            metricsConfig.port = static_cast<uint16_t>(metricsPort);
+            metrics = std::make_unique<WSCMetrics>(metricsConfig);
+            if (!metrics->start()) return 1;
+            std::cerr << "metrics on http://127.0.0.1:" << metrics->getPort()
+                      << metricsConfig.path << std::endl;
+        }
+
+        LoadGenerator generator(config);
+        const LoadGenerator::Result result = generator.run();
+        std::cout << LoadGenerator::toText(result);
+        if (!json.empty() && !writeJson(LoadGenerator::toJson(config, result), json)) return 1;
+        return result.connected == config.connections ? 0 : 1;
+    }
+
+    int runImpair(const Args &args) {
+        ImpairScenario::Config config;
+        config.url = args.get<std::string>("url", config.url);
+        config.profile = args.get<std::string>("scenario", config.profile);
+        config.duration = seconds(args.get("duration", 30.0));
+        config.rate = args.get("rate", config.rate);
+        config.size = args.get("size", config.size);
+        config.reconnectDelay = seconds(args.get("reconnect-delay", 0.1));
+        config.progress = !args.get("quiet", false);
+        config.client.subprotocols = {args.get<std::string>("subprotocol", "echo")};
+        config.client.autoReconnect = false;  // reconnecting is timed by the scenario
+        const std::string json = args.get<std::string>("json", "");
+        args.rejectUnknown();
+
+        ImpairScenario scenario(config);
+        const ImpairScenario::Result result = scenario.run();
+        std::cout << ImpairScenario::toText(result);
+        if (!json.empty() && !writeJson(ImpairScenario::toJson(config, result), json)) return 1;
+        return 0;
+    }
+
+    int runProxy(const Args &args) {
+        ImpairProxy::Config config;
+        const std::string target = args.get<std::string>("target", "");
+        const auto colon = target.rfind(':');
+        if (colon == std::string::npos) throw std::invalid_argument("--target HOST:PORT needed");
+        config.upstreamHost = target.substr(0, colon);
+        config.upstreamPort = static_cast<uint16_t>(std::stoul(target.substr(colon + 1)));
+        config.listenPort = args.get<uint16_t>("listen", 9100);
+        const std::string profile = args.get<std::string>("profile", "");
+        const double duration = args.get("duration", 0.0);
+        args.rejectUnknown();
+
+        ImpairProxy proxy(config);
+        proxy.start();
+        if (!profile.empty()) proxy.play(ImpairProfile::load(profile));
+        std::cerr << "Forwarding 127.0.0.1:" << proxy.port() << " to " << target << std::endl;
+        const auto end = std::chrono::steady_clock::now() + seconds(duration);
+        while (duration <= 0 || std::chrono::steady_clock::now() < end) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        const auto statistics = proxy.getStatistics();
+        std::cerr << statistics.connections << " connections, " << statistics.resets
+                  << " resets, " << statistics.bytesForwarded << " bytes forwarded" << std::endl;
+        return 0;
+    }
+
+    int runReplay(const Args &args) {
+        CaptureReplay::Config config;
+        if (args.positional().size() != 1) throw std::invalid_argument("replay FILE needed");
+        config.file = args.positional()[0];
+        config.url = args.get<std::string>("url", config.url);
+        const std::string direction = args.get<std::string>("direction", "sent");
+        if (direction != "sent" && direction != "received") {
+            throw std::invalid_argument("--direction must be sent or received");
+        }
+        config.direction = direction == "sent" ? WSCCapture::Direction::SENT
+                                               : WSCCapture::Direction::RECEIVED;
+        config.connection = args.get("connection", config.connection);
+        config.asFastAsPossible = args.get("fast", false);
+        config.speed = args.get("speed", config.speed);
+        if (config.speed <= 0) throw std::invalid_argument("--speed must be positive");
+        config.connections = args.get("connections", config.connections);
+        if (config.connections < 1) throw std::invalid_argument("--connections must be >= 1");
+        config.senderThreads = args.get("threads", config.senderThreads);
+        config.spin = std::chrono::microseconds(args.get<int64_t>("spin-us", 100));
+        config.progress = !args.get("quiet", false);
+        config.client.subprotocols = {args.get<std::string>("subprotocol", "echo")};
+        config.client.autoReconnect = false;
+        const bool dryRun = args.get("dry-run", false);
+        const std::string json = args.get<std::string>("json", "");
+        args.rejectUnknown();
+
+        CaptureReplay replay(config);
+        if (dryRun) {
+            const auto &messages = replay.messages();
+            std::cout << replay.records() << " records, " << messages.size()
+                      << " messages selected over "
+                      << (messages.empty() ? 0.0 : messages.back().offsetNs / 1e9) << "s"
+                      << std::endl;
+            return 0;
+        }
+        const CaptureReplay::Result result = replay.run();
+        std::cout << CaptureReplay::toText(result);
+        if (!json.empty() && !writeJson(CaptureReplay::toJson(config, result), json)) return 1;
+        return result.sendFailures == 0 ? 0 : 1;
+    }
+
+    int runBroadcast(const Args &args) {
+        BroadcastBenchmark::Config config;
+        config.url = args.get<std::string>("url", config.url);
+        config.connections = args.get("connections", config.connections);
+        config.broadcasts = args.get("broadcasts", config.broadcasts);
+        config.rate = args.get("rate", config.rate);
+        config.size = args.get("size", config.size);
+        const std::string mode = args.get<std::string>("mode", "both");
+        if (mode == "copy") {
+            config.modes = {BroadcastBenchmark::Mode::COPY};
+        } else if (mode == "shared") {
+            config.modes = {BroadcastBenchmark::Mode::SHARED};
+        } else if (mode != "both") {
+            throw std::invalid_argument("--mode must be copy, shared or both");
+        }
+        config.progress = !args.get("quiet", false);
+        config.client.subprotocols = {args.get<std::string>("subprotocol", "echo")};
+        config.client.autoReconnect = false;
+        const std::string json = args.get<std::string>("json", "");
+        args.rejectUnknown();
+
+        BroadcastBenchmark benchmark(config);
+        const auto results = benchmark.run();
+        std::cout << BroadcastBenchmark::toText(results);
+        if (!json.empty() && !writeJson(BroadcastBenchmark::toJson(config, results), json)) {
             return 1;
         }
-        int i = 0;
-        while (wsc.getCurrentState() != WSC::State::DISCONNECTED) {
-            i++;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            std::string message = "HELLO WOORLD " + std::to_string(i);
-            if (!wsc.sendText(message)) {
-                std::cerr << "Failed to send message" << std::endl;
-            }
-            if (i == 50) {
-                wsc.reconnect();
-            }
-            if (i > 100) {
-                message = "close";
-                if (!wsc.sendText(message)) {
-                    std::cerr << "Failed to send message" << std::endl;
-                }
-            }
-        }
-        std::cout << "EXITING" << std::endl;
+        return 0;
+    }
+
+    int runLatency(const Args &args) {
+        LatencyBenchmark::Config config;
+        config.url = args.get<std::string>("url", config.url);
+        config.connections = args.get("connections", config.connections);
+        config.rate = args.get("rate", config.rate);
+        config.size = args.get("size", config.size);
+        config.binary = args.get("binary", false);
+        config.warmup = seconds(args.get("warmup", 2.0));
+        config.duration = seconds(args.get("duration", 10.0));
+        config.progress = !args.get("quiet", false);
+        config.client.subprotocols = {args.get<std::string>("subprotocol", "echo")};
+        config.client.autoReconnect = false;
+        config.ioUring = args.get("io-uring", false);
+        const auto cpus = [&args](const char *name) {
+            return WSCThread::parseCpuList(args.get<std::string>(name, ""));
+        };
+        config.client.receiveCpus = cpus("receive-cpus");
+        config.client.sendCpus = cpus("send-cpus");
+        config.client.controlCpus = cpus("control-cpus");
+        config.client.busyPoll = std::chrono::microseconds(args.get("busy-poll", 0));
+        config.client.socketBusyPoll = std::chrono::microseconds(args.get("socket-busy-poll", 0));
+        const std::string json = args.get<std::string>("json", "");
+        args.rejectUnknown();
+
+        // the histograms are large, keep them off the stack
+        auto benchmark = std::make_unique<LatencyBenchmark>(config);
+        const auto result = std::make_unique<LatencyBenchmark::Result>(benchmark->run());
+        std::cout << LatencyBenchmark::toText(*result);
+        if (!json.empty() && !writeJson(LatencyBenchmark::toJson(config, *result), json)) {
+            return 1;
+        }
+        return result->timeouts == 0 ? 0 : 1;
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (command.empty() || command == "help" || command == "--help") {
+        usage(argv[0]);
+        return command.empty() ? 1 : 0;
+    }
+    try {
+        WSCLogger::init("WSCli", "WSCli.txt", spdlog::level::warn);
+        const Args args(argc, argv, 2);
+        if (command == "load") return runLoad(args);
+        if (command == "latency") return runLatency(args);
+        if (command == "impair") return runImpair(args);
+        if (command == "proxy") return runProxy(args);
+        if (command == "replay") return runReplay(args);
+        if (command == "broadcast") return runBroadcast(args);
+        std::cerr << "Unknown command: " << command << "\n\n";
+        usage(argv[0]);
+        return 1;
     } catch (const std::exception &e) {
         std::cerr << e.what() << std::endl;
+        return 1;
     }
 }
@@ -0,0 +1,215 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "json.h"
+#include "stamp.h"
+
+CaptureReplay::CaptureReplay(const Config &config)
+    : m_config(config), m_reader(config.file) {
+    struct Pending {
+        bool binary = false;
+        std::string payload;
+    };
+    std::map<uint64_t, Pending> fragments;  // per recorded connection
+    int64_t firstNs = 0;
+
+    for (size_t i = 0; i < m_reader.size(); i++) {
+        const WSCCaptureReader::Record record = m_reader[i];
+        if (record.direction != m_config.direction) continue;
+        if (m_config.connection != 0 && record.connection != m_config.connection) continue;
+
+        const int opcode = record.opcode();
+        std::string_view payload = record.payload;
+        bool binary = opcode == WSCMessageType::BINARY;
+        if (opcode == WSCMessageType::CONTINUATION) {
+            auto it = fragments.find(record.connection);
+            if (it == fragments.end()) continue;  // the start was not captured
+            it->second.payload.append(payload);
+            if (!record.isFinal()) continue;
+            binary = it->second.binary;
+            payload = m_reassembled.emplace_back(std::move(it->second.payload));
+            fragments.erase(it);
+        } else if (opcode != WSCMessageType::TEXT && opcode != WSCMessageType::BINARY) {
+            continue;
+        } else if (!record.isFinal()) {
+            fragments[record.connection] = Pending{binary, std::string(payload)};
+            continue;
+        }
+
+        if (m_messages.empty()) firstNs = record.timestampNs;
+        m_messages.push_back(Message{record.timestampNs - firstNs, binary, payload});
+    }
+}
+
+CaptureReplay::~CaptureReplay() { m_clients.clear(); }
+
+void CaptureReplay::sendLoop(int thread, int threads, int64_t startNs) {
+    std::vector<WSC *> clients;
+    for (size_t i = thread; i < m_clients.size(); i += threads) {
+        clients.push_back(m_clients[i].get());
+    }
+    std::string text;
+    std::vector<uint8_t> binary;
+    for (const Message &message : m_messages) {
+        const int64_t dueNs =
+            startNs + static_cast<int64_t>(static_cast<double>(message.offsetNs) / m_config.speed);
+        if (!m_config.asFastAsPossible) Stamp::waitUntil(dueNs, m_config.spin.count() * 1000);
+        if (message.binary) {
+            binary.assign(message.payload.begin(), message.payload.end());
+        } else {
+            text.assign(message.payload);
+        }
+        for (WSC *client : clients) {
+            const int64_t driftNs = Stamp::steadyNowNs() - dueNs;
+            if (!m_config.asFastAsPossible) {
+                m_drift.record(static_cast<uint64_t>(std::max<int64_t>(driftNs, 0)));
+                if (driftNs > kLateNs) m_late.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (message.binary ? client->sendBinary(binary) : client->sendText(text)) {
+                m_sent.fetch_add(1, std::memory_order_relaxed);
+                m_bytesSent.fetch_add(message.payload.size(), std::memory_order_relaxed);
+            } else {
+                m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+CaptureReplay::Result CaptureReplay::run() {
+    Result result;
+    result.records = m_reader.size();
+    result.messages = m_messages.size();
+    if (m_messages.empty()) return result;
+    result.recordedSeconds = m_messages.back().offsetNs / 1e9;
+    result.scheduledSeconds =
+        m_config.asFastAsPossible ? 0 : result.recordedSeconds / m_config.speed;
+
+    for (int i = 0; i < m_config.connections; i++) {
+        auto client = std::make_unique<WSC>(m_config.url, m_config.client);
+        client->connect();
+        m_clients.push_back(std::move(client));
+    }
+    const auto connectEnd = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (auto &client : m_clients) {
+        while (!client->isConnected()) {
+            if (std::chrono::steady_clock::now() > connectEnd) {
+                throw std::runtime_error("Could not connect to " + m_config.url);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    result.connected = static_cast<int>(m_clients.size());
+
+    size_t threads = m_config.senderThreads > 0 ? static_cast<size_t>(m_config.senderThreads)
+                                                : std::thread::hardware_concurrency();
+    threads = std::clamp<size_t>(threads, 1, m_clients.size());
+
+    // a common start a little ahead, so no thread begins behind schedule
+    const int64_t startNs = Stamp::steadyNowNs() + 10 * 1000 * 1000;
+    std::atomic<size_t> running{threads};
+    std::vector<std::thread> senders;
+    for (size_t t = 0; t < threads; t++) {
+        senders.emplace_back([this, t, threads, startNs, &running] {
+            sendLoop(static_cast<int>(t), static_cast<int>(threads), startNs);
+            running.fetch_sub(1);
+        });
+    }
+    const uint64_t total = m_messages.size() * m_clients.size();
+    int64_t nextReportNs = startNs + 1000 * 1000 * 1000;
+    uint64_t reported = 0;
+    while (running.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!m_config.progress || Stamp::steadyNowNs() < nextReportNs) continue;
+        const uint64_t sent = m_sent.load();
+        const auto drift = m_drift.snapshot();
+        std::cerr << "replayed " << sent << "/" << total << " (" << sent - reported
+                  << " msg/s)  drift p99 " << drift.percentile(99) / 1e3 << " us  max "
+                  << drift.max / 1e3 << " us" << std::endl;
+        reported = sent;
+        nextReportNs += 1000 * 1000 * 1000;
+    }
+    for (auto &sender : senders) sender.join();
+
+    // sendText() only queues, the replay is over once the send threads wrote everything
+    const auto drainEnd = std::chrono::steady_clock::now() + m_config.drain;
+    for (auto &client : m_clients) {
+        while (client->isConnected() && std::chrono::steady_clock::now() < drainEnd) {
+            const WSC::Statistics stats = client->getStatistics();
+            if (stats.sendQueueDepth == 0 && stats.messagesSent >= m_messages.size()) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    result.seconds = (Stamp::steadyNowNs() - startNs) / 1e9;
+    result.messagesSent = m_sent.load();
+    result.bytesSent = m_bytesSent.load();
+    result.sendFailures = m_sendFailures.load();
+    result.late = m_late.load();
+    result.drift = m_drift.snapshot();
+
+    for (auto &client : m_clients) {
+        if (client->isConnected()) client->disconnect();
+    }
+    const auto closeEnd = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    for (auto &client : m_clients) {
+        while (client->isConnected() && std::chrono::steady_clock::now() < closeEnd) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    return result;
+}
+
+std::string CaptureReplay::toJson(const Config &config, const Result &result) {
+    std::ostringstream out;
+    out.precision(3);
+    out << std::fixed << "{\"config\":{\"file\":" << Json::quote(config.file)
+        << ",\"url\":" << Json::quote(config.url) << ",\"direction\":"
+        << (config.direction == WSCCapture::Direction::SENT ? "\"sent\"" : "\"received\"")
+        << ",\"connection\":" << config.connection
+        << ",\"asFastAsPossible\":" << (config.asFastAsPossible ? "true" : "false")
+        << ",\"speed\":" << Json::number(config.speed) << ",\"connections\":" << config.connections
+        << "},";
+    out << "\"records\":" << result.records << ",\"messages\":" << result.messages
+        << ",\"connected\":" << result.connected << ",\"messagesSent\":" << result.messagesSent
+        << ",\"bytesSent\":" << result.bytesSent << ",\"sendFailures\":" << result.sendFailures
+        << ",\"recordedSeconds\":" << Json::number(result.recordedSeconds)
+        << ",\"scheduledSeconds\":" << Json::number(result.scheduledSeconds)
+        << ",\"seconds\":" << Json::number(result.seconds)
+        << ",\"late\":" << result.late << ",\"driftUs\":";
+    const auto &h = result.drift;
+    out << "{\"count\":" << h.count << ",\"mean\":" << Json::number(h.mean() / 1e3);
+    const std::pair<const char *, double> percentiles[] = {
+        {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}};
+    for (const auto &[name, p] : percentiles) {
+        out << ",\"" << name << "\":" << Json::number(h.percentile(p) / 1e3);
+    }
+    out << ",\"max\":" << Json::number(h.max / 1e3) << "}}\n";
+    return out.str();
+}
+
+std::string CaptureReplay::toText(const Result &result) {
+    char text[1024];
+    const auto &h = result.drift;
+    std::snprintf(text, sizeof(text),
+                  "%llu records, %llu messages x %d connections, %llu sent (%llu bytes), "
+                  "%llu failed\n"
+                  "recorded over %.3fs, scheduled over %.3fs, replayed in %.3fs\n"
+                  "drift  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f us, "
+                  "%llu sends more than 1ms late\n",
+                  static_cast<unsigned long long>(result.records),
+                  static_cast<unsigned long long>(result.messages), result.connected,
+                  static_cast<unsigned long long>(result.messagesSent),
+                  static_cast<unsigned long long>(result.bytesSent),
+                  static_cast<unsigned long long>(result.sendFailures), result.recordedSeconds,
+                  result.scheduledSeconds, result.seconds, h.percentile(50) / 1e3,
+                  h.percentile(90) / 1e3, h.percentile(99) / 1e3, h.percentile(99.9) / 1e3,
+                  h.max / 1e3, static_cast<unsigned long long>(result.late));
+    return text;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WSCHistogram.h"
+#include "capture.h"
+#include "ws.h"
+
+// Sends the data messages of a capture file (see WSCCapture) through WSC connections with
+// the recorded gaps between them, scaled by `speed`, or as fast as the clients take them.
+// Every connection replays the whole sequence, so N connections multiply the load and keep
+// its burst shape. Fragmented frames are reassembled first, control frames are left to the
+// client.
+//
+// Sends are scheduled from the start of the replay, a late send does not push the following
+// ones back. The drift is how far each send call started after its scheduled time.
+class CaptureReplay {
+   public:
+    struct Config {
+        std::string file;
+        std::string url;
+        WSCCapture::Direction direction;  // which side of the capture is sent
+        uint64_t connection;              // recorded connection id, 0 for all of them
+        bool asFastAsPossible;
+        double speed;     // 2 replays twice as fast as recorded, 0.5 at half the speed
+        int connections;  // each replays every message
+        int senderThreads;
+        std::chrono::microseconds spin;   // the end of every wait is spun instead of slept
+        std::chrono::milliseconds drain;  // wait for the send queues at the end
+        bool progress;
+        WSC::Config client;
+
+        Config()
+            : url("ws://127.0.0.1:9000"),
+              direction(WSCCapture::Direction::SENT),
+              connection(0),
+              asFastAsPossible(false),
+              speed(1.0),
+              connections(1),
+              senderThreads(0),  // 0 = min(connections, hardware threads)
+              spin(100),
+              drain(5 * 1000),  // 5 seconds
+              progress(true) {}
+    };
+
+    struct Message {
+        int64_t offsetNs;  // since the first message, as recorded
+        bool binary;
+        std::string_view payload;
+    };
+
+    using Histogram = WSCHistogram<7, 40>;  // nanoseconds
+
+    struct Result {
+        uint64_t records = 0;   // in the file
+        uint64_t messages = 0;  // selected for replay, per connection
+        int connected = 0;
+        uint64_t messagesSent = 0;  // all connections
+        uint64_t bytesSent = 0;
+        uint64_t sendFailures = 0;
+        uint64_t late = 0;           // sends that started more than kLateNs behind schedule
+        double recordedSeconds = 0;  // first to last selected message
+        double scheduledSeconds = 0;  // recordedSeconds / speed
+        double seconds = 0;           // first send to the send queues drained
+        Histogram::Snapshot drift;
+    };
+
+    static constexpr int64_t kLateNs = 1000 * 1000;  // 1ms
+
+    explicit CaptureReplay(const Config &config);
+    ~CaptureReplay();
+
+    const std::vector<Message> &messages() const noexcept { return m_messages; }
+    uint64_t records() const noexcept { return m_reader.size(); }
+
+    Result run();
+
+    static std::string toJson(const Config &config, const Result &result);
+    static std::string toText(const Result &result);
+
+   private:
+    void sendLoop(int thread, int threads, int64_t startNs);
+
+    Config m_config;
+    WSCCaptureReader m_reader;
+    std::list<std::string> m_reassembled;  // payloads of fragmented messages
+    std::vector<Message> m_messages;
+    std::vector<std::unique_ptr<WSC>> m_clients;
+
+    std::atomic<uint64_t> m_sent{0};
+    std::atomic<uint64_t> m_bytesSent{0};
+    std::atomic<uint64_t> m_sendFailures{0};
+    std::atomic<uint64_t> m_late{0};
+    Histogram m_drift;
+};
@@ -0,0 +1,254 @@
+#include "scenario.h"
+
+#include <Poco/URI.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "json.h"
+#include "stamp.h"
+
+namespace {
+    // VmRSS / VmHWM of this process in kB, 0 where /proc is not available
+    uint64_t readStatusKb(const std::string &field) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind(field + ":", 0) == 0) {
+                return std::strtoull(line.c_str() + field.size() + 1, nullptr, 10);
+            }
+        }
+        return 0;
+    }
+
+    struct Recovery {
+        double min = 0, mean = 0, max = 0;
+    };
+
+    Recovery summarize(const std::vector<double> &values) {
+        if (values.empty()) return {};
+        const auto [min, max] = std::minmax_element(values.begin(), values.end());
+        return {*min, std::accumulate(values.begin(), values.end(), 0.0) / values.size(), *max};
+    }
+}  // namespace
+
+ImpairScenario::ImpairScenario(const Config &config)
+    : m_config(config), m_profile(ImpairProfile::load(config.profile)) {
+    if (m_config.rate <= 0) throw std::invalid_argument("The rate must be positive");
+}
+
+ImpairScenario::Result ImpairScenario::run() {
+    using Clock = std::chrono::steady_clock;
+
+    // the client keeps the path and scheme, only the endpoint moves to the proxy
+    const std::string httpUrl = "http" + m_config.url.substr(m_config.url.find(':'));
+    const Poco::URI target(httpUrl);
+    if (m_config.url.rfind("ws://", 0) != 0) {
+        throw std::invalid_argument("Only ws:// targets can be proxied");
+    }
+    ImpairProxy::Config proxyConfig;
+    proxyConfig.upstreamHost = target.getHost();
+    proxyConfig.upstreamPort = target.getPort();
+    ImpairProxy proxy(proxyConfig);
+    proxy.start();
+    const std::string url = "ws://127.0.0.1:" + std::to_string(proxy.port()) +
+                            (target.getPathAndQuery().empty() ? "/" : target.getPathAndQuery());
+
+    Result result;
+    result.rssStartKb = readStatusKb("VmRSS");
+    Histogram rtt;
+    std::atomic<uint64_t> received{0};
+
+    // connection events, written by the WSC threads
+    std::mutex eventsMutex;
+    bool connected = false;
+    bool finished = false;  // the closing disconnect is not counted
+    Clock::time_point disconnectedAt;
+    uint64_t resetsAtConnect = 0;
+    std::string lastError;
+
+    WSC client(url, m_config.client);
+    client.setDataMessageCallback([&](const WSCMessage &message) {
+        received.fetch_add(1, std::memory_order_relaxed);
+        int64_t sendNs;
+        if (Stamp::read(message.payload, &sendNs)) {
+            const int64_t elapsed = Stamp::steadyNowNs() - sendNs;
+            rtt.record(static_cast<uint64_t>(std::max<int64_t>(elapsed, 0)));
+        }
+    });
+    client.setErrorCallback([&](const std::string &reason) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        lastError = reason;
+    });
+    client.setStateChangeCallback([&](const std::string &state) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        const auto now = Clock::now();
+        if (finished) return;
+        if (state == "CONNECTED") {
+            if (disconnectedAt != Clock::time_point{}) {
+                result.recoveryMs.push_back(
+                    std::chrono::duration<double, std::milli>(now - disconnectedAt).count());
+            }
+            connected = true;
+            resetsAtConnect = proxy.getStatistics().resets;
+            lastError.clear();
+        } else if (connected && (state == "WS_ERROR" || state == "DISCONNECTING" ||
+                                 state == "DISCONNECTED")) {
+            connected = false;
+            disconnectedAt = now;
+            result.disconnects++;
+            const bool byProxy = proxy.getStatistics().resets > resetsAtConnect;
+            result.falsePositives += !byProxy;
+            if (lastError.rfind("Pong not received", 0) == 0) {
+                result.keepaliveTimeouts++;
+            } else if (lastError.rfind("Failed to send", 0) == 0) {
+                result.sendErrors++;
+            } else if (!byProxy && !lastError.empty()) {
+                result.otherErrors++;
+            }
+        }
+    });
+
+    const auto start = Clock::now();
+    const auto end = start + m_config.duration;
+    proxy.play(m_profile);
+    client.connect();
+
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / m_config.rate));
+    std::string payload(std::max(m_config.size, Stamp::kSize), 'x');
+    auto nextSend = start;
+    auto nextReport = start + std::chrono::seconds(1);
+    auto retryAt = Clock::time_point{};
+    uint64_t reportedSent = 0, reportedReceived = 0;
+    while (Clock::now() < end) {
+        const auto now = Clock::now();
+        const WSC::State state = client.getCurrentState();
+        if (state == WSC::State::CONNECTED) {
+            for (; nextSend <= now; nextSend += interval) {
+                Stamp::write(payload.data(), Stamp::steadyNowNs());
+                if (client.sendText(payload)) {
+                    result.messagesSent++;
+                } else {
+                    result.sendFailures++;
+                }
+            }
+        } else {
+            // messages due while disconnected are failures, not a burst after reconnecting
+            for (; nextSend <= now; nextSend += interval) result.sendFailures++;
+            if (state != WSC::State::CONNECTING && state != WSC::State::DISCONNECTING) {
+                if (retryAt == Clock::time_point{}) {
+                    retryAt = now + m_config.reconnectDelay;
+                } else if (now >= retryAt) {
+                    retryAt = Clock::time_point{};
+                    client.connect();
+                }
+            }
+        }
+        const uint64_t queued = client.getStatistics().sendQueueDepth;
+        result.peakSendQueue = std::max(result.peakSendQueue, queued);
+
+        if (m_config.progress && now >= nextReport) {
+            uint64_t disconnects;
+            {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                disconnects = result.disconnects;
+            }
+            const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start);
+            std::cerr << "[" << elapsed.count() << "s] " << client.stateToString(state)
+                      << "  sent " << result.messagesSent - reportedSent << "  received "
+                      << received.load() - reportedReceived << "  queue " << queued
+                      << "  resets " << proxy.getStatistics().resets << "  disconnects "
+                      << disconnects << std::endl;
+            reportedSent = result.messagesSent;
+            reportedReceived = received.load();
+            nextReport += std::chrono::seconds(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        finished = true;
+    }
+    if (client.isConnected()) {
+        client.disconnect();
+        const auto closeEnd = Clock::now() + std::chrono::seconds(2);
+        while (client.isConnected() && Clock::now() < closeEnd) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    proxy.stop();
+
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    result.messagesReceived = received.load();
+    result.proxyResets = proxy.getStatistics().resets;
+    result.peakRssKb = readStatusKb("VmHWM");
+    result.rtt = rtt.snapshot();
+    return result;
+}
+
+std::string ImpairScenario::toJson(const Config &config, const Result &result) {
+    const Recovery recovery = summarize(result.recoveryMs);
+    std::ostringstream out;
+    out.precision(3);
+    out << std::fixed << "{\"config\":{\"url\":" << Json::quote(config.url)
+        << ",\"profile\":" << Json::quote(config.profile)
+        << ",\"rate\":" << Json::number(config.rate)
+        << ",\"size\":" << config.size
+        << ",\"durationSeconds\":" << config.duration.count() / 1000.0 << "},";
+    out << "\"seconds\":" << Json::number(result.seconds)
+        << ",\"messagesSent\":" << result.messagesSent
+        << ",\"messagesReceived\":" << result.messagesReceived
+        << ",\"sendFailures\":" << result.sendFailures
+        << ",\"proxyResets\":" << result.proxyResets << ",\"disconnects\":" << result.disconnects
+        << ",\"keepaliveTimeouts\":" << result.keepaliveTimeouts
+        << ",\"sendErrors\":" << result.sendErrors << ",\"otherErrors\":" << result.otherErrors
+        << ",\"falsePositives\":" << result.falsePositives
+        << ",\"recoveryMs\":{\"count\":" << result.recoveryMs.size() << ",\"min\":"
+        << Json::number(recovery.min) << ",\"mean\":" << Json::number(recovery.mean)
+        << ",\"max\":" << Json::number(recovery.max) << '}'
+        << ",\"peakSendQueue\":" << result.peakSendQueue << ",\"rssStartKb\":" << result.rssStartKb
+        << ",\"peakRssKb\":" << result.peakRssKb << ",\"rttUs\":{\"count\":" << result.rtt.count
+        << ",\"p50\":" << Json::number(result.rtt.percentile(50) / 1e3)
+        << ",\"p99\":" << Json::number(result.rtt.percentile(99) / 1e3)
+        << ",\"max\":" << Json::number(result.rtt.max / 1e3)
+        << "}}\n";
+    return out.str();
+}
+
+std::string ImpairScenario::toText(const Result &result) {
+    const Recovery recovery = summarize(result.recoveryMs);
+    char text[1024];
+    std::snprintf(
+        text, sizeof(text),
+        "%.1fs, sent %llu, received %llu, %llu send failures while disconnected\n"
+        "disconnects %llu: %llu proxy resets, %llu keepalive timeouts, %llu send errors, "
+        "%llu other, %llu false positives\n"
+        "recovery    %zu  min %.1f  mean %.1f  max %.1f ms\n"
+        "send queue  peak %llu messages\n"
+        "memory      rss at start %llu kB, peak %llu kB\n"
+        "rtt         p50 %.1f  p99 %.1f  max %.1f ms\n",
+        result.seconds, static_cast<unsigned long long>(result.messagesSent),
+        static_cast<unsigned long long>(result.messagesReceived),
+        static_cast<unsigned long long>(result.sendFailures),
+        static_cast<unsigned long long>(result.disconnects),
+        static_cast<unsigned long long>(result.proxyResets),
+        static_cast<unsigned long long>(result.keepaliveTimeouts),
+        static_cast<unsigned long long>(result.sendErrors),
+        static_cast<unsigned long long>(result.otherErrors),
+        static_cast<unsigned long long>(result.falsePositives), result.recoveryMs.size(),
+        recovery.min, recovery.mean, recovery.max,
+        static_cast<unsigned long long>(result.peakSendQueue),
+        static_cast<unsigned long long>(result.rssStartKb),
+        static_cast<unsigned long long>(result.peakRssKb), result.rtt.percentile(50) / 1e6,
+        result.rtt.percentile(99) / 1e6, result.rtt.max / 1e6);
+    return text;
+}
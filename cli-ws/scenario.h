@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "WSCHistogram.h"
+#include "impair.h"
+#include "ws.h"
+
+// Runs one WSC connection through an ImpairProxy playing a profile and reports how the
+// client copes: disconnects and their causes, time to recover, send queue growth and
+// memory. The proxy never drops a connection on its own, so every disconnect that does not
+// follow a reset (keepalive timeouts during stalls, send timeouts on a slow link) is a
+// false positive of the client.
+class ImpairScenario {
+   public:
+    struct Config {
+        std::string url;  // the real server, the client connects through the proxy
+        std::string profile;  // built-in scenario name or profile file
+        std::chrono::milliseconds duration;
+        double rate;  // echo messages per second
+        size_t size;
+        std::chrono::milliseconds reconnectDelay;  // the application's reconnect backoff
+        bool progress;
+        WSC::Config client;
+
+        Config()
+            : url("ws://127.0.0.1:9000"),
+              profile("flaky"),
+              duration(30 * 1000),  // 30 seconds
+              rate(200),
+              size(256),
+              reconnectDelay(100),
+              progress(true) {}
+    };
+
+    using Histogram = WSCHistogram<7, 40>;  // nanoseconds
+
+    struct Result {
+        double seconds = 0;
+        uint64_t messagesSent = 0;
+        uint64_t messagesReceived = 0;
+        uint64_t sendFailures = 0;  // sendText() while not connected
+        uint64_t proxyResets = 0;
+        uint64_t disconnects = 0;
+        uint64_t keepaliveTimeouts = 0;
+        uint64_t sendErrors = 0;
+        uint64_t otherErrors = 0;
+        uint64_t falsePositives = 0;  // disconnects the proxy did not cause
+        std::vector<double> recoveryMs;  // disconnect to connected again, per disconnect
+        uint64_t peakSendQueue = 0;
+        uint64_t rssStartKb = 0;
+        uint64_t peakRssKb = 0;
+        Histogram::Snapshot rtt;
+    };
+
+    explicit ImpairScenario(const Config &config);
+
+    Result run();
+
+    static std::string toJson(const Config &config, const Result &result);
+    static std::string toText(const Result &result);
+
+   private:
+    Config m_config;
+    ImpairProfile m_profile;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Timestamps carried in the payload of generated messages: "#" + 16 hex digits of a steady
+// clock time in ns, several stamps back to back. Echo servers may prefix the reply, so the
+// receiver looks for the first marker near the start of the payload.
+namespace Stamp {
+    constexpr size_t kSize = 17;
+    constexpr size_t kSearch = 32;
+
+    inline int64_t steadyNowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Sleeping is only accurate to tens of microseconds, the last spinNs of a wait are spun
+    constexpr int64_t kSpinNs = 100 * 1000;
+
+    inline void waitUntil(int64_t dueNs, int64_t spinNs = kSpinNs) {
+        const int64_t remaining = dueNs - steadyNowNs();
+        if (remaining > spinNs) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - spinNs));
+        }
+        while (steadyNowNs() < dueNs) {
+        }
+    }
+
+    inline void write(char *out, int64_t ns) {
+        char stamp[kSize + 1];
+        std::snprintf(stamp, sizeof(stamp), "#%016llx", static_cast<unsigned long long>(ns));
+        std::copy(stamp, stamp + kSize, out);
+    }
+
+    // Reads `count` consecutive stamps starting at the first marker
+    inline bool read(const std::vector<uint8_t> &payload, int64_t *values, size_t count = 1) {
+        const size_t limit = std::min(payload.size(), kSearch);
+        size_t start = 0;
+        while (start < limit && payload[start] != '#') start++;
+        if (start == limit || start + kSize * count > payload.size()) return false;
+        for (size_t n = 0; n < count; n++) {
+            const size_t at = start + n * kSize;
+            if (payload[at] != '#') return false;
+            uint64_t value = 0;
+            for (size_t j = 1; j < kSize; j++) {
+                const char c = static_cast<char>(payload[at + j]);
+                const int digit = c >= '0' && c <= '9'   ? c - '0'
+                                  : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                                         : -1;
+                if (digit < 0) return false;
+                value = value << 4 | static_cast<uint64_t>(digit);
+            }
+            values[n] = static_cast<int64_t>(value);
+        }
+        return true;
+    }
+}  // namespace Stamp
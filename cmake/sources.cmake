@@ -2,7 +2,7 @@ file(GLOB SCREENS_SOURCES src/gui/screens/*.cpp)
 file(GLOB UI_SOURCES src/gui/ui/*.cpp)
 file(GLOB IMG_SOURCES thirdparty/imgui/*.cpp)
 set(WSCPP_SOURCES ${CMAKE_CURRENT_SOURCE_DIR}/src/main.cpp)
-set(WS_SOURCES src/websocket/ws.cpp)
+file(GLOB WS_SOURCES src/websocket/*.cpp)
 set(GUI_SOURCES src/gui/gui.cpp ${SCREENS_SOURCES} ${UI_SOURCES} ${IMG_SOURCES})
 
 set(COMMON_INCLUDES
@@ -0,0 +1,160 @@
+"""Scrapes the WSCMetrics endpoint of a running WSCli load and parses it as OpenMetrics.
+
+    python3 metrics-scrape-test.py --cli path/to/WSCli --server path/to/WSCServer
+
+Starts a WSCServer, runs WSCli load against it with --metrics-port and takes a scrape while
+messages are flowing. The scrape goes through the strict OpenMetrics parser of
+prometheus_client, the one that rejects a sample not belonging to its family, plus checks
+on the values. When openssl is available a second run covers wss:// with --tls-records, so
+the TLS record histogram has samples too.
+
+Exits 0 on success, 1 on failure and 77 (skipped) without prometheus_client.
+"""
+import argparse
+import os
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+try:
+    from prometheus_client.openmetrics.parser import text_string_to_metric_families
+except ImportError:
+    print("prometheus_client is not installed, skipping")
+    sys.exit(77)
+
+CONTENT_TYPE = "application/openmetrics-text"
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def wait_for_port(port, timeout=10.0):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=0.5):
+                return
+        except OSError:
+            time.sleep(0.05)
+    raise RuntimeError(f"nothing listens on port {port}")
+
+
+def scrape(port):
+    with urllib.request.urlopen(f"http://127.0.0.1:{port}/metrics", timeout=5) as response:
+        content_type = response.headers.get("Content-Type", "")
+        if not content_type.startswith(CONTENT_TYPE):
+            raise AssertionError(f"content type {content_type}")
+        return response.read().decode()
+
+
+def value(families, sample_name):
+    return sum(s.value for f in families.values() for s in f.samples if s.name == sample_name)
+
+
+def check(text, connections, tls):
+    # raises ValueError on anything that is not valid OpenMetrics
+    families = {f.name: f for f in text_string_to_metric_families(text)}
+    expected = {
+        "wscpp_connections": "gauge",
+        "wscpp_connection_state": "stateset",
+        "wscpp_messages_sent": "counter",
+        "wscpp_messages_received": "counter",
+        "wscpp_sent_bytes": "counter",
+        "wscpp_received_bytes": "counter",
+        "wscpp_send_queue_depth": "gauge",
+        "wscpp_reconnects": "counter",
+        "wscpp_last_message_timestamp_seconds": "gauge",
+        "wscpp_rtt_seconds": "histogram",
+        "wscpp_tls_record_size_bytes": "histogram",
+    }
+    for name, kind in expected.items():
+        if name not in families:
+            raise AssertionError(f"family {name} missing")
+        if families[name].type != kind:
+            raise AssertionError(f"{name} is a {families[name].type}, not a {kind}")
+    if value(families, "wscpp_connections") != connections:
+        raise AssertionError(f"{value(families, 'wscpp_connections')} connections")
+    if value(families, "wscpp_messages_sent_total") <= 0:
+        raise AssertionError("no messages sent")
+    if value(families, "wscpp_received_bytes_total") <= 0:
+        raise AssertionError("no bytes received")
+    if tls and value(families, "wscpp_tls_record_size_bytes_count") <= 0:
+        raise AssertionError("no TLS records counted")
+    return len(families)
+
+
+def run(args, scheme, server_args, load_args, tls):
+    server_port = free_port()
+    metrics_port = free_port()
+    server = subprocess.Popen(
+        [args.server, "--port", str(server_port), "--quiet"] + server_args,
+        stdout=subprocess.DEVNULL)
+    try:
+        wait_for_port(server_port)
+        load = subprocess.Popen(
+            [args.cli, "load", "--url", f"{scheme}://127.0.0.1:{server_port}/echo",
+             "--connections", str(args.connections), "--duration", "4", "--quiet",
+             "--metrics-port", str(metrics_port)] + load_args,
+            stdout=subprocess.DEVNULL)
+        try:
+            wait_for_port(metrics_port)
+            # the first scrapes can come before every connection is up
+            deadline = time.monotonic() + 3
+            while True:
+                text = scrape(metrics_port)
+                try:
+                    count = check(text, args.connections, tls)
+                    break
+                except AssertionError:
+                    if time.monotonic() > deadline:
+                        raise
+                    time.sleep(0.2)
+            print(f"{scheme}: {count} families, {len(text.splitlines())} lines parsed")
+            if load.wait(timeout=30) != 0:
+                raise AssertionError(f"WSCli load exited with {load.returncode}")
+        finally:
+            if load.poll() is None:
+                load.kill()
+    finally:
+        server.terminate()
+        server.wait(timeout=10)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--cli", required=True, help="WSCli executable")
+    parser.add_argument("--server", required=True, help="WSCServer executable")
+    parser.add_argument("--connections", type=int, default=4)
+    args = parser.parse_args()
+
+    try:
+        run(args, "ws", [], [], False)
+        with tempfile.TemporaryDirectory() as directory:
+            cert = os.path.join(directory, "cert.pem")
+            key = os.path.join(directory, "key.pem")
+            openssl = shutil.which("openssl")
+            if openssl:
+                openssl = subprocess.run(
+                    [openssl, "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                     "-subj", "/CN=localhost", "-keyout", key, "-out", cert],
+                    stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            if openssl and openssl.returncode == 0:
+                run(args, "wss", ["--cert", cert, "--key", key], ["--tls-records"], True)
+            else:
+                print("no openssl to create a certificate, wss:// not covered")
+    except (AssertionError, ValueError, RuntimeError, OSError) as e:
+        print(f"FAILED: {e}")
+        return 1
+    print("OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
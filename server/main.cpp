@@ -0,0 +1,524 @@
+// WSCServer: local WebSocket server for benchmarking and testing the client offline.
+//
+// The behaviour is selected by the request path, query parameters tune it:
+//   /echo                                      every frame is sent back unchanged
+//   /sink                                      data is discarded, PINGs are answered
+//   /firehose?rate=1000&size=128&binary=0&count=0
+//                                              pushes messages at a fixed rate, count 0 is
+//                                              unlimited
+//   /fragment?parts=4                          echoes every message split into `parts` frames
+//   /delay-pong?delay=1000                     echo, PONGs are sent `delay` ms late
+//   /close?after=0&code=1000&abort=0           echo, closes after `after` messages; abort
+//                                              resets the TCP connection without a CLOSE frame
+// Any other path uses the --mode behaviour.
+//
+// With --cert and --key the server speaks wss://, e.g. to compare user-space TLS and kTLS in
+// the client on loopback:
+//   openssl req -x509 -newkey rsa:2048 -nodes -subj /CN=localhost -keyout key.pem -out cert.pem
+//   WSCServer --port 9443 --cert cert.pem --key key.pem
+#include <Poco/Buffer.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/Context.h>
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/SecureServerSocket.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/WebSocket.h>
+#include <Poco/String.h>
+#include <Poco/URI.h>
+#include <Poco/Util/HelpFormatter.h>
+#include <Poco/Util/Option.h>
+#include <Poco/Util/OptionSet.h>
+#include <Poco/Util/ServerApplication.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "WSCLogger.h"
+
+using Poco::Net::WebSocket;
+
+namespace {
+    struct ServerStats {
+        std::atomic<uint64_t> connections{0};
+        std::atomic<uint64_t> messagesIn{0};
+        std::atomic<uint64_t> messagesOut{0};
+        std::atomic<uint64_t> bytesIn{0};
+        std::atomic<uint64_t> bytesOut{0};
+    };
+
+    ServerStats g_stats;
+
+    // int, so it combines with the opcode enum without a deprecated enum-enum operation
+    constexpr int kFin = WebSocket::FRAME_FLAG_FIN;
+
+    enum class Mode { ECHO, SINK, FIREHOSE, FRAGMENT, DELAY_PONG, CLOSE };
+
+    bool parseMode(const std::string &name, Mode &mode) {
+        static const std::pair<const char *, Mode> kModes[] = {
+            {"echo", Mode::ECHO},         {"sink", Mode::SINK},
+            {"firehose", Mode::FIREHOSE}, {"fragment", Mode::FRAGMENT},
+            {"delay-pong", Mode::DELAY_PONG}, {"close", Mode::CLOSE},
+        };
+        for (const auto &[text, value] : kModes) {
+            if (name == text) {
+                mode = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct Behaviour {
+        Mode mode;
+        double rate;
+        size_t size;
+        bool binary;
+        uint64_t count;
+        int parts;
+        std::chrono::milliseconds pongDelay;
+        uint64_t closeAfter;
+        uint16_t closeCode;
+        bool abort;
+
+        Behaviour()
+            : mode(Mode::ECHO),
+              rate(1000),  // messages per second
+              size(128),
+              binary(false),
+              count(0),  // unlimited
+              parts(4),
+              pongDelay(1000),  // 1 second
+              closeAfter(0),
+              closeCode(1000),
+              abort(false) {}
+
+        static Behaviour fromUri(const std::string &target, Mode fallback) {
+            const Poco::URI uri(target);
+            Behaviour behaviour;
+            std::string path = uri.getPath();
+            if (!path.empty() && path.front() == '/') path.erase(0, 1);
+            if (!parseMode(path, behaviour.mode)) behaviour.mode = fallback;
+            for (const auto &[key, value] : uri.getQueryParameters()) {
+                if (key == "rate") behaviour.rate = std::stod(value);
+                if (key == "size") behaviour.size = std::stoul(value);
+                if (key == "binary") behaviour.binary = value == "1" || value == "true";
+                if (key == "count") behaviour.count = std::stoull(value);
+                if (key == "parts") behaviour.parts = std::max(1, std::stoi(value));
+                if (key == "delay") {
+                    behaviour.pongDelay = std::chrono::milliseconds(std::stol(value));
+                }
+                if (key == "after") behaviour.closeAfter = std::stoull(value);
+                if (key == "code") behaviour.closeCode = static_cast<uint16_t>(std::stoi(value));
+                if (key == "abort") behaviour.abort = value == "1" || value == "true";
+            }
+            return behaviour;
+        }
+    };
+
+    // Counts a connection in g_stats for as long as it exists, whichever way it ends
+    class ConnectionCount {
+       public:
+        ConnectionCount() { g_stats.connections.fetch_add(1, std::memory_order_relaxed); }
+        ~ConnectionCount() { g_stats.connections.fetch_sub(1, std::memory_order_relaxed); }
+        ConnectionCount(const ConnectionCount &) = delete;
+        ConnectionCount &operator=(const ConnectionCount &) = delete;
+    };
+
+    // One WebSocket connection. Frames are sent from the receive loop and, in firehose mode,
+    // from the push thread or, in delay-pong mode, from the pong thread, so sending is
+    // serialized.
+    class Session {
+       public:
+        Session(WebSocket &socket, const Behaviour &behaviour)
+            : m_socket(socket), m_behaviour(behaviour) {}
+
+        void run() {
+            std::thread sender;
+            if (m_behaviour.mode == Mode::FIREHOSE) {
+                sender = std::thread(&Session::pushLoop, this);
+            } else if (m_behaviour.mode == Mode::DELAY_PONG) {
+                sender = std::thread(&Session::pongLoop, this);
+            }
+            try {
+                if (m_behaviour.mode == Mode::CLOSE && m_behaviour.closeAfter == 0) {
+                    close();
+                } else {
+                    receiveLoop();
+                }
+            } catch (const Poco::Exception &e) {
+                WSCLog(debug, "Connection ended: {}", e.displayText());
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_pongMutex);
+                m_running = false;
+            }
+            m_pongWake.notify_one();
+            if (sender.joinable()) sender.join();
+        }
+
+       private:
+        void send(const char *data, size_t length, int flags) {
+            std::lock_guard<std::mutex> lock(m_sendMutex);
+            if (m_closeSent) return;  // nothing may follow the CLOSE frame
+            m_socket.sendFrame(data, static_cast<int>(length), flags);
+            m_closeSent = (flags & WebSocket::FRAME_OP_BITMASK) == WebSocket::FRAME_OP_CLOSE;
+            if ((flags & WebSocket::FRAME_OP_BITMASK) < WebSocket::FRAME_OP_CLOSE) {
+                g_stats.bytesOut.fetch_add(length, std::memory_order_relaxed);
+            }
+        }
+
+        void close() {
+            if (m_behaviour.abort) {
+                // RST instead of a closing handshake
+                m_socket.setLinger(true, 0);
+                m_socket.close();
+                return;
+            }
+            const char payload[2] = {static_cast<char>(m_behaviour.closeCode >> 8),
+                                     static_cast<char>(m_behaviour.closeCode & 0xFF)};
+            send(payload, sizeof(payload),
+                 kFin | WebSocket::FRAME_OP_CLOSE);
+            // WebSocket::shutdown() would send a CLOSE of its own, the peer's answer is
+            // still read by receiveLoop()
+            m_socket.shutdownSend();
+        }
+
+        void receiveLoop() {
+            Poco::Buffer<char> buffer(0);
+            std::vector<char> message;  // reassembled message in fragment mode
+            int messageOpcode = 0;
+            int flags = 0;
+            uint64_t received = 0;
+            while (true) {
+                buffer.resize(0);
+                const int n = m_socket.receiveFrame(buffer, flags);
+                const int opcode = flags & WebSocket::FRAME_OP_BITMASK;
+                const bool final = (flags & WebSocket::FRAME_FLAG_FIN) != 0;
+                if (n == 0 && flags == 0) return;  // peer closed the connection
+
+                if (opcode == WebSocket::FRAME_OP_CLOSE) {
+                    send(buffer.begin(), static_cast<size_t>(n), flags);
+                    return;
+                }
+                if (opcode == WebSocket::FRAME_OP_PING) {
+                    if (m_behaviour.mode == Mode::DELAY_PONG) {
+                        delayPong(buffer.begin(), static_cast<size_t>(n));
+                    } else {
+                        send(buffer.begin(), static_cast<size_t>(n),
+                             kFin | WebSocket::FRAME_OP_PONG);
+                    }
+                    continue;
+                }
+                if (opcode == WebSocket::FRAME_OP_PONG) continue;
+
+                g_stats.bytesIn.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+                if (final) {
+                    g_stats.messagesIn.fetch_add(1, std::memory_order_relaxed);
+                    received++;
+                }
+
+                switch (m_behaviour.mode) {
+                    case Mode::SINK:
+                    case Mode::FIREHOSE:
+                        break;
+                    case Mode::FRAGMENT:
+                        if (opcode != WebSocket::FRAME_OP_CONT) {
+                            messageOpcode = opcode;
+                            message.clear();
+                        }
+                        message.insert(message.end(), buffer.begin(), buffer.begin() + n);
+                        if (final) sendFragmented(message, messageOpcode);
+                        break;
+                    default:
+                        send(buffer.begin(), static_cast<size_t>(n), flags);
+                        if (final) g_stats.messagesOut.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                }
+
+                if (m_behaviour.mode == Mode::CLOSE && final &&
+                    received >= m_behaviour.closeAfter) {
+                    close();
+                    return;
+                }
+            }
+        }
+
+        // Queues the PONG for the pong thread, the receive loop goes on echoing meanwhile
+        void delayPong(const char *payload, size_t length) {
+            {
+                std::lock_guard<std::mutex> lock(m_pongMutex);
+                m_pongs.emplace_back(std::chrono::steady_clock::now() + m_behaviour.pongDelay,
+                                     std::string(payload, length));
+            }
+            m_pongWake.notify_one();
+        }
+
+        // Sends the queued PONGs once they are due, in the order of their PINGs
+        void pongLoop() {
+            std::unique_lock<std::mutex> lock(m_pongMutex);
+            try {
+                while (m_running) {
+                    if (m_pongs.empty()) {
+                        m_pongWake.wait(lock);
+                    } else if (std::chrono::steady_clock::now() < m_pongs.front().first) {
+                        m_pongWake.wait_until(lock, m_pongs.front().first);
+                    } else {
+                        const std::string payload = std::move(m_pongs.front().second);
+                        m_pongs.pop_front();
+                        lock.unlock();
+                        send(payload.data(), payload.size(), kFin | WebSocket::FRAME_OP_PONG);
+                        lock.lock();
+                    }
+                }
+            } catch (const Poco::Exception &e) {
+                WSCLog(debug, "Delayed PONGs stopped: {}", e.displayText());
+            }
+        }
+
+        void sendFragmented(const std::vector<char> &message, int opcode) {
+            // never more frames than bytes, an empty message is sent as a single frame
+            const size_t parts = std::clamp<size_t>(message.size(), 1, m_behaviour.parts);
+            const size_t partSize = (message.size() + parts - 1) / parts;
+            size_t offset = 0;
+            for (size_t i = 0; i < parts; i++) {
+                const size_t length = std::min(partSize, message.size() - offset);
+                int flags = i == 0 ? opcode : WebSocket::FRAME_OP_CONT;
+                if (i + 1 == parts) flags |= WebSocket::FRAME_FLAG_FIN;
+                send(message.data() + offset, length, flags);
+                offset += length;
+            }
+            g_stats.messagesOut.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Fixed schedule, late messages are sent immediately to keep the average rate
+        void pushLoop() {
+            using Clock = std::chrono::steady_clock;
+            const std::string payload(m_behaviour.size, 'x');
+            const int opcode =
+                m_behaviour.binary ? WebSocket::FRAME_OP_BINARY : WebSocket::FRAME_OP_TEXT;
+            const int flags = kFin | opcode;
+            const auto interval = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / std::max(m_behaviour.rate, 1e-3)));
+            auto next = Clock::now();
+            uint64_t sent = 0;
+            try {
+                while (m_running && (m_behaviour.count == 0 || sent < m_behaviour.count)) {
+                    std::this_thread::sleep_until(next);
+                    send(payload.data(), payload.size(), flags);
+                    g_stats.messagesOut.fetch_add(1, std::memory_order_relaxed);
+                    sent++;
+                    next += interval;
+                }
+            } catch (const Poco::Exception &e) {
+                WSCLog(debug, "Firehose stopped: {}", e.displayText());
+            }
+        }
+
+        WebSocket &m_socket;
+        const Behaviour m_behaviour;
+        std::mutex m_sendMutex;
+        bool m_closeSent = false;  // m_sendMutex
+        std::atomic<bool> m_running{true};
+        // PONGs of delay-pong mode with the time they are due
+        std::mutex m_pongMutex;
+        std::condition_variable m_pongWake;
+        std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> m_pongs;
+    };
+
+    class WebSocketRequestHandler : public Poco::Net::HTTPRequestHandler {
+       public:
+        explicit WebSocketRequestHandler(Mode mode) : m_mode(mode) {}
+
+        void handleRequest(Poco::Net::HTTPServerRequest &request,
+                           Poco::Net::HTTPServerResponse &response) override {
+            if (request.find("Upgrade") == request.end() ||
+                Poco::icompare(request.get("Upgrade"), "websocket") != 0) {
+                response.setContentType("text/plain");
+                response.send() << "WSCServer is running\n";
+                return;
+            }
+
+            Behaviour behaviour;
+            try {
+                behaviour = Behaviour::fromUri(request.getURI(), m_mode);
+            } catch (const std::exception &) {
+                response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+                response.setContentLength(0);
+                response.send();
+                return;
+            }
+
+            try {
+                WebSocket socket(request, response);
+                const ConnectionCount counted;
+                socket.setReceiveTimeout(Poco::Timespan(0));  // blocking
+                socket.setMaxPayloadSize(64 * 1024 * 1024);
+                socket.setNoDelay(true);
+                WSCLog(debug, "Client connected: {} {}", request.clientAddress().toString(),
+                       request.getURI());
+                Session(socket, behaviour).run();
+            } catch (const Poco::Net::WebSocketException &e) {
+                WSCLog(warn, "WebSocket handshake failed: {}", e.displayText());
+                if (!response.sent()) {
+                    response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+                    response.setContentLength(0);
+                    response.send();
+                }
+            }
+        }
+
+       private:
+        Mode m_mode;
+    };
+
+    class WebSocketRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+       public:
+        explicit WebSocketRequestHandlerFactory(Mode mode) : m_mode(mode) {}
+
+        Poco::Net::HTTPRequestHandler *createRequestHandler(
+            const Poco::Net::HTTPServerRequest &) override {
+            return new WebSocketRequestHandler(m_mode);
+        }
+
+       private:
+        Mode m_mode;
+    };
+}  // namespace
+
+class WSCServer : public Poco::Util::ServerApplication {
+   protected:
+    void defineOptions(Poco::Util::OptionSet &options) override {
+        ServerApplication::defineOptions(options);
+        using Poco::Util::Option;
+        options.addOption(
+            Option("help", "h", "Show this help").required(false).repeatable(false));
+        options.addOption(Option("address", "a", "Listen address (0.0.0.0)")
+                              .required(false)
+                              .argument("ADDRESS"));
+        options.addOption(
+            Option("port", "p", "Listen port (9000)").required(false).argument("PORT"));
+        options.addOption(
+            Option("mode", "m", "Behaviour for paths that do not name one (echo)")
+                .required(false)
+                .argument("MODE"));
+        options.addOption(Option("max-connections", "c", "Concurrent connections (1024)")
+                              .required(false)
+                              .argument("N"));
+        options.addOption(
+            Option("quiet", "q", "No per second statistics").required(false).repeatable(false));
+        options.addOption(Option("cert", "", "PEM certificate, serves wss:// with --key")
+                              .required(false)
+                              .argument("FILE"));
+        options.addOption(
+            Option("key", "", "PEM private key of --cert").required(false).argument("FILE"));
+    }
+
+    void handleOption(const std::string &name, const std::string &value) override {
+        ServerApplication::handleOption(name, value);
+        if (name == "help") {
+            m_help = true;
+            stopOptionsProcessing();
+        } else if (name == "address") {
+            m_address = value;
+        } else if (name == "port") {
+            m_port = static_cast<uint16_t>(std::stoi(value));
+        } else if (name == "mode") {
+            if (!parseMode(value, m_mode)) {
+                throw Poco::InvalidArgumentException("Unknown mode " + value);
+            }
+        } else if (name == "max-connections") {
+            m_maxConnections = std::stoi(value);
+        } else if (name == "quiet") {
+            m_quiet = true;
+        } else if (name == "cert") {
+            m_certificate = value;
+        } else if (name == "key") {
+            m_privateKey = value;
+        }
+    }
+
+    int main(const std::vector<std::string> &) override {
+        if (m_help) {
+            Poco::Util::HelpFormatter help(options());
+            help.setCommand(commandName());
+            help.setUsage("OPTIONS");
+            help.setHeader(
+                "WebSocket benchmark server. Paths: /echo /sink /firehose /fragment "
+                "/delay-pong /close, see server/main.cpp for their parameters.");
+            help.format(std::cout);
+            return Application::EXIT_OK;
+        }
+        WSCLogger::init("WSCServer", "WSCServer.txt", spdlog::level::info);
+
+        auto params = new Poco::Net::HTTPServerParams;
+        // every WebSocket connection keeps its handler thread
+        params->setMaxThreads(m_maxConnections);
+        params->setMaxQueued(m_maxConnections);
+        const Poco::Net::SocketAddress address(m_address, m_port);
+        Poco::Net::ServerSocket socket;
+        if (m_certificate.empty()) {
+            socket = Poco::Net::ServerSocket(address, 1024);
+        } else {
+            Poco::Net::Context::Ptr context = new Poco::Net::Context(
+                Poco::Net::Context::TLS_SERVER_USE, m_privateKey, m_certificate, "",
+                Poco::Net::Context::VERIFY_NONE);
+            socket = Poco::Net::SecureServerSocket(address, 1024, context);
+        }
+        Poco::Net::HTTPServer server(new WebSocketRequestHandlerFactory(m_mode), socket, params);
+        server.start();
+        WSCLog(info, "WSCServer listening on {}:{}{}", m_address, socket.address().port(),
+               m_certificate.empty() ? "" : " (TLS)");
+
+        std::atomic<bool> running{true};
+        std::thread reporter([&running, this] { reportLoop(running); });
+        waitForTerminationRequest();
+        running = false;
+        reporter.join();
+        server.stopAll(true);
+        return Application::EXIT_OK;
+    }
+
+   private:
+    void reportLoop(const std::atomic<bool> &running) const {
+        uint64_t lastIn = 0, lastOut = 0, lastBytesIn = 0, lastBytesOut = 0;
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            const uint64_t in = g_stats.messagesIn, out = g_stats.messagesOut;
+            const uint64_t bytesIn = g_stats.bytesIn, bytesOut = g_stats.bytesOut;
+            if (!m_quiet && (in != lastIn || out != lastOut)) {
+                std::cout << "connections " << g_stats.connections << "  in " << in - lastIn
+                          << " msg/s " << (bytesIn - lastBytesIn) / 1e6 << " MB/s  out "
+                          << out - lastOut << " msg/s " << (bytesOut - lastBytesOut) / 1e6
+                          << " MB/s" << std::endl;
+            }
+            lastIn = in;
+            lastOut = out;
+            lastBytesIn = bytesIn;
+            lastBytesOut = bytesOut;
+        }
+    }
+
+    bool m_help = false;
+    std::string m_address = "0.0.0.0";
+    uint16_t m_port = 9000;
+    Mode m_mode = Mode::ECHO;
+    int m_maxConnections = 1024;
+    bool m_quiet = false;
+    std::string m_certificate;
+    std::string m_privateKey;
+};
+
+POCO_SERVER_MAIN(WSCServer)
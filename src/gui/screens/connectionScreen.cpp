@@ -36,17 +36,17 @@ void GUI::connectionScreen(std::shared_ptr<websocketConnection> websocket) {
                     websocket->ws = std::unique_ptr<WSC>(ws);
                     websocket->messages = std::make_unique<MessageQueue>();
                     ws->setControlMessageCallback([websocket](WSCMessage message) {
-                        WSCLog(debug, "Control message: " + message.getPayload());
+                        WSCLog(debug, "Control message: {}", message.getPayload());
                         websocket->messages->push(message, true);
                     });
                     ws->setDataMessageCallback([websocket](WSCMessage message) {
                         message.type = WSCMessageType::RECEIVED;
-                        WSCLog(debug, "Received message: " + message.getPayload());
+                        WSCLog(debug, "Received message: {}", message.getPayload());
                         websocket->messages->push(message, true);
                     });
                     ws->setStateChangeCallback([websocket](const std::string &state) {
                         std::string stateMessage = "State changed to " + state;
-                        WSCLog(debug, stateMessage);
+                        WSCLog(debug, "{}", stateMessage);
                         websocket->messages->push(
                             WSCMessage{WSCMessageType::RECEIVED,
                                        std::vector<unsigned char>(stateMessage.begin(),
@@ -55,10 +55,10 @@ void GUI::connectionScreen(std::shared_ptr<websocketConnection> websocket) {
                     });
                 }
                 if (!ws->connect()) {
-                    WSCLog(error, "Failed to connect to " + websocket->hostInput);
+                    WSCLog(error, "Failed to connect to {}", websocket->hostInput);
                 }
             } catch (const std::exception &e) {
-                WSCLog(error, "Failed to connect to " + websocket->hostInput + ": " + e.what());
+                WSCLog(error, "Failed to connect to {}: {}", websocket->hostInput, e.what());
             }
         }
     }
@@ -71,7 +71,7 @@ namespace WSCpp::UI::Resources {
                     (void*)m_preLoadedfonts[i]->getData(), (int)m_preLoadedfonts[i]->getSize(),
                     static_cast<float>(fontSize), &cfg, ranges);
                 if (!f) {
-                    WSCLog(error, "Failed to load font: " + fontNames[i]);
+                    WSCLog(error, "Failed to load font: {}", fontNames[i]);
                     return false;
                 }
                 m_fonts[fontNames[i]][std::to_string(fontSize)] =
@@ -4,7 +4,7 @@
 #include "gui.h"
 
 int main() {
-    WSCLogger::init("WSCpp", "WSCLog.txt", spdlog::level::debug);
+    WSCLogger::initAsync("WSCpp", "WSCLog.txt", spdlog::level::debug);
 
     WSCLog(info, "Starting WSCpp");
     GUI &gui = GUI::getInstance();
@@ -22,6 +22,7 @@ int main() {
 
     gui.closeGUI();
     WSCLog(info, "Exiting WSCpp");
+    WSCLogger::shutdown();
 
     return 0;
 }
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <spdlog/fmt/fmt.h>
+#ifdef SPDLOG_FMT_EXTERNAL
+#include <fmt/args.h>
+#else
+#include <spdlog/fmt/bundled/args.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WSC_BINLOG_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define WSC_BINLOG_HAS_TSC 1
+#endif
+
+// NanoLog style binary log format.
+// Every WSCLog call site is described once by a SITE record (level, location, format
+// string and argument types); after that a log call only stores the site id, a raw
+// timestamp and the argument bytes. Text is produced offline by WSCLogDecode.
+//
+// File layout: kMagic, then records, each starting with a RecordKind byte. Integers are
+// stored in host byte order, the decoder is expected to run on the same architecture.
+namespace WSCBinaryLog {
+    inline constexpr char kMagic[8] = {'W', 'S', 'C', 'B', 'L', 'O', 'G', '1'};
+
+    enum class RecordKind : uint8_t {
+        SITE = 1,         // u32 id, u8 level, u32 line, str file, str function, str format,
+                          // u8 argc, argc x ArgType
+        CALIBRATION = 2,  // u64 timestamp, i64 unix nanoseconds
+        THREAD = 3,       // u64 thread id of the records that follow
+        ENTRY = 4,        // u32 site, u64 timestamp, u32 size, argument bytes
+        DROPPED = 5,      // u64 messages dropped since the previous DROPPED record
+    };
+
+    enum class ArgType : uint8_t {
+        I8 = 1,
+        I16,
+        I32,
+        I64,
+        U8,
+        U16,
+        U32,
+        U64,
+        F32,
+        F64,
+        BOOL,
+        CHAR,
+        STRING,  // u32 length + bytes
+    };
+
+    // Raw timestamp, TSC ticks where available, steady clock nanoseconds otherwise
+    inline uint64_t timestamp() noexcept {
+#ifdef WSC_BINLOG_HAS_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+#endif
+    }
+
+    // ------------------------------------------------------------------ encoding
+    template <typename T, typename = void>
+    struct Arg {
+        static constexpr bool supported = false;
+    };
+
+    template <typename T>
+    struct Arg<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                   !std::is_same_v<T, char>>> {
+        static constexpr bool supported = true;
+        static constexpr ArgType type = std::is_signed_v<T>
+                                            ? (sizeof(T) == 1   ? ArgType::I8
+                                               : sizeof(T) == 2 ? ArgType::I16
+                                               : sizeof(T) == 4 ? ArgType::I32
+                                                                : ArgType::I64)
+                                            : (sizeof(T) == 1   ? ArgType::U8
+                                               : sizeof(T) == 2 ? ArgType::U16
+                                               : sizeof(T) == 4 ? ArgType::U32
+                                                                : ArgType::U64);
+        static size_t size(T) noexcept { return sizeof(T); }
+        static char *encode(char *out, T value) noexcept {
+            std::memcpy(out, &value, sizeof(T));
+            return out + sizeof(T);
+        }
+    };
+
+    template <typename T>
+    struct Arg<T, std::enable_if_t<std::is_same_v<T, bool> || std::is_same_v<T, char> ||
+                                   std::is_floating_point_v<T>>> {
+        static constexpr bool supported = sizeof(T) <= 8;
+        static constexpr ArgType type = std::is_same_v<T, bool>   ? ArgType::BOOL
+                                        : std::is_same_v<T, char> ? ArgType::CHAR
+                                        : sizeof(T) == 4          ? ArgType::F32
+                                                                  : ArgType::F64;
+        static size_t size(T) noexcept { return sizeof(T); }
+        static char *encode(char *out, T value) noexcept {
+            std::memcpy(out, &value, sizeof(T));
+            return out + sizeof(T);
+        }
+    };
+
+    struct StringArg {
+        static constexpr bool supported = true;
+        static constexpr ArgType type = ArgType::STRING;
+        static size_t size(std::string_view value) noexcept {
+            return sizeof(uint32_t) + value.size();
+        }
+        static char *encode(char *out, std::string_view value) noexcept {
+            const auto length = static_cast<uint32_t>(value.size());
+            std::memcpy(out, &length, sizeof(length));
+            std::memcpy(out + sizeof(length), value.data(), value.size());
+            return out + sizeof(length) + value.size();
+        }
+    };
+
+    template <>
+    struct Arg<std::string> : StringArg {};
+    template <>
+    struct Arg<std::string_view> : StringArg {};
+    template <>
+    struct Arg<const char *> : StringArg {
+        static size_t size(const char *value) noexcept {
+            return StringArg::size(value ? value : "(null)");
+        }
+        static char *encode(char *out, const char *value) noexcept {
+            return StringArg::encode(out, value ? value : "(null)");
+        }
+    };
+    template <>
+    struct Arg<char *> : Arg<const char *> {};
+
+    template <typename T>
+    using ArgOf = Arg<std::decay_t<T>>;
+
+    template <typename... Args>
+    inline constexpr bool kEncodable = (ArgOf<Args>::supported && ...);
+
+    // ------------------------------------------------------------------ decoding
+    struct Site {
+        uint8_t level = 0;
+        uint32_t line = 0;
+        std::string file;
+        std::string function;
+        std::string format;
+        std::vector<ArgType> args;
+    };
+
+    struct Entry {
+        const Site *site = nullptr;
+        uint64_t threadId = 0;
+        std::chrono::system_clock::time_point time;
+        std::string message;
+    };
+
+    // Streams entries out of a binary log. Timestamps are converted with the CALIBRATION
+    // records: the first and last calibration define the tick rate.
+    class Decoder {
+       public:
+        explicit Decoder(std::istream &in) : m_in(in) {}
+
+        // Returns false when the stream does not start with kMagic
+        bool open() {
+            char magic[sizeof(kMagic)];
+            if (!m_in.read(magic, sizeof(magic))) return false;
+            if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return false;
+            m_dataStart = m_in.tellg();
+            scanCalibration();
+            m_in.clear();
+            m_in.seekg(m_dataStart);
+            return true;
+        }
+
+        // Next ENTRY (or a synthetic one for DROPPED records), std::nullopt at end of file
+        std::optional<Entry> next() {
+            while (true) {
+                uint8_t kind;
+                if (!read(kind)) return std::nullopt;
+                switch (static_cast<RecordKind>(kind)) {
+                    case RecordKind::SITE:
+                        if (!readSite()) return std::nullopt;
+                        break;
+                    case RecordKind::CALIBRATION: {
+                        Calibration calibration;
+                        if (!read(calibration.ticks) || !read(calibration.unixNs)) {
+                            return std::nullopt;
+                        }
+                        m_base = calibration;
+                        break;
+                    }
+                    case RecordKind::THREAD:
+                        if (!read(m_threadId)) return std::nullopt;
+                        break;
+                    case RecordKind::ENTRY:
+                        return readEntry();
+                    case RecordKind::DROPPED: {
+                        uint64_t count;
+                        if (!read(count)) return std::nullopt;
+                        Entry entry;
+                        entry.site = &m_droppedSite;
+                        entry.time = m_lastTime;
+                        entry.message = fmt::format("{} messages dropped", count);
+                        return entry;
+                    }
+                    default:
+                        m_error = "Unknown record kind " + std::to_string(kind);
+                        return std::nullopt;
+                }
+            }
+        }
+
+        const std::string &error() const noexcept { return m_error; }
+
+       private:
+        struct Calibration {
+            uint64_t ticks = 0;
+            int64_t unixNs = 0;
+        };
+
+        template <typename T>
+        bool read(T &value) {
+            return static_cast<bool>(m_in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+        }
+
+        template <typename Length>
+        bool readString(std::string &value) {
+            Length length;
+            if (!read(length)) return false;
+            value.resize(length);
+            return length == 0 || static_cast<bool>(m_in.read(value.data(), length));
+        }
+
+        void scanCalibration() {
+            // First pass over the file for the calibration records and site definitions. The
+            // writer may store an entry before the definition of its site, so sites are kept.
+            bool first = true;
+            Calibration calibration;
+            while (true) {
+                uint8_t kind;
+                if (!read(kind)) break;
+                const auto recordKind = static_cast<RecordKind>(kind);
+                if (recordKind == RecordKind::CALIBRATION) {
+                    if (!read(calibration.ticks) || !read(calibration.unixNs)) break;
+                    if (first) m_first = calibration;
+                    m_last = calibration;
+                    first = false;
+                } else if (recordKind == RecordKind::SITE) {
+                    if (!readSite()) break;
+                } else if (recordKind == RecordKind::THREAD || recordKind == RecordKind::DROPPED) {
+                    m_in.ignore(sizeof(uint64_t));
+                } else if (recordKind == RecordKind::ENTRY) {
+                    uint32_t site, size;
+                    uint64_t ticks;
+                    if (!read(site) || !read(ticks) || !read(size)) break;
+                    m_in.ignore(size);
+                } else {
+                    break;
+                }
+            }
+            const double elapsedNs = static_cast<double>(m_last.unixNs - m_first.unixNs);
+            if (m_last.ticks > m_first.ticks && elapsedNs > 0) {
+                m_ticksPerNs = static_cast<double>(m_last.ticks - m_first.ticks) / elapsedNs;
+            }
+            m_base = m_first;
+        }
+
+        bool readSite() {
+            uint32_t id;
+            Site site;
+            uint8_t argc;
+            if (!read(id) || !read(site.level) || !read(site.line) ||
+                !readString<uint16_t>(site.file) || !readString<uint16_t>(site.function) ||
+                !readString<uint32_t>(site.format) || !read(argc)) {
+                return false;
+            }
+            site.args.resize(argc);
+            if (argc && !m_in.read(reinterpret_cast<char *>(site.args.data()), argc)) {
+                return false;
+            }
+            m_sites[id] = std::move(site);
+            return true;
+        }
+
+        template <typename T>
+        T take(const char *&cursor) {
+            T value;
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return value;
+        }
+
+        std::optional<Entry> readEntry() {
+            uint32_t siteId, size;
+            uint64_t ticks;
+            if (!read(siteId) || !read(ticks) || !read(size)) return std::nullopt;
+            m_payload.resize(size);
+            if (size && !m_in.read(m_payload.data(), size)) return std::nullopt;
+
+            Entry entry;
+            entry.threadId = m_threadId;
+            const double offsetNs =
+                (static_cast<double>(ticks) - static_cast<double>(m_base.ticks)) / m_ticksPerNs;
+            entry.time = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(m_base.unixNs + static_cast<int64_t>(offsetNs))));
+            m_lastTime = entry.time;
+
+            auto site = m_sites.find(siteId);
+            if (site == m_sites.end()) {
+                entry.site = &m_unknownSite;
+                entry.message = "<unknown log site " + std::to_string(siteId) + ">";
+                return entry;
+            }
+            entry.site = &site->second;
+
+            // bounds are trusted: the payload was produced from the same site description
+            const char *cursor = m_payload.data();
+            std::vector<std::string> strings;
+            strings.reserve(site->second.args.size());
+            fmt::dynamic_format_arg_store<fmt::format_context> store;
+            for (ArgType type : site->second.args) {
+                switch (type) {
+                    case ArgType::I8: store.push_back(take<int8_t>(cursor)); break;
+                    case ArgType::I16: store.push_back(take<int16_t>(cursor)); break;
+                    case ArgType::I32: store.push_back(take<int32_t>(cursor)); break;
+                    case ArgType::I64: store.push_back(take<int64_t>(cursor)); break;
+                    case ArgType::U8: store.push_back(take<uint8_t>(cursor)); break;
+                    case ArgType::U16: store.push_back(take<uint16_t>(cursor)); break;
+                    case ArgType::U32: store.push_back(take<uint32_t>(cursor)); break;
+                    case ArgType::U64: store.push_back(take<uint64_t>(cursor)); break;
+                    case ArgType::F32: store.push_back(take<float>(cursor)); break;
+                    case ArgType::F64: store.push_back(take<double>(cursor)); break;
+                    case ArgType::BOOL: store.push_back(take<bool>(cursor)); break;
+                    case ArgType::CHAR: store.push_back(take<char>(cursor)); break;
+                    case ArgType::STRING: {
+                        const auto length = take<uint32_t>(cursor);
+                        strings.emplace_back(cursor, length);
+                        cursor += length;
+                        store.push_back(std::string_view(strings.back()));
+                        break;
+                    }
+                }
+            }
+            try {
+                entry.message = fmt::vformat(site->second.format, store);
+            } catch (const fmt::format_error &e) {
+                entry.message = "<format error: " + std::string(e.what()) + "> " +
+                                site->second.format;
+            }
+            return entry;
+        }
+
+        std::istream &m_in;
+        std::streampos m_dataStart;
+        std::map<uint32_t, Site> m_sites;
+        Site m_unknownSite;
+        Site m_droppedSite{3, 0, "WSCLogger.h", "", "", {}};  // reported at warn level
+        Calibration m_first, m_last, m_base;
+        double m_ticksPerNs = 1.0;
+        uint64_t m_threadId = 0;
+        std::chrono::system_clock::time_point m_lastTime;
+        std::vector<char> m_payload;
+        std::string m_error;
+    };
+}  // namespace WSCBinaryLog
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+// Lock-free single-producer/single-consumer ring of variable-length records.
+// The producer calls reserve() + commit(), the consumer front() + pop(). Records are
+// always contiguous in memory: when a record does not fit before the end of the buffer a
+// wrap marker is written and the record starts over at offset 0.
+class WSCByteRing {
+   public:
+    explicit WSCByteRing(size_t capacity)
+        : m_capacity(std::bit_ceil(std::max<size_t>(capacity, 64))),
+          m_buffer(new char[m_capacity]) {}
+
+    WSCByteRing(const WSCByteRing &) = delete;
+    WSCByteRing &operator=(const WSCByteRing &) = delete;
+
+    size_t capacity() const noexcept { return m_capacity; }
+
+    // Producer side. Returns nullptr when the ring is full or the record can never fit.
+    char *reserve(uint32_t size) noexcept {
+        const size_t need = recordSize(size);
+        if (need > m_capacity / 2) return nullptr;
+
+        size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t offset = head & (m_capacity - 1);
+        const size_t contiguous = m_capacity - offset;
+        const size_t total = contiguous < need ? contiguous + need : need;
+        if (head + total - m_tailCache > m_capacity) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head + total - m_tailCache > m_capacity) return nullptr;
+        }
+
+        if (contiguous < need) {
+            writeLength(offset, kWrapMarker);
+            head += contiguous;
+        }
+        m_pendingHead = head + need;
+        const size_t start = head & (m_capacity - 1);
+        writeLength(start, size);
+        return m_buffer.get() + start + kLengthSize;
+    }
+
+    void commit() noexcept { m_head.store(m_pendingHead, std::memory_order_release); }
+
+    bool write(const void *data, uint32_t size) noexcept {
+        char *target = reserve(size);
+        if (!target) return false;
+        std::memcpy(target, data, size);
+        commit();
+        return true;
+    }
+
+    // Consumer side. Returns nullptr when the ring is empty.
+    const char *front(uint32_t &size) noexcept {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) return nullptr;
+        size_t offset = tail & (m_capacity - 1);
+        uint32_t length = readLength(offset);
+        if (length == kWrapMarker) {
+            // the record following a wrap marker is committed together with it
+            tail += m_capacity - offset;
+            offset = 0;
+            length = readLength(0);
+        }
+        m_readTail = tail + recordSize(length);
+        size = length;
+        return m_buffer.get() + offset + kLengthSize;
+    }
+
+    void pop() noexcept { m_tail.store(m_readTail, std::memory_order_release); }
+
+    bool empty() const noexcept {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+   private:
+    static constexpr uint32_t kWrapMarker = UINT32_MAX;
+    static constexpr size_t kLengthSize = sizeof(uint32_t);
+    static constexpr size_t kAlignment = 8;
+
+    static constexpr size_t recordSize(uint32_t size) noexcept {
+        return (kLengthSize + size + kAlignment - 1) & ~(kAlignment - 1);
+    }
+    void writeLength(size_t offset, uint32_t length) noexcept {
+        std::memcpy(m_buffer.get() + offset, &length, kLengthSize);
+    }
+    uint32_t readLength(size_t offset) const noexcept {
+        uint32_t length;
+        std::memcpy(&length, m_buffer.get() + offset, kLengthSize);
+        return length;
+    }
+
+    const size_t m_capacity;
+    std::unique_ptr<char[]> m_buffer;
+
+    // producer
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_tailCache = 0;
+    size_t m_pendingHead = 0;
+
+    // consumer
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_readTail = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "WSCMask.h"
+
+// One WebSocket frame (FIN set) encoded once and shared read-only between connections, see
+// WSCManager::broadcast(). It holds the header without the masking key followed by the
+// plain payload; every client connection writes its own masked copy with encodeMasked().
+class WSCFrame {
+   public:
+    // opcode: WSCMessageType::TEXT, BINARY, ...
+    static std::shared_ptr<const WSCFrame> make(int opcode, const void *payload, size_t length) {
+        return std::shared_ptr<const WSCFrame>(new WSCFrame(opcode, payload, length));
+    }
+
+    int opcode() const noexcept { return m_opcode; }
+    const char *payload() const noexcept { return m_data.data() + m_headerSize; }
+    size_t payloadSize() const noexcept { return m_data.size() - m_headerSize; }
+
+    // Size of the client frame: header, masking key and payload
+    size_t maskedSize() const noexcept { return m_data.size() + 4; }
+
+    // Writes the client frame masked with `key` to out, which holds maskedSize() bytes
+    void encodeMasked(char *out, uint32_t key) const noexcept {
+        std::memcpy(out, m_data.data(), m_headerSize);
+        std::memcpy(out + m_headerSize, &key, 4);
+        WSCMask::apply(out + m_headerSize + 4, payload(), payloadSize(),
+                       reinterpret_cast<const uint8_t *>(out + m_headerSize));
+    }
+
+    // Size of a client frame with `length` payload bytes
+    static size_t clientFrameSize(size_t length) noexcept {
+        return headerSize(length) + 4 + length;
+    }
+
+    // Writes a client frame to out, which holds clientFrameSize(length) bytes. flags carry
+    // FIN and the opcode as the first header byte.
+    static void encodeClientFrame(char *out, int flags, const void *payload, size_t length,
+                                  uint32_t key) noexcept {
+        const size_t header = writeHeader(reinterpret_cast<uint8_t *>(out), flags, length);
+        std::memcpy(out + header, &key, 4);
+        WSCMask::apply(out + header + 4, static_cast<const char *>(payload), length,
+                       reinterpret_cast<const uint8_t *>(out + header));
+    }
+
+   private:
+    static constexpr uint8_t kFin = 0x80;
+    static constexpr uint8_t kMaskBit = 0x80;
+
+    static size_t headerSize(size_t length) noexcept {
+        return length < 126 ? 2 : length <= 0xFFFF ? 4 : 10;
+    }
+
+    // Header without the masking key, returns its size
+    static size_t writeHeader(uint8_t *header, int flags, size_t length) noexcept {
+        header[0] = static_cast<uint8_t>(flags);
+        if (length < 126) {
+            header[1] = static_cast<uint8_t>(kMaskBit | length);
+            return 2;
+        }
+        if (length <= 0xFFFF) {
+            header[1] = kMaskBit | 126;
+            header[2] = static_cast<uint8_t>(length >> 8);
+            header[3] = static_cast<uint8_t>(length);
+            return 4;
+        }
+        header[1] = kMaskBit | 127;
+        const auto wide = static_cast<uint64_t>(length);
+        for (int i = 0; i < 8; i++) header[2 + i] = static_cast<uint8_t>(wide >> (56 - 8 * i));
+        return 10;
+    }
+
+    WSCFrame(int opcode, const void *payload, size_t length) : m_opcode(opcode) {
+        uint8_t header[10];
+        m_headerSize = writeHeader(header, kFin | (opcode & 0x0F), length);
+        m_data.resize(m_headerSize + length);
+        std::memcpy(m_data.data(), header, m_headerSize);
+        if (length) std::memcpy(m_data.data() + m_headerSize, payload, length);
+    }
+
+    int m_opcode;
+    size_t m_headerSize = 0;
+    std::vector<char> m_data;
+};
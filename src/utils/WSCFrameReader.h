@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "WSCMask.h"
+#include "WSCThread.h"
+
+// Read-ahead parser for incoming WebSocket frames. fill() reads as much as the socket has
+// into one contiguous buffer and next() then hands out every complete frame in it without
+// another read, so a burst of small frames costs one recv() instead of two or three per
+// frame. A partial frame at the end stays in the buffer and is moved to the front once the
+// space behind it runs short; a frame larger than the buffer grows it until the frame was
+// read, afterwards the buffer returns to its configured size. Once placed on a NUMA node,
+// every buffer it allocates goes there too.
+class WSCFrameReader {
+   public:
+    enum class Parse { FRAME, NEED_MORE, TOO_BIG };
+
+    struct Frame {
+        int flags;  // first header byte: FIN, RSV and opcode, as Poco reports them
+        char *payload;  // unmasked, valid until the next fill()
+        size_t length;
+    };
+
+    WSCFrameReader(size_t capacity, size_t maxPayloadSize)
+        : m_baseCapacity(std::max<size_t>(capacity, 1024)),
+          m_capacity(m_baseCapacity),
+          m_data(new char[m_capacity]),
+          m_maxPayloadSize(maxPayloadSize) {}
+
+    WSCFrameReader(const WSCFrameReader &) = delete;
+    WSCFrameReader &operator=(const WSCFrameReader &) = delete;
+
+    // Takes the next complete frame out of the buffer
+    Parse next(Frame &frame) noexcept {
+        size_t header;
+        uint64_t length;
+        const Parse parse = peek(header, length);
+        if (parse != Parse::FRAME) return parse;
+        auto *begin = reinterpret_cast<uint8_t *>(m_data.get() + m_begin);
+        char *payload = m_data.get() + m_begin + header;
+        if (begin[1] & kMaskBit) WSCMask::apply(payload, payload, length, begin + header - 4);
+        frame = Frame{begin[0], payload, length};
+        m_begin += header + length;
+        m_needed = 2;
+        return Parse::FRAME;
+    }
+
+    // Whether next() returns without another fill(), true for a frame that is too big too
+    bool ready() noexcept {
+        size_t header;
+        uint64_t length;
+        return peek(header, length) != Parse::NEED_MORE;
+    }
+
+    // Makes room for the frame next() is waiting for and calls read(char *out, size_t size)
+    // once. Returns what read() returned: the bytes added, 0 when the peer closed.
+    template <typename Read>
+    auto fill(Read &&read) {
+        const size_t buffered = m_end - m_begin;
+        if (buffered == 0) {
+            m_begin = m_end = 0;
+            if (m_capacity != m_baseCapacity) resize(m_baseCapacity);
+        } else if (m_needed > m_capacity) {
+            resize(m_needed);
+        } else if (m_capacity - m_end <
+                   std::max(m_needed > buffered ? m_needed - buffered : 0, m_capacity / 4)) {
+            std::memmove(m_data.get(), m_data.get() + m_begin, buffered);
+            m_begin = 0;
+            m_end = buffered;
+        }
+        const auto n = read(m_data.get() + m_end, m_capacity - m_end);
+        if (n > 0) m_end += static_cast<size_t>(n);
+        m_reads++;
+        return n;
+    }
+
+    size_t buffered() const noexcept { return m_end - m_begin; }
+    uint64_t reads() const noexcept { return m_reads; }
+
+    // The read-ahead buffer, replaced when a frame outgrows it
+    char *buffer() noexcept { return m_data.get(); }
+    size_t capacity() const noexcept { return m_capacity; }
+
+    // Moves the buffer to a NUMA node and keeps the buffers of later resizes there
+    void placeOn(int node) {
+        m_node = node;
+        WSCThread::moveToNode(m_data.get(), m_capacity, m_node);
+    }
+
+   private:
+    static constexpr uint8_t kMaskBit = 0x80;
+
+    // Sizes of the frame at the front, sets m_needed while it is incomplete
+    Parse peek(size_t &header, uint64_t &length) noexcept {
+        const size_t available = m_end - m_begin;
+        if (available < 2) return needMore(2);
+        const auto *p = reinterpret_cast<const uint8_t *>(m_data.get() + m_begin);
+        length = p[1] & 0x7F;
+        header = length == 126 ? 4 : length == 127 ? 10 : 2;
+        if (p[1] & kMaskBit) header += 4;
+        if (available < header) return needMore(header);
+        if (length == 126) {
+            length = static_cast<uint64_t>(p[2]) << 8 | p[3];
+        } else if (length == 127) {
+            length = 0;
+            for (int i = 0; i < 8; i++) length = length << 8 | p[2 + i];
+        }
+        if (length > m_maxPayloadSize) return Parse::TOO_BIG;
+        if (available - header < length) return needMore(header + static_cast<size_t>(length));
+        return Parse::FRAME;
+    }
+
+    Parse needMore(size_t frameSize) noexcept {
+        m_needed = frameSize;
+        return Parse::NEED_MORE;
+    }
+
+    void resize(size_t capacity) {
+        const size_t buffered = m_end - m_begin;
+        std::unique_ptr<char[]> data(new char[capacity]);
+        // before the copy touches the pages
+        if (m_node >= 0) WSCThread::moveToNode(data.get(), capacity, m_node);
+        std::memcpy(data.get(), m_data.get() + m_begin, buffered);
+        m_data = std::move(data);
+        m_capacity = capacity;
+        m_begin = 0;
+        m_end = buffered;
+    }
+
+    const size_t m_baseCapacity;
+    size_t m_capacity;
+    std::unique_ptr<char[]> m_data;
+    const size_t m_maxPayloadSize;
+    size_t m_begin = 0;
+    size_t m_end = 0;
+    size_t m_needed = 2;  // size of the frame at the front once its header is known
+    uint64_t m_reads = 0;
+    int m_node = -1;  // NUMA node of the buffer, -1 when not placed
+};
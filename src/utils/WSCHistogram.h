@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear (HDR style) histogram for latency values.
+// Every power-of-two range is split into 2^(SubBucketBits - 1) linear buckets, so the
+// relative error of a reported value is bounded by 2^-(SubBucketBits - 1).
+// record() is a single relaxed atomic increment and is safe to call from any thread.
+template <unsigned SubBucketBits = 7, unsigned MaxValueBits = 40>
+class WSCHistogram {
+    static_assert(SubBucketBits >= 2 && SubBucketBits < MaxValueBits && MaxValueBits <= 64);
+
+   public:
+    static constexpr size_t kSubBucketCount = size_t{1} << SubBucketBits;
+    static constexpr size_t kHalfSubBucketCount = kSubBucketCount / 2;
+    static constexpr size_t kBucketCount =
+        (MaxValueBits - SubBucketBits + 1) * kHalfSubBucketCount + kHalfSubBucketCount;
+    static constexpr uint64_t kMaxValue =
+        MaxValueBits == 64 ? UINT64_MAX : (uint64_t{1} << MaxValueBits) - 1;
+
+    struct Snapshot {
+        std::array<uint64_t, kBucketCount> counts{};
+        uint64_t count{0};
+        uint64_t sum{0};
+        uint64_t min{0};
+        uint64_t max{0};
+
+        double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+        uint64_t percentile(double p) const {
+            if (count == 0) return 0;
+            p = std::clamp(p, 0.0, 100.0);
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count) + 0.5);
+            rank = std::clamp<uint64_t>(rank, 1, count);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBucketCount; i++) {
+                seen += counts[i];
+                if (seen >= rank) return std::min(highestEquivalentValue(i), max);
+            }
+            return max;
+        }
+    };
+
+    void record(uint64_t value, uint64_t times = 1) noexcept {
+        value = std::min(value, kMaxValue);
+        m_counts[indexOf(value)].fetch_add(times, std::memory_order_relaxed);
+        m_count.fetch_add(times, std::memory_order_relaxed);
+        m_sum.fetch_add(value * times, std::memory_order_relaxed);
+
+        uint64_t current = m_min.load(std::memory_order_relaxed);
+        while (value < current &&
+               !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+        current = m_max.load(std::memory_order_relaxed);
+        while (value > current &&
+               !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const noexcept { return m_count.load(std::memory_order_relaxed); }
+
+    // Approximate: concurrent writers may land in between bucket reads.
+    Snapshot snapshot() const noexcept {
+        Snapshot snap;
+        for (size_t i = 0; i < kBucketCount; i++) {
+            snap.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            snap.count += snap.counts[i];
+        }
+        snap.sum = m_sum.load(std::memory_order_relaxed);
+        snap.max = m_max.load(std::memory_order_relaxed);
+        uint64_t min = m_min.load(std::memory_order_relaxed);
+        snap.min = snap.count ? min : 0;
+        return snap;
+    }
+
+    uint64_t percentile(double p) const noexcept { return snapshot().percentile(p); }
+
+    void reset() noexcept {
+        for (auto &bucket : m_counts) bucket.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_min.store(UINT64_MAX, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    static constexpr size_t indexOf(uint64_t value) noexcept {
+        if (value < kSubBucketCount) return static_cast<size_t>(value);
+        const unsigned msb = 63u - static_cast<unsigned>(std::countl_zero(value));
+        const unsigned shift = msb - (SubBucketBits - 1);
+        return shift * kHalfSubBucketCount + static_cast<size_t>(value >> shift);
+    }
+
+    static constexpr uint64_t lowestEquivalentValue(size_t index) noexcept {
+        if (index < kSubBucketCount) return index;
+        const size_t shift = index / kHalfSubBucketCount - 1;
+        const uint64_t top = index - shift * kHalfSubBucketCount;
+        return top << shift;
+    }
+
+    static constexpr uint64_t highestEquivalentValue(size_t index) noexcept {
+        if (index < kSubBucketCount) return index;
+        const size_t shift = index / kHalfSubBucketCount - 1;
+        return lowestEquivalentValue(index) + ((uint64_t{1} << shift) - 1);
+    }
+
+   private:
+    std::array<std::atomic<uint64_t>, kBucketCount> m_counts{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_min{UINT64_MAX};
+    std::atomic<uint64_t> m_max{0};
+};
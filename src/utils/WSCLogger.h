@@ -1,23 +1,110 @@
 #pragma once
+#include <spdlog/details/os.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <initializer_list>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
+#include "WSCBinaryLog.h"
+#include "WSCByteRing.h"
 #include "WSCCommon.h"
 
-// Convenience macros for logging with source location
-#define WSCLog(level, msg) WSCLogger::level(msg, __FILE__, __LINE__, __FUNCTION__)
+// Levels below this threshold are compiled out entirely, their arguments are never evaluated
+#ifndef WSC_LOG_ACTIVE_LEVEL
+#define WSC_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+// Level names accepted by WSCLog
+namespace WSCLogLevel {
+    inline constexpr auto trace = spdlog::level::trace;
+    inline constexpr auto debug = spdlog::level::debug;
+    inline constexpr auto info = spdlog::level::info;
+    inline constexpr auto warn = spdlog::level::warn;
+    inline constexpr auto error = spdlog::level::err;
+    inline constexpr auto critical = spdlog::level::critical;
+}  // namespace WSCLogLevel
+
+// WSCLog(level, "fmt {}", args...): the runtime level is checked before any argument is
+// evaluated or formatted, and the source file basename is computed at compile time. Each
+// call site owns a WSCLogger::Site, the id it is known by in binary logs.
+#define WSCLog(level, ...)                                                                    \
+    do {                                                                                      \
+        if constexpr (WSCLogLevel::level >= WSC_LOG_ACTIVE_LEVEL) {                           \
+            if (WSCLogger::shouldLog(WSCLogLevel::level)) {                                   \
+                static constexpr const char* wscLogFile = WSCLogger::basename(__FILE__);      \
+                static WSCLogger::Site wscLogSite;                                            \
+                WSCLogger::log(wscLogSite, WSCLogLevel::level,                                \
+                               spdlog::source_loc{wscLogFile, __LINE__, __FUNCTION__},        \
+                               __VA_ARGS__);                                                  \
+            }                                                                                 \
+        }                                                                                     \
+    } while (0)
 
 class WSCLogger {
    public:
+    // Asynchronous mode: log calls format into a per-thread lock-free ring and return, a
+    // background thread writes the rings to the sinks in batches. When a ring is full the
+    // message is dropped and counted instead of blocking the caller. The writer sleeps
+    // while every ring is empty and the first message pushed after that wakes it up.
+    struct AsyncConfig {
+        size_t threadBufferSize;                   // bytes per logging thread
+        std::chrono::milliseconds flushInterval;   // sinks are flushed at least this often
+        size_t maxBatch;                           // records written per ring and pass
+
+        AsyncConfig()
+            : threadBufferSize(1024 * 1024),  // 1MB
+              flushInterval(200),             // 200ms
+              maxBatch(1024) {}
+    };
+
     static void init(const std::string& log_name, const std::string& log_file = "log.txt",
                      spdlog::level::level_enum log_level = spdlog::level::info) {
+        getInstance().doStopAsync();
+        getInstance().doInit(log_name, log_file, log_level);
+    }
+
+    // Binary mode: like async mode, but a log call stores the id of its call site, a raw
+    // timestamp and the argument bytes instead of formatted text. Call sites with argument
+    // types the binary format does not know are formatted and stored as text. The file is
+    // turned into text with WSCLogDecode; messages logged after shutdown() go to the text
+    // log with the same name and a .txt extension.
+    static void initBinary(const std::string& log_name, const std::string& log_file = "log.wscb",
+                           spdlog::level::level_enum log_level = spdlog::level::info,
+                           const AsyncConfig& config = AsyncConfig{}) {
+        getInstance().doStopAsync();
+        getInstance().doInit(log_name,
+                             std::filesystem::path(log_file).replace_extension(".txt").string(),
+                             log_level);
+        getInstance().doStartBinary(log_file, config);
+    }
+
+    static void initAsync(const std::string& log_name, const std::string& log_file = "log.txt",
+                          spdlog::level::level_enum log_level = spdlog::level::info,
+                          const AsyncConfig& config = AsyncConfig{}) {
+        getInstance().doStopAsync();
         getInstance().doInit(log_name, log_file, log_level);
+        getInstance().doStartAsync(config);
+    }
+
+    // Drains and stops the async writer, later messages are written synchronously
+    static void shutdown() { getInstance().doStopAsync(); }
+
+    static uint64_t droppedMessages() noexcept {
+        return getInstance().m_async.dropped.load(std::memory_order_relaxed);
     }
 
     static void setLogLevel(spdlog::level::level_enum level) {
@@ -36,47 +123,451 @@ class WSCLogger {
 
     static void setPattern(const std::string& pattern) { getInstance().doSetPattern(pattern); }
 
-    static void debug(const std::string& msg, const char* file, int line, const char* function) {
-        log_with_location(spdlog::level::debug, msg, file, line, function);
+    static bool shouldLog(spdlog::level::level_enum level) noexcept {
+        const auto& logger = getInstance().logger;
+        return logger && logger->should_log(level);
     }
 
-    static void info(const std::string& msg, const char* file, int line, const char* function) {
-        log_with_location(spdlog::level::info, msg, file, line, function);
-    }
+    // Binary log id of a WSCLog call site, assigned on its first message
+    struct Site {
+        std::atomic<uint32_t> id{0};
+    };
 
-    static void warn(const std::string& msg, const char* file, int line, const char* function) {
-        log_with_location(spdlog::level::warn, msg, file, line, function);
+    template <typename... Args>
+    static void log(Site& site, spdlog::level::level_enum level, spdlog::source_loc location,
+                    spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        auto& instance = getInstance();
+        if (instance.m_async.enabled.load(std::memory_order_acquire)) {
+            const bool binary = instance.m_async.binary.load(std::memory_order_relaxed);
+            if (binary) {
+                if constexpr (WSCBinaryLog::kEncodable<Args...>) {
+                    const auto format = fmt.get();
+                    instance.pushBinary(site, level, location,
+                                        std::string_view(format.data(), format.size()), args...);
+                    return;
+                }
+            }
+            spdlog::memory_buf_t& text = threadText();
+            text.clear();
+            spdlog::fmt_lib::format_to(spdlog::fmt_lib::appender(text), fmt,
+                                       std::forward<Args>(args)...);
+            if (binary) {
+                instance.pushBinary(site, level, location, "{}",
+                                    std::string_view(text.data(), text.size()));
+            } else {
+                instance.pushAsync(level, location, text);
+            }
+        } else {
+            instance.logger->log(location, level, fmt, std::forward<Args>(args)...);
+        }
     }
 
-    static void error(const std::string& msg, const char* file, int line, const char* function) {
-        log_with_location(spdlog::level::err, msg, file, line, function);
+    static constexpr const char* basename(const char* path) {
+        const char* name = path;
+        for (const char* c = path; *c != '\0'; c++) {
+            if (*c == '/' || *c == '\\') name = c + 1;
+        }
+        return name;
     }
 
    private:
     WSCLogger() = default;
+    ~WSCLogger() { doStopAsync(); }
     WSCLogger(const WSCLogger&) = delete;
     WSCLogger& operator=(const WSCLogger&) = delete;
 
-    static WSCLogger& getInstance() {
-        static WSCLogger instance;
-        return instance;
+    // Fixed part of an async record, followed by the formatted message
+    struct AsyncRecord {
+        spdlog::log_clock::time_point time;
+        const char* file;  // static storage, see WSCLog
+        const char* function;
+        int line;
+        spdlog::level::level_enum level;
+        size_t threadId;
+    };
+
+    struct AsyncBuffer {
+        explicit AsyncBuffer(size_t size)
+            : ring(size), threadId(spdlog::details::os::thread_id()) {}
+        WSCByteRing ring;
+        const size_t threadId;  // of the thread that created the buffer
+        std::atomic<bool> retired{false};
+    };
+
+    struct AsyncThreadState {
+        std::shared_ptr<AsyncBuffer> buffer;
+        ~AsyncThreadState() {
+            if (buffer) buffer->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    struct AsyncState {
+        std::atomic<bool> enabled{false};
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> dropped{0};
+        AsyncConfig config;
+        std::thread writer;
+        std::mutex buffersMutex;
+        std::vector<std::shared_ptr<AsyncBuffer>> buffers;
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping{false};  // the writer found every ring empty
+
+        // binary mode
+        std::atomic<bool> binary{false};  // only changed while the writer is stopped
+        std::FILE* binaryFile = nullptr;
+        std::mutex sitesMutex;
+        std::vector<std::string> sites;  // encoded SITE records, index + 1 is the site id
+        size_t sitesWritten = 0;         // to the current binary file
+        size_t binaryThread = 0;         // thread of the last ENTRY written, writer only
+    };
+
+    // Header of a binary ring record, followed by the encoded arguments
+    static constexpr size_t kBinaryHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+
+    static spdlog::memory_buf_t& threadText() {
+        thread_local spdlog::memory_buf_t text;
+        return text;
     }
 
-    static void log_with_location(spdlog::level::level_enum level, const std::string& msg,
-                                  const char* file, int line, const char* function) {
-        const auto& logger = getInstance().logger;
-        if (logger->should_log(level)) {
-            std::string filename = std::string(file);
-            size_t last_slash = filename.find_last_of("/\\");
-            if (last_slash != std::string::npos) {
-                filename = filename.substr(last_slash + 1);
+    AsyncBuffer& threadBuffer() {
+        thread_local AsyncThreadState state;
+        if (!state.buffer) {
+            state.buffer = std::make_shared<AsyncBuffer>(m_async.config.threadBufferSize);
+            std::lock_guard<std::mutex> lock(m_async.buffersMutex);
+            m_async.buffers.push_back(state.buffer);
+        }
+        return *state.buffer;
+    }
+
+    void pushAsync(spdlog::level::level_enum level, const spdlog::source_loc& location,
+                   const spdlog::memory_buf_t& text) {
+        AsyncBuffer& buffer = threadBuffer();
+        const AsyncRecord record{spdlog::log_clock::now(),
+                                 location.filename,
+                                 location.funcname,
+                                 location.line,
+                                 level,
+                                 spdlog::details::os::thread_id()};
+        char* slot = buffer.ring.reserve(static_cast<uint32_t>(sizeof(record) + text.size()));
+        if (!slot) {
+            m_async.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::memcpy(slot, &record, sizeof(record));
+        std::memcpy(slot + sizeof(record), text.data(), text.size());
+        buffer.ring.commit();
+        wakeWriter();
+    }
+
+    // After a commit. The fence pairs with the one in waitForRecords(): either the writer
+    // sees the record or this sees the writer sleeping, so the notify is only paid for by
+    // the first record after an idle period.
+    void wakeWriter() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_async.sleeping.load(std::memory_order_relaxed) ||
+            !m_async.sleeping.exchange(false, std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_async.wakeMutex);
+        m_async.wake.notify_one();
+    }
+
+    // Writer only, once a pass wrote nothing. Sleeps until a record is pushed, the async
+    // mode stops or the flush interval passed.
+    void waitForRecords() {
+        std::unique_lock<std::mutex> lock(m_async.wakeMutex);
+        m_async.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            // rings registered after the writer took its copy count too
+            std::lock_guard<std::mutex> buffersLock(m_async.buffersMutex);
+            for (const auto& buffer : m_async.buffers) {
+                if (!buffer->ring.empty()) {
+                    m_async.sleeping.store(false, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+        m_async.wake.wait_for(lock, m_async.config.flushInterval, [this] {
+            return !m_async.sleeping.load(std::memory_order_relaxed) ||
+                   !m_async.running.load(std::memory_order_acquire);
+        });
+        m_async.sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void pushBinary(Site& site, spdlog::level::level_enum level,
+                    const spdlog::source_loc& location, std::string_view format,
+                    const Args&... args) {
+        const uint64_t timestamp = WSCBinaryLog::timestamp();
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = registerSite(site, level, location, format,
+                              {WSCBinaryLog::ArgOf<Args>::type...});
+        }
+        AsyncBuffer& buffer = threadBuffer();
+        const size_t size = kBinaryHeaderSize + (WSCBinaryLog::ArgOf<Args>::size(args) + ... + 0);
+        char* slot = buffer.ring.reserve(static_cast<uint32_t>(size));
+        if (!slot) {
+            m_async.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::memcpy(slot, &id, sizeof(id));
+        std::memcpy(slot + sizeof(id), &timestamp, sizeof(timestamp));
+        [[maybe_unused]] char* out = slot + kBinaryHeaderSize;
+        ((out = WSCBinaryLog::ArgOf<Args>::encode(out, args)), ...);
+        buffer.ring.commit();
+        wakeWriter();
+    }
+
+    uint32_t registerSite(Site& site, spdlog::level::level_enum level,
+                          const spdlog::source_loc& location, std::string_view format,
+                          std::initializer_list<WSCBinaryLog::ArgType> args) {
+        std::lock_guard<std::mutex> lock(m_async.sitesMutex);
+        uint32_t id = site.id.load(std::memory_order_relaxed);
+        if (id != 0) return id;
+
+        std::string record;
+        auto append = [&record](const auto& value) {
+            record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        auto appendString = [&](auto length, std::string_view value) {
+            append(static_cast<decltype(length)>(value.size()));
+            record.append(value.data(), value.size());
+        };
+        id = static_cast<uint32_t>(m_async.sites.size() + 1);
+        append(WSCBinaryLog::RecordKind::SITE);
+        append(id);
+        append(static_cast<uint8_t>(level));
+        append(static_cast<uint32_t>(location.line));
+        appendString(uint16_t{}, location.filename ? location.filename : "");
+        appendString(uint16_t{}, location.funcname ? location.funcname : "");
+        appendString(uint32_t{}, format);
+        append(static_cast<uint8_t>(args.size()));
+        for (auto type : args) append(type);
+        m_async.sites.push_back(std::move(record));
+        site.id.store(id, std::memory_order_release);
+        return id;
+    }
+
+    void doStartAsync(const AsyncConfig& config) {
+        m_async.config = config;
+        m_async.running.store(true, std::memory_order_release);
+        m_async.writer = std::thread(&WSCLogger::asyncWriterLoop, this);
+        m_async.enabled.store(true, std::memory_order_release);
+    }
+
+    void doStartBinary(const std::string& log_file, const AsyncConfig& config) {
+        const std::string path = WSCUtils::getLogDirectory() + "/" + log_file;
+        m_async.binaryFile = std::fopen(path.c_str(), "wb");
+        if (!m_async.binaryFile) {
+            logger->error("Failed to open binary log {}, logging asynchronously as text", path);
+            doStartAsync(config);
+            return;
+        }
+        std::fwrite(WSCBinaryLog::kMagic, 1, sizeof(WSCBinaryLog::kMagic), m_async.binaryFile);
+        {
+            // a new file needs the definitions of sites registered by earlier sessions
+            std::lock_guard<std::mutex> lock(m_async.sitesMutex);
+            m_async.sitesWritten = 0;
+        }
+        writeCalibration();
+        m_async.binary.store(true, std::memory_order_relaxed);
+        doStartAsync(config);
+    }
+
+    void doStopAsync() {
+        if (!m_async.running.exchange(false, std::memory_order_acq_rel)) return;
+        m_async.enabled.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_async.wakeMutex);
+            m_async.wake.notify_one();
+        }
+        if (m_async.writer.joinable()) m_async.writer.join();
+        drainAfterStop();
+        if (m_async.binaryFile) {
+            writeCalibration();
+            std::fclose(m_async.binaryFile);
+            m_async.binaryFile = nullptr;
+        }
+        m_async.binary.store(false, std::memory_order_relaxed);
+    }
+
+    // Threads that saw the async mode enabled may still commit a record after the writer's
+    // final pass, they are written here once it has been joined
+    void drainAfterStop() {
+        std::vector<std::shared_ptr<AsyncBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(m_async.buffersMutex);
+            buffers = m_async.buffers;
+        }
+        const bool binary = m_async.binary.load(std::memory_order_relaxed);
+        if (binary && !m_async.binaryFile) return;
+        bool flushNow = false;
+        size_t written;
+        do {
+            written = binary ? drainBinaryBuffers(buffers) : drainAsyncBuffers(buffers, flushNow);
+        } while (written > 0);
+        if (binary) {
+            std::fflush(m_async.binaryFile);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_sinksMutex);
+        logger->flush();
+    }
+
+    // Pairs the raw timestamp with wall clock time, the decoder derives the tick rate
+    void writeCalibration() {
+        const uint64_t ticks = WSCBinaryLog::timestamp();
+        const int64_t unixNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+        const auto kind = WSCBinaryLog::RecordKind::CALIBRATION;
+        std::fwrite(&kind, sizeof(kind), 1, m_async.binaryFile);
+        std::fwrite(&ticks, sizeof(ticks), 1, m_async.binaryFile);
+        std::fwrite(&unixNs, sizeof(unixNs), 1, m_async.binaryFile);
+    }
+
+    void writeBinaryDropped(uint64_t count) {
+        const auto kind = WSCBinaryLog::RecordKind::DROPPED;
+        std::fwrite(&kind, sizeof(kind), 1, m_async.binaryFile);
+        std::fwrite(&count, sizeof(count), 1, m_async.binaryFile);
+    }
+
+    // Binary counterpart of drainAsyncBuffers: new site definitions first, then the rings
+    // with a THREAD record whenever the owning thread changes
+    size_t drainBinaryBuffers(std::vector<std::shared_ptr<AsyncBuffer>>& buffers) {
+        std::FILE* file = m_async.binaryFile;
+        {
+            std::lock_guard<std::mutex> lock(m_async.sitesMutex);
+            for (; m_async.sitesWritten < m_async.sites.size(); m_async.sitesWritten++) {
+                const std::string& site = m_async.sites[m_async.sitesWritten];
+                std::fwrite(site.data(), 1, site.size(), file);
             }
-            std::string location = "[" + filename + ":" + std::to_string(line) + "]";
-            if (level == spdlog::level::trace) {
-                location += "[" + std::string(function) + "]";
+        }
+        size_t written = 0;
+        for (auto& buffer : buffers) {
+            uint32_t size = 0;
+            for (size_t n = 0; n < m_async.config.maxBatch; n++) {
+                const char* data = buffer->ring.front(size);
+                if (!data) break;
+                if (buffer->threadId != m_async.binaryThread) {
+                    const auto kind = WSCBinaryLog::RecordKind::THREAD;
+                    const uint64_t threadId = buffer->threadId;
+                    std::fwrite(&kind, sizeof(kind), 1, file);
+                    std::fwrite(&threadId, sizeof(threadId), 1, file);
+                    m_async.binaryThread = buffer->threadId;
+                }
+                // ring record: u32 site, u64 timestamp, arguments
+                const auto kind = WSCBinaryLog::RecordKind::ENTRY;
+                const auto arguments = static_cast<uint32_t>(size - kBinaryHeaderSize);
+                std::fwrite(&kind, sizeof(kind), 1, file);
+                std::fwrite(data, 1, kBinaryHeaderSize, file);
+                std::fwrite(&arguments, sizeof(arguments), 1, file);
+                std::fwrite(data + kBinaryHeaderSize, 1, arguments, file);
+                buffer->ring.pop();
+                written++;
             }
-            logger->log(level, "{} {}", location, msg);
         }
+        return written;
+    }
+
+    // Writes up to maxBatch records of every ring, returns the number written
+    size_t drainAsyncBuffers(std::vector<std::shared_ptr<AsyncBuffer>>& buffers,
+                             bool& flushNow) {
+        size_t written = 0;
+        std::lock_guard<std::mutex> lock(m_sinksMutex);
+        for (auto& buffer : buffers) {
+            uint32_t size = 0;
+            for (size_t n = 0; n < m_async.config.maxBatch; n++) {
+                const char* data = buffer->ring.front(size);
+                if (!data) break;
+                AsyncRecord record;
+                std::memcpy(&record, data, sizeof(record));
+                spdlog::details::log_msg msg(
+                    record.time, spdlog::source_loc{record.file, record.line, record.function},
+                    logger->name(), record.level,
+                    spdlog::string_view_t(data + sizeof(record), size - sizeof(record)));
+                msg.thread_id = record.threadId;
+                for (auto& sink : logger->sinks()) {
+                    if (sink->should_log(record.level)) sink->log(msg);
+                }
+                flushNow |= record.level >= spdlog::level::err;
+                buffer->ring.pop();
+                written++;
+            }
+        }
+        return written;
+    }
+
+    void asyncWriterLoop() {
+        std::vector<std::shared_ptr<AsyncBuffer>> buffers;
+        auto lastFlush = std::chrono::steady_clock::now();
+        auto lastCalibration = lastFlush;
+        uint64_t reportedDrops = 0;
+        const bool binary = m_async.binary.load(std::memory_order_relaxed);
+        m_async.binaryThread = 0;
+        bool stopping = false;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(m_async.buffersMutex);
+                // forget rings whose thread exited once they are drained
+                std::erase_if(m_async.buffers, [](const auto& buffer) {
+                    return buffer->retired.load(std::memory_order_acquire) &&
+                           buffer->ring.empty();
+                });
+                buffers = m_async.buffers;
+            }
+
+            bool flushNow = false;
+            const size_t written =
+                binary ? drainBinaryBuffers(buffers) : drainAsyncBuffers(buffers, flushNow);
+
+            const uint64_t drops = m_async.dropped.load(std::memory_order_relaxed);
+            if (drops != reportedDrops && binary) {
+                writeBinaryDropped(drops - reportedDrops);
+                reportedDrops = drops;
+            } else if (drops != reportedDrops) {
+                logger->log(spdlog::source_loc{basename(__FILE__), __LINE__, __FUNCTION__},
+                            spdlog::level::warn, "Async logger dropped {} messages",
+                            drops - reportedDrops);
+                reportedDrops = drops;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (binary && now - lastCalibration >= std::chrono::seconds(1)) {
+                writeCalibration();
+                lastCalibration = now;
+            }
+            if (flushNow || now - lastFlush >= m_async.config.flushInterval) {
+                if (binary) {
+                    std::fflush(m_async.binaryFile);
+                } else {
+                    std::lock_guard<std::mutex> lock(m_sinksMutex);
+                    logger->flush();
+                }
+                lastFlush = now;
+            }
+
+            if (written == 0) {
+                // a final pass after stop picks up records committed while stopping
+                if (stopping) break;
+                waitForRecords();
+                stopping = !m_async.running.load(std::memory_order_acquire);
+            }
+        }
+        if (binary) {
+            std::fflush(m_async.binaryFile);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_sinksMutex);
+        logger->flush();
+    }
+
+    static WSCLogger& getInstance() {
+        static WSCLogger instance;
+        return instance;
     }
 
     void doInit(const std::string& log_name, const std::string& log_file,
@@ -94,7 +585,7 @@ class WSCLogger {
         sinks.push_back(file_sink);
 
         logger = std::make_shared<spdlog::logger>(log_name, begin(sinks), end(sinks));
-        doSetPattern("%^[%L]%$ [%Y-%m-%d %H:%M:%S] [thread %t] %v");
+        doSetPattern("%^[%L]%$ [%Y-%m-%d %H:%M:%S] [thread %t] [%s:%#] %v");
         logger->set_level(log_level);
         logger->flush_on(log_level);
     }
@@ -102,8 +593,9 @@ class WSCLogger {
     void doSetLogLevel(spdlog::level::level_enum level) { logger->set_level(level); }
 
     void doSetLogFile(const std::string& log_file) {
+        std::lock_guard<std::mutex> lock(m_sinksMutex);
         auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(log_file, true);
-        file_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
+        file_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] [%s:%#] %v");
         logger->sinks().at(1) = file_sink;
     }
 
@@ -116,10 +608,13 @@ class WSCLogger {
     }
 
     void doSetPattern(const std::string& pattern) {
+        std::lock_guard<std::mutex> lock(m_sinksMutex);
         logger->set_pattern(pattern);
         for (auto& sink : logger->sinks()) {
             sink->set_pattern(pattern);
         }
     }
     std::shared_ptr<spdlog::logger> logger;
+    std::mutex m_sinksMutex;  // sinks are only used by the async writer in async mode
+    AsyncState m_async;
 };
\ No newline at end of file
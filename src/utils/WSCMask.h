@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WSC_MASK_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WSC_MASK_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define WSC_MASK_NEON 1
+#endif
+
+// RFC 6455 payload masking: out[i] = in[i] ^ key[i % 4]. Works 32 or 16 bytes at a time
+// where the target has vector registers, 8 bytes at a time otherwise. out may equal in.
+namespace WSCMask {
+    inline void apply(char *out, const char *in, size_t length, const uint8_t key[4]) noexcept {
+        uint32_t key32;
+        std::memcpy(&key32, key, 4);
+        size_t i = 0;
+#ifdef WSC_MASK_AVX2
+        const __m256i key256 = _mm256_set1_epi32(static_cast<int>(key32));
+        for (; i + 32 <= length; i += 32) {
+            const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                                _mm256_xor_si256(data, key256));
+        }
+#endif
+#if defined(WSC_MASK_SSE2)
+        const __m128i key128 = _mm_set1_epi32(static_cast<int>(key32));
+        for (; i + 16 <= length; i += 16) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_xor_si128(data, key128));
+        }
+#elif defined(WSC_MASK_NEON)
+        const uint8x16_t key128 = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+        for (; i + 16 <= length; i += 16) {
+            const uint8x16_t data = vld1q_u8(reinterpret_cast<const uint8_t *>(in + i));
+            vst1q_u8(reinterpret_cast<uint8_t *>(out + i), veorq_u8(data, key128));
+        }
+#endif
+        // every block above is a multiple of 4 bytes long, so the key is still aligned to i
+        const uint64_t key64 = static_cast<uint64_t>(key32) << 32 | key32;
+        for (; i + 8 <= length; i += 8) {
+            uint64_t data;
+            std::memcpy(&data, in + i, 8);
+            data ^= key64;
+            std::memcpy(out + i, &data, 8);
+        }
+        for (; i < length; i++) out[i] = static_cast<char>(in[i] ^ key[i & 3]);
+    }
+}  // namespace WSCMask
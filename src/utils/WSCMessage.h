@@ -1,8 +1,14 @@
+#pragma once
+
 #include <chrono>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
+#include "WSCFrame.h"
+
 enum WSCMessageType {
     // Opcode mask (bits 0-3)
     OPCODE_MASK = 0x0F,
@@ -32,6 +38,7 @@ struct WSCMessage {
     std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::now();
     uint16_t closeCode{0};
     std::string closeReason = "";
+    std::shared_ptr<const WSCFrame> frame = nullptr;  // pre-encoded broadcast, no payload
     std::string getPayload() const { return std::string(payload.begin(), payload.end()); }
     std::string getFormattedTimestamp() const {
         auto time = std::chrono::system_clock::to_time_t(timestamp);
@@ -62,4 +69,15 @@ struct WSCMessage {
                 return "UNKNOWN";
         }
     }
-};
\ No newline at end of file
+};
+
+// A received TEXT or BINARY message that stays in the receive buffer, see
+// WSC::setDataBatchCallback(). Valid only until the callback returns.
+struct WSCMessageView {
+    WSCMessageType type;
+    const uint8_t *data;
+    size_t size;
+    std::string_view text() const noexcept {
+        return std::string_view(reinterpret_cast<const char *>(data), size);
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "WSCMessage.h"
+
+// Receive side protocol rules shared by WSC and BasicWSC: reassembles fragmented messages,
+// parses CLOSE payloads and rejects frames RFC 6455 does not allow. What a frame leads to is
+// up to the sink, called directly so it can be inlined:
+//   void onMessage(const WSCMessageView &message);
+//   void onPing(std::string_view payload);
+//   void onPong(std::string_view payload);
+//   void onClose(uint16_t code, std::string_view reason);  // 1005 for an empty CLOSE
+class WSCProtocol {
+   public:
+    enum class Result { OK, CLOSED, INVALID };
+
+    // One unmasked frame, flags carry FIN and the opcode. CLOSED after a CLOSE frame,
+    // INVALID when the frame breaks the protocol, see error().
+    template <typename Sink>
+    Result handle(int flags, const char *payload, size_t length, Sink &&sink) {
+        const int opcode = flags & WSCMessageType::OPCODE_MASK;
+        const bool final = (flags & WSCMessageType::FIN) != 0;
+        const auto *bytes = reinterpret_cast<const uint8_t *>(payload);
+        if (opcode >= WSCMessageType::CLOSE && (!final || length > 125)) {
+            return invalid("Fragmented or oversized control frame");
+        }
+        switch (opcode) {
+            case WSCMessageType::TEXT:
+            case WSCMessageType::BINARY:
+                if (m_fragmented) return invalid("New message before the last one ended");
+                if (final) {
+                    sink.onMessage(
+                        WSCMessageView{static_cast<WSCMessageType>(opcode), bytes, length});
+                } else {
+                    m_fragmented = true;
+                    m_fragmentType = static_cast<WSCMessageType>(opcode);
+                    m_fragments.assign(bytes, bytes + length);
+                }
+                return Result::OK;
+            case WSCMessageType::CONTINUATION:
+                if (!m_fragmented) return invalid("Continuation frame without a message");
+                m_fragments.insert(m_fragments.end(), bytes, bytes + length);
+                if (final) {
+                    m_fragmented = false;
+                    sink.onMessage(
+                        WSCMessageView{m_fragmentType, m_fragments.data(), m_fragments.size()});
+                    m_fragments.clear();
+                }
+                return Result::OK;
+            case WSCMessageType::PING:
+                sink.onPing(std::string_view(payload, length));
+                return Result::OK;
+            case WSCMessageType::PONG:
+                sink.onPong(std::string_view(payload, length));
+                return Result::OK;
+            case WSCMessageType::CLOSE: {
+                if (length == 1) return invalid("CLOSE frame with a one byte payload");
+                const uint16_t code =
+                    length >= 2 ? static_cast<uint16_t>(bytes[0] << 8 | bytes[1]) : 1005;
+                sink.onClose(code, length > 2 ? std::string_view(payload + 2, length - 2)
+                                              : std::string_view());
+                return Result::CLOSED;
+            }
+            default:
+                return invalid("Unknown opcode");
+        }
+    }
+
+    // Drops a message left incomplete, before reading from a new connection
+    void reset() noexcept {
+        m_fragmented = false;
+        m_fragments.clear();
+    }
+
+    // Whether a fragmented message is being reassembled
+    bool fragmented() const noexcept { return m_fragmented; }
+
+    // Why the last INVALID frame was rejected
+    const char *error() const noexcept { return m_error; }
+
+   private:
+    Result invalid(const char *error) noexcept {
+        m_error = error;
+        return Result::INVALID;
+    }
+
+    bool m_fragmented = false;
+    WSCMessageType m_fragmentType = WSCMessageType::TEXT;
+    std::vector<uint8_t> m_fragments;
+    const char *m_error = "";
+};
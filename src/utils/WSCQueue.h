@@ -1,6 +1,6 @@
 #pragma once
 
-#include <chrono>
+#include <atomic>
 #include <condition_variable>
 #include <iomanip>
 #include <iostream>
@@ -16,6 +16,7 @@ class WSCQueue {
     std::queue<T> m_queue;
     mutable std::mutex m_mutex;
     std::condition_variable m_condition;
+    std::atomic<size_t> m_size{0};  // mirrors m_queue.size() for lock-free readers
 
    public:
     void push(T msg, bool save = false) {
@@ -25,6 +26,7 @@ class WSCQueue {
                 m_vector.push_back(msg);
             }
             m_queue.push(std::move(msg));
+            m_size.store(m_queue.size(), std::memory_order_relaxed);
         }
         m_condition.notify_one();
     }
@@ -36,6 +38,7 @@ class WSCQueue {
         }
         msg = std::move(m_queue.front());
         m_queue.pop();
+        m_size.store(m_queue.size(), std::memory_order_relaxed);
         return true;
     }
 
@@ -44,6 +47,27 @@ class WSCQueue {
         m_condition.wait(lock, [this] { return !m_queue.empty(); });
         msg = std::move(m_queue.front());
         m_queue.pop();
+        m_size.store(m_queue.size(), std::memory_order_relaxed);
+    }
+
+    // Blocks until there is a message or, after wake(), stop() returns true. false when it
+    // returns without a message.
+    template <typename Stop>
+    bool wait_and_pop(T &msg, Stop &&stop) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] { return !m_queue.empty() || stop(); });
+        if (m_queue.empty()) return false;
+        msg = std::move(m_queue.front());
+        m_queue.pop();
+        m_size.store(m_queue.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    // Makes the waiting threads check their stop condition. The lock orders it after a stop
+    // flag set before, so a thread about to wait cannot miss it.
+    void wake() {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_condition.notify_all();
     }
 
     bool empty() const {
@@ -51,6 +75,8 @@ class WSCQueue {
         return m_queue.empty();
     }
 
+    size_t size() const noexcept { return m_size.load(std::memory_order_relaxed); }
+
     std::vector<T> getVector() const {
         std::lock_guard<std::mutex> lock(m_mutex);
         return m_vector;
@@ -60,5 +86,6 @@ class WSCQueue {
         std::lock_guard<std::mutex> lock(m_mutex);
         m_queue = std::queue<T>();
         m_vector.clear();
+        m_size.store(0, std::memory_order_relaxed);
     }
 };
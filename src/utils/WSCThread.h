@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#define WSC_NUMA 1
+#endif
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+// Placement of the calling thread: its name as the OS shows it (top -H, perf, gdb), the CPUs
+// it may run on and the NUMA node of memory it works on. Everything is best effort, a
+// function that is not supported on the platform does nothing and reports false.
+namespace WSCThread {
+    // Linux keeps the first 15 characters
+    inline void setName(const std::string &name) {
+#if defined(__linux__)
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+        pthread_setname_np(name.c_str());
+#elif defined(_WIN32)
+        const std::wstring wide(name.begin(), name.end());
+        SetThreadDescription(GetCurrentThread(), wide.c_str());
+#else
+        (void)name;
+#endif
+    }
+
+    // Restricts the calling thread to the given CPUs, macOS has no affinity
+    inline bool pin(const std::vector<int> &cpus) {
+        if (cpus.empty()) return false;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu < 0 || cpu >= static_cast<int>(sizeof(mask) * 8)) return false;
+            mask |= DWORD_PTR(1) << cpu;
+        }
+        return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        return false;
+#endif
+    }
+
+    // NUMA node of the CPU the calling thread runs on right now, -1 when unknown
+    inline int numaNode() {
+#if defined(__linux__)
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return -1;
+        return static_cast<int>(node);
+#else
+        return -1;
+#endif
+    }
+
+    // Prefers the node for the whole pages inside [data, data + size) and moves the pages
+    // already touched there. Untouched pages are placed on the node when first written.
+    inline bool moveToNode(void *data, size_t size, int node) {
+#ifdef WSC_NUMA
+        if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8)) return false;
+        const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const auto begin = (reinterpret_cast<uintptr_t>(data) + page - 1) & ~(page - 1);
+        const auto end = (reinterpret_cast<uintptr_t>(data) + size) & ~(page - 1);
+        if (begin >= end) return false;
+        const unsigned long nodes = 1UL << node;
+        return syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, &nodes,
+                       sizeof(nodes) * 8, MPOL_MF_MOVE) == 0;
+#else
+        (void)data;
+        (void)size;
+        (void)node;
+        return false;
+#endif
+    }
+
+    // "0-3,8" -> {0, 1, 2, 3, 8}, the format of taskset -c and /sys/devices/system/cpu
+    inline std::vector<int> parseCpuList(const std::string &list) {
+        std::vector<int> cpus;
+        size_t position = 0;
+        while (position < list.size()) {
+            size_t end = list.find(',', position);
+            if (end == std::string::npos) end = list.size();
+            const std::string item = list.substr(position, end - position);
+            const size_t dash = item.find('-');
+            const int first = std::stoi(item.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            if (first < 0 || last < first) throw std::invalid_argument("bad CPU range " + item);
+            for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+            position = end + 1;
+        }
+        return cpus;
+    }
+}  // namespace WSCThread
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WSC_TRACE_BUFFER_EVENTS
+#define WSC_TRACE_BUFFER_EVENTS 16384  // per thread, must be a power of two
+#endif
+
+// Frame lifecycle tracing in Chrome trace-event JSON (loadable in chrome://tracing and
+// ui.perfetto.dev). Every thread records into its own ring buffer, so recording is a few
+// stores with no locks; the oldest events are overwritten when a ring is full. When
+// tracing is disabled each trace point costs one relaxed load and a predictable branch.
+namespace WSCTrace {
+    struct Event {
+        const char *name;  // must point to static storage
+        int64_t start;     // nanoseconds since the trace origin
+        int64_t duration;  // < 0 for instant events
+        uint64_t connection;
+        uint64_t bytes;
+    };
+
+    class ThreadBuffer {
+       public:
+        static constexpr size_t kCapacity = WSC_TRACE_BUFFER_EVENTS;
+        static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+        ThreadBuffer() = default;
+
+        // The event is written before the head that publishes it
+        void record(const Event &event) noexcept {
+            const uint64_t head = m_head.load(std::memory_order_relaxed);
+            m_events[head & (kCapacity - 1)] = event;
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        // The events up to the acquired head, except the oldest whose slot the next event
+        // takes. While the owning thread keeps recording, more of them may be overwritten
+        // during the copy; the head is read again after it and those are dropped.
+        std::vector<Event> snapshot() const {
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            const uint64_t count = head < kCapacity - 1 ? head : kCapacity - 1;
+            const uint64_t first = head - count;
+            std::vector<Event> events;
+            events.reserve(count);
+            for (uint64_t i = first; i < head; i++) {
+                events.push_back(m_events[i & (kCapacity - 1)]);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // event i shares its slot with event i + kCapacity, written while the head is there
+            const uint64_t after = m_head.load(std::memory_order_relaxed);
+            const uint64_t valid = after >= kCapacity ? after - kCapacity + 1 : 0;
+            if (valid > first) {
+                events.erase(events.begin(),
+                             events.begin() + static_cast<std::ptrdiff_t>(
+                                                  std::min(valid - first, count)));
+            }
+            return events;
+        }
+
+        void clear() noexcept { m_head.store(0, std::memory_order_release); }
+
+        // A buffer is handed to a new thread once its previous owner has exited
+        void attach(uint32_t tid, const std::string &name) {
+            clear();
+            m_tid.store(tid, std::memory_order_relaxed);
+            setName(name);
+            m_retired.store(false, std::memory_order_release);
+        }
+        void retire() noexcept { m_retired.store(true, std::memory_order_release); }
+        bool retired() const noexcept { return m_retired.load(std::memory_order_acquire); }
+
+        uint32_t tid() const noexcept { return m_tid.load(std::memory_order_relaxed); }
+        void setName(const std::string &name) {
+            std::lock_guard<std::mutex> lock(m_nameMutex);
+            m_name = name;
+        }
+        std::string name() const {
+            std::lock_guard<std::mutex> lock(m_nameMutex);
+            return m_name;
+        }
+
+       private:
+        std::array<Event, kCapacity> m_events{};
+        std::atomic<uint64_t> m_head{0};
+        std::atomic<bool> m_retired{false};
+        std::atomic<uint32_t> m_tid{0};
+        mutable std::mutex m_nameMutex;
+        std::string m_name;
+    };
+
+    namespace detail {
+        inline std::atomic<bool> g_enabled{false};
+        inline const std::chrono::steady_clock::time_point g_origin =
+            std::chrono::steady_clock::now();
+
+        // Buffers of finished threads are kept for dumping until this many are retired,
+        // after that they are recycled for new threads.
+        inline constexpr size_t kMaxRetiredBuffers = 8;
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            uint32_t nextTid = 1;
+        };
+
+        inline Registry &registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        // Buffers are only allocated once a thread records its first event
+        struct ThreadState {
+            std::string name;
+            std::shared_ptr<ThreadBuffer> buffer;
+
+            ~ThreadState() {
+                if (buffer) buffer->retire();
+            }
+        };
+
+        inline ThreadState &threadState() {
+            thread_local ThreadState state;
+            return state;
+        }
+
+        inline ThreadBuffer &threadBuffer() {
+            auto &state = threadState();
+            if (!state.buffer) {
+                auto &reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                size_t retired = 0;
+                for (const auto &buffer : reg.buffers) retired += buffer->retired() ? 1 : 0;
+                if (retired > kMaxRetiredBuffers) {
+                    for (const auto &buffer : reg.buffers) {
+                        if (buffer->retired()) {
+                            state.buffer = buffer;
+                            break;
+                        }
+                    }
+                } else {
+                    state.buffer = std::make_shared<ThreadBuffer>();
+                    reg.buffers.push_back(state.buffer);
+                }
+                state.buffer->attach(reg.nextTid++, state.name);
+            }
+            return *state.buffer;
+        }
+
+        // For the noexcept trace points: without memory for a buffer the event is dropped
+        inline ThreadBuffer *tryThreadBuffer() noexcept {
+            try {
+                return &threadBuffer();
+            } catch (...) {
+                return nullptr;
+            }
+        }
+
+        inline int64_t now() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - g_origin)
+                .count();
+        }
+
+        inline void appendJsonString(std::ostringstream &out, const std::string &value) {
+            out << '"';
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    out << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    out << ' ';
+                } else {
+                    out << c;
+                }
+            }
+            out << '"';
+        }
+    }  // namespace detail
+
+    inline bool enabled() noexcept { return detail::g_enabled.load(std::memory_order_relaxed); }
+    inline void setEnabled(bool enable) noexcept {
+        detail::g_enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    inline void setThreadName(const std::string &name) {
+        auto &state = detail::threadState();
+        state.name = name;
+        if (state.buffer) state.buffer->setName(name);
+    }
+
+    inline void instant(const char *name, uint64_t connection = 0, uint64_t bytes = 0) noexcept {
+        if (ThreadBuffer *buffer = detail::tryThreadBuffer()) {
+            buffer->record(Event{name, detail::now(), -1, connection, bytes});
+        }
+    }
+
+    // Records a complete ("X") event covering the lifetime of the scope, if tracing was
+    // enabled when the scope began.
+    class Scope {
+       public:
+        Scope(const char *name, uint64_t connection = 0, uint64_t bytes = 0) noexcept
+            : m_name(name),
+              m_connection(connection),
+              m_bytes(bytes),
+              m_enabled(enabled()),
+              m_start(m_enabled ? detail::now() : 0) {}
+        ~Scope() {
+            if (!m_enabled) return;
+            if (ThreadBuffer *buffer = detail::tryThreadBuffer()) {
+                buffer->record(
+                    Event{m_name, m_start, detail::now() - m_start, m_connection, m_bytes});
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        void setBytes(uint64_t bytes) noexcept { m_bytes = bytes; }
+
+       private:
+        const char *m_name;
+        uint64_t m_connection;
+        uint64_t m_bytes;
+        const bool m_enabled;
+        const int64_t m_start;
+    };
+
+    inline void clear() {
+        auto &reg = detail::registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (auto &buffer : reg.buffers) buffer->clear();
+    }
+
+    inline std::string toJson() {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            auto &reg = detail::registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            buffers = reg.buffers;
+        }
+
+        std::ostringstream out;
+        out.precision(3);
+        out << std::fixed << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&] {
+            if (!first) out << ",\n";
+            first = false;
+        };
+        for (const auto &buffer : buffers) {
+            const std::string name = buffer->name();
+            if (!name.empty()) {
+                separator();
+                out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->tid()
+                    << R"(,"args":{"name":)";
+                detail::appendJsonString(out, name);
+                out << "}}";
+            }
+            for (const Event &event : buffer->snapshot()) {
+                separator();
+                out << R"({"name":")" << event.name << R"(","cat":"wsc","pid":1,"tid":)"
+                    << buffer->tid() << R"(,"ts":)" << event.start / 1000.0;
+                if (event.duration >= 0) {
+                    out << R"(,"ph":"X","dur":)" << event.duration / 1000.0;
+                } else {
+                    out << R"(,"ph":"i","s":"t")";
+                }
+                out << R"(,"args":{"connection":)" << event.connection << R"(,"bytes":)"
+                    << event.bytes << "}}";
+            }
+        }
+        out << "]}\n";
+        return out.str();
+    }
+
+    inline bool dump(const std::string &path) {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file) return false;
+        file << toJson();
+        return static_cast<bool>(file);
+    }
+}  // namespace WSCTrace
+
+#define WSC_TRACE_CONCAT_INNER(a, b) a##b
+#define WSC_TRACE_CONCAT(a, b) WSC_TRACE_CONCAT_INNER(a, b)
+
+// Trace points: (name[, connection[, bytes]]), name must be a string literal
+#define WSCTraceInstant(...)                                      \
+    do {                                                          \
+        if (WSCTrace::enabled()) WSCTrace::instant(__VA_ARGS__); \
+    } while (0)
+#define WSCTraceScope(...) WSCTrace::Scope WSC_TRACE_CONCAT(wscTraceScope, __LINE__)(__VA_ARGS__)
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <Poco/Buffer.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/NetException.h>
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "WSCByteRing.h"
+#include "WSCMessage.h"
+#include "WSCProtocol.h"
+#include "WSCQueue.h"
+#include "transport.h"
+
+// Send queue policies for BasicWSC. A policy stores whole messages:
+//   bool push(int flags, const void *data, size_t size);
+//   template <typename Send> size_t drain(Send &&send);  // send(flags, data, size)
+
+// Any number of producer threads, a WSCMessage and its payload vector per message
+class WSCLockedQueuePolicy {
+   public:
+    bool push(int flags, const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        m_queue.push(WSCMessage{static_cast<WSCMessageType>(flags),
+                                std::vector<uint8_t>(bytes, bytes + size)});
+        return true;
+    }
+
+    template <typename Send>
+    size_t drain(Send &&send) {
+        size_t sent = 0;
+        WSCMessage message;
+        while (m_queue.try_pop(message)) {
+            send(static_cast<int>(message.type), message.payload.data(), message.payload.size());
+            sent++;
+        }
+        return sent;
+    }
+
+   private:
+    WSCQueue<WSCMessage> m_queue;
+};
+
+// One producer thread, messages are copied into a lock-free ring without allocating.
+// push() fails while the ring is full.
+class WSCRingQueuePolicy {
+   public:
+    explicit WSCRingQueuePolicy(size_t capacity = 1024 * 1024) : m_ring(capacity) {}
+
+    bool push(int flags, const void *data, size_t size) {
+        char *record = m_ring.reserve(static_cast<uint32_t>(size + sizeof(int32_t)));
+        if (!record) return false;
+        const auto header = static_cast<int32_t>(flags);
+        std::memcpy(record, &header, sizeof(header));
+        if (size) std::memcpy(record + sizeof(header), data, size);
+        m_ring.commit();
+        return true;
+    }
+
+    template <typename Send>
+    size_t drain(Send &&send) {
+        size_t sent = 0;
+        uint32_t size;
+        while (const char *record = m_ring.front(size)) {
+            int32_t flags;
+            std::memcpy(&flags, record, sizeof(flags));
+            send(static_cast<int>(flags), record + sizeof(flags), size - sizeof(flags));
+            m_ring.pop();
+            sent++;
+        }
+        return sent;
+    }
+
+   private:
+    WSCByteRing m_ring;
+};
+
+// WebSocket client core assembled at compile time, the specialised counterpart of WSC.
+//
+//   Transport    a WSCTransport, preferably a concrete final class: WSCPlainTransport for
+//                ws://, without any TLS code, or WSCPocoTransport for wss://
+//   QueuePolicy  WSCLockedQueuePolicy or WSCRingQueuePolicy, see above
+//   Handler      called directly, so the compiler can inline it:
+//                  void onMessage(const WSCMessageView &message);          required
+//                  void onControl(int opcode, std::string_view payload);   optional
+//                  void onClose(uint16_t code, std::string_view reason);   optional
+//
+// There are no threads: the owner calls poll() to receive and flush() to send, which
+// suits an event loop or a pinned busy thread. WSC stays the runtime configured façade
+// with its own threads, reconnects, keepalive and std::function callbacks.
+//
+//   struct Ticks { void onMessage(const WSCMessageView &m) { book.apply(m.text()); } };
+//   Ticks ticks;
+//   WSCPlainClient<Ticks> client(ticks);
+//   client.connect("/feed", options);
+//   while (client.poll(Poco::Timespan(0, 1000)) >= 0) client.flush();
+template <typename Transport, typename QueuePolicy, typename Handler>
+class BasicWSC {
+   public:
+    // queueArgs construct the QueuePolicy, e.g. the ring capacity
+    template <typename... QueueArgs>
+    BasicWSC(std::unique_ptr<Transport> transport, Handler &handler, QueueArgs &&...queueArgs)
+        : m_transport(std::move(transport)),
+          m_handler(handler),
+          m_queue(std::forward<QueueArgs>(queueArgs)...) {}
+
+    // Constructs the transport itself
+    template <typename... QueueArgs>
+        requires std::default_initializable<Transport>
+    explicit BasicWSC(Handler &handler, QueueArgs &&...queueArgs)
+        : BasicWSC(std::make_unique<Transport>(), handler,
+                   std::forward<QueueArgs>(queueArgs)...) {}
+
+    BasicWSC(const BasicWSC &) = delete;
+    BasicWSC &operator=(const BasicWSC &) = delete;
+
+    ~BasicWSC() { close(); }
+
+    // Opening handshake, throws Poco::Exception when it fails
+    void connect(const std::string &path, const WSCTransport::Options &options,
+                 const std::string &subprotocols = "") {
+        Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, path,
+                                       Poco::Net::HTTPMessage::HTTP_1_1);
+        request.set("Upgrade", "websocket");
+        request.set("Connection", "Upgrade");
+        request.set("Sec-WebSocket-Version", "13");
+        if (!subprotocols.empty()) request.set("Sec-WebSocket-Protocol", subprotocols);
+        Poco::Net::HTTPResponse response;
+        m_transport->connect(options, request, response);
+        if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_SWITCHING_PROTOCOLS) {
+            throw Poco::Net::WebSocketException("Handshake rejected: " + response.getReason(),
+                                                Poco::Net::WebSocket::WS_ERR_NO_HANDSHAKE);
+        }
+        m_protocol.reset();
+        m_open = true;
+    }
+
+    // Queues a message, from any thread the QueuePolicy allows
+    bool sendText(std::string_view text) {
+        return m_queue.push(WSCMessageType::FIN | WSCMessageType::TEXT, text.data(), text.size());
+    }
+    bool sendBinary(const void *data, size_t size) {
+        return m_queue.push(WSCMessageType::FIN | WSCMessageType::BINARY, data, size);
+    }
+
+    // Writes the queued messages, on the thread that polls. Returns how many.
+    size_t flush() {
+        if (!m_open) return 0;
+        return m_queue.drain([this](int flags, const void *data, size_t size) {
+            m_transport->sendFrame(data, static_cast<int>(size), flags);
+        });
+    }
+
+    // Waits up to timeout for input and handles every frame one read brings. Returns the
+    // number of frames, -1 once the connection is closed (see error()).
+    int poll(const Poco::Timespan &timeout) {
+        if (!m_open) return -1;
+        if (m_transport->waitReadable(timeout) != WSCTransport::Wait::READABLE) return 0;
+        m_frames.clear();
+        WSCTransport::Receive status;
+        if (m_transport->batches()) {
+            status = m_transport->receiveBatch(m_frames, m_error);
+        } else {
+            m_buffer.resize(0);
+            int flags = 0;
+            int length = 0;
+            status = m_transport->receive(m_buffer, flags, length, m_error);
+            if (status == WSCTransport::Receive::FRAME) {
+                m_frames.push_back(WSCTransport::FrameView{flags, m_buffer.begin(),
+                                                           static_cast<size_t>(length)});
+            }
+        }
+        switch (status) {
+            case WSCTransport::Receive::TIMEOUT:
+                return 0;
+            case WSCTransport::Receive::CLOSED:
+                m_error = "Connection closed by peer";
+                m_open = false;
+                return -1;
+            case WSCTransport::Receive::FAILED:
+                m_open = false;
+                return -1;
+            case WSCTransport::Receive::FRAME:
+                break;
+        }
+        for (const auto &frame : m_frames) {
+            if (!handleFrame(frame)) break;
+        }
+        return static_cast<int>(m_frames.size());
+    }
+
+    // Sends a CLOSE frame (code 1000) unless the server closed first
+    void close() {
+        if (!m_open) return;
+        m_open = false;
+        try {
+            m_transport->shutdown();
+            m_transport->close();
+        } catch (const Poco::Exception &exc) {
+            m_error = exc.displayText();
+        }
+    }
+
+    bool isOpen() const noexcept { return m_open; }
+    const std::string &error() const noexcept { return m_error; }
+    Transport &transport() noexcept { return *m_transport; }
+
+   private:
+    // WSCProtocol's sink: the handler, and a PONG for every PING
+    struct Events {
+        BasicWSC &client;
+
+        void onMessage(const WSCMessageView &message) { client.m_handler.onMessage(message); }
+        void onPing(std::string_view payload) {
+            client.m_transport->sendFrame(payload.data(), static_cast<int>(payload.size()),
+                                          WSCMessageType::FIN | WSCMessageType::PONG);
+            control(WSCMessageType::PING, payload);
+        }
+        void onPong(std::string_view payload) { control(WSCMessageType::PONG, payload); }
+        void onClose(uint16_t code, std::string_view reason) {
+            if constexpr (requires { client.m_handler.onClose(code, reason); }) {
+                client.m_handler.onClose(code, reason);
+            }
+        }
+        void control(int opcode, std::string_view payload) {
+            if constexpr (requires { client.m_handler.onControl(opcode, payload); }) {
+                client.m_handler.onControl(opcode, payload);
+            }
+        }
+    };
+
+    // false after a CLOSE frame or one that breaks the protocol
+    bool handleFrame(const WSCTransport::FrameView &frame) {
+        switch (m_protocol.handle(frame.flags, frame.payload, frame.length, Events{*this})) {
+            case WSCProtocol::Result::OK:
+                return true;
+            case WSCProtocol::Result::INVALID:
+                m_error = m_protocol.error();
+                break;
+            case WSCProtocol::Result::CLOSED:
+                break;
+        }
+        close();  // answers with CLOSE
+        return false;
+    }
+
+    std::unique_ptr<Transport> m_transport;
+    Handler &m_handler;
+    QueuePolicy m_queue;
+    bool m_open = false;
+    std::string m_error;
+
+    // receive state, reused for every poll()
+    std::vector<WSCTransport::FrameView> m_frames;
+    Poco::Buffer<char> m_buffer{0};
+    WSCProtocol m_protocol;
+};
+
+// The plain ws:// client, TCP only
+template <typename Handler, typename QueuePolicy = WSCRingQueuePolicy>
+using WSCPlainClient = BasicWSC<WSCPlainTransport, QueuePolicy, Handler>;
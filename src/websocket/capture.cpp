@@ -0,0 +1,122 @@
+#include "capture.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "WSCLogger.h"
+
+WSCCapture::WSCCapture(const std::string &path, const Config &config)
+    : m_path(path), m_file(path), m_capacity(config.capacity) {
+    if (m_capacity < sizeof(FileHeader)) {
+        throw std::invalid_argument("Capture capacity too small");
+    }
+    {
+        std::ofstream create(path, std::ios::binary | std::ios::trunc);
+        if (!create) throw std::runtime_error("Failed to create capture file " + path);
+    }
+    m_file.setSize(m_capacity);
+    m_mapping = std::make_unique<Poco::SharedMemory>(m_file, Poco::SharedMemory::AM_WRITE);
+    m_base = m_mapping->begin();
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = 1;
+    header.headerSize = sizeof(FileHeader);
+    header.steadyStartNs = steadyNowNs();
+    header.unixStartNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+    std::memcpy(m_base, &header, sizeof(header));
+    m_open.store(true, std::memory_order_release);
+    WSCLog(info, "Capturing frames to {}", path);
+}
+
+WSCCapture::~WSCCapture() {
+    try {
+        close();
+    } catch (const std::exception &e) {
+        WSCLog(error, "Failed to close capture {}: {}", m_path, e.what());
+    }
+}
+
+void WSCCapture::close() {
+    std::lock_guard<std::mutex> lock(m_closeMutex);
+    if (!m_open.exchange(false, std::memory_order_acq_rel)) return;
+
+    // the records end at the first slot that was never published: the end of the reserved
+    // space, or a reservation that did not fit
+    const uint64_t limit = std::min(m_tail.load(std::memory_order_acquire), m_capacity);
+    std::vector<uint64_t> index;
+    uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(RecordHeader) <= limit) {
+        const uint32_t size =
+            std::atomic_ref<uint32_t>(*reinterpret_cast<uint32_t *>(m_base + offset))
+                .load(std::memory_order_acquire);
+        if (size == 0) break;
+        index.push_back(offset);
+        offset += size;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, m_base, sizeof(header));
+    header.dataEnd = offset;
+    header.indexOffset = offset;
+    header.recordCount = index.size();
+    header.dropped = dropped();
+    std::memcpy(m_base, &header, sizeof(header));
+    m_base = nullptr;
+    m_mapping.reset();
+
+    m_file.setSize(offset);
+    std::ofstream out(m_path, std::ios::binary | std::ios::app);
+    out.write(reinterpret_cast<const char *>(index.data()),
+              static_cast<std::streamsize>(index.size() * sizeof(uint64_t)));
+    if (!out) throw std::runtime_error("Failed to write capture index");
+    WSCLog(info, "Capture {} closed: {} records, {} dropped", m_path, index.size(),
+           header.dropped);
+}
+
+WSCCaptureReader::WSCCaptureReader(const std::string &path) : m_file(path) {
+    m_fileSize = m_file.getSize();
+    if (m_fileSize < sizeof(WSCCapture::FileHeader)) {
+        throw std::runtime_error(path + " is not a capture file");
+    }
+    m_mapping = std::make_unique<Poco::SharedMemory>(m_file, Poco::SharedMemory::AM_READ);
+    m_base = m_mapping->begin();
+    std::memcpy(&m_header, m_base, sizeof(m_header));
+    if (std::memcmp(m_header.magic, WSCCapture::kMagic, sizeof(WSCCapture::kMagic)) != 0) {
+        throw std::runtime_error(path + " is not a capture file");
+    }
+
+    const uint64_t indexBytes = m_header.recordCount * sizeof(uint64_t);
+    if (m_header.indexOffset != 0 && m_header.indexOffset + indexBytes <= m_fileSize) {
+        m_offsets.resize(m_header.recordCount);
+        std::memcpy(m_offsets.data(), m_base + m_header.indexOffset, indexBytes);
+        return;
+    }
+
+    // not closed, recover what was published
+    m_header.indexOffset = 0;
+    uint64_t offset = m_header.headerSize;
+    while (offset + sizeof(WSCCapture::RecordHeader) <= m_fileSize) {
+        WSCCapture::RecordHeader record;
+        std::memcpy(&record, m_base + offset, sizeof(record));
+        if (record.size < sizeof(record) || offset + record.size > m_fileSize ||
+            record.length > record.size - sizeof(record)) {
+            break;
+        }
+        m_offsets.push_back(offset);
+        offset += record.size;
+    }
+    WSCLog(warn, "{} was not closed, recovered {} records", path, m_offsets.size());
+}
+
+WSCCaptureReader::Record WSCCaptureReader::operator[](size_t index) const {
+    WSCCapture::RecordHeader header;
+    const char *record = m_base + m_offsets.at(index);
+    std::memcpy(&header, record, sizeof(header));
+    return Record{static_cast<WSCCapture::Direction>(header.direction), header.flags,
+                  header.connection, header.timestampNs,
+                  std::string_view(record + sizeof(header), header.length)};
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <Poco/File.h>
+#include <Poco/SharedMemory.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Append-only, memory mapped record of the frames sent and received by WSC connections.
+// Share one capture between any number of connections through WSC::Config::capture; an
+// append reserves its slot with a single atomic add and copies the frame into the mapping,
+// there is no lock, no system call and no allocation on the I/O threads.
+//
+// File layout, integers in host byte order:
+//   FileHeader                      64 bytes, completed by close()
+//   records                         RecordHeader + payload, padded to 8 bytes
+//   index                           u64 offset of every record, written by close()
+//
+// A record is published by storing its size last, so a file left behind by a crashed
+// process is still readable up to the last complete record.
+class WSCCapture {
+   public:
+    static constexpr char kMagic[8] = {'W', 'S', 'C', 'C', 'A', 'P', '0', '1'};
+
+    enum class Direction : uint8_t { SENT = 0, RECEIVED = 1 };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        int64_t steadyStartNs;  // the clock of the record timestamps
+        int64_t unixStartNs;    // wall clock at the same instant
+        uint64_t dataEnd;       // 0 until closed
+        uint64_t indexOffset;   // 0 until closed
+        uint64_t recordCount;
+        uint64_t dropped;  // records that did not fit
+    };
+
+    struct RecordHeader {
+        uint32_t size;  // whole record including padding, 0 while being written
+        uint8_t direction;
+        uint8_t flags;  // opcode | FIN as on the wire
+        uint16_t reserved;
+        uint64_t connection;  // WSC::getId()
+        int64_t timestampNs;  // steady clock
+        uint32_t length;      // payload bytes
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(FileHeader) == 64 && sizeof(RecordHeader) == 32);
+
+    struct Config {
+        uint64_t capacity;  // file size while capturing, frames beyond it are dropped
+
+        Config() : capacity(1024ull * 1024 * 1024) {}  // 1GB, sparse until written
+    };
+
+    // Creates (truncates) the file and maps it, throws Poco::Exception on failure
+    explicit WSCCapture(const std::string &path, const Config &config = Config{});
+    ~WSCCapture();
+
+    WSCCapture(const WSCCapture &) = delete;
+    WSCCapture &operator=(const WSCCapture &) = delete;
+
+    // Safe from any thread; returns false when the frame was dropped
+    bool append(Direction direction, uint64_t connection, int flags, const void *payload,
+                size_t length) noexcept {
+        if (!m_open.load(std::memory_order_acquire)) return false;
+        const uint64_t size = recordSize(length);
+        const uint64_t offset = m_tail.fetch_add(size, std::memory_order_relaxed);
+        if (offset + size > m_capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        char *record = m_base + offset;
+        RecordHeader header{0,
+                            static_cast<uint8_t>(direction),
+                            static_cast<uint8_t>(flags),
+                            0,
+                            connection,
+                            steadyNowNs(),
+                            static_cast<uint32_t>(length),
+                            0};
+        std::memcpy(record, &header, sizeof(header));
+        if (length > 0) std::memcpy(record + sizeof(header), payload, length);
+        std::atomic_ref<uint32_t>(*reinterpret_cast<uint32_t *>(record))
+            .store(static_cast<uint32_t>(size), std::memory_order_release);
+        return true;
+    }
+
+    // Writes the index and header and shrinks the file to its contents. Call once the
+    // connections using the capture stopped, appends after it are dropped.
+    void close();
+
+    uint64_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+    const std::string &path() const noexcept { return m_path; }
+
+    static uint64_t recordSize(size_t length) noexcept {
+        return (sizeof(RecordHeader) + length + 7) & ~uint64_t{7};
+    }
+    static int64_t steadyNowNs() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+   private:
+    std::string m_path;
+    Poco::File m_file;
+    std::unique_ptr<Poco::SharedMemory> m_mapping;
+    char *m_base = nullptr;
+    uint64_t m_capacity = 0;
+    std::atomic<bool> m_open{false};
+    std::atomic<uint64_t> m_tail{sizeof(FileHeader)};
+    std::atomic<uint64_t> m_dropped{0};
+    std::mutex m_closeMutex;
+};
+
+// Read side of a capture file, also of one that was never closed
+class WSCCaptureReader {
+   public:
+    struct Record {
+        WSCCapture::Direction direction;
+        int flags;
+        uint64_t connection;
+        int64_t timestampNs;
+        std::string_view payload;
+
+        int opcode() const noexcept { return flags & 0x0F; }
+        bool isFinal() const noexcept { return (flags & 0x80) != 0; }
+    };
+
+    // Throws std::runtime_error when the file is not a capture
+    explicit WSCCaptureReader(const std::string &path);
+
+    size_t size() const noexcept { return m_offsets.size(); }
+    Record operator[](size_t index) const;
+
+    int64_t steadyStartNs() const noexcept { return m_header.steadyStartNs; }
+    int64_t unixStartNs() const noexcept { return m_header.unixStartNs; }
+    uint64_t dropped() const noexcept { return m_header.dropped; }
+    bool complete() const noexcept { return m_header.indexOffset != 0; }  // closed cleanly
+
+   private:
+    Poco::File m_file;
+    std::unique_ptr<Poco::SharedMemory> m_mapping;
+    const char *m_base = nullptr;
+    uint64_t m_fileSize = 0;
+    WSCCapture::FileHeader m_header{};
+    std::vector<uint64_t> m_offsets;
+};
@@ -0,0 +1,185 @@
+#include "dispatcher.h"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+#include "WSCLogger.h"
+#include "WSCThread.h"
+#include "WSCTrace.h"
+
+namespace {
+    // the pool and queue of the worker running on this thread
+    thread_local const WSCDispatcher *t_dispatcher = nullptr;
+    thread_local size_t t_worker = 0;
+
+    // the strand whose handler runs on this thread
+    thread_local const WSCDispatcher::Strand *t_strand = nullptr;
+}  // namespace
+
+// =================================== STRAND ====================================
+
+WSCDispatcher::Strand::Strand(WSCDispatcher &dispatcher, size_t maxInFlight, Handler handler)
+    : m_dispatcher(dispatcher),
+      m_maxInFlight(std::max<size_t>(maxInFlight, 1)),
+      m_handler(std::move(handler)) {}
+
+bool WSCDispatcher::Strand::post(WSCMessage &&message, bool control) {
+    bool schedule = false;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // a handler posting to its own full strand would wait for itself
+        if (t_strand != this) {
+            m_changed.wait(lock, [this] { return m_closed || m_inFlight < m_maxInFlight; });
+        }
+        if (m_closed) return false;
+        m_items.push_back(Item{std::move(message), control});
+        m_inFlight++;
+        if (!m_scheduled) {
+            m_scheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule) m_dispatcher.submit([self = shared_from_this()] { self->run(); });
+    return true;
+}
+
+void WSCDispatcher::Strand::run() {
+    const Strand *outer = t_strand;
+    t_strand = this;
+    for (size_t delivered = 0;; delivered++) {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_items.empty()) {
+                m_scheduled = false;
+                m_changed.notify_all();
+                break;
+            }
+            if (delivered == m_dispatcher.m_config.strandBatch) {
+                // requeue behind the other strands, the items stay in order here
+                lock.unlock();
+                m_dispatcher.submit([self = shared_from_this()] { self->run(); });
+                break;
+            }
+            item = std::move(m_items.front());
+            m_items.pop_front();
+        }
+        try {
+            m_handler(item.message, item.control);
+        } catch (const std::exception &e) {
+            WSCLog(error, "Message handler failed: {}", e.what());
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight--;
+        m_changed.notify_all();
+    }
+    t_strand = outer;
+}
+
+void WSCDispatcher::Strand::flush() {
+    if (t_strand == this) return;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return m_inFlight == 0 && !m_scheduled; });
+}
+
+void WSCDispatcher::Strand::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+    }
+    m_changed.notify_all();
+    flush();
+}
+
+size_t WSCDispatcher::Strand::inFlight() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_inFlight;
+}
+
+// ================================= DISPATCHER ==================================
+
+WSCDispatcher::WSCDispatcher(const Config &config) : m_config(config) {
+    const int threads = std::max(1, m_config.threads);
+    for (int i = 0; i < threads; i++) m_workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        m_workers[i]->thread = std::thread(&WSCDispatcher::workerLoop, this, i);
+    }
+}
+
+WSCDispatcher::~WSCDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+std::shared_ptr<WSCDispatcher::Strand> WSCDispatcher::makeStrand(size_t maxInFlight,
+                                                                 Strand::Handler handler) {
+    return std::make_shared<Strand>(*this, maxInFlight, std::move(handler));
+}
+
+void WSCDispatcher::submit(Task task) {
+    const size_t index = t_dispatcher == this
+                             ? t_worker
+                             : m_nextWorker.fetch_add(1, std::memory_order_relaxed) %
+                                   m_workers.size();
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+    // taking the lock orders this against a worker that just found nothing to do
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+bool WSCDispatcher::popOwn(size_t index, Task &task) {
+    Worker &worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    return true;
+}
+
+bool WSCDispatcher::steal(size_t index, Task &task) {
+    for (size_t i = 1; i < m_workers.size(); i++) {
+        Worker &victim = *m_workers[(index + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        m_steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void WSCDispatcher::workerLoop(size_t index) {
+    WSCThread::setName("wsc-dispatch-" + std::to_string(index));
+    WSCTrace::setThreadName("WSC dispatch #" + std::to_string(index));
+    t_dispatcher = this;
+    t_worker = index;
+    for (;;) {
+        Task task;
+        if (popOwn(index, task) || steal(index, task)) {
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            try {
+                task();
+            } catch (const std::exception &e) {
+                WSCLog(error, "Dispatcher task failed: {}", e.what());
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] {
+            return m_stopping || m_queued.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stopping && m_queued.load(std::memory_order_acquire) == 0) break;
+    }
+}
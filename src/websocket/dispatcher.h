@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WSCMessage.h"
+
+// Work-stealing thread pool that runs the message callbacks of WSC connections, see
+// WSC::Config::dispatcher. Every connection posts to its own Strand: the strand delivers
+// its messages one after another in the order they were received, on whichever worker is
+// free, while different connections run in parallel. A slow handler then delays only its
+// own connection and no longer stops the receive thread from reading the socket.
+//
+//   auto dispatcher = std::make_shared<WSCDispatcher>();
+//   WSC::Config config;
+//   config.dispatcher = dispatcher;  // share it between any number of connections
+class WSCDispatcher {
+   public:
+    using Task = std::function<void()>;
+
+    struct Config {
+        int threads;
+        size_t strandBatch;  // messages a strand delivers before it lets others run
+
+        Config() : threads(std::max(1u, std::thread::hardware_concurrency())), strandBatch(64) {}
+    };
+
+    // Delivers the messages of one connection in order. post() blocks the caller while
+    // maxInFlight messages are queued or running, which pushes back on the socket.
+    class Strand : public std::enable_shared_from_this<Strand> {
+       public:
+        // control: the message is for the control callback, not the data callback
+        using Handler = std::function<void(const WSCMessage &message, bool control)>;
+
+        Strand(WSCDispatcher &dispatcher, size_t maxInFlight, Handler handler);
+
+        // false once closed
+        bool post(WSCMessage &&message, bool control);
+
+        // Waits until every message posted so far was delivered, returns at once when called
+        // from this strand's own handler
+        void flush();
+
+        // Stops accepting messages and flushes the rest
+        void close();
+
+        size_t inFlight() const;
+
+       private:
+        struct Item {
+            WSCMessage message;
+            bool control;
+        };
+
+        void run();
+
+        WSCDispatcher &m_dispatcher;
+        const size_t m_maxInFlight;
+        const Handler m_handler;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::deque<Item> m_items;
+        size_t m_inFlight = 0;   // queued and running
+        bool m_scheduled = false;  // a run() is queued or running in the pool
+        bool m_closed = false;
+    };
+
+    explicit WSCDispatcher(const Config &config = Config{});
+    ~WSCDispatcher();  // runs the queued tasks, then joins the workers
+
+    WSCDispatcher(const WSCDispatcher &) = delete;
+    WSCDispatcher &operator=(const WSCDispatcher &) = delete;
+
+    std::shared_ptr<Strand> makeStrand(size_t maxInFlight, Strand::Handler handler);
+
+    // Any task, from any thread. A worker pushes to its own queue, other threads spread
+    // tasks over all queues; idle workers steal from the others.
+    void submit(Task task);
+
+    int threads() const noexcept { return static_cast<int>(m_workers.size()); }
+    uint64_t steals() const noexcept { return m_steals.load(std::memory_order_relaxed); }
+
+   private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void workerLoop(size_t index);
+    bool popOwn(size_t index, Task &task);
+    bool steal(size_t index, Task &task);
+
+    const Config m_config;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_nextWorker{0};
+    std::atomic<uint64_t> m_steals{0};
+
+    // sleeping workers, m_queued counts the tasks in all queues
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued{0};
+    bool m_stopping = false;
+};
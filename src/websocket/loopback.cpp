@@ -0,0 +1,391 @@
+#include "loopback.h"
+
+#include <Poco/Net/NetException.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WSCMask.h"
+
+namespace {
+    constexpr int kFin = Poco::Net::WebSocket::FRAME_FLAG_FIN;
+    constexpr int kOpcodeMask = Poco::Net::WebSocket::FRAME_OP_BITMASK;
+    constexpr int kClose = Poco::Net::WebSocket::FRAME_OP_CLOSE;
+    constexpr int kPing = Poco::Net::WebSocket::FRAME_OP_PING;
+    constexpr int kPong = Poco::Net::WebSocket::FRAME_OP_PONG;
+
+    // RFC 6455 framing, the first header byte is the Poco frame flags value
+    size_t headerSize(size_t length, bool masked) {
+        return 2 + (length < 126 ? 0 : length <= 0xFFFF ? 2 : 8) + (masked ? 4 : 0);
+    }
+
+    void encodeFrame(char *out, const void *data, size_t length, int flags, bool masked,
+                     uint32_t maskKey) {
+        auto *header = reinterpret_cast<uint8_t *>(out);
+        header[0] = static_cast<uint8_t>(flags);
+        const uint8_t maskBit = masked ? 0x80 : 0;
+        size_t offset = 2;
+        if (length < 126) {
+            header[1] = maskBit | static_cast<uint8_t>(length);
+        } else if (length <= 0xFFFF) {
+            header[1] = maskBit | 126;
+            header[2] = static_cast<uint8_t>(length >> 8);
+            header[3] = static_cast<uint8_t>(length);
+            offset = 4;
+        } else {
+            header[1] = maskBit | 127;
+            const auto wide = static_cast<uint64_t>(length);
+            for (int i = 0; i < 8; i++) header[2 + i] = static_cast<uint8_t>(wide >> (56 - 8 * i));
+            offset = 10;
+        }
+        if (!masked) {
+            if (length) std::memcpy(header + offset, data, length);
+            return;
+        }
+        std::memcpy(header + offset, &maskKey, 4);
+        WSCMask::apply(out + offset + 4, static_cast<const char *>(data), length,
+                       header + offset);
+    }
+
+    struct Frame {
+        int flags;
+        size_t length;
+        const uint8_t *payload;
+        const uint8_t *mask;  // nullptr for unmasked frames
+    };
+
+    Frame decodeFrame(const char *data) {
+        const auto *header = reinterpret_cast<const uint8_t *>(data);
+        Frame frame{header[0], header[1] & 0x7Fu, nullptr, nullptr};
+        size_t offset = 2;
+        if (frame.length == 126) {
+            frame.length = static_cast<size_t>(header[2]) << 8 | header[3];
+            offset = 4;
+        } else if (frame.length == 127) {
+            uint64_t length = 0;
+            for (int i = 0; i < 8; i++) length = length << 8 | header[2 + i];
+            frame.length = static_cast<size_t>(length);
+            offset = 10;
+        }
+        if (header[1] & 0x80) {
+            frame.mask = header + offset;
+            offset += 4;
+        }
+        frame.payload = header + offset;
+        return frame;
+    }
+}  // namespace
+
+// One client connection: a ring per direction. Both rings are written under sendMutex, the
+// client ring is read by the client receive thread and the server ring by whichever thread
+// holds sendMutex.
+struct WSCLoopback::Connection {
+    explicit Connection(size_t ringSize) : toServer(ringSize), toClient(ringSize) {}
+
+    WSCByteRing toServer;
+    WSCByteRing toClient;
+    std::mutex sendMutex;
+    uint32_t maskState = 0x9E3779B9u;  // xorshift, the masking keys need not be secure here
+
+    // receive side wake up, only signalled while the client actually waits
+    std::mutex waitMutex;
+    std::condition_variable readable;
+    std::atomic<bool> clientWaiting{false};
+
+    std::atomic<bool> serverClosed{false};  // after the CLOSE reply
+    std::atomic<bool> clientClosed{false};
+    bool serving = false;  // a thread is in serve(), guarded by sendMutex
+
+    uint32_t nextMask() noexcept {
+        maskState ^= maskState << 13;
+        maskState ^= maskState >> 17;
+        maskState ^= maskState << 5;
+        return maskState;
+    }
+
+    void wakeClient() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (clientWaiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            readable.notify_one();
+        }
+    }
+
+    bool fits(size_t frameSize) const noexcept {
+        return frameSize + 16 <= toClient.capacity() / 2;
+    }
+};
+
+struct WSCLoopback::Shared {
+    explicit Shared(const Config &config) : config(config) {}
+
+    const Config config;
+    std::mutex mutex;
+    std::shared_ptr<Connection> current;
+
+    std::atomic<uint64_t> framesReceived{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> framesSent{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> connects{0};
+
+    // Writes a server frame to the client ring. Gives up sendMutex while the ring is full so
+    // the receive thread can answer a PING meanwhile. False once the client is gone.
+    bool writeToClient(Connection &connection, std::unique_lock<std::mutex> &lock,
+                       const void *data, size_t length, int flags) {
+        const size_t size = headerSize(length, false) + length;
+        char *out;
+        while (!(out = connection.toClient.reserve(static_cast<uint32_t>(size)))) {
+            if (connection.clientClosed.load(std::memory_order_relaxed)) return false;
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+        encodeFrame(out, data, length, flags, false, 0);
+        connection.toClient.commit();
+        connection.wakeClient();
+        framesSent.fetch_add(1, std::memory_order_relaxed);
+        bytesSent.fetch_add(length, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Handles every frame the client sent so far, sendMutex is held. While one thread
+    // waits for client ring space here, other senders only queue their frames, the serving
+    // thread answers them in order.
+    void serve(Connection &connection, std::unique_lock<std::mutex> &lock) {
+        if (connection.serving) return;
+        connection.serving = true;
+        std::vector<uint8_t> payload;
+        uint32_t size;
+        while (const char *record = connection.toServer.front(size)) {
+            const Frame frame = decodeFrame(record);
+            payload.resize(frame.length);
+            const auto *in = reinterpret_cast<const char *>(frame.payload);
+            auto *out = reinterpret_cast<char *>(payload.data());
+            if (frame.mask) {
+                WSCMask::apply(out, in, frame.length, frame.mask);
+            } else if (frame.length) {
+                std::memcpy(out, in, frame.length);
+            }
+            const int flags = frame.flags;
+            connection.toServer.pop();
+            framesReceived.fetch_add(1, std::memory_order_relaxed);
+            bytesReceived.fetch_add(payload.size(), std::memory_order_relaxed);
+
+            const int opcode = flags & kOpcodeMask;
+            if (connection.serverClosed.load(std::memory_order_relaxed)) {
+                continue;  // nothing is answered after the close handshake
+            }
+            if (opcode == kPing) {
+                writeToClient(connection, lock, payload.data(), payload.size(), kFin | kPong);
+            } else if (opcode == kClose) {
+                writeToClient(connection, lock, payload.data(), payload.size(), kFin | kClose);
+                connection.serverClosed.store(true, std::memory_order_release);
+                connection.wakeClient();
+            } else if (opcode != kPong && config.mode == Mode::ECHO) {
+                writeToClient(connection, lock, payload.data(), payload.size(), flags);
+            }
+        }
+        connection.serving = false;
+    }
+};
+
+// ================================== TRANSPORT ==================================
+
+class WSCLoopback::Transport final : public WSCTransport {
+   public:
+    explicit Transport(std::shared_ptr<Shared> shared) : m_shared(std::move(shared)) {}
+
+    ~Transport() override { close(); }
+
+    void connect(const Options &options, Poco::Net::HTTPRequest &request,
+                 Poco::Net::HTTPResponse &response) override {
+        if (Poco::icompare(request.get("Upgrade", ""), "websocket") != 0) {
+            throw Poco::Net::WebSocketException("Not a WebSocket upgrade request",
+                                                Poco::Net::WebSocket::WS_ERR_NO_HANDSHAKE);
+        }
+        m_receiveTimeout = options.receiveTimeout;
+        m_maxPayloadSize = options.maxPayloadSize;
+        m_connection = std::make_shared<Connection>(m_shared->config.ringSize);
+
+        response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_SWITCHING_PROTOCOLS);
+        const std::string protocols = request.get("Sec-WebSocket-Protocol", "");
+        if (!protocols.empty()) {
+            response.set("Sec-WebSocket-Protocol", protocols.substr(0, protocols.find(',')));
+        }
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        m_shared->current = m_connection;
+        m_shared->connects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int sendFrame(const void *buffer, int length, int flags) override {
+        const size_t size = headerSize(static_cast<size_t>(length), true) + length;
+        write(size, [&](char *out) {
+            encodeFrame(out, buffer, static_cast<size_t>(length), flags, true,
+                        m_connection->nextMask());
+        });
+        return length;
+    }
+
+    bool sendEncodedFrame(const char *frame, int length) override {
+        write(static_cast<size_t>(length),
+              [&](char *out) { std::memcpy(out, frame, static_cast<size_t>(length)); });
+        return true;
+    }
+
+    int receiveFrame(Poco::Buffer<char> &buffer, int &flags) override {
+        Connection &connection = *m_connection;
+        uint32_t size;
+        const char *record = connection.toClient.front(size);
+        if (!record) record = waitForFrame(size);
+        if (!record) {
+            flags = 0;
+            return 0;
+        }
+        const Frame frame = decodeFrame(record);
+        if (frame.length > static_cast<size_t>(m_maxPayloadSize)) {
+            connection.toClient.pop();
+            throw Poco::Net::WebSocketException("Payload too big",
+                                                Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+        }
+        buffer.append(reinterpret_cast<const char *>(frame.payload), frame.length);
+        flags = frame.flags;
+        connection.toClient.pop();
+        return static_cast<int>(frame.length);
+    }
+
+    Wait waitReadable(const Poco::Timespan &timeout) override {
+        Connection &connection = *m_connection;
+        uint32_t size;
+        const bool ready = waitFor(timeout, [&] {
+            return connection.toClient.front(size) ||
+                   connection.serverClosed.load(std::memory_order_acquire) ||
+                   m_wakeUp.load(std::memory_order_relaxed);
+        });
+        if (m_wakeUp.exchange(false, std::memory_order_relaxed)) return Wait::WOKEN;
+        return ready ? Wait::READABLE : Wait::TIMEOUT;
+    }
+
+    void wakeUp() override {
+        if (!m_connection) return;
+        std::lock_guard<std::mutex> lock(m_connection->waitMutex);
+        m_wakeUp.store(true, std::memory_order_relaxed);
+        m_connection->readable.notify_all();
+    }
+
+    void shutdown() override {
+        if (!m_connection || m_connection->serverClosed.load(std::memory_order_acquire)) {
+            return;
+        }
+        const unsigned char normalClosure[] = {0x03, 0xE8};  // 1000
+        sendFrame(normalClosure, sizeof(normalClosure), kFin | kClose);
+    }
+
+    void close() override {
+        if (!m_connection) return;
+        m_connection->clientClosed.store(true, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        if (m_shared->current == m_connection) m_shared->current.reset();
+    }
+
+   private:
+    // Puts one client frame of `size` bytes, written by fill(), into the server ring and
+    // lets the server handle it
+    template <typename Fill>
+    void write(size_t size, Fill &&fill) {
+        Connection &connection = *m_connection;
+        if (connection.clientClosed.load(std::memory_order_relaxed) ||
+            connection.serverClosed.load(std::memory_order_acquire)) {
+            throw Poco::Net::ConnectionResetException("Loopback connection closed");
+        }
+        if (!connection.fits(size)) {
+            throw Poco::Net::WebSocketException("Frame does not fit in the loopback ring",
+                                                Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+        }
+        std::unique_lock<std::mutex> lock(connection.sendMutex);
+        char *out;
+        while (!(out = connection.toServer.reserve(static_cast<uint32_t>(size)))) {
+            // only while another thread waits in serve() for client ring space
+            if (connection.clientClosed.load(std::memory_order_relaxed)) {
+                throw Poco::Net::ConnectionResetException("Loopback connection closed");
+            }
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+        fill(out);
+        connection.toServer.commit();
+        m_shared->serve(connection, lock);
+    }
+
+    // Waits on the connection until ready() holds, false after the timeout
+    template <typename Ready>
+    bool waitFor(const Poco::Timespan &timeout, Ready &&ready) {
+        Connection &connection = *m_connection;
+        if (ready()) return true;
+        std::unique_lock<std::mutex> lock(connection.waitMutex);
+        connection.clientWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool result = connection.readable.wait_for(
+            lock, std::chrono::microseconds(timeout.totalMicroseconds()), ready);
+        connection.clientWaiting.store(false, std::memory_order_relaxed);
+        return result;
+    }
+
+    // nullptr when the server closed the connection and everything was read
+    const char *waitForFrame(uint32_t &size) {
+        Connection &connection = *m_connection;
+        const char *record = nullptr;
+        const bool ready = waitFor(m_receiveTimeout, [&] {
+            record = connection.toClient.front(size);
+            return record || connection.serverClosed.load(std::memory_order_acquire);
+        });
+        if (!ready) throw Poco::TimeoutException();
+        return record;
+    }
+
+    std::shared_ptr<Shared> m_shared;
+    std::shared_ptr<Connection> m_connection;
+    Poco::Timespan m_receiveTimeout;
+    int m_maxPayloadSize = 0;
+    std::atomic<bool> m_wakeUp{false};  // set under waitMutex
+};
+
+// =================================== LOOPBACK ===================================
+
+WSCLoopback::WSCLoopback(const Config &config) : m_shared(std::make_shared<Shared>(config)) {}
+
+WSCLoopback::~WSCLoopback() = default;
+
+WSCTransportFactory WSCLoopback::transportFactory() {
+    return [shared = m_shared]() -> std::unique_ptr<WSCTransport> {
+        return std::make_unique<Transport>(shared);
+    };
+}
+
+bool WSCLoopback::send(const void *data, size_t length, int flags) {
+    std::shared_ptr<Connection> connection;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        connection = m_shared->current;
+    }
+    if (!connection || connection->serverClosed.load(std::memory_order_acquire) ||
+        !connection->fits(headerSize(length, false) + length)) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(connection->sendMutex);
+    return m_shared->writeToClient(*connection, lock, data, length, flags);
+}
+
+WSCLoopback::Statistics WSCLoopback::getStatistics() const {
+    Statistics statistics;
+    statistics.framesReceived = m_shared->framesReceived.load(std::memory_order_relaxed);
+    statistics.bytesReceived = m_shared->bytesReceived.load(std::memory_order_relaxed);
+    statistics.framesSent = m_shared->framesSent.load(std::memory_order_relaxed);
+    statistics.bytesSent = m_shared->bytesSent.load(std::memory_order_relaxed);
+    statistics.connects = m_shared->connects.load(std::memory_order_relaxed);
+    return statistics;
+}
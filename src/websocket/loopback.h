@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "WSCByteRing.h"
+#include "transport.h"
+
+// In-process stand-in for a WebSocket server. Frames are encoded as on the wire (client
+// frames masked) and passed through a pair of memory rings; the emulated server runs on the
+// thread that sends to it, so a benchmark over the loopback measures the codec, queue,
+// callback and allocation costs of WSC without the kernel TCP stack, and does so
+// deterministically.
+//
+//   WSCLoopback loopback;
+//   WSC::Config config;
+//   config.transportFactory = loopback.transportFactory();
+//   WSC client("ws://loopback/", config);  // the host is not resolved
+//
+// The server answers PING with PONG and CLOSE with CLOSE. Data frames are echoed or
+// dropped depending on the mode; send() pushes server initiated frames to the client.
+class WSCLoopback {
+   public:
+    enum class Mode { ECHO, SINK };
+
+    struct Config {
+        Mode mode;
+        size_t ringSize;  // bytes per direction, a frame may take up to half of it
+
+        Config()
+            : mode(Mode::ECHO),
+              ringSize(4 * 1024 * 1024) {}  // 4MB
+    };
+
+    struct Statistics {
+        uint64_t framesReceived{0};  // by the server
+        uint64_t bytesReceived{0};
+        uint64_t framesSent{0};
+        uint64_t bytesSent{0};
+        uint64_t connects{0};
+    };
+
+    explicit WSCLoopback(const Config &config = Config{});
+    ~WSCLoopback();
+
+    WSCLoopback(const WSCLoopback &) = delete;
+    WSCLoopback &operator=(const WSCLoopback &) = delete;
+
+    // For WSC::Config::transportFactory. Every connection attempt opens a new pair of rings,
+    // the server talks to the latest one.
+    WSCTransportFactory transportFactory();
+
+    // Sends a frame from the server, blocks while the client ring is full. Returns false
+    // when no client is connected.
+    bool send(const void *data, size_t length, int flags);
+
+    Statistics getStatistics() const;
+
+    class Transport;
+
+   private:
+    struct Connection;
+    struct Shared;
+    std::shared_ptr<Shared> m_shared;
+};
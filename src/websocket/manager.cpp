@@ -0,0 +1,63 @@
+#include "manager.h"
+
+WSCManager::~WSCManager() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connections.clear();
+}
+
+WSC &WSCManager::add(const std::string &url, const WSC::Config &config) {
+    auto connection = std::make_unique<WSC>(url, config);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connections.push_back(std::move(connection));
+    return *m_connections.back();
+}
+
+size_t WSCManager::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_connections.size();
+}
+
+WSC &WSCManager::operator[](size_t index) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return *m_connections.at(index);
+}
+
+size_t WSCManager::connectedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t connected = 0;
+    for (const auto &connection : m_connections) {
+        if (connection->isConnected()) connected++;
+    }
+    return connected;
+}
+
+void WSCManager::connectAll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &connection : m_connections) {
+        if (!connection->isConnected()) connection->connect();
+    }
+}
+
+void WSCManager::disconnectAll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &connection : m_connections) {
+        if (connection->isConnected()) connection->disconnect();
+    }
+}
+
+size_t WSCManager::broadcastText(std::string_view text) {
+    return broadcast(WSCFrame::make(WSCMessageType::TEXT, text.data(), text.size()));
+}
+
+size_t WSCManager::broadcastBinary(const void *data, size_t length) {
+    return broadcast(WSCFrame::make(WSCMessageType::BINARY, data, length));
+}
+
+size_t WSCManager::broadcast(const std::shared_ptr<const WSCFrame> &frame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t queued = 0;
+    for (auto &connection : m_connections) {
+        if (connection->sendShared(frame)) queued++;
+    }
+    return queued;
+}
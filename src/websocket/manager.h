@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WSCFrame.h"
+#include "ws.h"
+
+// Owns a set of WSC connections and sends to all of them at once. A broadcast encodes the
+// payload into one immutable WSCFrame that every connection queues by reference; the send
+// threads only mask it with their own key into a per-connection scratch buffer, so the
+// payload is neither copied nor framed once per connection.
+//
+//   WSCManager manager;
+//   for (int i = 0; i < 1000; i++) manager.add(url, config);
+//   manager.connectAll();
+//   manager.broadcastText(R"({"op":"subscribe","channel":"ticker"})");
+class WSCManager {
+   public:
+    WSCManager() = default;
+    ~WSCManager();
+
+    WSCManager(const WSCManager &) = delete;
+    WSCManager &operator=(const WSCManager &) = delete;
+
+    // The connection stays owned by the manager, set callbacks before connecting it
+    WSC &add(const std::string &url, const WSC::Config &config = WSC::Config{});
+
+    size_t size() const;
+    WSC &operator[](size_t index);
+    size_t connectedCount() const;
+
+    void connectAll();
+    void disconnectAll();
+
+    // Queue the payload on every connected connection, returns how many took it
+    size_t broadcastText(std::string_view text);
+    size_t broadcastBinary(const void *data, size_t length);
+    size_t broadcast(const std::shared_ptr<const WSCFrame> &frame);
+
+   private:
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<WSC>> m_connections;
+};
@@ -0,0 +1,272 @@
+#include "metrics.h"
+
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "ws.h"
+
+namespace {
+    struct Registry {
+        std::mutex mutex;
+        std::vector<const WSC *> connections;
+    };
+
+    Registry &registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    struct ConnectionSample {
+        std::string labels;
+        WSC::State state;
+        WSC::Statistics stats;
+        WSC::RttHistogram::Snapshot rtt;
+        WSCTlsRecords::SizeHistogram::Snapshot tlsRecords;
+    };
+
+    std::string escapeLabel(const std::string &value) {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    double secondsSinceEpoch(std::chrono::system_clock::time_point time) {
+        return std::chrono::duration<double>(time.time_since_epoch()).count();
+    }
+
+    void family(std::ostringstream &out, const char *name, const char *type, const char *help,
+                const char *unit = nullptr) {
+        out << "# TYPE " << name << ' ' << type << '\n';
+        if (unit) out << "# UNIT " << name << ' ' << unit << '\n';
+        out << "# HELP " << name << ' ' << help << '\n';
+    }
+
+    template <typename Getter>
+    void series(std::ostringstream &out, const std::vector<ConnectionSample> &samples,
+                const char *name, const char *suffix, Getter getter) {
+        for (const auto &sample : samples) {
+            out << name << suffix << '{' << sample.labels << "} " << getter(sample) << '\n';
+        }
+    }
+
+    constexpr std::pair<WSC::State, const char *> kStates[] = {
+        {WSC::State::UNINITIALIZED, "UNINITIALIZED"}, {WSC::State::CONNECTING, "CONNECTING"},
+        {WSC::State::CONNECTED, "CONNECTED"},         {WSC::State::DISCONNECTING, "DISCONNECTING"},
+        {WSC::State::DISCONNECTED, "DISCONNECTED"},   {WSC::State::WS_ERROR, "WS_ERROR"}};
+
+    // Bucket bounds of the exported RTT histogram, in microseconds
+    constexpr uint64_t kRttBucketsUs[] = {100,    250,    500,     1000,    2500,
+                                          5000,   10000,  25000,   50000,   100000,
+                                          250000, 500000, 1000000, 2500000, 5000000};
+
+    // Bucket bounds of the exported TLS record size histogram, in bytes on the wire
+    constexpr uint64_t kTlsRecordBuckets[] = {128, 256, 512, 1024, 1500, 2048, 4096, 8192, 16384};
+
+    class MetricsRequestHandler : public Poco::Net::HTTPRequestHandler {
+       public:
+        explicit MetricsRequestHandler(const std::string &path) : m_path(path) {}
+
+        void handleRequest(Poco::Net::HTTPServerRequest &request,
+                           Poco::Net::HTTPServerResponse &response) override {
+            if (request.getMethod() != Poco::Net::HTTPRequest::HTTP_GET ||
+                request.getURI().substr(0, request.getURI().find('?')) != m_path) {
+                response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+                response.setContentLength(0);
+                response.send();
+                return;
+            }
+            const std::string body = WSCMetrics::render();
+            response.setContentType(WSCMetrics::kContentType);
+            response.setContentLength(static_cast<std::streamsize>(body.size()));
+            response.send() << body;
+        }
+
+       private:
+        std::string m_path;
+    };
+
+    class MetricsRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+       public:
+        explicit MetricsRequestHandlerFactory(const std::string &path) : m_path(path) {}
+
+        Poco::Net::HTTPRequestHandler *createRequestHandler(
+            const Poco::Net::HTTPServerRequest &) override {
+            return new MetricsRequestHandler(m_path);
+        }
+
+       private:
+        std::string m_path;
+    };
+}  // namespace
+
+WSCMetrics::WSCMetrics(const Config &config) : m_config(config) {}
+
+WSCMetrics::~WSCMetrics() { stop(); }
+
+bool WSCMetrics::start() {
+    if (m_server) return true;
+    try {
+        Poco::Net::ServerSocket socket(Poco::Net::SocketAddress(m_config.address, m_config.port));
+        m_port = socket.address().port();
+        auto params = new Poco::Net::HTTPServerParams;
+        params->setMaxThreads(m_config.maxThreads);
+        params->setKeepAlive(false);
+        m_server = std::make_unique<Poco::Net::HTTPServer>(
+            new MetricsRequestHandlerFactory(m_config.path), socket, params);
+        m_server->start();
+        WSCLog(info, "Metrics endpoint listening on {}:{}{}", m_config.address, m_port,
+               m_config.path);
+        return true;
+    } catch (const Poco::Exception &e) {
+        WSCLog(error, "Failed to start metrics endpoint: {}", e.displayText());
+        m_server.reset();
+        return false;
+    }
+}
+
+void WSCMetrics::stop() {
+    if (!m_server) return;
+    m_server->stopAll(true);
+    m_server.reset();
+}
+
+void WSCMetrics::registerConnection(const WSC *connection) {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.connections.push_back(connection);
+}
+
+void WSCMetrics::unregisterConnection(const WSC *connection) {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.connections.erase(
+        std::remove(reg.connections.begin(), reg.connections.end(), connection),
+        reg.connections.end());
+}
+
+std::string WSCMetrics::render() {
+    auto &reg = registry();
+    std::vector<ConnectionSample> samples;
+    {
+        // Only guards the registry against concurrent (un)registration, the connections
+        // themselves are read through their atomics.
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        samples.reserve(reg.connections.size());
+        for (const WSC *connection : reg.connections) {
+            samples.push_back(ConnectionSample{
+                "connection=\"" + std::to_string(connection->getId()) + "\",url=\"" +
+                    escapeLabel(connection->getUrl()) + "\"",
+                connection->getCurrentState(), connection->getStatistics(),
+                connection->getRttSnapshot(), connection->getTlsRecordSnapshot()});
+        }
+    }
+
+    std::ostringstream out;
+    family(out, "wscpp_connections", "gauge", "Number of registered WebSocket connections.");
+    out << "wscpp_connections " << samples.size() << '\n';
+
+    family(out, "wscpp_connection_state", "stateset", "Current connection state.");
+    for (const auto &sample : samples) {
+        for (const auto &[state, name] : kStates) {
+            out << "wscpp_connection_state{" << sample.labels << ",wscpp_connection_state=\""
+                << name << "\"} " << (sample.state == state ? 1 : 0) << '\n';
+        }
+    }
+
+    family(out, "wscpp_messages_sent", "counter", "Data messages sent.");
+    series(out, samples, "wscpp_messages_sent", "_total",
+           [](const ConnectionSample &s) { return s.stats.messagesSent; });
+    family(out, "wscpp_messages_received", "counter", "Data messages received.");
+    series(out, samples, "wscpp_messages_received", "_total",
+           [](const ConnectionSample &s) { return s.stats.messagesReceived; });
+    family(out, "wscpp_sent_bytes", "counter", "Payload bytes sent.", "bytes");
+    series(out, samples, "wscpp_sent_bytes", "_total",
+           [](const ConnectionSample &s) { return s.stats.bytesSent; });
+    family(out, "wscpp_received_bytes", "counter", "Payload bytes received.", "bytes");
+    series(out, samples, "wscpp_received_bytes", "_total",
+           [](const ConnectionSample &s) { return s.stats.bytesReceived; });
+    family(out, "wscpp_pings_sent", "counter", "PING frames sent.");
+    series(out, samples, "wscpp_pings_sent", "_total",
+           [](const ConnectionSample &s) { return s.stats.pingsSent; });
+    family(out, "wscpp_pongs_received", "counter", "PONG frames received.");
+    series(out, samples, "wscpp_pongs_received", "_total",
+           [](const ConnectionSample &s) { return s.stats.pongsReceived; });
+    family(out, "wscpp_errors", "counter", "Transitions into the error state.");
+    series(out, samples, "wscpp_errors", "_total",
+           [](const ConnectionSample &s) { return s.stats.errors; });
+    family(out, "wscpp_reconnects", "counter", "Successful connections after the first one.");
+    series(out, samples, "wscpp_reconnects", "_total",
+           [](const ConnectionSample &s) { return s.stats.reconnects; });
+    family(out, "wscpp_reconnect_attempts", "counter", "Connection retries.");
+    series(out, samples, "wscpp_reconnect_attempts", "_total",
+           [](const ConnectionSample &s) { return s.stats.reconnectAttempts; });
+    family(out, "wscpp_send_queue_depth", "gauge", "Messages waiting in the send queue.");
+    series(out, samples, "wscpp_send_queue_depth", "",
+           [](const ConnectionSample &s) { return s.stats.sendQueueDepth; });
+    family(out, "wscpp_last_message_timestamp_seconds", "gauge",
+           "Time of the last data message sent or received.", "seconds");
+    series(out, samples, "wscpp_last_message_timestamp_seconds", "",
+           [](const ConnectionSample &s) { return secondsSinceEpoch(s.stats.lastMessageTime); });
+
+    family(out, "wscpp_rtt_seconds", "histogram", "PING to PONG round trip time.", "seconds");
+    for (const auto &sample : samples) {
+        size_t index = 0;
+        uint64_t cumulative = 0;
+        for (uint64_t bound : kRttBucketsUs) {
+            while (index < WSC::RttHistogram::kBucketCount &&
+                   WSC::RttHistogram::highestEquivalentValue(index) <= bound) {
+                cumulative += sample.rtt.counts[index++];
+            }
+            out << "wscpp_rtt_seconds_bucket{" << sample.labels << ",le=\"" << bound / 1e6
+                << "\"} " << cumulative << '\n';
+        }
+        out << "wscpp_rtt_seconds_bucket{" << sample.labels << ",le=\"+Inf\"} "
+            << sample.rtt.count << '\n';
+        out << "wscpp_rtt_seconds_count{" << sample.labels << "} " << sample.rtt.count << '\n';
+        out << "wscpp_rtt_seconds_sum{" << sample.labels << "} " << sample.rtt.sum / 1e6
+            << '\n';
+    }
+
+    family(out, "wscpp_tls_record_size_bytes", "histogram",
+           "TLS records written, with WSC::Config::tlsRecords.", "bytes");
+    for (const auto &sample : samples) {
+        if (sample.tlsRecords.count == 0) continue;
+        size_t index = 0;
+        uint64_t cumulative = 0;
+        for (uint64_t bound : kTlsRecordBuckets) {
+            while (index < WSCTlsRecords::SizeHistogram::kBucketCount &&
+                   WSCTlsRecords::SizeHistogram::highestEquivalentValue(index) <= bound) {
+                cumulative += sample.tlsRecords.counts[index++];
+            }
+            out << "wscpp_tls_record_size_bytes_bucket{" << sample.labels << ",le=\"" << bound
+                << "\"} " << cumulative << '\n';
+        }
+        out << "wscpp_tls_record_size_bytes_bucket{" << sample.labels << ",le=\"+Inf\"} "
+            << sample.tlsRecords.count << '\n';
+        out << "wscpp_tls_record_size_bytes_count{" << sample.labels << "} "
+            << sample.tlsRecords.count << '\n';
+        out << "wscpp_tls_record_size_bytes_sum{" << sample.labels << "} "
+            << sample.tlsRecords.sum << '\n';
+    }
+
+    out << "# EOF\n";
+    return out.str();
+}
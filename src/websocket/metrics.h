@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Poco/Net/HTTPServer.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WSC;
+
+// OpenMetrics / Prometheus exporter for every live WSC instance.
+// Connections register themselves on construction; a scrape only reads their atomic
+// counters, so it never takes a lock the send/receive threads use.
+class WSCMetrics {
+   public:
+    struct Config {
+        std::string address;
+        uint16_t port;
+        std::string path;
+        int maxThreads;
+
+        Config()
+            : address("127.0.0.1"),  // local scrapes only by default
+              port(9464),            // 0 picks a free port, see getPort()
+              path("/metrics"),
+              maxThreads(2) {}
+    };
+
+    explicit WSCMetrics(const Config &config = Config{});
+    ~WSCMetrics();
+
+    WSCMetrics(const WSCMetrics &) = delete;
+    WSCMetrics &operator=(const WSCMetrics &) = delete;
+
+    bool start();
+    void stop();
+    bool isRunning() const noexcept { return m_server != nullptr; }
+    uint16_t getPort() const noexcept { return m_port; }
+
+    // Connection registry, called by WSC itself
+    static void registerConnection(const WSC *connection);
+    static void unregisterConnection(const WSC *connection);
+
+    // OpenMetrics text exposition of all registered connections
+    static std::string render();
+
+    static constexpr const char *kContentType =
+        "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+   private:
+    Config m_config;
+    uint16_t m_port = 0;
+    std::unique_ptr<Poco::Net::HTTPServer> m_server;
+};
@@ -0,0 +1,93 @@
+#include "tlsrecords.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+    // Sessions whose handshake completed, by socket, until a connection takes its own
+    std::mutex g_handshakesMutex;
+    std::unordered_map<poco_socket_t, SSL *> g_handshakes;
+
+    constexpr size_t kRecordHeaderSize = 5;
+}  // namespace
+
+int WSCTlsRecords::sessionIndex() {
+    static const int index =
+        SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, &WSCTlsRecords::onFree);
+    return index;
+}
+
+void WSCTlsRecords::install(SSL_CTX *context) {
+    sessionIndex();
+    SSL_CTX_set_info_callback(context, &WSCTlsRecords::onInfo);
+    SSL_CTX_set_msg_callback(context, &WSCTlsRecords::onRecord);
+}
+
+void WSCTlsRecords::onInfo(const SSL *ssl, int where, int /*result*/) {
+    // TLS 1.3 reports post-handshake messages as handshakes too, taken sessions stay taken
+    if (!(where & SSL_CB_HANDSHAKE_DONE) || SSL_get_ex_data(ssl, sessionIndex())) return;
+    std::lock_guard<std::mutex> lock(g_handshakesMutex);
+    g_handshakes[SSL_get_fd(ssl)] = const_cast<SSL *>(ssl);
+}
+
+void WSCTlsRecords::onRecord(int writing, int /*version*/, int contentType, const void *buffer,
+                             size_t length, SSL *ssl, void * /*arg*/) {
+    if (!writing || contentType != SSL3_RT_HEADER || length < kRecordHeaderSize) return;
+    auto *records = static_cast<WSCTlsRecords *>(SSL_get_ex_data(ssl, sessionIndex()));
+    if (!records || !records->m_sizes) return;
+    const auto *header = static_cast<const uint8_t *>(buffer);
+    records->m_sizes->record(kRecordHeaderSize + (header[3] << 8 | header[4]));
+}
+
+// Called by SSL_free() for every session, whether a connection took it or not
+void WSCTlsRecords::onFree(void *ssl, void *records, CRYPTO_EX_DATA * /*data*/, int /*index*/,
+                           long /*argl*/, void * /*argp*/) {
+    {
+        std::lock_guard<std::mutex> lock(g_handshakesMutex);
+        const auto handshake = g_handshakes.find(SSL_get_fd(static_cast<SSL *>(ssl)));
+        if (handshake != g_handshakes.end() && handshake->second == ssl) {
+            g_handshakes.erase(handshake);
+        }
+    }
+    if (records) {
+        auto &owner = *static_cast<WSCTlsRecords *>(records);
+        std::lock_guard<std::mutex> lock(owner.m_mutex);
+        owner.m_ssl = nullptr;
+    }
+}
+
+WSCTlsRecords::WSCTlsRecords(const Config &config, std::shared_ptr<SizeHistogram> sizes)
+    : m_config(config), m_sizes(std::move(sizes)) {}
+
+WSCTlsRecords::~WSCTlsRecords() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ssl) SSL_set_ex_data(m_ssl, sessionIndex(), nullptr);
+}
+
+bool WSCTlsRecords::attach(poco_socket_t fd) {
+    SSL *ssl;
+    {
+        std::lock_guard<std::mutex> lock(g_handshakesMutex);
+        const auto handshake = g_handshakes.find(fd);
+        if (handshake == g_handshakes.end()) return false;
+        ssl = handshake->second;
+        g_handshakes.erase(handshake);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ssl = ssl;
+    SSL_set_ex_data(m_ssl, sessionIndex(), this);
+    return true;
+}
+
+size_t WSCTlsRecords::recordSize(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_lastWrite > m_config.idleReset) m_burst = 0;
+    m_lastWrite = now;
+    // up to max_send_fragment, which stays at the TLS maximum
+    const int size = std::clamp(
+        m_burst >= m_config.rampBytes ? m_config.largeRecord : m_config.smallRecord, 512,
+        SSL3_RT_MAX_PLAIN_LENGTH);
+    m_burst += bytes;
+    return static_cast<size_t>(size);
+}
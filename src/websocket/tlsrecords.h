@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Poco/Net/Socket.h>
+#include <openssl/ssl.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "WSCHistogram.h"
+
+// Dynamic TLS record sizing of a wss:// connection. Large records fill the pipe with less
+// overhead, but the receiver can decrypt nothing before the whole record arrived, so after
+// an idle period the first bytes would wait for up to 16KB to cross a cold or lossy link.
+// Records start small after idle and grow to the TLS maximum once a burst keeps going:
+//
+//   idle > idleReset  ->  smallRecord bytes per record
+//   burst > rampBytes ->  largeRecord bytes per record, until the next idle period
+//
+// The sender cuts its writes into SSL_write() calls of recordSize() bytes, each of which
+// OpenSSL sends as one record. The session itself is never reconfigured: SSL_read() runs
+// on the receive thread without a lock, and OpenSSL does not allow changing a session's
+// settings while another thread uses it. The sizes of the records written are counted,
+// see WSC::getTlsRecordSnapshot().
+class WSCTlsRecords {
+   public:
+    struct Config {
+        bool enabled;
+        int smallRecord;  // plaintext per record, with the TLS overhead one TCP segment
+        int largeRecord;  // the TLS maximum
+        size_t rampBytes;
+        std::chrono::milliseconds idleReset;
+
+        Config()
+            : enabled(false),
+              smallRecord(1369),         // 1400 bytes on the wire with AES-GCM
+              largeRecord(16 * 1024),    // 16KB
+              rampBytes(1024 * 1024),    // 1MB
+              idleReset(1000) {}         // 1 second
+    };
+
+    // bytes per record on the wire, header and authentication tag included
+    using SizeHistogram = WSCHistogram<5, 15>;
+
+    // Lets OpenSSL report handshakes and written records of a client context, once before
+    // connections use it
+    static void install(SSL_CTX *context);
+
+    WSCTlsRecords(const Config &config, std::shared_ptr<SizeHistogram> sizes);
+    ~WSCTlsRecords();
+
+    WSCTlsRecords(const WSCTlsRecords &) = delete;
+    WSCTlsRecords &operator=(const WSCTlsRecords &) = delete;
+
+    // Takes over the TLS session of the socket after its handshake. false when the context
+    // was not prepared with install().
+    bool attach(poco_socket_t fd);
+
+    // Plaintext bytes per record for a write of the given size, from the sending thread
+    size_t recordSize(size_t bytes);
+
+   private:
+    // ex_data slot of a session pointing to its WSCTlsRecords
+    static int sessionIndex();
+    static void onRecord(int writing, int version, int contentType, const void *buffer,
+                         size_t length, SSL *ssl, void *arg);
+    static void onInfo(const SSL *ssl, int where, int result);
+    static void onFree(void *ssl, void *records, CRYPTO_EX_DATA *data, int index, long argl,
+                       void *argp);
+
+    const Config m_config;
+    const std::shared_ptr<SizeHistogram> m_sizes;
+
+    mutable std::mutex m_mutex;
+    SSL *m_ssl = nullptr;  // cleared when OpenSSL frees the session
+    std::chrono::steady_clock::time_point m_lastWrite{};
+    size_t m_burst = 0;
+};
@@ -0,0 +1,399 @@
+#include "transport.h"
+
+#include <Poco/Net/HTTPSClientSession.h>
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/StreamSocketImpl.h>
+#include <Poco/Net/WebSocketImpl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "WSCFrame.h"
+
+#if defined(__linux__) && __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#include <sys/socket.h>
+#define WSC_KTLS 1
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
+namespace {
+    // WebSocketImpl::receiveSomeBytes() first hands out what the handshake read past the
+    // response, then reads from the socket or SSL session beneath. It is protected, a
+    // derived class may still name it.
+    struct WebSocketBytes : Poco::Net::WebSocketImpl {
+        static int receive(Poco::Net::WebSocketImpl &impl, char *buffer, int length) {
+            return (impl.*&WebSocketBytes::receiveSomeBytes)(buffer, length);
+        }
+    };
+
+    // The plain or secure socket the frames of a WebSocketImpl go through is private. An
+    // explicit instantiation may name a private member, this one hands the pointer out.
+    template <Poco::Net::StreamSocketImpl *Poco::Net::WebSocketImpl::*Member>
+    struct StreamSocketOf {
+        friend Poco::Net::StreamSocketImpl &streamSocket(Poco::Net::WebSocketImpl &impl) {
+            return *(impl.*Member);
+        }
+    };
+    Poco::Net::StreamSocketImpl &streamSocket(Poco::Net::WebSocketImpl &impl);
+    template struct StreamSocketOf<&Poco::Net::WebSocketImpl::_pStreamSocketImpl>;
+
+    // Runs a receive call of a transport and maps its exceptions to a status
+    template <typename Call>
+    WSCTransport::Receive guarded(std::string &error, Call &&call) noexcept {
+        try {
+            return call();
+        } catch (const Poco::TimeoutException &) {
+            return WSCTransport::Receive::TIMEOUT;
+        } catch (const Poco::Exception &e) {
+            if (e.code() == POCO_EAGAIN || e.code() == POCO_ETIMEDOUT) {
+                return WSCTransport::Receive::TIMEOUT;
+            }
+            error = e.displayText();
+        } catch (const std::exception &e) {
+            error = e.what();
+        }
+        return WSCTransport::Receive::FAILED;
+    }
+
+    // What OpenSSL installed into the socket after the handshake. The kernel answers
+    // ENOPROTOOPT without the tls module and EBUSY for a direction it does not handle.
+    WSCTransport::KernelTls kernelTlsOf(poco_socket_t fd) {
+        WSCTransport::KernelTls state{};
+#ifdef WSC_KTLS
+        auto installed = [fd](int direction) {
+            tls_crypto_info info{};
+            socklen_t length = sizeof(info);
+            return getsockopt(fd, SOL_TLS, direction, &info, &length) == 0;
+        };
+        state.send = installed(TLS_TX);
+        state.receive = installed(TLS_RX);
+#else
+        (void)fd;
+#endif
+        return state;
+    }
+
+    // The read-ahead path of the socket transports
+
+    // One read into the read-ahead buffer, 0 when the peer closed between two frames
+    int fillReader(Poco::Net::WebSocket &socket, WSCFrameReader &reader) {
+        auto &impl = *static_cast<Poco::Net::WebSocketImpl *>(socket.impl());
+        const int n = reader.fill([&](char *out, size_t size) {
+            const size_t limit = std::numeric_limits<int>::max();
+            return WebSocketBytes::receive(impl, out, static_cast<int>(std::min(size, limit)));
+        });
+        if (n <= 0 && reader.buffered() > 0) {
+            throw Poco::Net::WebSocketException("Incomplete frame received",
+                                                Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+        }
+        return std::max(n, 0);
+    }
+
+    WSCFrameReader::Parse parseFrames(WSCFrameReader &reader,
+                                      std::vector<WSCTransport::FrameView> &frames) {
+        WSCFrameReader::Frame frame;
+        WSCFrameReader::Parse parse;
+        while ((parse = reader.next(frame)) == WSCFrameReader::Parse::FRAME) {
+            frames.push_back(WSCTransport::FrameView{frame.flags, frame.payload, frame.length});
+        }
+        return parse;
+    }
+
+    void payloadTooBig() {
+        throw Poco::Net::WebSocketException("Payload too big",
+                                            Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+    }
+
+    // receiveFrame() through the read-ahead buffer
+    int readFrame(Poco::Net::WebSocket &socket, WSCFrameReader &reader,
+                  Poco::Buffer<char> &buffer, int &flags) {
+        WSCFrameReader::Frame frame;
+        WSCFrameReader::Parse parse;
+        while ((parse = reader.next(frame)) == WSCFrameReader::Parse::NEED_MORE) {
+            if (fillReader(socket, reader) == 0) {
+                flags = 0;
+                return 0;
+            }
+        }
+        if (parse == WSCFrameReader::Parse::TOO_BIG) payloadTooBig();
+        buffer.append(frame.payload, frame.length);
+        flags = frame.flags;
+        return static_cast<int>(frame.length);
+    }
+
+    WSCTransport::Receive readFrames(Poco::Net::WebSocket &socket, WSCFrameReader &reader,
+                                     std::vector<WSCTransport::FrameView> &frames) {
+        const size_t before = frames.size();
+        // a read may move the buffer, it only happens before the first view was taken
+        WSCFrameReader::Parse parse = parseFrames(reader, frames);
+        if (frames.size() == before && parse == WSCFrameReader::Parse::NEED_MORE) {
+            if (fillReader(socket, reader) == 0) return WSCTransport::Receive::CLOSED;
+            parse = parseFrames(reader, frames);
+        }
+        if (frames.size() > before) return WSCTransport::Receive::FRAME;
+        if (parse == WSCFrameReader::Parse::TOO_BIG) payloadTooBig();
+        return WSCTransport::Receive::TIMEOUT;
+    }
+
+    // Writes encoded frames to the plain or secure socket beneath the WebSocketImpl, in
+    // writes of at most limit bytes
+    void writeEncoded(Poco::Net::WebSocket &socket, const char *data, size_t length,
+                      size_t limit) {
+        auto &stream = streamSocket(*static_cast<Poco::Net::WebSocketImpl *>(socket.impl()));
+        limit = std::min(limit, static_cast<size_t>(std::numeric_limits<int>::max()));
+        size_t sent = 0;
+        while (sent < length) {
+            const int n =
+                stream.sendBytes(data + sent, static_cast<int>(std::min(length - sent, limit)));
+            if (n <= 0) throw Poco::Net::NetException("Failed to send frames");
+            sent += static_cast<size_t>(n);
+        }
+    }
+}  // namespace
+
+WSCTransport::Receive WSCTransport::receive(Poco::Buffer<char> &buffer, int &flags, int &length,
+                                           std::string &error) noexcept {
+    return guarded(error, [&] {
+        length = receiveFrame(buffer, flags);
+        return length == 0 && flags == 0 ? Receive::CLOSED : Receive::FRAME;
+    });
+}
+
+size_t WSCTransport::sendFrames(const std::vector<FrameView> &frames) {
+    for (const FrameView &frame : frames) {
+        sendFrame(frame.payload, static_cast<int>(frame.length), frame.flags);
+    }
+    return frames.size();
+}
+
+WSCTransport::Receive WSCTransport::receiveFrames(std::vector<FrameView> & /*frames*/) {
+    throw Poco::NotImplementedException("The transport receives frame by frame");
+}
+
+WSCTransport::Receive WSCTransport::receiveBatch(std::vector<FrameView> &frames,
+                                                std::string &error) noexcept {
+    return guarded(error, [&] { return receiveFrames(frames); });
+}
+
+void WSCPocoTransport::connect(const Options &options, Poco::Net::HTTPRequest &request,
+                               Poco::Net::HTTPResponse &response) {
+    if (options.secure) {
+        m_session = options.tlsContext
+                        ? std::make_unique<Poco::Net::HTTPSClientSession>(
+                              options.host, options.port, options.tlsContext)
+                        : std::make_unique<Poco::Net::HTTPSClientSession>(options.host,
+                                                                          options.port);
+    } else {
+        m_session = std::make_unique<Poco::Net::HTTPClientSession>(options.host, options.port);
+    }
+    m_session->setTimeout(options.connectionTimeout);
+
+    m_websocket = std::make_unique<Poco::Net::WebSocket>(*m_session, request, response);
+    m_websocket->setSendTimeout(options.sendTimeout);
+    m_websocket->setReceiveTimeout(options.receiveTimeout);
+    m_websocket->setMaxPayloadSize(options.maxPayloadSize);
+    m_websocket->setSendBufferSize(options.sendBufferSize);
+    m_websocket->setReceiveBufferSize(options.receiveBufferSize);
+    m_pollSet.add(*m_websocket, Poco::Net::PollSet::POLL_READ | Poco::Net::PollSet::POLL_ERROR);
+    if (options.readAheadSize > 0) {
+        m_reader = std::make_unique<WSCFrameReader>(options.readAheadSize, options.maxPayloadSize);
+    }
+    if (!options.secure) return;
+    m_kernelTls = kernelTlsOf(m_websocket->impl()->sockfd());
+    if (options.tlsRecords.enabled) {
+        m_tlsRecords = std::make_unique<WSCTlsRecords>(options.tlsRecords, options.tlsRecordSizes);
+        if (!m_tlsRecords->attach(m_websocket->impl()->sockfd())) m_tlsRecords.reset();
+    }
+}
+
+int WSCPocoTransport::sendFrame(const void *buffer, int length, int flags) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (!encodesFrames()) return m_websocket->sendFrame(buffer, length, flags);
+    m_sendBuffer.clear();
+    appendFrame(buffer, static_cast<size_t>(length), flags);
+    writeFrames();
+    return length;
+}
+
+size_t WSCPocoTransport::sendFrames(const std::vector<FrameView> &frames) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (!encodesFrames()) {
+        for (const FrameView &frame : frames) {
+            m_websocket->sendFrame(frame.payload, static_cast<int>(frame.length), frame.flags);
+        }
+        return frames.size();
+    }
+    m_sendBuffer.clear();
+    for (const FrameView &frame : frames) appendFrame(frame.payload, frame.length, frame.flags);
+    writeFrames();
+    return frames.size();
+}
+
+// Appends a masked client frame to m_sendBuffer. m_sendMutex held.
+void WSCPocoTransport::appendFrame(const void *payload, size_t length, int flags) {
+    const size_t offset = m_sendBuffer.size();
+    m_sendBuffer.resize(offset + WSCFrame::clientFrameSize(length));
+    WSCFrame::encodeClientFrame(m_sendBuffer.data() + offset, flags, payload, length,
+                                static_cast<uint32_t>(m_maskKeys()));
+}
+
+// Writes m_sendBuffer through the SSL session. OpenSSL cuts a write into records of up to
+// 16KB; with record sizing every SSL_write() is one record of the size picked for the
+// burst. m_sendMutex held.
+void WSCPocoTransport::writeFrames() {
+    const size_t length = m_sendBuffer.size();
+    writeEncoded(*m_websocket, m_sendBuffer.data(), length,
+                 m_tlsRecords ? m_tlsRecords->recordSize(length) : length);
+}
+
+int WSCPocoTransport::receiveFrame(Poco::Buffer<char> &buffer, int &flags) {
+    if (!m_reader) return m_websocket->receiveFrame(buffer, flags);
+    return readFrame(*m_websocket, *m_reader, buffer, flags);
+}
+
+WSCTransport::Receive WSCPocoTransport::receiveFrames(std::vector<FrameView> &frames) {
+    return readFrames(*m_websocket, *m_reader, frames);
+}
+
+WSCTransport::Wait WSCPocoTransport::waitReadable(const Poco::Timespan &timeout) {
+    if (m_wakeUp.exchange(false, std::memory_order_acq_rel)) return Wait::WOKEN;
+    if (m_reader && m_reader->ready()) return Wait::READABLE;
+    // bytes Poco or OpenSSL hold already do not make the socket readable; with TLS a record
+    // can carry several frames, SSL_pending() is checked before every wait. What the
+    // handshake read past its response may take several reads to drain, the check stays on
+    // until nothing is left.
+    if (m_checkBuffered || m_websocket->secure()) {
+        if (m_websocket->available() > 0) return Wait::READABLE;
+        m_checkBuffered = false;
+    }
+    try {
+        const auto ready = m_pollSet.poll(timeout);
+        if (m_wakeUp.exchange(false, std::memory_order_acq_rel)) return Wait::WOKEN;
+        return ready.empty() ? Wait::TIMEOUT : Wait::READABLE;
+    } catch (const Poco::Exception &) {
+        return Wait::READABLE;  // receive() reports what is wrong with the socket
+    }
+}
+
+void WSCPocoTransport::wakeUp() {
+    m_wakeUp.store(true, std::memory_order_release);
+    m_pollSet.wakeUp();
+}
+
+void WSCPocoTransport::placeReceiveBuffers(int node) {
+    if (m_reader) m_reader->placeOn(node);
+}
+
+void WSCPocoTransport::close() {
+    m_tlsRecords.reset();
+    m_pollSet.clear();
+    m_websocket->close();
+}
+
+// To the socket beneath the WebSocketImpl, which would frame the bytes again. With TLS
+// through the SSL session in records sized as writeFrames() sizes them.
+bool WSCPocoTransport::sendEncodedFrame(const char *frame, int length) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    const auto size = static_cast<size_t>(length);
+    writeEncoded(*m_websocket, frame, size,
+                 m_tlsRecords ? m_tlsRecords->recordSize(size) : size);
+    return true;
+}
+
+// ================================= PLAIN TRANSPORT ==================================
+
+void WSCPlainTransport::connect(const Options &options, Poco::Net::HTTPRequest &request,
+                                Poco::Net::HTTPResponse &response) {
+    if (options.secure) {
+        throw Poco::InvalidArgumentException("WSCPlainTransport has no TLS, use WSCPocoTransport");
+    }
+    m_session = std::make_unique<Poco::Net::HTTPClientSession>(options.host, options.port);
+    m_session->setTimeout(options.connectionTimeout);
+
+    m_websocket = std::make_unique<Poco::Net::WebSocket>(*m_session, request, response);
+    m_websocket->setSendTimeout(options.sendTimeout);
+    m_websocket->setReceiveTimeout(options.receiveTimeout);
+    m_websocket->setMaxPayloadSize(options.maxPayloadSize);
+    m_websocket->setSendBufferSize(options.sendBufferSize);
+    m_websocket->setReceiveBufferSize(options.receiveBufferSize);
+    m_pollSet.add(*m_websocket, Poco::Net::PollSet::POLL_READ | Poco::Net::PollSet::POLL_ERROR);
+    if (options.readAheadSize > 0) {
+        m_reader = std::make_unique<WSCFrameReader>(options.readAheadSize, options.maxPayloadSize);
+    }
+}
+
+int WSCPlainTransport::sendFrame(const void *buffer, int length, int flags) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    const auto size = static_cast<size_t>(length);
+    m_sendBuffer.resize(WSCFrame::clientFrameSize(size));
+    WSCFrame::encodeClientFrame(m_sendBuffer.data(), flags, buffer, size,
+                                static_cast<uint32_t>(m_maskKeys()));
+    writeEncoded(*m_websocket, m_sendBuffer.data(), m_sendBuffer.size(), m_sendBuffer.size());
+    return length;
+}
+
+size_t WSCPlainTransport::sendFrames(const std::vector<FrameView> &frames) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    size_t size = 0;
+    for (const FrameView &frame : frames) size += WSCFrame::clientFrameSize(frame.length);
+    m_sendBuffer.resize(size);
+    char *out = m_sendBuffer.data();
+    for (const FrameView &frame : frames) {
+        WSCFrame::encodeClientFrame(out, frame.flags, frame.payload, frame.length,
+                                    static_cast<uint32_t>(m_maskKeys()));
+        out += WSCFrame::clientFrameSize(frame.length);
+    }
+    writeEncoded(*m_websocket, m_sendBuffer.data(), size, size);
+    return frames.size();
+}
+
+bool WSCPlainTransport::sendEncodedFrame(const char *frame, int length) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    const auto size = static_cast<size_t>(length);
+    writeEncoded(*m_websocket, frame, size, size);
+    return true;
+}
+
+int WSCPlainTransport::receiveFrame(Poco::Buffer<char> &buffer, int &flags) {
+    if (!m_reader) return m_websocket->receiveFrame(buffer, flags);
+    return readFrame(*m_websocket, *m_reader, buffer, flags);
+}
+
+WSCTransport::Receive WSCPlainTransport::receiveFrames(std::vector<FrameView> &frames) {
+    return readFrames(*m_websocket, *m_reader, frames);
+}
+
+WSCTransport::Wait WSCPlainTransport::waitReadable(const Poco::Timespan &timeout) {
+    if (m_wakeUp.exchange(false, std::memory_order_acq_rel)) return Wait::WOKEN;
+    if (m_reader && m_reader->ready()) return Wait::READABLE;
+    // what the handshake read past its response, until nothing is left of it
+    if (m_checkBuffered) {
+        if (m_websocket->available() > 0) return Wait::READABLE;
+        m_checkBuffered = false;
+    }
+    try {
+        const auto ready = m_pollSet.poll(timeout);
+        if (m_wakeUp.exchange(false, std::memory_order_acq_rel)) return Wait::WOKEN;
+        return ready.empty() ? Wait::TIMEOUT : Wait::READABLE;
+    } catch (const Poco::Exception &) {
+        return Wait::READABLE;  // receive() reports what is wrong with the socket
+    }
+}
+
+void WSCPlainTransport::wakeUp() {
+    m_wakeUp.store(true, std::memory_order_release);
+    m_pollSet.wakeUp();
+}
+
+void WSCPlainTransport::placeReceiveBuffers(int node) {
+    if (m_reader) m_reader->placeOn(node);
+}
+
+void WSCPlainTransport::close() {
+    m_pollSet.clear();
+    m_websocket->close();
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <Poco/Buffer.h>
+#include <Poco/Net/Context.h>
+#include <Poco/Net/HTTPClientSession.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/PollSet.h>
+#include <Poco/Net/WebSocket.h>
+#include <Poco/Timespan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "WSCFrameReader.h"
+#include "tlsrecords.h"
+
+// Frame level connection beneath WSC. Every implementation follows the
+// Poco::Net::WebSocket contract so WSC treats them alike: receiveFrame() appends the
+// payload to the buffer and returns its length (0 once the peer closed the connection) and
+// throws Poco::TimeoutException when nothing arrived within the receive timeout, other
+// failures are thrown as Poco::Exception.
+//
+// The receive thread of WSC does not block in receiveFrame() though: it waits in
+// waitReadable() until a frame arrives or another thread calls wakeUp(), then reads it
+// through receive(), which reports the outcome as a status instead of an exception.
+class WSCTransport {
+   public:
+    enum class Wait { READABLE, TIMEOUT, WOKEN };
+    enum class Receive { FRAME, CLOSED, TIMEOUT, FAILED };
+
+    struct Options {
+        std::string host;
+        uint16_t port;
+        bool secure;
+        Poco::Timespan connectionTimeout;
+        Poco::Timespan sendTimeout;
+        Poco::Timespan receiveTimeout;
+        int maxPayloadSize;
+        int sendBufferSize;
+        int receiveBufferSize;
+        int readAheadSize;  // 0 to receive frame by frame
+        // TLS record sizing of wss:// connections and where the record sizes are counted
+        WSCTlsRecords::Config tlsRecords;
+        std::shared_ptr<WSCTlsRecords::SizeHistogram> tlsRecordSizes;
+        // TLS context of this wss:// connection, null for Poco's default client context
+        Poco::Net::Context::Ptr tlsContext;
+    };
+
+    // A received frame inside the transport's receive buffer
+    struct FrameView {
+        int flags;
+        const char *payload;
+        size_t length;
+    };
+
+    virtual ~WSCTransport() = default;
+
+    // Opens the connection and performs the opening handshake
+    virtual void connect(const Options &options, Poco::Net::HTTPRequest &request,
+                         Poco::Net::HTTPResponse &response) = 0;
+
+    virtual int sendFrame(const void *buffer, int length, int flags) = 0;
+
+    // Sends the frames in order, flags carry FIN and the opcode as for sendFrame(). Returns how
+    // many were sent, which is all of them: failures throw. Transports that can send several
+    // frames at once override it.
+    virtual size_t sendFrames(const std::vector<FrameView> &frames);
+    virtual int receiveFrame(Poco::Buffer<char> &buffer, int &flags) = 0;
+
+    // Writes a complete client frame (header, masking key and masked payload) as it is.
+    // Returns false when the transport cannot, the caller then sends through sendFrame().
+    virtual bool sendEncodedFrame(const char * /*frame*/, int /*length*/) { return false; }
+
+    // Waits until there is something to receive, the timeout passed or wakeUp() was called.
+    // Transports without readiness report READABLE at once and receive() blocks instead.
+    virtual Wait waitReadable(const Poco::Timespan & /*timeout*/) { return Wait::READABLE; }
+
+    // Ends the current or next waitReadable() early, safe to call from any thread
+    virtual void wakeUp() {}
+
+    // receiveFrame() with the outcome as a status: FRAME sets length and flags, FAILED sets
+    // error. TIMEOUT means a frame stalled halfway or the transport cannot wait for readiness.
+    Receive receive(Poco::Buffer<char> &buffer, int &flags, int &length,
+                    std::string &error) noexcept;
+
+    // Appends every complete frame that at most one read makes available. The views stay
+    // valid until the next receive call. FRAME when frames were appended, TIMEOUT when the
+    // read ended inside a frame. Only transports reporting batches() implement it.
+    virtual bool batches() const noexcept { return false; }
+    virtual Receive receiveFrames(std::vector<FrameView> &frames);
+
+    // receiveFrames() with failures as a status, like receive()
+    Receive receiveBatch(std::vector<FrameView> &frames, std::string &error) noexcept;
+
+    // Transports with an event loop of their own call receiver on it whenever input arrived,
+    // instead of a receive thread waiting in waitReadable(). The receiver takes what is
+    // there with waitReadable(0) and receiveFrames(). nullptr stops the calls and waits for
+    // one that runs. false when the caller has to read on a thread of its own.
+    virtual bool setReceiver(std::function<void()> /*receiver*/) { return false; }
+
+    // Sends a CLOSE frame and shuts down the sending side
+    virtual void shutdown() = 0;
+    virtual void close() = 0;
+
+    // The socket for TCP level options, nullptr for transports without one
+    virtual Poco::Net::WebSocket *socket() noexcept { return nullptr; }
+
+    // The directions in which the kernel took over TLS records after the handshake (kTLS)
+    struct KernelTls {
+        bool send;
+        bool receive;
+    };
+    virtual KernelTls kernelTls() const noexcept { return {}; }
+
+    // Moves the receive buffers to a NUMA node and keeps the ones allocated later there,
+    // called by the receive thread once it is pinned. Only a hint, transports without
+    // buffers of their own ignore it.
+    virtual void placeReceiveBuffers(int /*node*/) {}
+};
+
+using WSCTransportFactory = std::function<std::unique_ptr<WSCTransport>()>;
+
+// TCP or TLS connection through Poco::Net::WebSocket, the default transport
+class WSCPocoTransport final : public WSCTransport {
+   public:
+    void connect(const Options &options, Poco::Net::HTTPRequest &request,
+                 Poco::Net::HTTPResponse &response) override;
+
+    // TLS connections encode the frames themselves and write a batch with one SSL_write(),
+    // or one per record with Options::tlsRecords, so records carry several small frames
+    int sendFrame(const void *buffer, int length, int flags) override;
+    size_t sendFrames(const std::vector<FrameView> &frames) override;
+    // Through the read-ahead buffer unless Options::readAheadSize is 0
+    int receiveFrame(Poco::Buffer<char> &buffer, int &flags) override;
+    bool batches() const noexcept override { return m_reader != nullptr; }
+    Receive receiveFrames(std::vector<FrameView> &frames) override;
+    bool sendEncodedFrame(const char *frame, int length) override;
+
+    // epoll, poll or wepoll on the socket plus a wake up descriptor, see Poco::Net::PollSet
+    Wait waitReadable(const Poco::Timespan &timeout) override;
+    void wakeUp() override;
+
+    void shutdown() override { m_websocket->shutdown(); }
+    void close() override;
+
+    Poco::Net::WebSocket *socket() noexcept override { return m_websocket.get(); }
+
+    // Set when the TLS context enabled SSL_OP_ENABLE_KTLS and kernel and cipher support it
+    KernelTls kernelTls() const noexcept override { return m_kernelTls; }
+
+    // The read-ahead buffer
+    void placeReceiveBuffers(int node) override;
+
+   private:
+    std::unique_ptr<Poco::Net::HTTPClientSession> m_session;
+    std::unique_ptr<Poco::Net::WebSocket> m_websocket;
+    Poco::Net::PollSet m_pollSet;
+    std::atomic<bool> m_wakeUp{false};
+    bool m_checkBuffered = true;  // the handshake may have read the first frames already
+    std::unique_ptr<WSCFrameReader> m_reader;
+    KernelTls m_kernelTls{};
+    std::unique_ptr<WSCTlsRecords> m_tlsRecords;  // destroyed before the socket
+    // Frames come from the send, receive, ping and command threads
+    std::mutex m_sendMutex;
+    std::vector<char> m_sendBuffer;  // m_sendMutex
+    std::mt19937 m_maskKeys{std::random_device{}()};  // m_sendMutex
+
+    bool encodesFrames() const noexcept { return m_websocket->secure() && !m_kernelTls.send; }
+    void appendFrame(const void *payload, size_t length, int flags);
+    void writeFrames();
+};
+
+// TCP only connection for ws:// URLs: no SSL session, HTTPS session or TLS branch anywhere
+// on the send and receive paths. Frames are encoded here and every send is one write of
+// the socket, sendFrames() included. connect() throws Poco::InvalidArgumentException for
+// secure options. The default transport of WSCPlainClient.
+class WSCPlainTransport final : public WSCTransport {
+   public:
+    void connect(const Options &options, Poco::Net::HTTPRequest &request,
+                 Poco::Net::HTTPResponse &response) override;
+
+    int sendFrame(const void *buffer, int length, int flags) override;
+    size_t sendFrames(const std::vector<FrameView> &frames) override;
+    bool sendEncodedFrame(const char *frame, int length) override;
+    // Through the read-ahead buffer unless Options::readAheadSize is 0
+    int receiveFrame(Poco::Buffer<char> &buffer, int &flags) override;
+    bool batches() const noexcept override { return m_reader != nullptr; }
+    Receive receiveFrames(std::vector<FrameView> &frames) override;
+
+    Wait waitReadable(const Poco::Timespan &timeout) override;
+    void wakeUp() override;
+
+    void shutdown() override { m_websocket->shutdown(); }
+    void close() override;
+
+    Poco::Net::WebSocket *socket() noexcept override { return m_websocket.get(); }
+    void placeReceiveBuffers(int node) override;
+
+   private:
+    std::unique_ptr<Poco::Net::HTTPClientSession> m_session;
+    std::unique_ptr<Poco::Net::WebSocket> m_websocket;
+    Poco::Net::PollSet m_pollSet;
+    std::atomic<bool> m_wakeUp{false};
+    bool m_checkBuffered = true;  // the handshake may have read the first frames already
+    std::unique_ptr<WSCFrameReader> m_reader;
+    // BasicWSC sends from one thread, WSC from several
+    std::mutex m_sendMutex;
+    std::vector<char> m_sendBuffer;                   // m_sendMutex
+    std::mt19937 m_maskKeys{std::random_device{}()};  // m_sendMutex
+};
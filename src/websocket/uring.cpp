@@ -0,0 +1,1006 @@
+#include "uring.h"
+
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/StreamSocketImpl.h>
+#include <Poco/Net/WebSocketImpl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include "WSCFrame.h"
+#include "WSCLogger.h"
+#include "WSCThread.h"
+#include "WSCTrace.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+// multishot receive and fixed buffer sends arrived with Linux 6.0
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+#define WSC_URING 1
+#else
+#define WSC_URING 0
+#endif
+
+namespace {
+    // see transport.cpp
+    struct WebSocketBytes : Poco::Net::WebSocketImpl {
+        static int receive(Poco::Net::WebSocketImpl &impl, char *buffer, int length) {
+            return (impl.*&WebSocketBytes::receiveSomeBytes)(buffer, length);
+        }
+    };
+
+    // what a completion belongs to, the slot index sits above it in the user data
+    enum Operation : uint64_t { RECEIVE = 1, SEND = 2, CANCEL = 3, STOP = 4, NOTIFY = 5 };
+
+    uint64_t userData(int slot, Operation operation) {
+        return static_cast<uint64_t>(slot) << 8 | operation;
+    }
+
+    std::chrono::microseconds toChrono(const Poco::Timespan &timespan) {
+        return std::chrono::microseconds(timespan.totalMicroseconds());
+    }
+
+    // Waits up to timeout for ready(), a timeout of 0 only checks it once as poll() does.
+    // false on timeout.
+    template <typename Ready>
+    bool waitFor(std::condition_variable &changed, std::unique_lock<std::mutex> &lock,
+                 const Poco::Timespan &timeout, Ready &&ready) {
+        if (timeout.totalMicroseconds() <= 0) return ready();
+        return changed.wait_for(lock, toChrono(timeout), ready);
+    }
+
+    // Reads and writes take the socket timeouts, where 0 means no limit as in Poco
+    template <typename Ready>
+    bool waitForSocket(std::condition_variable &changed, std::unique_lock<std::mutex> &lock,
+                       const Poco::Timespan &timeout, Ready &&ready) {
+        if (timeout.totalMicroseconds() > 0) return waitFor(changed, lock, timeout, ready);
+        changed.wait(lock, ready);
+        return true;
+    }
+}  // namespace
+
+// ==================================== RING =====================================
+
+#if WSC_URING
+
+struct WSCUringReactor::Ring {
+    int fd = -1;
+
+    void *sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void *cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+
+    std::mutex submitMutex;
+    unsigned unsubmitted = 0;
+    bool zeroCopySends = true;  // cleared when the kernel refuses them
+    bool registeredSends = false;  // the send arena is a registered buffer
+
+    // provided buffers, the tail overlays the last field of the first entry
+    io_uring_buf *buffers = static_cast<io_uring_buf *>(MAP_FAILED);
+    size_t buffersSize = 0;
+    unsigned bufferMask = 0;
+    uint16_t bufferTail = 0;
+    int buffersHeld = 0;  // received into and not yet released
+    std::unique_ptr<char[]> receiveArena;
+    std::unique_ptr<char[]> sendArena;
+
+    std::atomic<uint64_t> enters{0};
+    std::atomic<uint64_t> completions{0};
+
+    ~Ring() {
+        if (buffers != MAP_FAILED) munmap(buffers, buffersSize);
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqMap != MAP_FAILED && cqMap != sqMap) munmap(cqMap, cqMapSize);
+        if (sqMap != MAP_FAILED) munmap(sqMap, sqMapSize);
+        if (fd >= 0) ::close(fd);
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        enters.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<int>(
+            syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    // Waits up to timeout for a completion, -1 with ETIME when none came
+    int wait(std::chrono::microseconds timeout) {
+        enters.fetch_add(1, std::memory_order_relaxed);
+        __kernel_timespec time{};
+        time.tv_sec = timeout.count() / 1000000;
+        time.tv_nsec = timeout.count() % 1000000 * 1000;
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&time);
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, 0, 1,
+                                        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                                        sizeof(arg)));
+    }
+
+    int registerRing(unsigned opcode, void *arg, unsigned count) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    // Next free submission entry, the kernel sees it with submit(). submitMutex held.
+    io_uring_sqe *sqe() {
+        const unsigned tail = *sqTail + unsubmitted;
+        if (tail - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire) >=
+            sqEntries) {
+            submit();
+        }
+        const unsigned index = (*sqTail + unsubmitted) & sqMask;
+        sqArray[index] = index;
+        io_uring_sqe *entry = &sqes[index];
+        std::memset(entry, 0, sizeof(*entry));
+        unsubmitted++;
+        return entry;
+    }
+
+    // submitMutex held
+    void submit() {
+        std::atomic_ref<unsigned>(*sqTail).store(*sqTail + unsubmitted,
+                                                 std::memory_order_release);
+        while (unsubmitted > 0) {
+            const int n = enter(unsubmitted, 0, 0);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                throw Poco::Net::NetException("io_uring_enter failed", std::strerror(errno));
+            }
+            unsubmitted -= std::min<unsigned>(unsubmitted, static_cast<unsigned>(n));
+        }
+    }
+
+    char *receiveBuffer(uint16_t id, size_t bufferSize) const {
+        return receiveArena.get() + static_cast<size_t>(id) * bufferSize;
+    }
+
+    // Hands a buffer back to the kernel, under m_buffersMutex
+    void provide(uint16_t id, size_t bufferSize) {
+        io_uring_buf &entry = buffers[bufferTail & bufferMask];
+        entry.addr = reinterpret_cast<uint64_t>(receiveBuffer(id, bufferSize));
+        entry.len = static_cast<uint32_t>(bufferSize);
+        entry.bid = id;
+        bufferTail++;
+        std::atomic_ref<uint16_t>(buffers[0].resv)
+            .store(bufferTail, std::memory_order_release);
+    }
+};
+
+// Maps the queues and registers the buffers, sets m_unavailableReason when that fails
+bool WSCUringReactor::setUp(Ring &ring) {
+    auto fail = [this](const std::string &what) {
+        m_unavailableReason = what + ": " + std::strerror(errno);
+        return false;
+    };
+
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = static_cast<unsigned>(std::max(m_config.ringEntries, 1)) * 8;
+    ring.fd = static_cast<int>(
+        syscall(__NR_io_uring_setup, std::max(m_config.ringEntries, 1), &params));
+    if (ring.fd < 0) return fail("io_uring_setup");
+
+    ring.sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.sqMapSize = ring.cqMapSize = std::max(ring.sqMapSize, ring.cqMapSize);
+    }
+    ring.sqMap = mmap(nullptr, ring.sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sqMap == MAP_FAILED) return fail("mmap submission queue");
+    ring.cqMap = params.features & IORING_FEAT_SINGLE_MMAP
+                     ? ring.sqMap
+                     : mmap(nullptr, ring.cqMapSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    if (ring.cqMap == MAP_FAILED) return fail("mmap completion queue");
+    ring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring.sqes = static_cast<io_uring_sqe *>(mmap(nullptr, ring.sqesSize, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring.fd,
+                                                 IORING_OFF_SQES));
+    if (ring.sqes == MAP_FAILED) return fail("mmap submission entries");
+
+    auto *sq = static_cast<char *>(ring.sqMap);
+    ring.sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    ring.sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    ring.sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    ring.sqEntries = params.sq_entries;
+    ring.sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    auto *cq = static_cast<char *>(ring.cqMap);
+    ring.cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    ring.cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    ring.cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    ring.cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    // one registered buffer holding the send slot of every connection
+    const size_t slots = std::max(m_config.maxConnections, 1);
+    const size_t arenaSize = slots * m_config.sendSlotSize;
+    ring.sendArena.reset(new char[arenaSize]);
+    iovec arena{ring.sendArena.get(), arenaSize};
+    ring.registeredSends = ring.registerRing(IORING_REGISTER_BUFFERS, &arena, 1) == 0;
+    if (!ring.registeredSends) {
+        // RLIMIT_MEMLOCK, zero copy sends then pin the pages send by send
+        WSCLog(warn, "io_uring send buffers not registered: {}", std::strerror(errno));
+    }
+
+    // provided receive buffers, group 0
+    unsigned count = 1;
+    while (count < static_cast<unsigned>(std::max(m_config.receiveBuffers, 1))) count <<= 1;
+    count = std::min(count, 32768u);
+    ring.bufferMask = count - 1;
+    ring.buffersSize = count * sizeof(io_uring_buf);
+    ring.buffers = static_cast<io_uring_buf *>(mmap(nullptr, ring.buffersSize,
+                                                    PROT_READ | PROT_WRITE,
+                                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (ring.buffers == MAP_FAILED) return fail("mmap receive buffer ring");
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(ring.buffers);
+    registration.ring_entries = count;
+    registration.bgid = 0;
+    if (ring.registerRing(IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        return fail("register receive buffer ring");
+    }
+    ring.receiveArena.reset(new char[count * m_config.receiveBufferSize]);
+    for (unsigned id = 0; id < count; id++) {
+        ring.provide(static_cast<uint16_t>(id), m_config.receiveBufferSize);
+    }
+    return true;
+}
+
+WSCUringReactor::WSCUringReactor(const Config &config) : m_config(config) {
+    auto ring = std::make_unique<Ring>();
+    if (!setUp(*ring)) {
+        WSCLog(warn, "io_uring unavailable, connections use Poco sockets: {}",
+               m_unavailableReason);
+        return;
+    }
+    const int slots = std::max(m_config.maxConnections, 1);
+    for (int i = 0; i < slots; i++) {
+        auto slot = std::make_unique<Slot>();
+        slot->index = i;
+        slot->sendBuffer = ring->sendArena.get() + static_cast<size_t>(i) * m_config.sendSlotSize;
+        m_slots.push_back(std::move(slot));
+        m_freeSlots.push_back(slots - 1 - i);
+    }
+    m_ring = std::move(ring);
+    m_running = true;
+    m_thread = std::thread(&WSCUringReactor::run, this);
+}
+
+WSCUringReactor::~WSCUringReactor() {
+    if (!m_ring) return;
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_ring->submitMutex);
+        io_uring_sqe *sqe = m_ring->sqe();
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = userData(0, STOP);
+        m_ring->submit();
+    }
+    m_thread.join();
+}
+
+void WSCUringReactor::run() {
+    WSCThread::setName("wsc-io-uring");
+    WSCTrace::setThreadName("WSC io_uring");
+    while (m_running) {
+        if (m_ring->enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR &&
+            errno != EAGAIN && errno != EBUSY) {
+            WSCLog(error, "io_uring wait failed: {}", std::strerror(errno));
+            break;
+        }
+        reap();
+        deliver();
+    }
+}
+
+// Reactor thread only, never from complete()
+void WSCUringReactor::reap() {
+    unsigned head = *m_ring->cqHead;
+    const unsigned tail =
+        std::atomic_ref<unsigned>(*m_ring->cqTail).load(std::memory_order_acquire);
+    for (; head != tail; head++) {
+        const io_uring_cqe &cqe = m_ring->cqes[head & m_ring->cqMask];
+        complete(cqe.user_data, cqe.res, cqe.flags);
+    }
+    m_ring->completions.fetch_add(tail - *m_ring->cqHead, std::memory_order_relaxed);
+    std::atomic_ref<unsigned>(*m_ring->cqHead).store(head, std::memory_order_release);
+}
+
+void WSCUringReactor::reapFor(std::chrono::microseconds timeout) {
+    if (m_ring->wait(timeout) < 0 && errno != ETIME && errno != EINTR && errno != EAGAIN &&
+        errno != EBUSY) {
+        WSCLog(error, "io_uring wait failed: {}", std::strerror(errno));
+    }
+    reap();
+}
+
+// Runs the receivers of the slots that got input. Receivers that wait inside reap again,
+// what becomes readable meanwhile is delivered in the next round.
+void WSCUringReactor::deliver() {
+    std::vector<Slot *> readable;
+    while (!m_readable.empty()) {
+        readable.swap(m_readable);
+        for (Slot *slot : readable) {
+            std::function<void()> receiver;
+            {
+                std::lock_guard<std::mutex> lock(slot->mutex);
+                slot->readable = false;
+                if (!slot->receiver) continue;
+                receiver = slot->receiver;
+                slot->delivering = true;
+            }
+            try {
+                receiver();
+            } catch (const std::exception &e) {
+                WSCLog(error, "io_uring receiver failed: {}", e.what());
+            }
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            slot->delivering = false;
+            slot->changed.notify_all();
+        }
+        readable.clear();
+    }
+}
+
+void WSCUringReactor::setReceiver(Slot &slot, std::function<void()> receiver) {
+    std::unique_lock<std::mutex> lock(slot.mutex);
+    const bool start = receiver != nullptr;
+    slot.receiver = std::move(receiver);
+    if (!start) {
+        if (!onReactorThread()) slot.changed.wait(lock, [&slot] { return !slot.delivering; });
+        return;
+    }
+    lock.unlock();
+    // input may have arrived before, the reactor thread looks at the slot once
+    std::lock_guard<std::mutex> submitLock(m_ring->submitMutex);
+    io_uring_sqe *sqe = m_ring->sqe();
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = userData(slot.index, NOTIFY);
+    m_ring->submit();
+}
+
+template <typename Ready>
+bool WSCUringReactor::await(std::condition_variable &changed, std::unique_lock<std::mutex> &lock,
+                            const Poco::Timespan &timeout, bool unlimited, Ready &&ready) {
+    if (!onReactorThread()) {
+        return unlimited ? waitForSocket(changed, lock, timeout, ready)
+                         : waitFor(changed, lock, timeout, ready);
+    }
+    const bool limited = timeout.totalMicroseconds() > 0;
+    if (!limited && !unlimited) return ready();
+    const auto end = std::chrono::steady_clock::now() + toChrono(timeout);
+    while (!ready()) {
+        auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+            end - std::chrono::steady_clock::now());
+        if (!limited) {
+            left = std::chrono::seconds(1);
+        } else if (left.count() <= 0) {
+            return false;
+        }
+        lock.unlock();
+        reapFor(left);
+        lock.lock();
+    }
+    return true;
+}
+
+void WSCUringReactor::complete(uint64_t data, int result, uint32_t flags) {
+    const auto operation = static_cast<Operation>(data & 0xFF);
+    if (operation != RECEIVE && operation != SEND && operation != NOTIFY) return;
+    Slot &slot = *m_slots[data >> 8];
+    auto markReadable = [this, &slot] {  // slot.mutex held
+        if (!slot.receiver || slot.readable) return;
+        slot.readable = true;
+        m_readable.push_back(&slot);
+    };
+    if (operation == NOTIFY) {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        markReadable();
+        return;
+    }
+    if (operation == SEND) {
+        // a zero copy send completes twice: the result with F_MORE, then the notification
+        // that the kernel let go of the buffer
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (!(flags & IORING_CQE_F_NOTIF)) {
+            if (result < 0) {
+                if (!slot.sendError) slot.sendError = -result;
+            } else {
+                slot.sentBytes += static_cast<size_t>(result);
+            }
+            if (flags & IORING_CQE_F_MORE) return;
+        }
+        if (--slot.sendsPending > 0) return;
+        size_t chainBytes = 0;
+        bool zeroCopy = false;
+        for (const Send &send : slot.chain) {
+            chainBytes += send.length;
+            zeroCopy |= send.zeroCopy;
+        }
+        if (slot.sendError == EINVAL && zeroCopy && slot.sentBytes == 0) {
+            // no zero copy sends before Linux 6.0, the chain goes again without
+            {
+                std::lock_guard<std::mutex> submitLock(m_ring->submitMutex);
+                m_ring->zeroCopySends = false;
+            }
+            for (Send &send : slot.chain) send.zeroCopy = false;
+            slot.queued.insert(slot.queued.begin(), slot.chain.begin(), slot.chain.end());
+            slot.sendError = 0;
+        } else if (!slot.sendError && slot.sentBytes != chainBytes) {
+            slot.sendError = EIO;
+        }
+        slot.chain.clear();
+        if (slot.sendError) slot.queued.clear();
+        // sendEnd stays, reserve() starts the buffer over: a frame may be written right now
+        if (!slot.queued.empty()) submitChain(slot);
+        slot.sent.notify_all();
+        if (slot.closed) slot.changed.notify_all();  // detach() waits for the chain
+        return;
+    }
+
+    const bool buffered = (flags & IORING_CQE_F_BUFFER) != 0;
+    const auto buffer = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+    bool rearm = false;
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (buffered) {
+            std::lock_guard<std::mutex> buffersLock(m_buffersMutex);
+            m_ring->buffersHeld++;
+        }
+        if (buffered && result > 0) {
+            slot.inbox.push_back(Chunk{buffer, 0, static_cast<uint32_t>(result)});
+            m_receives.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!(flags & IORING_CQE_F_MORE)) {
+            slot.receiving = false;
+            if (result == -ENOBUFS && !slot.closed) {
+                // armed again once a connection hands buffers back
+                std::lock_guard<std::mutex> buffersLock(m_buffersMutex);
+                if (m_ring->buffersHeld <= static_cast<int>(m_ring->bufferMask)) {
+                    rearm = true;
+                } else {
+                    slot.starved = true;
+                    m_starved.push_back(&slot);
+                }
+            } else if (result <= 0) {
+                if (result < 0 && result != -ECANCELED && !slot.error) slot.error = -result;
+                slot.closed = true;
+            } else {
+                rearm = !slot.closed;  // the kernel may end a multishot request at any time
+            }
+        }
+        slot.changed.notify_all();
+        markReadable();
+    }
+    if (buffered && result <= 0) releaseBuffer(buffer);
+    if (rearm) armReceive(slot);
+}
+
+void WSCUringReactor::armReceive(Slot &slot) {
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (slot.closed || slot.receiving) return;
+        slot.receiving = true;
+        slot.starved = false;
+    }
+    std::lock_guard<std::mutex> lock(m_ring->submitMutex);
+    io_uring_sqe *sqe = m_ring->sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = slot.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = userData(slot.index, RECEIVE);
+    m_ring->submit();
+}
+
+void WSCUringReactor::releaseBuffer(uint16_t buffer) {
+    std::vector<Slot *> starved;
+    {
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        m_ring->provide(buffer, m_config.receiveBufferSize);
+        m_ring->buffersHeld--;
+        starved.swap(m_starved);
+    }
+    for (Slot *slot : starved) {
+        m_rearms.fetch_add(1, std::memory_order_relaxed);
+        armReceive(*slot);
+    }
+}
+
+WSCUringReactor::Slot *WSCUringReactor::attach(int fd) {
+    if (!m_ring) return nullptr;
+    Slot *slot;
+    {
+        std::lock_guard<std::mutex> lock(m_slotsMutex);
+        if (m_freeSlots.empty()) return nullptr;
+        slot = m_slots[m_freeSlots.back()].get();
+        m_freeSlots.pop_back();
+    }
+    {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        slot->fd = fd;
+        slot->inbox.clear();
+        slot->receiving = slot->starved = slot->closed = slot->wakeUp = false;
+        slot->error = slot->sendError = 0;
+        slot->receiver = nullptr;
+        slot->sendEnd = 0;
+        slot->queued.clear();
+        slot->chain.clear();
+        slot->sendsPending = 0;
+    }
+    return slot;
+}
+
+void WSCUringReactor::detach(Slot *slot) {
+    std::unique_lock<std::mutex> lock(slot->mutex);
+    slot->receiver = nullptr;
+    if (!onReactorThread()) slot->changed.wait(lock, [slot] { return !slot->delivering; });
+    slot->closed = true;
+    slot->queued.clear();
+    if (slot->receiving || slot->sendsPending > 0) {
+        std::lock_guard<std::mutex> submitLock(m_ring->submitMutex);
+        for (const Operation operation : {RECEIVE, SEND}) {
+            io_uring_sqe *sqe = m_ring->sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = userData(slot->index, operation);
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = userData(slot->index, CANCEL);
+        }
+        m_ring->submit();
+    }
+    await(slot->changed, lock, Poco::Timespan(0), true,
+          [slot] { return !slot->receiving && slot->sendsPending == 0; });
+    std::deque<Chunk> inbox;
+    inbox.swap(slot->inbox);
+    lock.unlock();
+    {
+        std::lock_guard<std::mutex> buffersLock(m_buffersMutex);
+        m_starved.erase(std::remove(m_starved.begin(), m_starved.end(), slot), m_starved.end());
+    }
+    for (const Chunk &chunk : inbox) releaseBuffer(chunk.buffer);
+    std::lock_guard<std::mutex> slotsLock(m_slotsMutex);
+    m_freeSlots.push_back(slot->index);
+}
+
+size_t WSCUringReactor::read(Slot &slot, char *out, size_t size, const Poco::Timespan &timeout) {
+    uint16_t done[64];  // emptied buffers, handed back after the slot is unlocked
+    size_t doneCount = 0;
+    size_t copied = 0;
+    {
+        std::unique_lock<std::mutex> lock(slot.mutex);
+        if (!await(slot.changed, lock, timeout, true, [&slot] {
+                return !slot.inbox.empty() || slot.closed || slot.error;
+            })) {
+            throw Poco::TimeoutException("No data received");
+        }
+        if (slot.inbox.empty() && slot.error) {
+            throw Poco::Net::NetException("Receive failed", std::strerror(slot.error));
+        }
+        while (copied < size && !slot.inbox.empty() && doneCount < std::size(done)) {
+            Chunk &chunk = slot.inbox.front();
+            const size_t n = std::min<size_t>(size - copied, chunk.length);
+            std::memcpy(out + copied,
+                        m_ring->receiveBuffer(chunk.buffer, m_config.receiveBufferSize) +
+                            chunk.offset,
+                        n);
+            copied += n;
+            chunk.offset += static_cast<uint32_t>(n);
+            chunk.length -= static_cast<uint32_t>(n);
+            if (chunk.length == 0) {
+                done[doneCount++] = chunk.buffer;
+                slot.inbox.pop_front();
+            }
+        }
+    }
+    for (size_t i = 0; i < doneCount; i++) releaseBuffer(done[i]);
+    return copied;
+}
+
+WSCTransport::Wait WSCUringReactor::waitReadable(Slot &slot, const Poco::Timespan &timeout,
+                                                 bool buffered) {
+    std::unique_lock<std::mutex> lock(slot.mutex);
+    auto ready = [&slot, buffered] {
+        return buffered || slot.wakeUp || !slot.inbox.empty() || slot.closed || slot.error;
+    };
+    if (!await(slot.changed, lock, timeout, false, ready)) return WSCTransport::Wait::TIMEOUT;
+    if (slot.wakeUp) {
+        slot.wakeUp = false;
+        return WSCTransport::Wait::WOKEN;
+    }
+    return WSCTransport::Wait::READABLE;
+}
+
+void WSCUringReactor::wakeUp(Slot &slot) {
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    slot.wakeUp = true;
+    slot.changed.notify_all();
+}
+
+char *WSCUringReactor::reserve(Slot &slot, size_t size, const Poco::Timespan &timeout) {
+    if (size > m_config.sendSlotSize) return nullptr;
+    std::unique_lock<std::mutex> lock(slot.mutex);
+    auto idle = [&slot] { return slot.sendsPending == 0 && slot.queued.empty(); };
+    if (slot.sendEnd + size > m_config.sendSlotSize) {
+        // the buffer starts over once everything in it was sent
+        if (slot.sendsPending == 0 && !slot.sendError) submitChain(slot);
+        if (!await(slot.sent, lock, timeout, true, [&] { return slot.sendError || idle(); })) {
+            slot.sendError = ETIMEDOUT;
+            throw Poco::TimeoutException("Send timed out");
+        }
+    }
+    if (slot.sendError) {
+        throw Poco::Net::NetException("Send failed", std::strerror(slot.sendError));
+    }
+    if (idle()) slot.sendEnd = 0;
+    return slot.sendBuffer + slot.sendEnd;
+}
+
+void WSCUringReactor::commit(Slot &slot, size_t size) {
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    bool zeroCopy = size >= m_config.zeroCopySize;
+    if (zeroCopy) {
+        std::lock_guard<std::mutex> submitLock(m_ring->submitMutex);
+        zeroCopy = m_ring->zeroCopySends;
+    }
+    // runs of small frames go out with one send, the link keeps them in order with the rest
+    Send *last = slot.queued.empty() ? nullptr : &slot.queued.back();
+    if (!zeroCopy && last && !last->zeroCopy && last->offset + last->length == slot.sendEnd) {
+        last->length += size;
+    } else {
+        slot.queued.push_back(Send{slot.sendEnd, size, zeroCopy});
+    }
+    slot.sendEnd += size;
+}
+
+void WSCUringReactor::flush(Slot &slot) {
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    if (slot.sendError) {
+        throw Poco::Net::NetException("Send failed", std::strerror(slot.sendError));
+    }
+    if (slot.sendsPending > 0) return;  // the completion submits what is queued
+    sendDirect(slot);
+    if (slot.sendError) {
+        throw Poco::Net::NetException("Send failed", std::strerror(slot.sendError));
+    }
+    submitChain(slot);
+}
+
+// With no chain in flight the queued sends go straight to the socket while it takes them, a
+// completion would only wake the reactor thread. The chain gets the rest and the zero copy
+// sends. slot.mutex held.
+void WSCUringReactor::sendDirect(Slot &slot) {
+    size_t sent = 0;
+    for (; sent < slot.queued.size() && !slot.queued[sent].zeroCopy; sent++) {
+        Send &send = slot.queued[sent];
+        ssize_t n;
+        do {
+            n = ::send(slot.fd, slot.sendBuffer + send.offset, send.length,
+                       MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) slot.sendError = errno;
+            break;
+        }
+        m_directSends.fetch_add(1, std::memory_order_relaxed);
+        if (static_cast<size_t>(n) < send.length) {
+            send.offset += static_cast<size_t>(n);
+            send.length -= static_cast<size_t>(n);
+            break;
+        }
+    }
+    slot.queued.erase(slot.queued.begin(), slot.queued.begin() + static_cast<ptrdiff_t>(sent));
+    if (slot.sendError) slot.queued.clear();
+}
+
+void WSCUringReactor::drain(Slot &slot, const Poco::Timespan &timeout) {
+    flush(slot);
+    std::unique_lock<std::mutex> lock(slot.mutex);
+    if (!await(slot.sent, lock, timeout, true, [&slot] {
+            return slot.sendError || (slot.sendsPending == 0 && slot.queued.empty());
+        })) {
+        slot.sendError = ETIMEDOUT;
+        throw Poco::TimeoutException("Send timed out");
+    }
+    if (slot.sendError) {
+        throw Poco::Net::NetException("Send failed", std::strerror(slot.sendError));
+    }
+}
+
+// Submits the queued sends as one linked chain, slot.mutex held and no chain in flight
+void WSCUringReactor::submitChain(Slot &slot) {
+    if (slot.queued.empty()) return;
+    slot.chain.swap(slot.queued);
+    slot.queued.clear();
+    slot.sendsPending = static_cast<int>(slot.chain.size());
+    slot.sentBytes = 0;
+    std::lock_guard<std::mutex> lock(m_ring->submitMutex);
+    for (size_t i = 0; i < slot.chain.size(); i++) {
+        const Send &send = slot.chain[i];
+        io_uring_sqe *sqe = m_ring->sqe();
+        sqe->opcode = send.zeroCopy ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+        sqe->fd = slot.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(slot.sendBuffer + send.offset);
+        sqe->len = static_cast<uint32_t>(send.length);
+        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        if (send.zeroCopy && m_ring->registeredSends) {
+            sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+            sqe->buf_index = 0;
+        }
+        // a failed send cancels the rest of the chain, nothing goes out of order
+        if (i + 1 < slot.chain.size()) sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = userData(slot.index, SEND);
+    }
+    m_ring->submit();
+    m_sendChains.fetch_add(1, std::memory_order_relaxed);
+    m_sends.fetch_add(slot.chain.size(), std::memory_order_relaxed);
+}
+
+WSCUringReactor::Statistics WSCUringReactor::statistics() const noexcept {
+    Statistics statistics{};
+    if (m_ring) {
+        statistics.enters = m_ring->enters.load(std::memory_order_relaxed);
+        statistics.completions = m_ring->completions.load(std::memory_order_relaxed);
+    }
+    statistics.receives = m_receives.load(std::memory_order_relaxed);
+    statistics.rearms = m_rearms.load(std::memory_order_relaxed);
+    statistics.sendChains = m_sendChains.load(std::memory_order_relaxed);
+    statistics.sends = m_sends.load(std::memory_order_relaxed);
+    statistics.directSends = m_directSends.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+#else  // no io_uring, every transport falls back to WSCPocoTransport
+
+struct WSCUringReactor::Ring {};
+
+WSCUringReactor::WSCUringReactor(const Config &config) : m_config(config) {
+    m_unavailableReason = "io_uring is not supported on this system";
+}
+
+WSCUringReactor::~WSCUringReactor() = default;
+
+WSCUringReactor::Slot *WSCUringReactor::attach(int) { return nullptr; }
+void WSCUringReactor::detach(Slot *) {}
+void WSCUringReactor::setReceiver(Slot &, std::function<void()>) {}
+void WSCUringReactor::reapFor(std::chrono::microseconds) {}
+size_t WSCUringReactor::read(Slot &, char *, size_t, const Poco::Timespan &) { return 0; }
+WSCTransport::Wait WSCUringReactor::waitReadable(Slot &, const Poco::Timespan &, bool) {
+    return WSCTransport::Wait::READABLE;
+}
+void WSCUringReactor::wakeUp(Slot &) {}
+char *WSCUringReactor::reserve(Slot &, size_t, const Poco::Timespan &) { return nullptr; }
+void WSCUringReactor::commit(Slot &, size_t) {}
+void WSCUringReactor::flush(Slot &) {}
+void WSCUringReactor::drain(Slot &, const Poco::Timespan &) {}
+void WSCUringReactor::submitChain(Slot &) {}
+void WSCUringReactor::sendDirect(Slot &) {}
+void WSCUringReactor::armReceive(Slot &) {}
+WSCUringReactor::Statistics WSCUringReactor::statistics() const noexcept { return {}; }
+
+#endif
+
+WSCTransportFactory WSCUringReactor::transportFactory() {
+    return [this]() -> std::unique_ptr<WSCTransport> {
+        return std::make_unique<WSCUringTransport>(*this);
+    };
+}
+
+// ================================== TRANSPORT ==================================
+
+WSCUringTransport::~WSCUringTransport() {
+    if (m_slot) m_reactor.detach(m_slot);
+}
+
+void WSCUringTransport::connect(const Options &options, Poco::Net::HTTPRequest &request,
+                                Poco::Net::HTTPResponse &response) {
+    m_poco.connect(options, request, response);
+    if (options.secure || !m_reactor.available() ||
+        response.getStatus() != Poco::Net::HTTPResponse::HTTP_SWITCHING_PROTOCOLS) {
+        return;
+    }
+    m_options = options;
+    Poco::Net::WebSocket &websocket = *m_poco.socket();
+    auto &impl = *static_cast<Poco::Net::WebSocketImpl *>(websocket.impl());
+    m_slot = m_reactor.attach(impl.sockfd());
+    if (!m_slot) {
+        WSCLog(warn, "io_uring reactor full, connection uses Poco sockets");
+        return;
+    }
+
+    // What the handshake read past the response is still in Poco's buffer and goes first,
+    // the ring reads what follows from the socket. The socket is asked first: bytes arriving
+    // in between can only make the estimate larger, never leave buffered bytes behind.
+    const int queued = impl.Poco::Net::SocketImpl::available();
+    size_t handshake = static_cast<size_t>(std::max(impl.available() - queued, 0));
+    m_reader = std::make_unique<WSCFrameReader>(
+        std::max({static_cast<size_t>(options.readAheadSize), m_reactor.m_config.receiveBufferSize,
+                  handshake}),
+        options.maxPayloadSize);
+    // the reader holds all of it, and every byte asked for is there without blocking
+    while (handshake > 0) {
+        const int n = m_reader->fill([&](char *out, size_t size) {
+            return WebSocketBytes::receive(impl, out, static_cast<int>(std::min(size, handshake)));
+        });
+        if (n <= 0) break;
+        handshake -= static_cast<size_t>(n);
+    }
+    m_reactor.armReceive(*m_slot);
+}
+
+WSCTransport::Wait WSCUringTransport::waitReadable(const Poco::Timespan &timeout) {
+    if (!m_slot) return m_poco.waitReadable(timeout);
+    return m_reactor.waitReadable(*m_slot, timeout, m_reader->ready());
+}
+
+void WSCUringTransport::wakeUp() {
+    if (m_slot) {
+        m_reactor.wakeUp(*m_slot);
+    } else {
+        m_poco.wakeUp();
+    }
+}
+
+bool WSCUringTransport::setReceiver(std::function<void()> receiver) {
+    if (!m_slot) return m_poco.setReceiver(std::move(receiver));
+    if (!m_reactor.m_config.receiveOnReactor) return false;
+    m_reactor.setReceiver(*m_slot, std::move(receiver));
+    return true;
+}
+
+std::unique_lock<std::mutex> WSCUringTransport::lockSend() {
+    std::unique_lock<std::mutex> lock(m_sendMutex, std::try_to_lock);
+    if (lock.owns_lock()) return lock;
+    if (!m_reactor.onReactorThread()) {
+        lock.lock();
+        return lock;
+    }
+    // the sender holding it may wait for a send completion only this thread reaps
+    while (!lock.try_lock()) m_reactor.reapFor(std::chrono::microseconds(100));
+    return lock;
+}
+
+void WSCUringTransport::placeReceiveBuffers(int node) {
+    if (!m_slot) return m_poco.placeReceiveBuffers(node);
+    m_reader->placeOn(node);
+}
+
+int WSCUringTransport::receiveFrame(Poco::Buffer<char> &buffer, int &flags) {
+    if (!m_slot) return m_poco.receiveFrame(buffer, flags);
+    WSCFrameReader::Frame frame;
+    WSCFrameReader::Parse parse;
+    while ((parse = m_reader->next(frame)) == WSCFrameReader::Parse::NEED_MORE) {
+        if (fillReader() == 0) {
+            flags = 0;
+            return 0;
+        }
+    }
+    if (parse == WSCFrameReader::Parse::TOO_BIG) {
+        throw Poco::Net::WebSocketException("Payload too big",
+                                            Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+    }
+    buffer.append(frame.payload, frame.length);
+    flags = frame.flags;
+    return static_cast<int>(frame.length);
+}
+
+WSCTransport::Receive WSCUringTransport::receiveFrames(std::vector<FrameView> &frames) {
+    if (!m_slot) return m_poco.receiveFrames(frames);
+    const size_t before = frames.size();
+    WSCFrameReader::Parse parse = parseFrames(frames);
+    if (frames.size() == before && parse == WSCFrameReader::Parse::NEED_MORE) {
+        if (fillReader() == 0) return Receive::CLOSED;
+        parse = parseFrames(frames);
+    }
+    if (frames.size() > before) return Receive::FRAME;
+    if (parse == WSCFrameReader::Parse::TOO_BIG) {
+        throw Poco::Net::WebSocketException("Payload too big",
+                                            Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+    }
+    return Receive::TIMEOUT;
+}
+
+WSCFrameReader::Parse WSCUringTransport::parseFrames(std::vector<FrameView> &frames) {
+    WSCFrameReader::Frame frame;
+    WSCFrameReader::Parse parse;
+    while ((parse = m_reader->next(frame)) == WSCFrameReader::Parse::FRAME) {
+        frames.push_back(FrameView{frame.flags, frame.payload, frame.length});
+    }
+    return parse;
+}
+
+// Received chunks into the read-ahead buffer, 0 when the peer closed between two frames
+size_t WSCUringTransport::fillReader() {
+    const size_t n = m_reader->fill([&](char *out, size_t size) {
+        return m_reactor.read(*m_slot, out, size, m_options.receiveTimeout);
+    });
+    if (n == 0 && m_reader->buffered() > 0) {
+        throw Poco::Net::WebSocketException("Incomplete frame received",
+                                            Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+    }
+    return n;
+}
+
+bool WSCUringTransport::queueFrame(const void *payload, size_t length, int flags) {
+    const size_t size = WSCFrame::clientFrameSize(length);
+    char *out = m_reactor.reserve(*m_slot, size, m_options.sendTimeout);
+    if (!out) return false;
+    WSCFrame::encodeClientFrame(out, flags, payload, length, static_cast<uint32_t>(m_maskKeys()));
+    m_reactor.commit(*m_slot, size);
+    return true;
+}
+
+int WSCUringTransport::sendFrame(const void *buffer, int length, int flags) {
+    if (!m_slot) return m_poco.sendFrame(buffer, length, flags);
+    const auto lock = lockSend();
+    if (!queueFrame(buffer, static_cast<size_t>(length), flags)) {
+        // larger than the send slot, after what is queued
+        m_reactor.drain(*m_slot, m_options.sendTimeout);
+        return m_poco.sendFrame(buffer, length, flags);
+    }
+    m_reactor.flush(*m_slot);
+    return length;
+}
+
+size_t WSCUringTransport::sendFrames(const std::vector<FrameView> &frames) {
+    if (!m_slot) return m_poco.sendFrames(frames);
+    const auto lock = lockSend();
+    for (const FrameView &frame : frames) {
+        if (queueFrame(frame.payload, frame.length, frame.flags)) continue;
+        m_reactor.drain(*m_slot, m_options.sendTimeout);
+        m_poco.sendFrame(frame.payload, static_cast<int>(frame.length), frame.flags);
+    }
+    m_reactor.flush(*m_slot);
+    return frames.size();
+}
+
+bool WSCUringTransport::sendEncodedFrame(const char *frame, int length) {
+    if (!m_slot) return m_poco.sendEncodedFrame(frame, length);
+    const auto lock = lockSend();
+    const auto size = static_cast<size_t>(length);
+    char *out = m_reactor.reserve(*m_slot, size, m_options.sendTimeout);
+    if (!out) return false;
+    std::memcpy(out, frame, size);
+    m_reactor.commit(*m_slot, size);
+    m_reactor.flush(*m_slot);
+    return true;
+}
+
+void WSCUringTransport::shutdown() {
+    const auto lock = lockSend();
+    // the CLOSE frame goes out after everything queued
+    if (m_slot) m_reactor.drain(*m_slot, m_options.sendTimeout);
+    m_poco.shutdown();
+}
+
+void WSCUringTransport::close() {
+    if (m_slot) {
+        m_reactor.detach(m_slot);
+        m_slot = nullptr;
+    }
+    m_poco.close();
+}
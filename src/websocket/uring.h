@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "transport.h"
+
+// io_uring reactor for WSC connections on Linux. One ring and one thread serve every
+// connection attached to the reactor:
+//   - receives are multishot: one armed request per socket delivers every arriving chunk into
+//     a buffer the kernel picks from a shared ring of provided buffers, no recv() per read
+//   - the reactor thread parses the frames and runs the callbacks of WSC right where the
+//     completion arrived, there is no receive thread per connection to wake up. A slow
+//     callback holds up every connection of the reactor, WSC::Config::dispatcher moves the
+//     callbacks to a worker pool.
+//   - frames are written into a slot of one registered send arena. While the socket takes
+//     them they are sent right away; what queues up behind a full socket goes out as a chain
+//     of linked sends, large frames zero copy straight from the arena, and the reactor
+//     submits the next chain when the previous completed
+//
+//   WSCUringReactor reactor;  // outlives every connection using it
+//   WSC::Config config;
+//   config.transportFactory = reactor.transportFactory();
+//
+// Where io_uring is not available (other systems, kernels before 6.0, seccomp filters) the
+// transports fall back to WSCPocoTransport, so do TLS connections and connections beyond
+// Config::maxConnections.
+class WSCUringReactor {
+   public:
+    struct Config {
+        int maxConnections;        // registered send slots
+        size_t sendSlotSize;       // registered send buffer per connection, larger frames
+                                   // are sent through Poco
+        size_t zeroCopySize;       // frames from this size on are sent zero copy
+        int receiveBuffers;        // provided receive buffers, rounded up to a power of two
+        size_t receiveBufferSize;  // bytes per receive buffer
+        int ringEntries;           // submission queue entries
+        bool receiveOnReactor;     // false: WSC reads on a receive thread per connection
+
+        Config()
+            : maxConnections(1024),
+              sendSlotSize(32 * 1024),       // 32KB
+              zeroCopySize(8 * 1024),        // 8KB, below pinning pages costs more than copying
+              receiveBuffers(1024),
+              receiveBufferSize(16 * 1024),  // 16KB
+              ringEntries(1024),
+              receiveOnReactor(true) {}
+    };
+
+    struct Statistics {
+        uint64_t enters;       // io_uring_enter() calls, submitting and waiting
+        uint64_t completions;  // completion queue entries reaped
+        uint64_t receives;     // completions carrying received bytes
+        uint64_t rearms;       // multishot receives armed again after the buffers ran out
+        uint64_t sendChains;   // linked send chains submitted
+        uint64_t sends;        // sends in those chains, one per run of frames or zero copy frame
+        uint64_t directSends;  // send() calls while no chain was in flight
+    };
+
+    explicit WSCUringReactor(const Config &config = Config{});
+    ~WSCUringReactor();
+
+    WSCUringReactor(const WSCUringReactor &) = delete;
+    WSCUringReactor &operator=(const WSCUringReactor &) = delete;
+
+    // Whether the ring was set up, otherwise unavailableReason() tells why
+    bool available() const noexcept { return m_ring != nullptr; }
+    const std::string &unavailableReason() const noexcept { return m_unavailableReason; }
+
+    // For WSC::Config::transportFactory
+    WSCTransportFactory transportFactory();
+
+    Statistics statistics() const noexcept;
+
+   private:
+    friend class WSCUringTransport;
+    struct Ring;
+
+    // A send of a chain, an offset into the slot's send buffer
+    struct Send {
+        size_t offset;
+        size_t length;
+        bool zeroCopy;
+    };
+
+    // A received chunk inside a provided buffer
+    struct Chunk {
+        uint16_t buffer;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // Per connection state shared between the reactor thread and the connection
+    struct Slot {
+        int index = 0;
+        int fd = -1;
+        char *sendBuffer = nullptr;  // sendSlotSize bytes inside the registered arena
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<Chunk> inbox;
+        bool receiving = false;  // the multishot receive is armed
+        bool starved = false;    // it ended for lack of buffers, rearmed on release
+        bool closed = false;     // the peer closed or detach() cancelled the receive
+        int error = 0;           // errno of a failed receive
+        bool wakeUp = false;
+        std::function<void()> receiver;  // runs on the reactor thread, see setReceiver()
+        bool delivering = false;         // the receiver runs
+        bool readable = false;           // queued in m_readable
+
+        std::condition_variable sent;  // send completions, the receiver keeps sleeping
+        size_t sendEnd = 0;        // bytes written into sendBuffer, reset when all were sent
+        std::vector<Send> queued;  // written, waiting for the chain in flight
+        std::vector<Send> chain;   // in flight
+        int sendsPending = 0;      // completions the chain still waits for
+        size_t sentBytes = 0;
+        int sendError = 0;         // errno of a failed send, the connection is done then
+    };
+
+    // Takes a slot for the socket, receiving starts with armReceive()
+    Slot *attach(int fd);
+    void detach(Slot *slot);
+
+    // Calls receiver on the reactor thread whenever input for the slot arrived. nullptr stops
+    // the calls and waits for one running, unless it is the reactor thread itself that asks.
+    void setReceiver(Slot &slot, std::function<void()> receiver);
+    bool onReactorThread() const noexcept {
+        return std::this_thread::get_id() == m_thread.get_id();
+    }
+    // Processes completions from the reactor thread while it waits inside a receiver:
+    // nobody else would reap what it waits for
+    void reapFor(std::chrono::microseconds timeout);
+    // Waits with slot.mutex held by lock. unlimited: a timeout of 0 waits without a limit
+    // as for sockets, otherwise it only checks ready() once.
+    template <typename Ready>
+    bool await(std::condition_variable &changed, std::unique_lock<std::mutex> &lock,
+               const Poco::Timespan &timeout, bool unlimited, Ready &&ready);
+
+    // Copies received bytes to out, waits up to timeout for them. 0 once the peer closed.
+    size_t read(Slot &slot, char *out, size_t size, const Poco::Timespan &timeout);
+    // buffered: the transport holds a complete frame already
+    WSCTransport::Wait waitReadable(Slot &slot, const Poco::Timespan &timeout, bool buffered);
+    void wakeUp(Slot &slot);
+
+    // Space for size bytes in the slot's send buffer, waits while it is full. nullptr when
+    // size exceeds the slot. commit() queues what was written there, flush() submits it.
+    char *reserve(Slot &slot, size_t size, const Poco::Timespan &timeout);
+    void commit(Slot &slot, size_t size);
+    void flush(Slot &slot);
+    // Waits until everything queued was sent
+    void drain(Slot &slot, const Poco::Timespan &timeout);
+    void submitChain(Slot &slot);
+    void sendDirect(Slot &slot);
+
+    bool setUp(Ring &ring);
+    void run();
+    void reap();
+    void deliver();
+    void complete(uint64_t userData, int result, uint32_t flags);
+    void armReceive(Slot &slot);
+    void releaseBuffer(uint16_t buffer);
+
+    const Config m_config;
+    std::string m_unavailableReason;
+    std::unique_ptr<Ring> m_ring;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::mutex m_slotsMutex;
+    std::vector<int> m_freeSlots;
+
+    std::mutex m_buffersMutex;  // producer side of the provided buffer ring
+    std::vector<Slot *> m_starved;
+
+    std::vector<Slot *> m_readable;  // receivers to call, reactor thread only
+
+    std::atomic<uint64_t> m_receives{0};
+    std::atomic<uint64_t> m_rearms{0};
+    std::atomic<uint64_t> m_sendChains{0};
+    std::atomic<uint64_t> m_sends{0};
+    std::atomic<uint64_t> m_directSends{0};
+};
+
+// Transport of a WSCUringReactor. The opening handshake goes through Poco, afterwards the
+// socket is served by the reactor. Without a reactor slot or with TLS everything stays with
+// the WSCPocoTransport inside.
+class WSCUringTransport final : public WSCTransport {
+   public:
+    explicit WSCUringTransport(WSCUringReactor &reactor) : m_reactor(reactor) {}
+    ~WSCUringTransport() override;
+
+    void connect(const Options &options, Poco::Net::HTTPRequest &request,
+                 Poco::Net::HTTPResponse &response) override;
+
+    int sendFrame(const void *buffer, int length, int flags) override;
+    size_t sendFrames(const std::vector<FrameView> &frames) override;
+    bool sendEncodedFrame(const char *frame, int length) override;
+
+    int receiveFrame(Poco::Buffer<char> &buffer, int &flags) override;
+    bool batches() const noexcept override { return m_slot || m_poco.batches(); }
+    Receive receiveFrames(std::vector<FrameView> &frames) override;
+
+    Wait waitReadable(const Poco::Timespan &timeout) override;
+    void wakeUp() override;
+
+    void shutdown() override;
+    void close() override;
+
+    // On the reactor thread, unless Config::receiveOnReactor is off
+    bool setReceiver(std::function<void()> receiver) override;
+
+    Poco::Net::WebSocket *socket() noexcept override { return m_poco.socket(); }
+    KernelTls kernelTls() const noexcept override { return m_poco.kernelTls(); }
+    // The frame buffer, the provided buffers are shared by every connection of the reactor
+    void placeReceiveBuffers(int node) override;
+
+    // Whether the reactor serves this connection
+    bool onRing() const noexcept { return m_slot != nullptr; }
+
+   private:
+    // Writes the masked client frame to the send slot, false when it is larger than the slot
+    bool queueFrame(const void *payload, size_t length, int flags);
+    size_t fillReader();
+    WSCFrameReader::Parse parseFrames(std::vector<FrameView> &frames);
+    // The reactor thread must not sleep on a sender that waits for the reactor
+    std::unique_lock<std::mutex> lockSend();
+
+    WSCUringReactor &m_reactor;
+    WSCPocoTransport m_poco;
+    WSCUringReactor::Slot *m_slot = nullptr;
+    Options m_options{};
+    std::unique_ptr<WSCFrameReader> m_reader;
+
+    std::mutex m_sendMutex;  // one send slot, WSC sends from several threads
+    std::mt19937 m_maskKeys{std::random_device{}()};
+};
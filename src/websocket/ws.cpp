@@ -1,6 +1,14 @@
 #include "ws.h"
 
-WSC::WSC(const std::string &url, const Config &config) : m_url(url), m_config(config) {
+#include "WSCThread.h"
+#include "metrics.h"
+
+namespace {
+    std::atomic<uint64_t> g_nextConnectionId{1};
+}
+
+WSC::WSC(const std::string &url, const Config &config)
+    : m_url(url), m_config(config), m_id(g_nextConnectionId.fetch_add(1)) {
     if (url.empty()) {
         throw std::invalid_argument("Empty URL provided");
     }
@@ -12,17 +20,27 @@ WSC::WSC(const std::string &url, const Config &config) : m_url(url), m_config(co
 
     m_messageQueue = std::make_unique<MessageQueue>();
     m_commandQueue = std::make_unique<CommandQueue>();
+    if (m_config.dispatcher) {
+        m_strand = m_config.dispatcher->makeStrand(
+            m_config.dispatchMaxInFlight,
+            [this](const WSCMessage &message, bool control) { invokeCallback(message, control); });
+    }
     startWSCommandThread();
+    WSCMetrics::registerConnection(this);
 }
 
 WSC::~WSC() {
     WSCLog(debug, "Destroying WSC");
-    stopThreads();
+    WSCMetrics::unregisterConnection(this);
+    // the command thread may itself be stopping the I/O threads (disconnect, error), it has
+    // to finish before they are joined here
     stopWSCommandThread();
+    stopThreads();
     if (m_state == State::CONNECTED) {
         updateState(State::DISCONNECTED);
     }
     cleanupResources();
+    if (m_strand) m_strand->close();  // the callbacks may still run until here
     m_commandQueue.reset();
     m_messageQueue.reset();
 }
@@ -60,6 +78,7 @@ bool WSC::sendPing() {
 
 bool WSC::sendText(std::string &message) {
     if (m_state != State::CONNECTED) return false;
+    WSCTraceInstant("enqueue", m_id, message.size());
     std::vector<unsigned char> payload(message.begin(), message.end());
     m_messageQueue->push(WSCMessage{WSCMessageType::TEXT, payload});
     return true;
@@ -67,12 +86,29 @@ bool WSC::sendText(std::string &message) {
 
 bool WSC::sendBinary(const std::vector<uint8_t> &data) {
     if (m_state != State::CONNECTED) return false;
+    WSCTraceInstant("enqueue", m_id, data.size());
     m_messageQueue->push(WSCMessage{WSCMessageType::BINARY, data});
     return true;
 }
 
+bool WSC::sendShared(const std::shared_ptr<const WSCFrame> &frame) {
+    if (m_state != State::CONNECTED || !frame) return false;
+    WSCTraceInstant("enqueue", m_id, frame->payloadSize());
+    WSCMessage message;
+    message.type = static_cast<WSCMessageType>(frame->opcode());
+    message.frame = frame;
+    m_messageQueue->push(std::move(message));
+    return true;
+}
+
 // ================================== PRIVATE METHODS =================================
 
+void WSC::placeThread(const std::string &name, const std::vector<int> &cpus) {
+    WSCThread::setName(name);
+    if (cpus.empty()) return;
+    if (!WSCThread::pin(cpus)) WSCLog(warn, "Failed to pin thread {} to its CPUs", name);
+}
+
 // ================================= CALLBACK THREAD =================================
 
 void WSC::startWSCommandThread() {
@@ -83,11 +119,12 @@ void WSC::startWSCommandThread() {
 }
 
 void WSC::wsCommandLoop() {
+    placeThread("wsc-cmd-" + std::to_string(m_id), m_config.controlCpus);
     while (m_WSCommandThreadRunning) {
         try {
             Command command;
             m_commandQueue->wait_and_pop(command);
-            WSCLog(debug, "WSCommand: " + command.command);
+            WSCLog(debug, "WSCommand: {}", command.command);
             if (command.command == "connect") {
                 establishWebsocketConnection();
             } else if (command.command == "disconnect") {
@@ -97,6 +134,8 @@ void WSC::wsCommandLoop() {
             } else if (command.command == "ping") {
                 if (m_state == State::CONNECTED) {
                     sendFrame(nullptr, 0, WSCMessageType::PING);
+                    m_counters.pingsSent.fetch_add(1, std::memory_order_relaxed);
+                    m_counters.lastPingTime.store(systemNowNs(), std::memory_order_relaxed);
                     if (m_controlMessageCallback) {
                         m_controlMessageCallback(WSCMessage{
                             WSCMessageType::SENT, std::vector<uint8_t>({'P', 'I', 'N', 'G'})});
@@ -106,13 +145,13 @@ void WSC::wsCommandLoop() {
             } else if (command.command == "error") {
                 std::string reason =
                     command.reason.empty() ? "No reason provided" : command.reason;
-                WSCLog(error, "Error: " + command.message + " - Reason: " + reason);
+                WSCLog(error, "Error: {} - Reason: {}", command.message, reason);
                 updateState(State::WS_ERROR, command.message);
             } else if (command.command == "exit") {
                 break;
             }
         } catch (const std::exception &e) {
-            WSCLog(error, "WSCommand thread error: " + std::string(e.what()));
+            WSCLog(error, "WSCommand thread error: {}", e.what());
             updateState(State::WS_ERROR, e.what());
         }
     }
@@ -139,25 +178,90 @@ void WSC::startSendThread() {
 }
 
 void WSC::sendLoop() {
+    placeThread("wsc-send-" + std::to_string(m_id), m_config.sendCpus);
+    WSCTrace::setThreadName("WSC send #" + std::to_string(m_id));
     while (m_sendThreadRunning) {
         try {
             WSCMessage m_message;
-            m_messageQueue->try_pop(m_message);
+            if (!m_messageQueue->wait_and_pop(m_message, [this] { return !m_sendThreadRunning; })) {
+                continue;
+            }
             if (m_message.type != WSCMessageType::UNINITIALIZED && m_state == State::CONNECTED) {
-                sendFrame(m_message.payload.data(), m_message.payload.size(), m_message.type);
+                if (isBatchable(m_message)) {
+                    sendBatch(std::move(m_message));
+                } else {
+                    sendMessage(m_message);
+                }
             }
         } catch (const std::exception &e) {
             m_commandQueue->push(
                 Command{"error", "Error happened while sending message", std::string(e.what())});
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     WSCLog(debug, "Send Thread Loop stopped");
 }
 
+void WSC::sendMessage(const WSCMessage &message) {
+    if (message.frame) {
+        WSCTraceInstant("dequeue", m_id, message.frame->payloadSize());
+        sendSharedFrame(*message.frame);
+        updateStatistics(true, message.frame->payloadSize());
+    } else {
+        WSCTraceInstant("dequeue", m_id, message.payload.size());
+        sendFrame(message.payload.data(), message.payload.size(), message.type);
+        updateStatistics(true, message.payload.size());
+    }
+}
+
+// A single frame message, several of them can go to the transport in one call
+bool WSC::isBatchable(const WSCMessage &message) const {
+    return !message.frame && message.type != WSCMessageType::UNINITIALIZED &&
+           message.payload.size() <= static_cast<size_t>(m_config.sendChunkSize);
+}
+
+// Sends first and the batchable messages queued behind it with one sendFrames() call, the
+// first message that does not fit the batch follows on its own
+void WSC::sendBatch(WSCMessage &&first) {
+    constexpr size_t kMaxBatch = 64;
+    m_sendBatch.clear();
+    m_sendBatch.push_back(std::move(first));
+    WSCMessage next;
+    bool pending = false;
+    while (m_sendBatch.size() < kMaxBatch && m_messageQueue->try_pop(next)) {
+        if (!isBatchable(next)) {
+            pending = next.type != WSCMessageType::UNINITIALIZED;
+            break;
+        }
+        m_sendBatch.push_back(std::move(next));
+    }
+
+    m_sendFrames.clear();
+    for (const auto &message : m_sendBatch) {
+        m_sendFrames.push_back(WSCTransport::FrameView{
+            message.type | WSCMessageType::FIN,
+            reinterpret_cast<const char *>(message.payload.data()), message.payload.size()});
+    }
+    WSCTraceScope("sendBatch", m_id, m_sendFrames.size());
+    try {
+        m_transport->sendFrames(m_sendFrames);
+        for (const auto &message : m_sendBatch) {
+            if (m_config.capture) {
+                m_config.capture->append(WSCCapture::Direction::SENT, m_id,
+                                         message.type | WSCMessageType::FIN,
+                                         message.payload.data(), message.payload.size());
+            }
+            updateStatistics(true, message.payload.size());
+        }
+    } catch (const Poco::Exception &e) {
+        m_commandQueue->push(Command{"error", "Failed to send frame", e.displayText()});
+    }
+    if (pending && m_state == State::CONNECTED) sendMessage(next);
+}
+
 void WSC::stopSendThread() {
     WSCLog(debug, "Stopping send thread");
     m_sendThreadRunning = false;
+    m_messageQueue->wake();
     if (m_sendThread && m_sendThread->joinable()) {
         m_sendThread->join();
         WSCLog(debug, "Send Thread joined");
@@ -168,167 +272,263 @@ void WSC::stopSendThread() {
 
 void WSC::startReceiveThread() {
     if (m_receiveThreadRunning) return;
-    WSCLog(debug, "Starting receive thread");
     m_receiveThreadRunning = true;
+    m_receiveErrorFrames = 0;
+    if (m_transport->setReceiver([this] { receiveReady(); })) {
+        WSCLog(debug, "Receiving on the transport's event loop");
+        // a receive thread spinning here would still wait for the event loop to wake up
+        if (m_config.busyPoll.count() > 0) {
+            WSCLog(warn, "busyPoll has no effect on a transport with an event loop");
+        }
+        return;
+    }
+    WSCLog(debug, "Starting receive thread");
     m_receiveThread = std::make_unique<std::thread>(&WSC::receiveLoop, this);
 }
 
-bool WSC::handleControlFrame(int opcode, const Poco::Buffer<char> &buffer, size_t length) {
-    switch (opcode) {
-        case WSCMessageType::PING: {
-            WSCLog(info, "PING Received");
-            std::string payload = "PING " + std::string(buffer.begin(), buffer.end());
-            if (m_controlMessageCallback) {
-                m_controlMessageCallback(WSCMessage{
-                    WSCMessageType::RECEIVED, std::vector<uint8_t>(payload.begin(), payload.end())});
-            }
-            if (m_config.autoPong) {
-                sendFrame(buffer.begin(), length, WSCMessageType::PONG);
-                WSCLog(debug, "PONG sent");
-            }
-            return true;
+// Called by the transport's event loop whenever input arrived, see startReceiveThread()
+void WSC::receiveReady() {
+    while (m_receiveThreadRunning &&
+           m_transport->waitReadable(Poco::Timespan(0)) == WSCTransport::Wait::READABLE) {
+        if (!receiveBatch(m_receiveErrorFrames)) {
+            m_transport->setReceiver(nullptr);
+            return;
         }
+    }
+}
 
-        case WSCMessageType::PONG: {
-            WSCLog(info, "PONG Received");
-            std::string payload = "PONG " + std::string(buffer.begin(), buffer.end());
-            if (m_controlMessageCallback) {
-                m_controlMessageCallback(WSCMessage{
-                    WSCMessageType::RECEIVED, std::vector<uint8_t>(payload.begin(), payload.end())});
-            }
-            m_pongNotReceivedCount = 0;
-            return true;
-        }
+// WSCProtocol's sink: statistics, the callbacks, autoPong and the keepalive bookkeeping
+struct WSC::ProtocolEvents {
+    WSC &wsc;
 
-        case WSCMessageType::CLOSE: {
-            WSCLog(info, "CLOSE Received");
-            if (length < 2) {
-                WSCLog(error, "Invalid CLOSE frame received");
-                return false;
-            }
-            handleClose(static_cast<uint16_t>(static_cast<unsigned char>(buffer[0]) << 8 |
-                                              static_cast<unsigned char>(buffer[1])),
-                        length > 2 ? std::string(buffer.begin() + 2, buffer.end()) : "");
-            return true;
+    void onMessage(const WSCMessageView &message) {
+        wsc.updateStatistics(false, message.size);
+        if (wsc.m_dataBatchCallback) {
+            WSCTraceScope("batchCallback", wsc.m_id, 1);
+            wsc.m_dataBatchCallback(std::span<const WSCMessageView>(&message, 1));
+        } else if (wsc.m_dataMessageCallback) {
+            wsc.deliver(WSCMessage{message.type, std::vector<uint8_t>(
+                                                     message.data, message.data + message.size)},
+                        false);
         }
+        wsc.m_serverCrashContinuationFrame = 0;
+    }
 
-        default:
-            WSCLog(warn, "Unknown control frame type: " + std::to_string(opcode));
-            return false;
+    void onPing(std::string_view payload) {
+        WSCLog(info, "PING Received");
+        control("PING ", payload);
+        if (wsc.m_config.autoPong) {
+            wsc.sendFrame(payload.data(), payload.size(), WSCMessageType::PONG);
+            WSCLog(debug, "PONG sent");
+        }
     }
-}
 
-bool WSC::handleDataFrame(int opcode, bool isFinal, const Poco::Buffer<char> &buffer,
-                          size_t length) {
-    if (!isFinal) {
-        WSCLog(debug, "Recieving Continuation Frame");
+    void onPong(std::string_view payload) {
+        WSCLog(info, "PONG Received");
+        wsc.onPongReceived();  // before the callback, which would count into the RTT
+        control("PONG ", payload);
     }
-    if (opcode <= WSCMessageType::BINARY) {
-        if (opcode == WSCMessageType::CONTINUATION) {
-            if (m_serverCrashContinuationFrame > m_config.serverCrashContinuationFrame) {
-                return false;
-            }
-            m_serverCrashContinuationFrame++;
-            return true;
-        }
-        if (m_dataMessageCallback) {
-            m_dataMessageCallback(WSCMessage{static_cast<WSCMessageType>(opcode),
-                                             std::vector<uint8_t>(buffer.begin(), buffer.end())});
-        }
-        m_serverCrashContinuationFrame = 0;
-        return true;
+
+    void onClose(uint16_t code, std::string_view reason) {
+        WSCLog(info, "CLOSE Received");
+        wsc.handleClose(code, std::string(reason));
     }
 
-    WSCLog(warn, "Unknown data frame type: " + std::to_string(opcode) +
-                     "length: " + std::to_string(length));
-    return false;
-}
+    void control(std::string_view prefix, std::string_view payload) {
+        if (!wsc.m_controlMessageCallback) return;
+        std::vector<uint8_t> message(prefix.begin(), prefix.end());
+        message.insert(message.end(), payload.begin(), payload.end());
+        wsc.deliver(WSCMessage{WSCMessageType::RECEIVED, std::move(message)}, true);
+    }
+};
 
 void WSC::handleClose(uint16_t code, const std::string &reason) {
-    if (reason.empty()) {
-        WSCLog(debug,
-               "Closing connection: " + std::to_string(code) + " - " + "No reason provided");
-    } else {
-        WSCLog(debug, "Closing connection: " + std::to_string(code) + " - " + reason);
-    }
+    WSCLog(debug, "Closing connection: {} - {}", code,
+           reason.empty() ? "No reason provided" : reason);
     std::string closePayload = std::to_string(code) + " - " + reason;
     if (m_controlMessageCallback) {
-        m_controlMessageCallback(
-            WSCMessage{WSCMessageType::CLOSE,
-                       std::vector<uint8_t>(closePayload.begin(), closePayload.end())});
+        deliver(WSCMessage{WSCMessageType::CLOSE,
+                           std::vector<uint8_t>(closePayload.begin(), closePayload.end())},
+                true);
     }
     m_commandQueue->push(Command{"serverClose"});
     m_receiveThreadRunning = false;
 }
 
-bool WSC::processFrame(const Poco::Buffer<char> &buffer, size_t length, int flags) {
-    const int opcode = getOpcode(flags);
-    const bool isFinal = isFinalFrame(flags);
-
-    if (!isValidFrameLength(opcode, length)) {
-        WSCLog(error, "Invalid frame length for opcode: " + std::to_string(opcode));
-        return false;
+void WSC::deliver(WSCMessage &&message, bool control) {
+    if (m_strand) {
+        m_strand->post(std::move(message), control);
+    } else {
+        invokeCallback(message, control);
     }
+}
 
-    WSCLog(debug,
-           "Processing frame: "
-           "Flags=" +
-               std::to_string(flags) +
-               " "
-               "Opcode=" +
-               std::to_string(opcode) +
-               " "
-               "Final=" +
-               (isFinal ? "true" : "false") +
-               " "
-               "Length=" +
-               std::to_string(length));
-
-    // Handle control frames (PING, PONG, CLOSE)
-    if (opcode >= WSCMessageType::CLOSE) {
-        return handleControlFrame(opcode, buffer, length);
+void WSC::invokeCallback(const WSCMessage &message, bool control) {
+    if (control) {
+        WSCTraceScope("controlCallback", m_id, message.payload.size());
+        if (m_controlMessageCallback) m_controlMessageCallback(message);
+    } else {
+        WSCTraceScope("dataCallback", m_id, message.payload.size());
+        if (m_dataMessageCallback) m_dataMessageCallback(message);
     }
+}
 
-    // Handle data frames (TEXT, BINARY, CONTINUATION)
-    return handleDataFrame(opcode, isFinal, buffer, length);
+bool WSC::processFrame(const char *payload, size_t length, int flags) {
+    WSCTraceScope("processFrame", m_id, length);
+    WSCLog(debug, "Processing frame: Flags={} Opcode={} Final={} Length={}", flags,
+           getOpcode(flags), isFinalFrame(flags), length);
+    if (m_protocol.handle(flags, payload, length, ProtocolEvents{*this}) ==
+        WSCProtocol::Result::INVALID) {
+        WSCLog(error, "Invalid frame: {}", m_protocol.error());
+        return false;
+    }
+    return true;
 }
 
 void WSC::receiveLoop() {
+    placeThread("wsc-recv-" + std::to_string(m_id), m_config.receiveCpus);
+    WSCTrace::setThreadName("WSC receive #" + std::to_string(m_id));
+    if (!m_config.receiveCpus.empty()) {
+        // before the first read touches the buffer pages
+        const int node = WSCThread::numaNode();
+        if (node >= 0) m_transport->placeReceiveBuffers(node);
+    }
+    if (m_config.busyPoll.count() > 0 && m_config.receiveCpus.empty()) {
+        WSCLog(warn, "Busy polling receive thread is not pinned, set receiveCpus");
+    }
     int errorFrameCount = 0;
     while (m_receiveThreadRunning) {
-        try {
-            Poco::Buffer<char> buffer(0);
-            int flags;
-            int n = m_websocket->receiveFrame(buffer, flags);
+        if (waitForInput() != WSCTransport::Wait::READABLE) continue;
+        const bool keepReading = m_dataBatchCallback && m_transport->batches()
+                                     ? receiveBatch(errorFrameCount)
+                                     : receiveSingle(errorFrameCount);
+        if (!keepReading) break;
+    }
+    WSCLog(debug, "Receive Thread Loop stopped");
+}
 
-            if (!processFrame(buffer, n, flags)) {
-                if (m_serverCrashContinuationFrame > m_config.serverCrashContinuationFrame) {
-                    m_commandQueue->push(Command{"error", "Server crash detected"});
-                    break;
-                }
-                errorFrameCount++;
-                if (errorFrameCount > 10) {
-                    m_commandQueue->push(Command{"error", "Too many error frames received"});
-                    break;
-                }
-            } else {
-                errorFrameCount = 0;
-            }
-        } catch (Poco::Exception &exc) {
-            if (exc.code() == POCO_EAGAIN || exc.code() == POCO_ETIMEDOUT ||
-                exc.displayText() == "Timeout") {
-                // ignore timeout - caused by receive timeout
-                continue;
-            }
-            m_commandQueue->push(Command{"error", "Failed to receive frame", exc.displayText()});
+// Idle connections sleep in poll, disconnect() ends the wait with wakeUp(). In busy-poll
+// mode the thread first polls without a timeout until Config::busyPoll passed.
+WSCTransport::Wait WSC::waitForInput() {
+    if (m_config.busyPoll.count() > 0) {
+        const auto until = std::chrono::steady_clock::now() + m_config.busyPoll;
+        do {
+            const auto wait = m_transport->waitReadable(Poco::Timespan(0));
+            if (wait != WSCTransport::Wait::TIMEOUT) return wait;
+        } while (m_receiveThreadRunning && std::chrono::steady_clock::now() < until);
+    }
+    return m_transport->waitReadable(m_config.receiveTimeout);
+}
+
+bool WSC::receiveSingle(int &errorFrameCount) {
+    m_receiveBuffer.resize(0);
+    int flags = 0;
+    int n = 0;
+    const auto status = m_transport->receive(m_receiveBuffer, flags, n, m_receiveError);
+    if (status == WSCTransport::Receive::TIMEOUT) return true;
+    if (status == WSCTransport::Receive::FAILED) {
+        m_commandQueue->push(Command{"error", "Failed to receive frame", m_receiveError});
+        return true;
+    }
+    WSCTraceInstant("receive", m_id, n);
+    if (status == WSCTransport::Receive::CLOSED) return connectionEnded(errorFrameCount);
+    m_lastReceiveNs.store(steadyNowNs(), std::memory_order_release);
+    if (m_config.capture) {
+        m_config.capture->append(WSCCapture::Direction::RECEIVED, m_id, flags,
+                                 m_receiveBuffer.begin(), n);
+    }
+    return checkProcessed(processFrame(m_receiveBuffer.begin(), n, flags), errorFrameCount);
+}
+
+// Complete TEXT and BINARY frames of one read go to the batch callback as views into the
+// transport buffer, control frames and fragments through processFrame() in between. Without
+// a batch callback every frame goes through processFrame().
+bool WSC::receiveBatch(int &errorFrameCount) {
+    m_frames.clear();
+    const auto status = m_transport->receiveBatch(m_frames, m_receiveError);
+    if (status == WSCTransport::Receive::TIMEOUT) return true;
+    if (status == WSCTransport::Receive::FAILED) {
+        m_commandQueue->push(Command{"error", "Failed to receive frame", m_receiveError});
+        return true;
+    }
+    if (status == WSCTransport::Receive::CLOSED) return connectionEnded(errorFrameCount);
+    WSCTraceInstant("receiveBatch", m_id, m_frames.size());
+    // proof of life when read, however long the callbacks take
+    m_lastReceiveNs.store(steadyNowNs(), std::memory_order_release);
+    m_views.clear();
+    for (const auto &frame : m_frames) {
+        if (m_config.capture) {
+            m_config.capture->append(WSCCapture::Direction::RECEIVED, m_id, frame.flags,
+                                     frame.payload, frame.length);
+        }
+        const int opcode = getOpcode(frame.flags);
+        if (m_dataBatchCallback && isFinalFrame(frame.flags) && !m_protocol.fragmented() &&
+            (opcode == WSCMessageType::TEXT || opcode == WSCMessageType::BINARY)) {
+            m_views.push_back(WSCMessageView{static_cast<WSCMessageType>(opcode),
+                                             reinterpret_cast<const uint8_t *>(frame.payload),
+                                             frame.length});
+            continue;
+        }
+        deliverViews();  // keeps the messages in order with the control callbacks
+        if (!checkProcessed(processFrame(frame.payload, frame.length, frame.flags),
+                            errorFrameCount)) {
+            return false;
         }
     }
-    WSCLog(debug, "Receive Thread Loop stopped");
+    if (!m_views.empty()) {
+        deliverViews();
+        errorFrameCount = 0;
+    }
+    return true;
+}
+
+// The transport read the end of the stream without a CLOSE frame, and keeps reading it.
+// After Config::serverCrashContinuationFrame of them the server counts as crashed.
+bool WSC::connectionEnded(int &errorFrameCount) {
+    return checkProcessed(
+        m_serverCrashContinuationFrame++ <= m_config.serverCrashContinuationFrame,
+        errorFrameCount);
+}
+
+// false when the connection has to be given up
+bool WSC::checkProcessed(bool processed, int &errorFrameCount) {
+    if (processed) {
+        errorFrameCount = 0;
+        return true;
+    }
+    if (m_serverCrashContinuationFrame > m_config.serverCrashContinuationFrame) {
+        m_commandQueue->push(Command{"error", "Server crash detected"});
+        return false;
+    }
+    if (++errorFrameCount > 10) {
+        m_commandQueue->push(Command{"error", "Too many error frames received"});
+        return false;
+    }
+    return true;
+}
+
+void WSC::deliverViews() {
+    if (m_views.empty()) return;
+    size_t bytes = 0;
+    for (const auto &view : m_views) bytes += view.size;
+    m_counters.messagesReceived.fetch_add(m_views.size(), std::memory_order_relaxed);
+    m_counters.bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+    m_counters.lastMessageTime.store(systemNowNs(), std::memory_order_relaxed);
+    m_serverCrashContinuationFrame = 0;
+    {
+        WSCTraceScope("batchCallback", m_id, m_views.size());
+        m_dataBatchCallback(std::span<const WSCMessageView>(m_views));
+    }
+    m_views.clear();
 }
 
 void WSC::stopReceiveThread() {
     WSCLog(debug, "Stopping receive thread");
     m_receiveThreadRunning = false;
+    if (m_transport) {
+        m_transport->setReceiver(nullptr);
+        m_transport->wakeUp();
+    }
     if (m_receiveThread && m_receiveThread->joinable()) {
         WSCLog(debug, "Stopping receive thread");
         m_receiveThread->join();
@@ -346,16 +546,24 @@ void WSC::startPingThread() {
 }
 
 void WSC::pingLoop() {
+    placeThread("wsc-ping-" + std::to_string(m_id), m_config.controlCpus);
+    if (m_config.adaptiveKeepalive) {
+        adaptivePingLoop();
+        return;
+    }
     while (m_pingThreadRunning) {
         std::unique_lock<std::mutex> lock(m_pingMutex);
         if (m_state == State::CONNECTED) {
             // not pushing in command queue to avoid blocking
+            m_pingSentNs.store(steadyNowNs(), std::memory_order_release);
             sendFrame(nullptr, 0, WSCMessageType::PING);
+            m_counters.pingsSent.fetch_add(1, std::memory_order_relaxed);
+            m_counters.lastPingTime.store(systemNowNs(), std::memory_order_relaxed);
             if (m_controlMessageCallback) {
                 m_controlMessageCallback(
                     WSCMessage{WSCMessageType::SENT, std::vector<uint8_t>({'P', 'I', 'N', 'G'})});
             }
-            if (m_pongNotReceivedCount > m_config.pongThreshold) {
+            if (++m_pongNotReceivedCount > m_config.pongThreshold) {
                 m_commandQueue->push(Command{
                     "error",
                     "Pong not received for " + std::to_string(m_pongNotReceivedCount) + " times"});
@@ -368,6 +576,96 @@ void WSC::pingLoop() {
     WSCLog(debug, "Ping Thread Loop stopped");
 }
 
+// A PING goes out right after connecting to measure the RTT, later ones only once the link
+// has been quiet for the RTT derived idleProbeDelay(). Any inbound frame counts as proof of
+// life, and a connection that received nothing for the RTT derived pongDeadline() while a
+// PING was outstanding fails instead of after pongThreshold * pingInterval.
+void WSC::adaptivePingLoop() {
+    bool seed = true;  // a thread per connection
+    while (m_pingThreadRunning) {
+        std::unique_lock<std::mutex> lock(m_pingMutex);
+        const int64_t idleNs =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(idleProbeDelay()).count();
+        const int64_t now = steadyNowNs();
+        int64_t wakeAt = now + idleNs;
+        if (m_state == State::CONNECTED) {
+            const int64_t lastReceive = m_lastReceiveNs.load(std::memory_order_acquire);
+            const int64_t pingSent = m_pingSentNs.load(std::memory_order_acquire);
+            if (pingSent != 0) {
+                // the PING stays outstanding until its PONG, frames behind it push the
+                // deadline out
+                const auto deadline = pongDeadline();
+                const int64_t deadlineAt =
+                    std::max(pingSent, lastReceive) +
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(deadline).count();
+                if (now >= deadlineAt) {
+                    m_commandQueue->push(Command{
+                        "error", "Pong not received within " +
+                                     std::to_string(deadline.count() / 1000) + "ms"});
+                    break;
+                }
+                wakeAt = deadlineAt;
+            } else if (seed || now - lastReceive >= idleNs) {
+                seed = false;
+                m_pingSentNs.store(now, std::memory_order_release);
+                sendFrame(nullptr, 0, WSCMessageType::PING);
+                m_counters.pingsSent.fetch_add(1, std::memory_order_relaxed);
+                m_counters.lastPingTime.store(systemNowNs(), std::memory_order_relaxed);
+                if (m_controlMessageCallback) {
+                    m_controlMessageCallback(WSCMessage{
+                        WSCMessageType::SENT, std::vector<uint8_t>({'P', 'I', 'N', 'G'})});
+                }
+                wakeAt = now + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   pongDeadline())
+                                   .count();
+            } else {
+                wakeAt = lastReceive + idleNs;
+            }
+        }
+        // a PONG clears m_pingSentNs and wakes us up to schedule the next probe
+        const int64_t outstanding = m_pingSentNs.load(std::memory_order_acquire);
+        m_pingCondVar.wait_for(lock, std::chrono::nanoseconds(std::max<int64_t>(wakeAt - now, 0)),
+                               [this, outstanding] {
+                                   return !m_pingThreadRunning ||
+                                          m_pingSentNs.load(std::memory_order_acquire) !=
+                                              outstanding;
+                               });
+    }
+    WSCLog(debug, "Ping Thread Loop stopped");
+}
+
+void WSC::onPongReceived() {
+    m_pongNotReceivedCount = 0;
+    m_counters.pongsReceived.fetch_add(1, std::memory_order_relaxed);
+    m_counters.lastPongTime.store(systemNowNs(), std::memory_order_relaxed);
+    const int64_t now = steadyNowNs();
+    m_lastReceiveNs.store(now, std::memory_order_release);
+    const int64_t pingSent = m_pingSentNs.exchange(0, std::memory_order_acq_rel);
+    if (pingSent != 0) {
+        m_rtt.record(static_cast<uint64_t>(now - pingSent) / 1000);
+    }
+    m_pingCondVar.notify_one();
+}
+
+// RTT times the multiplier within [low, high], high until the first PONG came back. One
+// sample is enough: it is the RTT of this path, the clamp covers what it does not show yet.
+std::chrono::microseconds WSC::fromRtt(double multiplier, std::chrono::microseconds low,
+                                       std::chrono::microseconds high) const {
+    high = std::max(low, high);
+    if (m_rtt.count() == 0) return high;
+    const auto p99 = static_cast<double>(m_rtt.percentile(99.0));
+    return std::clamp(std::chrono::microseconds(static_cast<int64_t>(p99 * multiplier)), low,
+                      high);
+}
+
+std::chrono::microseconds WSC::pongDeadline() const {
+    return fromRtt(m_config.pongRttMultiplier, m_config.minPongTimeout, m_config.maxPongTimeout);
+}
+
+std::chrono::microseconds WSC::idleProbeDelay() const {
+    return fromRtt(m_config.idleRttMultiplier, m_config.minPingInterval, m_config.pingInterval);
+}
+
 void WSC::stopPingThread() {
     WSCLog(debug, "Stopping ping thread");
     m_pingThreadRunning = false;
@@ -381,26 +679,32 @@ void WSC::stopPingThread() {
 // ================================== HELPER METHODS ==================================
 
 bool WSC::establishWebsocketConnection() {
+    // each connection its own context: the TLS settings of one WSC never reach another
+    Poco::Net::Context::Ptr sslContext;
     if (m_isSecure) {
-        Poco::Net::Context::Ptr sslContext =
-            new Poco::Net::Context(Poco::Net::Context::TLS_CLIENT_USE,
-                                   m_config.certificatePath,  // No certificate file
-                                   m_config.privateKeyPath,   // No private key file
-                                   m_config.caLocation,       // No CA location
-                                   static_cast<Poco::Net::Context::VerificationMode>(
-                                       m_config.verificationMode),  // No verification
-                                   9,                               // Verification depth
-                                   false,                           // Don't load default CAs
-                                   m_config.cipherList              // Cipher list
-            );
-        Poco::SharedPtr<Poco::Net::InvalidCertificateHandler> certHandler =
-            new Poco::Net::AcceptCertificateHandler(false);
-        Poco::Net::SSLManager::instance().initializeClient(nullptr, certHandler, sslContext);
-        m_secureSession = std::make_unique<Poco::Net::HTTPSClientSession>(m_host, m_port);
-        m_secureSession->setTimeout(m_config.connectionTimeout);
-    } else {
-        m_session = std::make_unique<Poco::Net::HTTPClientSession>(m_host, m_port);
-        m_session->setTimeout(m_config.connectionTimeout);
+        // Poco sets up OpenSSL in the first Context without making the others wait: contexts
+        // created at once on several command threads fail with "library has no ciphers"
+        static std::once_flag sslInitialized;
+        std::call_once(sslInitialized, [] { Poco::Net::initializeSSL(); });
+        sslContext = new Poco::Net::Context(Poco::Net::Context::TLS_CLIENT_USE,
+                                            m_config.certificatePath,  // No certificate file
+                                            m_config.privateKeyPath,   // No private key file
+                                            m_config.caLocation,       // No CA location
+                                            static_cast<Poco::Net::Context::VerificationMode>(
+                                                m_config.verificationMode),  // No verification
+                                            9,                    // Verification depth
+                                            false,                // Don't load default CAs
+                                            m_config.cipherList   // Cipher list
+        );
+        if (m_config.tlsRecords.enabled) WSCTlsRecords::install(sslContext->sslContext());
+        if (m_config.kernelTls) {
+#ifdef SSL_OP_ENABLE_KTLS
+            SSL_CTX_set_options(sslContext->sslContext(), SSL_OP_ENABLE_KTLS);
+#else
+            WSCLog(warn, "kTLS needs OpenSSL 3, TLS stays in user space");
+#endif
+        }
+        sslContext->setInvalidCertificateHandler(new Poco::Net::AcceptCertificateHandler(false));
     }
     HTTPRequest request(HTTPRequest::HTTP_GET, m_path, HTTPMessage::HTTP_1_1);
     request.set("User-Agent", m_config.userAgent);
@@ -420,21 +724,37 @@ bool WSC::establishWebsocketConnection() {
     }
 
     HTTPResponse response;
+    m_protocol.reset();
     try {
-        m_websocket = std::make_unique<Poco::Net::WebSocket>(
-            m_isSecure ? *m_secureSession : *m_session, request, response);
-        m_websocket->setSendTimeout(m_config.sendTimeout);
-        m_websocket->setReceiveTimeout(m_config.receiveTimeout);
-        m_websocket->setMaxPayloadSize(m_config.receiveMaxPayloadSize);
-        m_websocket->setSendBufferSize(m_config.sendBufferSize);
-        m_websocket->setReceiveBufferSize(m_config.receiveBufferSize);
+        m_transport = m_config.transportFactory ? m_config.transportFactory()
+                                                : std::make_unique<WSCPocoTransport>();
+        m_transport->connect(
+            WSCTransport::Options{m_host, m_port, m_isSecure, m_config.connectionTimeout,
+                                  m_config.sendTimeout, m_config.receiveTimeout,
+                                  m_config.receiveMaxPayloadSize, m_config.sendBufferSize,
+                                  m_config.receiveBufferSize, m_config.readAheadSize,
+                                  m_config.tlsRecords, m_tlsRecordSizes, sslContext},
+            request, response);
+        applySocketOptions();
+        if (m_isSecure && m_config.kernelTls) {
+            const WSCTransport::KernelTls kernelTls = m_transport->kernelTls();
+            if (kernelTls.send || kernelTls.receive) {
+                WSCLog(debug, "kTLS active, send {} receive {}", kernelTls.send,
+                       kernelTls.receive);
+            } else {
+                WSCLog(warn, "kTLS not available for {}, TLS stays in user space", m_host);
+            }
+        }
 
         //  LATER: Add more options
-        // m_websocket->setLinger - SO_LINGER used to close connection gracefully
-        // m_websocket->setKeepAlive(true)  // Keep connection alive
-        // m_websocket->setNoDelay(true);  // Disable Nagle's algorithm
+        // socket->setLinger - SO_LINGER used to close connection gracefully
+        // socket->setNoDelay(true);  // Disable Nagle's algorithm
 
         if (response.getStatus() == HTTPResponse::HTTP_SWITCHING_PROTOCOLS) {
+            m_pongNotReceivedCount = 0;
+            m_pingSentNs.store(0, std::memory_order_relaxed);
+            m_lastReceiveNs.store(steadyNowNs(), std::memory_order_relaxed);
+            m_counters.connects.fetch_add(1, std::memory_order_relaxed);
             updateState(State::CONNECTED);
             startPingThread();
             startSendThread();
@@ -445,9 +765,9 @@ bool WSC::establishWebsocketConnection() {
             throw std::runtime_error("Failed to connect to WebSocket server");
         }
     } catch (const Poco::Exception &exc) {
-        WSCLog(error, exc.displayText());
+        WSCLog(error, "{}", exc.displayText());
         if (shouldRetry()) {
-            WSCLog(warn, "Retrying connection to " + m_host);
+            WSCLog(warn, "Retrying connection to {}", m_host);
             incrementRetryCount();
             std::this_thread::sleep_for(m_config.retryDelay);
             updateState(State::UNINITIALIZED);
@@ -462,6 +782,56 @@ bool WSC::establishWebsocketConnection() {
     }
 }
 
+void WSC::applySocketOptions() {
+    Poco::Net::WebSocket *socket = m_transport->socket();
+    if (!socket) return;
+    try {
+        if (m_config.tcpKeepAlive) {
+            socket->setKeepAlive(true);
+#if defined(TCP_KEEPIDLE)
+            if (m_config.tcpKeepAliveIdle.count() > 0) {
+                socket->setOption(IPPROTO_TCP, TCP_KEEPIDLE,
+                                  static_cast<int>(m_config.tcpKeepAliveIdle.count()));
+            }
+#elif defined(TCP_KEEPALIVE)
+            if (m_config.tcpKeepAliveIdle.count() > 0) {
+                socket->setOption(IPPROTO_TCP, TCP_KEEPALIVE,
+                                  static_cast<int>(m_config.tcpKeepAliveIdle.count()));
+            }
+#endif
+#if defined(TCP_KEEPINTVL)
+            if (m_config.tcpKeepAliveInterval.count() > 0) {
+                socket->setOption(IPPROTO_TCP, TCP_KEEPINTVL,
+                                  static_cast<int>(m_config.tcpKeepAliveInterval.count()));
+            }
+#endif
+#if defined(TCP_KEEPCNT)
+            if (m_config.tcpKeepAliveCount > 0) {
+                socket->setOption(IPPROTO_TCP, TCP_KEEPCNT, m_config.tcpKeepAliveCount);
+            }
+#endif
+        }
+#if defined(TCP_USER_TIMEOUT)
+        if (m_config.tcpUserTimeout.count() > 0) {
+            socket->setOption(IPPROTO_TCP, TCP_USER_TIMEOUT,
+                              static_cast<int>(m_config.tcpUserTimeout.count()));
+        }
+#endif
+    } catch (const Poco::Exception &e) {
+        WSCLog(warn, "Failed to apply TCP keepalive options: {}", e.displayText());
+    }
+#if defined(SO_BUSY_POLL)
+    if (m_config.socketBusyPoll.count() > 0) {
+        try {
+            socket->setOption(SOL_SOCKET, SO_BUSY_POLL,
+                              static_cast<int>(m_config.socketBusyPoll.count()));
+        } catch (const Poco::Exception &e) {
+            WSCLog(warn, "Failed to set SO_BUSY_POLL: {}", e.displayText());
+        }
+    }
+#endif
+}
+
 void WSC::terminateWebsocketConnection(uint16_t code, const std::string &reason) {
     std::vector<unsigned char> payload;
     payload.reserve(2 + reason.size());
@@ -473,44 +843,68 @@ void WSC::terminateWebsocketConnection(uint16_t code, const std::string &reason)
 
 void WSC::sendFrame(const void *buffer, size_t length, int flags) {
     if (m_state != State::CONNECTED) return;
+    WSCTraceScope("sendFrame", m_id, length);
     int len = static_cast<int>(length);
+    const int firstFlags = flags;
     try {
         int totalBytesSent = 0;
         if (len > m_config.sendChunkSize) {
-            bool firstFrame = true;
+            // all chunks in one call, a transport that writes them at once fills whole TLS
+            // records and segments instead of one per chunk
+            std::vector<WSCTransport::FrameView> chunks;
+            chunks.reserve(static_cast<size_t>(len / m_config.sendChunkSize + 1));
             while (totalBytesSent < len) {
-                if (!firstFrame) {
+                if (!chunks.empty()) {
                     flags = WSCMessageType::CONTINUATION;
                 }
                 if (totalBytesSent + m_config.sendChunkSize >= len) {
                     flags |= WSCMessageType::FIN;
                 }
                 int bytesToSend = std::min<int>(m_config.sendChunkSize, len - totalBytesSent);
-                int sent = m_websocket->sendFrame(
-                    static_cast<const char *>(buffer) + totalBytesSent, bytesToSend, flags);
-                if (sent < 0) {
-                    updateState(State::WS_ERROR, "Failed to send frame");
-                }
-                firstFrame = false;
-                totalBytesSent += sent;
+                chunks.push_back(WSCTransport::FrameView{
+                    flags, static_cast<const char *>(buffer) + totalBytesSent,
+                    static_cast<size_t>(bytesToSend)});
+                totalBytesSent += bytesToSend;
             }
+            m_transport->sendFrames(chunks);
         } else {
             flags |= WSCMessageType::FIN;
-            totalBytesSent = m_websocket->sendFrame(buffer, len, flags);
+            totalBytesSent = m_transport->sendFrame(buffer, len, flags);
         }
-        if (totalBytesSent < 0 || totalBytesSent != len) {
-            updateState(State::WS_ERROR, "Failed to send frame");
+        if (totalBytesSent != len) {
+            // the state changes on the command thread, this may be the send thread it stops
+            m_commandQueue->push(Command{"error", "Failed to send frame",
+                                         std::to_string(totalBytesSent) + " of " +
+                                             std::to_string(len) + " bytes sent"});
+        } else if (m_config.capture) {
+            // the message as a whole, chunking is a property of this client
+            m_config.capture->append(WSCCapture::Direction::SENT, m_id,
+                                     getOpcode(firstFlags) | WSCMessageType::FIN, buffer, length);
         }
     } catch (const Poco::Exception &e) {
         m_commandQueue->push(Command{"error", "Failed to send frame", e.displayText()});
     }
 }
 
-bool WSC::isValidFrameLength(int opcode, size_t length) {
-    if (opcode == WSCMessageType::TEXT || opcode == WSCMessageType::BINARY) {
-        return length > 0 || !isFinalFrame(opcode);
+void WSC::sendSharedFrame(const WSCFrame &frame) {
+    if (m_state != State::CONNECTED) return;
+    WSCTraceScope("sendFrame", m_id, frame.payloadSize());
+    m_maskScratch.resize(frame.maskedSize());
+    frame.encodeMasked(m_maskScratch.data(), static_cast<uint32_t>(m_maskKeys()));
+    try {
+        if (!m_transport->sendEncodedFrame(m_maskScratch.data(),
+                                           static_cast<int>(m_maskScratch.size()))) {
+            sendFrame(frame.payload(), frame.payloadSize(), frame.opcode());
+            return;
+        }
+        if (m_config.capture) {
+            m_config.capture->append(WSCCapture::Direction::SENT, m_id,
+                                     frame.opcode() | WSCMessageType::FIN, frame.payload(),
+                                     frame.payloadSize());
+        }
+    } catch (const Poco::Exception &e) {
+        m_commandQueue->push(Command{"error", "Failed to send frame", e.displayText()});
     }
-    return true;
 }
 
 void WSC::parseURI(const std::string &url) {
@@ -546,25 +940,23 @@ void WSC::parseURI(const std::string &url) {
 void WSC::stopThreads() {
     stopSendThread();
     stopReceiveThread();
+    if (m_strand) m_strand->flush();  // as inline, every received message is delivered
     stopPingThread();
 }
 
 void WSC::cleanupResources() {
     WSCLog(debug, "Cleaning up resources");
-    if (m_websocket) {
+    if (m_transport) {
         try {
             if (m_state == State::CONNECTED) {
-                m_websocket->shutdown();
-                m_websocket->close();
+                m_transport->shutdown();
+                m_transport->close();
             }
         } catch (Poco::Exception &exc) {
-            WSCLog(error, "Error shutting down WebSocket: " + exc.displayText());
+            WSCLog(error, "Error shutting down WebSocket: {}", exc.displayText());
         }
-        m_websocket.reset();
+        m_transport.reset();
     }
-
-    m_session.reset();
-    m_secureSession.reset();
 }
 
 std::string WSC::stateToString(State state) const {
@@ -586,16 +978,54 @@ std::string WSC::stateToString(State state) const {
     }
 }
 
+void WSC::updateStatistics(bool sent, size_t bytes) {
+    if (sent) {
+        m_counters.messagesSent.fetch_add(1, std::memory_order_relaxed);
+        m_counters.bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+    } else {
+        m_counters.messagesReceived.fetch_add(1, std::memory_order_relaxed);
+        m_counters.bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    m_counters.lastMessageTime.store(systemNowNs(), std::memory_order_relaxed);
+}
+
+WSC::Statistics WSC::getStatistics() const {
+    const auto toTimePoint = [](const std::atomic<int64_t> &ns) {
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(ns.load(std::memory_order_relaxed))));
+    };
+    Statistics stats;
+    stats.messagesSent = m_counters.messagesSent.load(std::memory_order_relaxed);
+    stats.messagesReceived = m_counters.messagesReceived.load(std::memory_order_relaxed);
+    stats.bytesSent = m_counters.bytesSent.load(std::memory_order_relaxed);
+    stats.bytesReceived = m_counters.bytesReceived.load(std::memory_order_relaxed);
+    stats.pingsSent = m_counters.pingsSent.load(std::memory_order_relaxed);
+    stats.pongsReceived = m_counters.pongsReceived.load(std::memory_order_relaxed);
+    stats.errors = m_counters.errors.load(std::memory_order_relaxed);
+    stats.sendQueueDepth = m_messageQueue ? m_messageQueue->size() : 0;
+    stats.lastMessageTime = toTimePoint(m_counters.lastMessageTime);
+    stats.lastPingTime = toTimePoint(m_counters.lastPingTime);
+    stats.lastPongTime = toTimePoint(m_counters.lastPongTime);
+    stats.reconnectAttempts = m_counters.reconnectAttempts.load(std::memory_order_relaxed);
+    const uint32_t connects = m_counters.connects.load(std::memory_order_relaxed);
+    stats.reconnects = connects > 0 ? connects - 1 : 0;
+    return stats;
+}
+
 void WSC::updateState(State newState, std::string reason) {
     if (getCurrentState() == newState) {
         return;
     }
-    WSCLog(info, "State changed: " + stateToString(getCurrentState()) + " -> " +
-                     stateToString(newState));
+    WSCLog(info, "State changed: {} -> {}", stateToString(getCurrentState()),
+           stateToString(newState));
     setState(newState);
     if (m_stateChangeCallback) {
         m_stateChangeCallback(stateToString(newState));
     }
+    if (m_state == State::WS_ERROR) {
+        m_counters.errors.fetch_add(1, std::memory_order_relaxed);
+    }
     if (m_state == State::WS_ERROR || m_state == State::DISCONNECTING) {
         stopThreads();
         if (m_state == State::WS_ERROR && m_errorCallback) {
@@ -9,21 +9,31 @@
 #include <Poco/Net/WebSocket.h>
 #include <Poco/URI.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <random>
+#include <span>
 #include <string>
 #include <thread>
 
 #include "Poco/Net/AcceptCertificateHandler.h"
 #include "Poco/Net/Context.h"
 #include "Poco/Net/SSLManager.h"
+#include "WSCFrame.h"
+#include "WSCHistogram.h"
 #include "WSCLogger.h"
 #include "WSCMessage.h"
+#include "WSCProtocol.h"
 #include "WSCQueue.h"
+#include "WSCTrace.h"
+#include "capture.h"
+#include "dispatcher.h"
+#include "transport.h"
 
 using Poco::Net::HTTPClientSession;
 using Poco::Net::HTTPMessage;
@@ -66,6 +76,7 @@ class WSC {
         int receiveBufferSize;
         int sendBufferSize;
         int sendChunkSize;
+        int readAheadSize;  // bytes read at once and parsed into frames, 0 for frame by frame
 
         // Retry settings
         bool autoReconnect;
@@ -78,6 +89,12 @@ class WSC {
         std::string caLocation;
         std::string cipherList;
         int verificationMode;
+        // kTLS: after the handshake OpenSSL hands the keys to the kernel, which then encrypts
+        // and decrypts records without copies through user space. Needs OpenSSL 3, the
+        // Linux tls module and an AES-GCM or ChaCha20 cipher, otherwise TLS stays in OpenSSL.
+        bool kernelTls;
+        // Small TLS records after idle, 16KB records in sustained transfers, see WSCTlsRecords
+        WSCTlsRecords::Config tlsRecords;
 
         // Additional settings
         std::map<std::string, std::string> customHeaders;
@@ -88,6 +105,58 @@ class WSC {
         int pongThreshold;
         int serverCrashContinuationFrame;
 
+        // Keepalive settings
+        // With adaptiveKeepalive, a PING right after connecting measures the RTT. Later
+        // PINGs probe a link that has been quiet for clamp(p99 * idleRttMultiplier,
+        // minPingInterval, pingInterval), inbound traffic counts as proof of life, and the
+        // PONG deadline is clamp(p99 * pongRttMultiplier, minPongTimeout, maxPongTimeout).
+        // Until the first PONG the upper bounds apply; pongThreshold is not used. Without
+        // it, the default, a PING is sent every pingInterval and the connection fails after
+        // pongThreshold unanswered PINGs.
+        bool adaptiveKeepalive;
+        double pongRttMultiplier;
+        std::chrono::milliseconds minPongTimeout;
+        std::chrono::milliseconds maxPongTimeout;
+        double idleRttMultiplier;
+        std::chrono::milliseconds minPingInterval;
+
+        // TCP level liveness, 0 leaves the OS default untouched
+        bool tcpKeepAlive;
+        std::chrono::seconds tcpKeepAliveIdle;
+        std::chrono::seconds tcpKeepAliveInterval;
+        int tcpKeepAliveCount;
+        std::chrono::milliseconds tcpUserTimeout;  // Linux only
+
+        // Busy-poll receive: the receive thread polls the socket without sleeping for up to
+        // busyPoll since the last data before it blocks again, which saves the wake up
+        // latency at the cost of a core. Pin it with receiveCpus. 0 always blocks. Ignored
+        // by transports that receive on an event loop of their own (io_uring): the loop
+        // still sleeps in the kernel, spinning behind it only burns the core.
+        std::chrono::microseconds busyPoll;
+        // SO_BUSY_POLL, Linux only: the kernel polls the device queue for this long before
+        // a read sleeps. Values above net.core.busy_read need CAP_NET_ADMIN. io_uring
+        // receives do not busy poll on it.
+        std::chrono::microseconds socketBusyPoll;
+
+        // Creates the transport of every connection attempt, WSCPocoTransport when empty
+        WSCTransportFactory transportFactory;
+
+        // Records every frame sent and received, may be shared by many connections
+        std::shared_ptr<WSCCapture> capture;
+
+        // Runs the message callbacks on a shared worker pool instead of the receive thread,
+        // in order per connection. The receive thread waits while dispatchMaxInFlight
+        // messages of its connection are queued or running.
+        std::shared_ptr<WSCDispatcher> dispatcher;
+        int dispatchMaxInFlight;
+
+        // CPUs the threads of the connection may run on, empty leaves them to the scheduler.
+        // The read-ahead buffer moves to the NUMA node of the pinned receive thread. io_uring
+        // connections receive on the reactor thread and have no receive thread.
+        std::vector<int> receiveCpus;
+        std::vector<int> sendCpus;
+        std::vector<int> controlCpus;  // command and ping threads
+
         Config()
             : connectionTimeout(30, 0),                 // 30 seconds
               receiveTimeout(5, 0),                     // 5 seconds
@@ -97,6 +166,7 @@ class WSC {
               receiveBufferSize(64 * 1024),             // 64KB
               sendBufferSize(64 * 1024),                // 64KB
               sendChunkSize(4096),                      // 4KB
+              readAheadSize(64 * 1024),                 // 64KB, up to 1MB for busy feeds
               autoReconnect(false),
               maxRetryAttempts(3),
               retryDelay(3),
@@ -105,15 +175,37 @@ class WSC {
               caLocation(""),
               cipherList("ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH"),
               verificationMode(5),  // 0 - none, 1 - relaxed, 3 - strict, 5 - verifyOnce
+              kernelTls(false),
               userAgent("WSCpp v1.0"),
               autoPing(true),
               pongThreshold(3),
-              serverCrashContinuationFrame(10) {}
+              serverCrashContinuationFrame(10),
+              adaptiveKeepalive(false),
+              pongRttMultiplier(4.0),
+              minPongTimeout(50),    // 50ms
+              maxPongTimeout(5000),  // 5 seconds, used until the first PONG
+              idleRttMultiplier(100.0),
+              minPingInterval(200),  // 200ms
+              tcpKeepAlive(false),
+              tcpKeepAliveIdle(0),
+              tcpKeepAliveInterval(0),
+              tcpKeepAliveCount(0),
+              tcpUserTimeout(0),
+              busyPoll(0),
+              socketBusyPoll(0),
+              transportFactory(nullptr),
+              capture(nullptr),
+              dispatcher(nullptr),
+              dispatchMaxInFlight(1024),
+              receiveCpus(),
+              sendCpus(),
+              controlCpus() {}
     };
 
     // callbacks
     using ControlMessageCallback = std::function<void(const WSCMessage &message)>;
     using DataMessageCallback = std::function<void(const WSCMessage &message)>;
+    using DataBatchCallback = std::function<void(std::span<const WSCMessageView> messages)>;
     using StateChangeCallback = std::function<void(const std::string &state)>;
     using ErrorCallback = std::function<void(const std::string &message)>;
 
@@ -136,12 +228,17 @@ class WSC {
     bool sendPing();
     bool sendText(std::string &message);
     bool sendBinary(const std::vector<uint8_t> &data);
+    // Queues a frame encoded once for many connections, see WSCManager::broadcast()
+    bool sendShared(const std::shared_ptr<const WSCFrame> &frame);
 
     // set callbacks
     void setControlMessageCallback(ControlMessageCallback callback) {
         m_controlMessageCallback = callback;
     }
     void setDataMessageCallback(DataMessageCallback callback) { m_dataMessageCallback = callback; }
+    // Replaces the data callback: all messages parsed from one socket read at once, as views
+    // into the receive buffer. Always runs on the receive thread, also with a dispatcher.
+    void setDataBatchCallback(DataBatchCallback callback) { m_dataBatchCallback = callback; }
     void setStateChangeCallback(StateChangeCallback callback) { m_stateChangeCallback = callback; }
     void setErrorCallback(ErrorCallback callback) { m_errorCallback = callback; }
 
@@ -163,13 +260,27 @@ class WSC {
         uint64_t messagesReceived{0};
         uint64_t bytesSent{0};
         uint64_t bytesReceived{0};
+        uint64_t pingsSent{0};
+        uint64_t pongsReceived{0};
+        uint64_t errors{0};
+        uint64_t sendQueueDepth{0};
         std::chrono::system_clock::time_point lastMessageTime;
         std::chrono::system_clock::time_point lastPingTime;
         std::chrono::system_clock::time_point lastPongTime;
         uint32_t reconnectAttempts{0};
+        uint32_t reconnects{0};
     };
+    using RttHistogram = WSCHistogram<5, 32>;  // microseconds
 
+    // Lock-free, safe to call from any thread while the connection is running
     Statistics getStatistics() const;
+    RttHistogram::Snapshot getRttSnapshot() const { return m_rtt.snapshot(); }
+    // Sizes of the TLS records written, counted with Config::tlsRecords.enabled
+    WSCTlsRecords::SizeHistogram::Snapshot getTlsRecordSnapshot() const {
+        return m_tlsRecordSizes->snapshot();
+    }
+    uint64_t getId() const noexcept { return m_id; }
+    const std::string &getUrl() const noexcept { return m_url; }
 
    private:
     // Internal state
@@ -188,16 +299,14 @@ class WSC {
     void updateStatistics(bool sent, size_t bytes);
 
     // Connection handling
-    std::unique_ptr<Poco::Net::WebSocket> m_websocket;
-    std::unique_ptr<Poco::Net::HTTPClientSession> m_session;
-    std::unique_ptr<Poco::Net::HTTPSClientSession> m_secureSession;
+    std::unique_ptr<WSCTransport> m_transport;
 
     // Threading and its management
     bool m_WSCommandThreadRunning = false;
-    bool m_sendThreadRunning = false;
+    std::atomic<bool> m_sendThreadRunning{false};  // also the message queue wait checks it
     bool m_receiveThreadRunning = false;
     bool m_pingThreadRunning = false;
-    int m_pongNotReceivedCount = 0;
+    std::atomic<int> m_pongNotReceivedCount = 0;
     std::unique_ptr<std::thread> m_WSCommandThread;
     std::unique_ptr<std::thread> m_sendThread;
     std::unique_ptr<std::thread> m_receiveThread;
@@ -205,6 +314,9 @@ class WSC {
     std::mutex m_pingMutex;
     std::condition_variable m_pingCondVar;
 
+    // Names the calling thread for top, perf and debuggers and pins it to cpus
+    void placeThread(const std::string &name, const std::vector<int> &cpus);
+
     void startWSCommandThread();
     void stopWSCommandThread();
     void wsCommandLoop();
@@ -215,13 +327,23 @@ class WSC {
     void startReceiveThread();
     void stopReceiveThread();
     void receiveLoop();
+    void receiveReady();
+    int m_receiveErrorFrames = 0;  // receiveReady() only
+    WSCTransport::Wait waitForInput();
+    bool receiveSingle(int &errorFrameCount);
+    bool receiveBatch(int &errorFrameCount);
+    bool checkProcessed(bool processed, int &errorFrameCount);
+    bool connectionEnded(int &errorFrameCount);
+    void deliverViews();
     void startPingThread();
     void stopPingThread();
     void pingLoop();
+    void adaptivePingLoop();
 
     // Callbacks
     ControlMessageCallback m_controlMessageCallback;
     DataMessageCallback m_dataMessageCallback;
+    DataBatchCallback m_dataBatchCallback;
     StateChangeCallback m_stateChangeCallback;
     ErrorCallback m_errorCallback;
 
@@ -230,28 +352,83 @@ class WSC {
     std::unique_ptr<CommandQueue> m_commandQueue;
 
     // Processing frames
-    bool processFrame(const Poco::Buffer<char> &buffer, size_t length, int flags);
-    bool handleControlFrame(int opcode, const Poco::Buffer<char> &buffer, size_t length);
-    bool handleDataFrame(int opcode, bool isFinal, const Poco::Buffer<char> &buffer,
-                         size_t length);
+    struct ProtocolEvents;
+    bool processFrame(const char *payload, size_t length, int flags);
     void handleClose(uint16_t code, const std::string &reason);
-
-    // Statistics
-    mutable std::mutex m_statsMutex;
-    Statistics m_stats;
+    WSCProtocol m_protocol;  // receive thread only
+
+    // Receive thread buffers, reused for every frame or batch
+    Poco::Buffer<char> m_receiveBuffer{0};
+    std::string m_receiveError;
+    std::vector<WSCTransport::FrameView> m_frames;
+    std::vector<WSCMessageView> m_views;
+
+    // Received messages go to their callback inline or through the dispatcher strand
+    std::shared_ptr<WSCDispatcher::Strand> m_strand;
+    void deliver(WSCMessage &&message, bool control);
+    void invokeCallback(const WSCMessage &message, bool control);
+
+    // Keepalive
+    static int64_t steadyNowNs() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+    std::atomic<int64_t> m_lastReceiveNs{0};
+    std::atomic<int64_t> m_pingSentNs{0};  // 0 when no PING is outstanding
+    RttHistogram m_rtt;
+    // shared with the transports, which count into it
+    const std::shared_ptr<WSCTlsRecords::SizeHistogram> m_tlsRecordSizes =
+        std::make_shared<WSCTlsRecords::SizeHistogram>();
+    void onPongReceived();
+    std::chrono::microseconds fromRtt(double multiplier, std::chrono::microseconds low,
+                                      std::chrono::microseconds high) const;
+    std::chrono::microseconds pongDeadline() const;
+    std::chrono::microseconds idleProbeDelay() const;
+    void applySocketOptions();
+
+    // Statistics, written by the I/O threads and read by getStatistics() without locking
+    struct Counters {
+        std::atomic<uint64_t> messagesSent{0};
+        std::atomic<uint64_t> messagesReceived{0};
+        std::atomic<uint64_t> bytesSent{0};
+        std::atomic<uint64_t> bytesReceived{0};
+        std::atomic<uint64_t> pingsSent{0};
+        std::atomic<uint64_t> pongsReceived{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<int64_t> lastMessageTime{0};  // system_clock nanoseconds
+        std::atomic<int64_t> lastPingTime{0};
+        std::atomic<int64_t> lastPongTime{0};
+        std::atomic<uint32_t> reconnectAttempts{0};
+        std::atomic<uint32_t> connects{0};
+    };
+    static int64_t systemNowNs() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+    const uint64_t m_id;
+    Counters m_counters;
 
     // Utility methods
     bool establishWebsocketConnection();
     void terminateWebsocketConnection(uint16_t code = 1000,
                                       const std::string &reason = "Normal closure");
     void sendFrame(const void *buffer, size_t length, int flags);
+    void sendSharedFrame(const WSCFrame &frame);
+    void sendMessage(const WSCMessage &message);
+    bool isBatchable(const WSCMessage &message) const;
+    void sendBatch(WSCMessage &&first);
+    std::vector<WSCMessage> m_sendBatch;                  // send thread only
+    std::vector<WSCTransport::FrameView> m_sendFrames;  // send thread only
+    std::vector<char> m_maskScratch;  // send thread only
+    std::mt19937 m_maskKeys{std::random_device{}()};
 
     void parseURI(const std::string &url);
     void stopThreads();
     void cleanupResources();
     int getOpcode(int flags) { return flags & WSCMessageType::OPCODE_MASK; }
     bool isFinalFrame(int flags) { return (flags & WSCMessageType::FIN) != 0; }
-    bool isValidFrameLength(int opcode, size_t length);
 
     // Retry handling
     std::atomic<int> m_retryCount = 0;
@@ -259,7 +436,10 @@ class WSC {
         return m_config.autoReconnect && m_retryCount < m_config.maxRetryAttempts;
     }
     void resetRetryCount() noexcept { m_retryCount = 0; }
-    void incrementRetryCount() noexcept { m_retryCount++; }
+    void incrementRetryCount() noexcept {
+        m_retryCount++;
+        m_counters.reconnectAttempts.fetch_add(1, std::memory_order_relaxed);
+    }
 
     // Frame composition
     // struct FrameHeader {
@@ -0,0 +1,111 @@
+// WSCByteRing: record framing, wrap-around, a full ring and one producer with one consumer
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "WSCByteRing.h"
+
+namespace {
+    std::string pop(WSCByteRing &ring) {
+        uint32_t size = 0;
+        const char *record = ring.front(size);
+        if (!record) return "<empty>";
+        std::string value(record, size);
+        ring.pop();
+        return value;
+    }
+
+    bool push(WSCByteRing &ring, const std::string &value) {
+        return ring.write(value.data(), static_cast<uint32_t>(value.size()));
+    }
+}  // namespace
+
+TEST(ByteRing, RecordsComeOutInOrder) {
+    WSCByteRing ring(1024);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(push(ring, "one"));
+    EXPECT_TRUE(push(ring, ""));
+    EXPECT_TRUE(push(ring, std::string(100, 'x')));
+    EXPECT_FALSE(ring.empty());
+    EXPECT_EQ(pop(ring), "one");
+    EXPECT_EQ(pop(ring), "");
+    EXPECT_EQ(pop(ring), std::string(100, 'x'));
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(pop(ring), "<empty>");
+}
+
+TEST(ByteRing, CapacityIsAPowerOfTwo) {
+    EXPECT_EQ(WSCByteRing(1000).capacity(), 1024u);
+    EXPECT_EQ(WSCByteRing(1).capacity(), 64u);
+}
+
+TEST(ByteRing, RecordsStayContiguousAcrossTheEnd) {
+    WSCByteRing ring(256);
+    // 40 byte records (4 length + 33 payload, padded) do not divide 256, so records wrap
+    for (int i = 0; i < 100; i++) {
+        const std::string value(33, static_cast<char>('a' + i % 26));
+        ASSERT_TRUE(push(ring, value)) << i;
+        ASSERT_EQ(pop(ring), value) << i;
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(ByteRing, FullRingRefusesUntilPopped) {
+    WSCByteRing ring(256);
+    int pushed = 0;
+    while (push(ring, std::string(24, static_cast<char>('a' + pushed)))) pushed++;
+    EXPECT_EQ(pushed, 256 / 32);
+    EXPECT_EQ(ring.reserve(0), nullptr);
+    EXPECT_EQ(pop(ring), std::string(24, 'a'));
+    EXPECT_TRUE(push(ring, std::string(24, 'z')));
+    for (int i = 1; i < pushed; i++) EXPECT_EQ(pop(ring), std::string(24, 'a' + i));
+    EXPECT_EQ(pop(ring), std::string(24, 'z'));
+}
+
+TEST(ByteRing, RejectsRecordsOverHalfTheCapacity) {
+    WSCByteRing ring(256);
+    EXPECT_EQ(ring.reserve(125), nullptr);
+    EXPECT_NE(ring.reserve(124), nullptr);
+}
+
+TEST(ByteRing, ReservedRecordIsInvisibleUntilCommitted) {
+    WSCByteRing ring(256);
+    char *record = ring.reserve(4);
+    ASSERT_NE(record, nullptr);
+    std::memcpy(record, "wxyz", 4);
+    EXPECT_TRUE(ring.empty());
+    ring.commit();
+    EXPECT_EQ(pop(ring), "wxyz");
+}
+
+TEST(ByteRing, OneProducerOneConsumer) {
+    constexpr uint64_t kRecords = 200000;
+    WSCByteRing ring(4096);
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < kRecords; i++) {
+            // sizes 8 to 71 bytes, so the wrap position keeps moving
+            std::string value(8 + i % 64, '\0');
+            std::memcpy(value.data(), &i, sizeof(i));
+            while (!push(ring, value)) std::this_thread::yield();
+        }
+    });
+    uint64_t expected = 0;
+    while (expected < kRecords) {
+        uint32_t size = 0;
+        const char *record = ring.front(size);
+        if (!record) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t value = 0;
+        ASSERT_EQ(size, 8 + expected % 64);
+        std::memcpy(&value, record, sizeof(value));
+        ASSERT_EQ(value, expected);
+        ring.pop();
+        expected++;
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
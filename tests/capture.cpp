@@ -0,0 +1,148 @@
+// WSCCapture and WSCCaptureReader: records written and read back, dropped records and the
+// recovery of a file that was never closed
+#include <gtest/gtest.h>
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture.h"
+
+namespace {
+    using Direction = WSCCapture::Direction;
+
+    void removeFile(const std::string &path) {
+        try {
+            Poco::File(path).remove();
+        } catch (const Poco::Exception &) {
+        }
+    }
+
+    std::string tempPath(const std::string &name) {
+        const std::string path = ::testing::TempDir() + "wsc-" + name + ".cap";
+        removeFile(path);
+        return path;
+    }
+}  // namespace
+
+TEST(Capture, RecordsReadBack) {
+    const std::string path = tempPath("read-back");
+    {
+        WSCCapture capture(path);
+        EXPECT_TRUE(capture.append(Direction::SENT, 1, 0x81, "hello", 5));
+        EXPECT_TRUE(capture.append(Direction::RECEIVED, 2, 0x02, "", 0));
+        const std::string large(100000, 'x');
+        EXPECT_TRUE(capture.append(Direction::RECEIVED, 2, 0x80, large.data(), large.size()));
+        capture.close();
+        EXPECT_FALSE(capture.append(Direction::SENT, 1, 0x81, "late", 4));
+    }
+    WSCCaptureReader reader(path);
+    EXPECT_TRUE(reader.complete());
+    ASSERT_EQ(reader.size(), 3u);
+    EXPECT_EQ(reader.dropped(), 0u);
+
+    const auto first = reader[0];
+    EXPECT_EQ(first.direction, Direction::SENT);
+    EXPECT_EQ(first.connection, 1u);
+    EXPECT_EQ(first.opcode(), 1);
+    EXPECT_TRUE(first.isFinal());
+    EXPECT_EQ(first.payload, "hello");
+
+    const auto second = reader[1];
+    EXPECT_EQ(second.direction, Direction::RECEIVED);
+    EXPECT_EQ(second.opcode(), 2);
+    EXPECT_FALSE(second.isFinal());
+    EXPECT_TRUE(second.payload.empty());
+    EXPECT_GE(second.timestampNs, first.timestampNs);
+
+    EXPECT_EQ(reader[2].payload, std::string(100000, 'x'));
+    EXPECT_EQ(Poco::File(path).getSize(),
+              sizeof(WSCCapture::FileHeader) + WSCCapture::recordSize(5) +
+                  WSCCapture::recordSize(0) + WSCCapture::recordSize(100000) +
+                  3 * sizeof(uint64_t));
+    removeFile(path);
+}
+
+TEST(Capture, DropsWhatDoesNotFit) {
+    const std::string path = tempPath("dropped");
+    WSCCapture::Config config;
+    config.capacity = sizeof(WSCCapture::FileHeader) + 2 * WSCCapture::recordSize(100);
+    {
+        WSCCapture capture(path, config);
+        const std::string payload(100, 'p');
+        EXPECT_TRUE(capture.append(Direction::SENT, 1, 0x81, payload.data(), payload.size()));
+        EXPECT_TRUE(capture.append(Direction::SENT, 1, 0x81, payload.data(), payload.size()));
+        EXPECT_FALSE(capture.append(Direction::SENT, 1, 0x81, payload.data(), payload.size()));
+        EXPECT_FALSE(capture.append(Direction::SENT, 1, 0x81, "x", 1));
+        EXPECT_EQ(capture.dropped(), 2u);
+    }
+    WSCCaptureReader reader(path);
+    EXPECT_EQ(reader.size(), 2u);
+    EXPECT_EQ(reader.dropped(), 2u);
+    removeFile(path);
+}
+
+TEST(Capture, ConcurrentAppends) {
+    const std::string path = tempPath("concurrent");
+    {
+        WSCCapture capture(path);
+        std::vector<std::thread> threads;
+        for (uint64_t connection = 0; connection < 4; connection++) {
+            threads.emplace_back([&capture, connection] {
+                for (uint32_t i = 0; i < 10000; i++) {
+                    capture.append(Direction::SENT, connection, 0x82, &i, sizeof(i));
+                }
+            });
+        }
+        for (auto &thread : threads) thread.join();
+    }
+    WSCCaptureReader reader(path);
+    ASSERT_EQ(reader.size(), 40000u);
+    // every connection's records in its own order
+    std::vector<uint32_t> next(4, 0);
+    for (size_t i = 0; i < reader.size(); i++) {
+        const auto record = reader[i];
+        ASSERT_EQ(record.payload.size(), sizeof(uint32_t));
+        uint32_t value;
+        std::memcpy(&value, record.payload.data(), sizeof(value));
+        ASSERT_LT(record.connection, 4u);
+        EXPECT_EQ(value, next[record.connection]++);
+    }
+    removeFile(path);
+}
+
+TEST(Capture, RecoversFileThatWasNeverClosed) {
+    const std::string path = tempPath("open");
+    const std::string copy = tempPath("crashed");
+    {
+        WSCCapture::Config config;
+        config.capacity = 1024 * 1024;
+        WSCCapture capture(path, config);
+        EXPECT_TRUE(capture.append(Direction::SENT, 7, 0x81, "one", 3));
+        EXPECT_TRUE(capture.append(Direction::RECEIVED, 7, 0x81, "two", 3));
+        // what a crash right now would leave behind: records, no index, zeros after them
+        Poco::File(path).copyTo(copy);
+    }
+    WSCCaptureReader reader(copy);
+    EXPECT_FALSE(reader.complete());
+    ASSERT_EQ(reader.size(), 2u);
+    EXPECT_EQ(reader[0].payload, "one");
+    EXPECT_EQ(reader[1].payload, "two");
+    removeFile(path);
+    removeFile(copy);
+}
+
+TEST(Capture, RejectsOtherFiles) {
+    const std::string path = tempPath("other");
+    {
+        Poco::File file(path);
+        file.createFile();
+        file.setSize(256);
+    }
+    EXPECT_THROW(WSCCaptureReader reader(path), std::runtime_error);
+    removeFile(path);
+}
@@ -0,0 +1,195 @@
+// WSCFrameReader: length encodings, reads that end anywhere in a frame, masking, payloads
+// over the limit and the compaction and growth of the read-ahead buffer
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "WSCFrame.h"
+#include "WSCFrameReader.h"
+
+namespace {
+    constexpr int kText = 0x81;    // FIN | TEXT
+    constexpr int kBinary = 0x82;  // FIN | BINARY
+
+    std::string payloadOf(size_t length, char first = 'a') {
+        std::string payload(length, '\0');
+        for (size_t i = 0; i < length; i++) payload[i] = static_cast<char>(first + i % 26);
+        return payload;
+    }
+
+    // An unmasked frame as a server sends it
+    std::string serverFrame(int flags, const std::string &payload) {
+        std::string frame(1, static_cast<char>(flags));
+        const size_t length = payload.size();
+        if (length < 126) {
+            frame += static_cast<char>(length);
+        } else if (length <= 0xFFFF) {
+            frame += static_cast<char>(126);
+            frame += static_cast<char>(length >> 8);
+            frame += static_cast<char>(length & 0xFF);
+        } else {
+            frame += static_cast<char>(127);
+            for (int i = 0; i < 8; i++) {
+                frame += static_cast<char>(static_cast<uint64_t>(length) >> (56 - 8 * i));
+            }
+        }
+        return frame + payload;
+    }
+
+    // Bytes the socket hands out, at most `chunk` per read
+    struct Wire {
+        std::string bytes;
+        size_t chunk = SIZE_MAX;
+        size_t offset = 0;
+
+        int fill(WSCFrameReader &reader) {
+            return reader.fill([this](char *out, size_t size) {
+                const size_t n = std::min({size, chunk, bytes.size() - offset});
+                std::memcpy(out, bytes.data() + offset, n);
+                offset += n;
+                return static_cast<int>(n);
+            });
+        }
+
+        // Fills until a frame is complete, fails when the wire runs dry first
+        WSCFrameReader::Parse next(WSCFrameReader &reader, WSCFrameReader::Frame &frame) {
+            WSCFrameReader::Parse parse;
+            while ((parse = reader.next(frame)) == WSCFrameReader::Parse::NEED_MORE) {
+                if (fill(reader) == 0) break;
+            }
+            return parse;
+        }
+    };
+
+    std::string payloadString(const WSCFrameReader::Frame &frame) {
+        return std::string(frame.payload, frame.length);
+    }
+
+    void expectFrame(Wire &wire, WSCFrameReader &reader, int flags, const std::string &payload) {
+        WSCFrameReader::Frame frame{};
+        ASSERT_EQ(wire.next(reader, frame), WSCFrameReader::Parse::FRAME);
+        EXPECT_EQ(frame.flags, flags);
+        EXPECT_EQ(payloadString(frame), payload);
+    }
+}  // namespace
+
+TEST(FrameReader, LengthEncodings) {
+    // 7-bit up to 125, 16-bit from 126 to 65535, 64-bit beyond
+    for (size_t length : {0, 1, 125, 126, 127, 1000, 65535, 65536, 100000}) {
+        SCOPED_TRACE(length);
+        WSCFrameReader reader(64 * 1024, 1024 * 1024);
+        Wire wire{serverFrame(kBinary, payloadOf(length))};
+        expectFrame(wire, reader, kBinary, payloadOf(length));
+        WSCFrameReader::Frame frame{};
+        EXPECT_EQ(reader.next(frame), WSCFrameReader::Parse::NEED_MORE);
+    }
+}
+
+TEST(FrameReader, ReadsEndingInsideHeaderOrPayload) {
+    const std::string small = payloadOf(10);
+    const std::string medium = payloadOf(300, 'A');
+    const std::string large = payloadOf(70000, 'k');
+    for (size_t chunk : {1, 2, 3, 7, 11, 4096}) {
+        SCOPED_TRACE(chunk);
+        WSCFrameReader reader(1024, 1024 * 1024);
+        Wire wire{serverFrame(kText, small) + serverFrame(kBinary, medium) +
+                      serverFrame(kText, large) + serverFrame(kText, small),
+                  chunk};
+        expectFrame(wire, reader, kText, small);
+        expectFrame(wire, reader, kBinary, medium);
+        expectFrame(wire, reader, kText, large);
+        expectFrame(wire, reader, kText, small);
+        EXPECT_EQ(wire.offset, wire.bytes.size());
+    }
+}
+
+TEST(FrameReader, UnmasksMaskedFrames) {
+    for (size_t length : {0, 5, 125, 126, 4000, 70000}) {
+        SCOPED_TRACE(length);
+        const std::string payload = payloadOf(length);
+        std::string frame(WSCFrame::clientFrameSize(length), '\0');
+        WSCFrame::encodeClientFrame(frame.data(), kText, payload.data(), length, 0x9A3C5E71u);
+        if (length > 0) {
+            EXPECT_EQ(frame.find(payload), std::string::npos);
+        }
+
+        WSCFrameReader reader(1024, 1024 * 1024);
+        Wire wire{frame, 333};
+        expectFrame(wire, reader, kText, payload);
+    }
+}
+
+TEST(FrameReader, RejectsPayloadOverTheLimit) {
+    WSCFrameReader reader(1024, 1000);
+    Wire wire{serverFrame(kText, payloadOf(1000)) + serverFrame(kText, payloadOf(1001))};
+    expectFrame(wire, reader, kText, payloadOf(1000));
+    WSCFrameReader::Frame frame{};
+    EXPECT_EQ(wire.next(reader, frame), WSCFrameReader::Parse::TOO_BIG);
+    EXPECT_TRUE(reader.ready());
+    // the header alone is enough to tell, the payload is never buffered
+    EXPECT_EQ(reader.capacity(), 1024u);
+
+    WSCFrameReader wide(1024, 70000);
+    Wire huge{serverFrame(kText, payloadOf(70000)).substr(0, 10) + "\x01"};
+    huge.bytes[2] = '\x7F';  // a 64-bit length far beyond any buffer
+    EXPECT_EQ(huge.next(wide, frame), WSCFrameReader::Parse::TOO_BIG);
+}
+
+TEST(FrameReader, ManyFramesFromOneRead) {
+    std::string bytes;
+    for (int i = 0; i < 50; i++) bytes += serverFrame(kText, payloadOf(10, 'a' + i % 26));
+    WSCFrameReader reader(4096, 1024);
+    Wire wire{bytes};
+    ASSERT_EQ(wire.fill(reader), static_cast<int>(bytes.size()));
+    WSCFrameReader::Frame frame{};
+    for (int i = 0; i < 50; i++) {
+        ASSERT_EQ(reader.next(frame), WSCFrameReader::Parse::FRAME);
+        EXPECT_EQ(payloadString(frame), payloadOf(10, 'a' + i % 26));
+    }
+    EXPECT_EQ(reader.next(frame), WSCFrameReader::Parse::NEED_MORE);
+    EXPECT_FALSE(reader.ready());
+    EXPECT_EQ(reader.reads(), 1u);
+}
+
+TEST(FrameReader, MovesPartialFrameToTheFront) {
+    // three 304 byte frames and the start of a fourth fill the 1024 byte buffer
+    std::string bytes;
+    for (int i = 0; i < 6; i++) bytes += serverFrame(kText, payloadOf(300, 'a' + i));
+    WSCFrameReader reader(1024, 4096);
+    char *const buffer = reader.buffer();
+    Wire wire{bytes};
+    for (int i = 0; i < 6; i++) expectFrame(wire, reader, kText, payloadOf(300, 'a' + i));
+    EXPECT_EQ(reader.buffer(), buffer);
+    EXPECT_EQ(reader.capacity(), 1024u);
+    EXPECT_EQ(wire.offset, bytes.size());
+}
+
+TEST(FrameReader, GrowsForLargeFrameAndShrinksAfterwards) {
+    const std::string large = payloadOf(5000);
+    WSCFrameReader reader(1024, 1024 * 1024);
+    Wire wire{serverFrame(kBinary, large) + serverFrame(kText, "after")};
+    wire.chunk = 1500;
+    WSCFrameReader::Frame frame{};
+    ASSERT_EQ(wire.next(reader, frame), WSCFrameReader::Parse::FRAME);
+    EXPECT_EQ(payloadString(frame), large);
+    EXPECT_GE(reader.capacity(), 5004u);
+
+    // back to the configured size with the first read after the large frame
+    expectFrame(wire, reader, kText, "after");
+    EXPECT_EQ(reader.capacity(), 1024u);
+}
+
+TEST(FrameReader, PeerClosedBetweenFrames) {
+    WSCFrameReader reader(1024, 1024);
+    Wire wire{serverFrame(kText, "last")};
+    expectFrame(wire, reader, kText, "last");
+    EXPECT_EQ(wire.fill(reader), 0);
+    EXPECT_EQ(reader.buffered(), 0u);
+
+    Wire cut{serverFrame(kText, "cut short").substr(0, 5)};
+    WSCFrameReader::Frame frame{};
+    EXPECT_EQ(cut.next(reader, frame), WSCFrameReader::Parse::NEED_MORE);
+    EXPECT_EQ(reader.buffered(), 5u);
+}
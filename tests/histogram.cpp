@@ -0,0 +1,120 @@
+// WSCHistogram: bucket boundaries, the relative error bound and the summary values
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "WSCHistogram.h"
+
+using Histogram = WSCHistogram<>;
+
+TEST(Histogram, SmallValuesAreExact) {
+    for (uint64_t value = 0; value < Histogram::kSubBucketCount; value++) {
+        const size_t index = Histogram::indexOf(value);
+        EXPECT_EQ(Histogram::lowestEquivalentValue(index), value);
+        EXPECT_EQ(Histogram::highestEquivalentValue(index), value);
+    }
+}
+
+TEST(Histogram, BucketsCoverEveryValueWithinTheErrorBound) {
+    // 2^-(SubBucketBits - 1) with the default 7 bits
+    const double bound = 1.0 / 64;
+    std::vector<uint64_t> values;
+    for (uint64_t value = 1; value < (uint64_t{1} << 40); value = value * 3 / 2 + 1) {
+        values.push_back(value - 1);
+        values.push_back(value);
+        if (value < Histogram::kMaxValue) values.push_back(value + 1);
+    }
+    values.push_back(Histogram::kMaxValue);
+    for (uint64_t value : values) {
+        SCOPED_TRACE(value);
+        const size_t index = Histogram::indexOf(value);
+        ASSERT_LT(index, Histogram::kBucketCount);
+        const uint64_t low = Histogram::lowestEquivalentValue(index);
+        const uint64_t high = Histogram::highestEquivalentValue(index);
+        EXPECT_LE(low, value);
+        EXPECT_GE(high, value);
+        EXPECT_LE(static_cast<double>(high - low), bound * static_cast<double>(value) + 1);
+        // the next bucket starts right after this one
+        if (index + 1 < Histogram::kBucketCount) {
+            EXPECT_EQ(Histogram::lowestEquivalentValue(index + 1), high + 1);
+        }
+    }
+}
+
+TEST(Histogram, EmptySnapshotIsAllZero) {
+    Histogram histogram;
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 0u);
+    EXPECT_EQ(snapshot.min, 0u);
+    EXPECT_EQ(snapshot.max, 0u);
+    EXPECT_EQ(snapshot.mean(), 0.0);
+    EXPECT_EQ(snapshot.percentile(99), 0u);
+}
+
+TEST(Histogram, PercentilesOfAUniformRange) {
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 100000; value++) histogram.record(value);
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 100000u);
+    EXPECT_EQ(snapshot.min, 1u);
+    EXPECT_EQ(snapshot.max, 100000u);
+    EXPECT_DOUBLE_EQ(snapshot.mean(), 50000.5);
+    for (double p : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+        SCOPED_TRACE(p);
+        const double exact = p * 1000;
+        const double reported = static_cast<double>(snapshot.percentile(p));
+        EXPECT_GE(reported, exact);
+        EXPECT_LE(reported, exact * (1 + 1.0 / 64) + 1);
+    }
+    EXPECT_EQ(snapshot.percentile(100), 100000u);
+    EXPECT_EQ(snapshot.percentile(0), snapshot.percentile(0.0001));
+}
+
+TEST(Histogram, PercentileNeverExceedsTheMaximum) {
+    Histogram histogram;
+    histogram.record(1000);
+    // 1000 shares its bucket with larger values, the maximum caps the report
+    EXPECT_EQ(histogram.percentile(50), 1000u);
+    EXPECT_EQ(histogram.percentile(100), 1000u);
+}
+
+TEST(Histogram, ValuesAboveTheRangeAreClamped) {
+    WSCHistogram<7, 20> histogram;
+    histogram.record(uint64_t{1} << 30);
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.max, (uint64_t{1} << 20) - 1);
+    EXPECT_EQ(snapshot.count, 1u);
+}
+
+TEST(Histogram, RecordTimesAndReset) {
+    Histogram histogram;
+    histogram.record(10, 5);
+    histogram.record(20);
+    EXPECT_EQ(histogram.count(), 6u);
+    EXPECT_EQ(histogram.snapshot().sum, 70u);
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0u);
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 0u);
+    EXPECT_EQ(snapshot.min, 0u);
+    histogram.record(7);
+    EXPECT_EQ(histogram.snapshot().min, 7u);
+}
+
+TEST(Histogram, ConcurrentRecords) {
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&histogram, t] {
+            for (uint64_t i = 0; i < 50000; i++) histogram.record(i + 1 + t * 50000);
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 200000u);
+    EXPECT_EQ(snapshot.min, 1u);
+    EXPECT_EQ(snapshot.max, 200000u);
+    EXPECT_EQ(snapshot.sum, uint64_t{200000} * 200001 / 2);
+}
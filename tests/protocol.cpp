@@ -0,0 +1,93 @@
+// WSCProtocol: reassembly of fragmented messages, control frames between fragments, CLOSE
+// payloads and the frames RFC 6455 does not allow
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WSCProtocol.h"
+
+namespace {
+    using Result = WSCProtocol::Result;
+
+    constexpr int kFin = WSCMessageType::FIN;
+
+    // Everything the protocol hands out, in order
+    struct Recorder {
+        std::vector<std::string> events;
+
+        void onMessage(const WSCMessageView &message) {
+            events.push_back((message.type == WSCMessageType::TEXT ? "text " : "binary ") +
+                             std::string(message.text()));
+        }
+        void onPing(std::string_view payload) { events.push_back("ping " + std::string(payload)); }
+        void onPong(std::string_view payload) { events.push_back("pong " + std::string(payload)); }
+        void onClose(uint16_t code, std::string_view reason) {
+            events.push_back("close " + std::to_string(code) + " " + std::string(reason));
+        }
+    };
+
+    Result handle(WSCProtocol &protocol, Recorder &recorder, int flags, std::string_view payload) {
+        return protocol.handle(flags, payload.data(), payload.size(), recorder);
+    }
+}  // namespace
+
+TEST(Protocol, WholeMessages) {
+    WSCProtocol protocol;
+    Recorder recorder;
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::TEXT, "one"), Result::OK);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::BINARY, "two"), Result::OK);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::TEXT, ""), Result::OK);
+    EXPECT_EQ(recorder.events, (std::vector<std::string>{"text one", "binary two", "text "}));
+}
+
+TEST(Protocol, ReassemblesFragmentsAroundControlFrames) {
+    WSCProtocol protocol;
+    Recorder recorder;
+    EXPECT_EQ(handle(protocol, recorder, WSCMessageType::TEXT, "frag"), Result::OK);
+    EXPECT_TRUE(protocol.fragmented());
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::PING, "p"), Result::OK);
+    EXPECT_EQ(handle(protocol, recorder, WSCMessageType::CONTINUATION, "men"), Result::OK);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::CONTINUATION, "ted"),
+              Result::OK);
+    EXPECT_FALSE(protocol.fragmented());
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::TEXT, "next"), Result::OK);
+    EXPECT_EQ(recorder.events,
+              (std::vector<std::string>{"ping p", "text fragmented", "text next"}));
+}
+
+TEST(Protocol, ClosePayloads) {
+    WSCProtocol protocol;
+    Recorder recorder;
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::CLOSE, "\x03\xE8going away"),
+              Result::CLOSED);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::CLOSE, ""), Result::CLOSED);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::CLOSE, "\x03"), Result::INVALID);
+    EXPECT_EQ(recorder.events, (std::vector<std::string>{"close 1000 going away", "close 1005 "}));
+}
+
+TEST(Protocol, RejectsFramesOutOfOrder) {
+    WSCProtocol protocol;
+    Recorder recorder;
+    // a continuation without a message, a message inside another one
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::CONTINUATION, "x"),
+              Result::INVALID);
+    EXPECT_EQ(handle(protocol, recorder, WSCMessageType::BINARY, "a"), Result::OK);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::TEXT, "b"), Result::INVALID);
+    // a new connection starts clean
+    protocol.reset();
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::TEXT, "c"), Result::OK);
+    EXPECT_EQ(recorder.events, std::vector<std::string>{"text c"});
+}
+
+TEST(Protocol, RejectsMalformedControlFrames) {
+    WSCProtocol protocol;
+    Recorder recorder;
+    EXPECT_EQ(handle(protocol, recorder, WSCMessageType::PING, "unfinished"), Result::INVALID);
+    EXPECT_EQ(handle(protocol, recorder, kFin | WSCMessageType::PONG, std::string(126, 'x')),
+              Result::INVALID);
+    EXPECT_EQ(handle(protocol, recorder, kFin | 0x3, ""), Result::INVALID);
+    EXPECT_STREQ(protocol.error(), "Unknown opcode");
+    EXPECT_TRUE(recorder.events.empty());
+}
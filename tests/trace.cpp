@@ -0,0 +1,51 @@
+// WSCTrace: thread buffers, scopes that began while tracing was off and snapshots taken
+// while the owning thread keeps recording
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "WSCTrace.h"
+
+TEST(Trace, ScopeKeepsTheFlagItBeganWith) {
+    WSCTrace::setEnabled(false);
+    {
+        WSCTrace::Scope scope("off");
+        WSCTrace::setEnabled(true);
+    }
+    {
+        WSCTrace::Scope scope("on");
+        WSCTrace::setEnabled(false);
+    }
+    const std::string json = WSCTrace::toJson();
+    EXPECT_EQ(json.find("\"off\""), std::string::npos);
+    EXPECT_NE(json.find("\"on\""), std::string::npos);
+}
+
+TEST(Trace, SnapshotWhileRecording) {
+    constexpr size_t kCapacity = WSCTrace::ThreadBuffer::kCapacity;
+    WSCTrace::ThreadBuffer buffer;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        // bytes numbers the events, every snapshot has to be one unbroken run of them
+        for (uint64_t i = 0; i < 50 * kCapacity; i++) {
+            buffer.record(WSCTrace::Event{"e", 0, -1, 0, i});
+        }
+        done = true;
+    });
+    int snapshots = 0;
+    while (!done || snapshots == 0) {
+        const auto events = buffer.snapshot();
+        snapshots++;
+        ASSERT_LT(events.size(), kCapacity);
+        for (size_t i = 1; i < events.size(); i++) {
+            ASSERT_EQ(events[i].bytes, events[i - 1].bytes + 1) << "snapshot " << snapshots;
+        }
+    }
+    writer.join();
+    const auto events = buffer.snapshot();
+    // all but the slot the next event goes to
+    ASSERT_EQ(events.size(), kCapacity - 1);
+    EXPECT_EQ(events.back().bytes, 50 * kCapacity - 1);
+}
@@ -0,0 +1,156 @@
+// WSCUringTransport::connect() against a server that floods right after its 101 response:
+// the frames that arrived with the response, those queued in the socket and those still
+// coming all come out once and in order
+#include <gtest/gtest.h>
+
+#include <Poco/Base64Encoder.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/SHA1Engine.h>
+
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "uring.h"
+
+namespace {
+    constexpr uint64_t kFrames = 30000;
+    constexpr size_t kPayload = 100;  // a 102 byte frame, 3MB in all
+    constexpr uint64_t kFirstWrite = 640;  // sent with the response
+
+    std::string acceptKey(const std::string &key) {
+        Poco::SHA1Engine sha1;
+        sha1.update(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+        const auto digest = sha1.digest();
+        std::ostringstream out;
+        Poco::Base64Encoder base64(out);
+        base64.write(reinterpret_cast<const char *>(digest.data()),
+                     static_cast<std::streamsize>(digest.size()));
+        base64.close();
+        return out.str();
+    }
+
+    void sendAll(Poco::Net::StreamSocket &socket, const std::string &bytes) {
+        size_t sent = 0;
+        while (sent < bytes.size()) {
+            const int n = socket.sendBytes(bytes.data() + sent,
+                                           static_cast<int>(bytes.size() - sent));
+            if (n <= 0) throw std::runtime_error("send failed");
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // Binary frames carrying their sequence number
+    std::string frames(uint64_t first, uint64_t count) {
+        std::string bytes;
+        for (uint64_t i = first; i < first + count; i++) {
+            char payload[kPayload] = {};
+            std::memcpy(payload, &i, sizeof(i));
+            bytes += static_cast<char>(0x82);
+            bytes += static_cast<char>(kPayload);
+            bytes.append(payload, kPayload);
+        }
+        return bytes;
+    }
+
+    // Answers one handshake and sends the first frames in the same write, the rest right after
+    class FloodServer {
+       public:
+        FloodServer()
+            : m_socket(Poco::Net::SocketAddress("127.0.0.1", 0)),
+              m_thread([this] { run(); }) {}
+
+        ~FloodServer() { m_thread.join(); }
+
+        uint16_t port() const { return m_socket.address().port(); }
+
+       private:
+        void run() {
+            Poco::Net::StreamSocket peer = m_socket.acceptConnection();
+            peer.setReceiveTimeout(Poco::Timespan(30, 0));
+            std::string request;
+            char buffer[4096];
+            while (request.find("\r\n\r\n") == std::string::npos) {
+                const int n = peer.receiveBytes(buffer, sizeof(buffer));
+                if (n <= 0) return;
+                request.append(buffer, static_cast<size_t>(n));
+            }
+            const std::string name = "Sec-WebSocket-Key: ";
+            const size_t begin = request.find(name) + name.size();
+            const std::string key = request.substr(begin, request.find("\r\n", begin) - begin);
+            sendAll(peer, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                          "Connection: Upgrade\r\nSec-WebSocket-Accept: " +
+                              acceptKey(key) + "\r\n\r\n" + frames(0, kFirstWrite));
+            for (uint64_t first = kFirstWrite; first < kFrames; first += 1000) {
+                sendAll(peer, frames(first, std::min<uint64_t>(1000, kFrames - first)));
+            }
+            // until the client closed
+            try {
+                while (peer.receiveBytes(buffer, sizeof(buffer)) > 0) {
+                }
+            } catch (const Poco::Exception &) {
+            }
+        }
+
+        Poco::Net::ServerSocket m_socket;
+        std::thread m_thread;
+    };
+}  // namespace
+
+TEST(UringConnect, FloodRightAfterTheHandshake) {
+    WSCUringReactor::Config config;
+    // a read-ahead buffer smaller than what the handshake reads past the response
+    config.receiveBufferSize = 1024;
+    WSCUringReactor reactor(config);
+    if (!reactor.available()) GTEST_SKIP() << reactor.unavailableReason();
+
+    FloodServer server;
+    WSCUringTransport transport(reactor);
+    const Poco::Timespan timeout(10, 0);
+    WSCTransport::Options options{"127.0.0.1", server.port(), false, timeout,  timeout,
+                                  timeout,     1024 * 1024,   64 * 1024, 64 * 1024, 1024,
+                                  {},          nullptr,       nullptr};
+    Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, "/flood",
+                                   Poco::Net::HTTPMessage::HTTP_1_1);
+    request.set("Upgrade", "websocket");
+    request.set("Connection", "Upgrade");
+    request.set("Sec-WebSocket-Version", "13");
+    Poco::Net::HTTPResponse response;
+
+    // returns once the bytes read with the response are taken, whatever queues behind them
+    auto connected = std::async(std::launch::async, [&] {
+        transport.connect(options, request, response);
+    });
+    ASSERT_EQ(connected.wait_for(std::chrono::seconds(10)), std::future_status::ready)
+        << "connect() hangs";
+    connected.get();
+    ASSERT_EQ(response.getStatus(), Poco::Net::HTTPResponse::HTTP_SWITCHING_PROTOCOLS);
+    EXPECT_TRUE(transport.onRing());
+
+    uint64_t next = 0;
+    std::vector<WSCTransport::FrameView> received;
+    std::string error;
+    while (next < kFrames) {
+        ASSERT_EQ(transport.waitReadable(timeout), WSCTransport::Wait::READABLE)
+            << "stalled after " << next << " frames";
+        received.clear();
+        const auto status = transport.receiveBatch(received, error);
+        ASSERT_NE(status, WSCTransport::Receive::FAILED) << error;
+        ASSERT_NE(status, WSCTransport::Receive::CLOSED) << "after " << next << " frames";
+        for (const auto &frame : received) {
+            ASSERT_EQ(frame.length, kPayload);
+            uint64_t sequence;
+            std::memcpy(&sequence, frame.payload, sizeof(sequence));
+            ASSERT_EQ(sequence, next);
+            next++;
+        }
+    }
+    transport.close();
+}
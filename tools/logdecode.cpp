@@ -0,0 +1,61 @@
+// WSCLogDecode: converts a binary log written by WSCLogger::initBinary into text.
+// Usage: WSCLogDecode <file.wscb> [min level]
+#include <spdlog/common.h>
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "WSCBinaryLog.h"
+
+namespace {
+    // Same layout as the text logger pattern, with microseconds
+    void print(const WSCBinaryLog::Entry &entry) {
+        const auto level = static_cast<spdlog::level::level_enum>(entry.site->level);
+        const auto seconds = std::chrono::time_point_cast<std::chrono::seconds>(entry.time);
+        const auto micros =
+            std::chrono::duration_cast<std::chrono::microseconds>(entry.time - seconds).count();
+        const std::time_t time = std::chrono::system_clock::to_time_t(seconds);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local);
+        std::cout << fmt::format("[{}] [{}.{:06}] [thread {}] [{}:{}] {}\n",
+                                 spdlog::level::to_short_c_str(level), date, micros,
+                                 entry.threadId, entry.site->file, entry.site->line,
+                                 entry.message);
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file.wscb> [trace|debug|info|warning|error]\n";
+        return 1;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << argv[1] << '\n';
+        return 1;
+    }
+    const auto minLevel = argc > 2 ? spdlog::level::from_str(argv[2]) : spdlog::level::trace;
+
+    WSCBinaryLog::Decoder decoder(file);
+    if (!decoder.open()) {
+        std::cerr << argv[1] << " is not a WSCpp binary log\n";
+        return 1;
+    }
+    while (auto entry = decoder.next()) {
+        if (entry->site->level >= minLevel) print(*entry);
+    }
+    if (!decoder.error().empty()) {
+        std::cerr << decoder.error() << '\n';
+        return 1;
+    }
+    return 0;
+}